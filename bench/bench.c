@@ -0,0 +1,298 @@
+// Microbenchmarks dos formatadores (make bench)
+//
+// Gera corpora sinteticos deterministicos em varios tamanhos, formata cada um
+// com cores ligadas e desligadas (saida em /dev/null) e grava os resultados
+// em JSON. Com --baseline, compara com um resultado anterior.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "output.h"
+#include "strbuf.h"
+#include "json_dom.h"
+#include "corpus.h"
+#include "formatters/formatters.h"
+
+#define BENCH_MIN_TIME  0.3     // segundos de medicao por caso
+#define BENCH_MIN_RUNS  3
+#define BENCH_MAX_RUNS  1000
+
+// Arvore JSON: parser incremental (--diff) e documento inteiro (--sort-keys)
+static void json_dom_feed_all(const char *data) {
+    JsonDom *dom = json_dom_new(NULL);
+    if (dom && json_dom_feed(dom, data, strlen(data)) == 0) json_dom_finish(dom);
+    json_dom_free(dom);
+}
+
+static void json_dom_parse_all(const char *data) {
+    JsonDom *dom = json_dom_new(NULL);
+    if (dom) json_dom_parse(dom, data, strlen(data), JSON_DOM_NO_HASH);
+    json_dom_free(dom);
+}
+
+// Strings com --unicode: escapes decodificados e UTF-8 validado
+static void format_json_unicode(const char *data) {
+    json_unicode = 1;
+    format_json(data);
+    json_unicode = 0;
+}
+
+// --select: so os links da pagina, o resto apenas tokenizado
+static void format_html_select(const char *data) {
+    char error[128];
+    HtmlSelector *sel = html_selector_parse("a::attr(href)", error, sizeof(error));
+    Formatter *f = sel ? html_select_formatter_new(sel) : NULL;
+    if (f) {
+        formatter_feed(f, data, strlen(data));
+        formatter_finish(f);
+    }
+    html_selector_free(sel);
+}
+
+typedef struct {
+    const char *name;       // corpus
+    const char *function;
+    void (*format)(const char *data);
+} BenchCase;
+
+static const BenchCase cases[] = {
+    { "json_nested",  "format_json",   format_json },
+    { "json_wide",    "format_json",   format_json },
+    { "json_strings", "format_json",   format_json },
+    { "json_nested",  "format_json_unicode", format_json_unicode },
+    { "json_strings", "format_json_unicode", format_json_unicode },
+    { "json_nested",  "json_dom_feed", json_dom_feed_all },
+    { "json_nested",  "json_dom_parse", json_dom_parse_all },
+    { "xml_sitemap",  "format_xml",    format_xml },
+    { "html_page",    "format_html",   format_html },
+    { "html_page",    "format_html_select", format_html_select },
+    { "headers",      "print_headers", print_headers },
+};
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+static const size_t sizes[] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+#define SIZE_COUNT (sizeof(sizes) / sizeof(sizes[0]))
+
+// Medicao -----------------------------------------------------------------
+
+typedef struct {
+    const BenchCase *c;
+    size_t size;
+    int color;
+    size_t bytes;
+    int runs;
+    double best_ns;
+    double median_ns;
+} BenchResult;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void measure(BenchResult *r, const char *data) {
+    static double samples[BENCH_MAX_RUNS];
+    double total = 0;
+    int runs = 0;
+
+    colors_enabled = r->color;
+    while (runs < BENCH_MAX_RUNS && (runs < BENCH_MIN_RUNS || total < BENCH_MIN_TIME * 1e9)) {
+        double t0 = now_ns();
+        r->c->format(data);
+        out_flush();
+        samples[runs] = now_ns() - t0;
+        total += samples[runs++];
+    }
+
+    qsort(samples, runs, sizeof(double), compare_double);
+    r->runs = runs;
+    r->best_ns = samples[0];
+    r->median_ns = samples[runs / 2];
+}
+
+static double mb_per_s(const BenchResult *r) {
+    return (double)r->bytes / (1024.0 * 1024.0) / (r->best_ns / 1e9);
+}
+
+// Baseline ----------------------------------------------------------------
+
+static const JsonNode* field(const JsonNode *obj, const char *key) {
+    if (!obj || obj->type != JSON_OBJECT) return NULL;
+    size_t n = strlen(key);
+    for (uint32_t i = 0; i < obj->len; i++) {
+        const JsonNode *c = &obj->as.children[i];
+        if (c->key_len == n && memcmp(c->key, key, n) == 0) return c;
+    }
+    return NULL;
+}
+
+static int field_is(const JsonNode *obj, const char *key, const char *value) {
+    const JsonNode *f = field(obj, key);
+    return f && f->type == JSON_STRING && f->len == strlen(value) && memcmp(f->as.text, value, f->len) == 0;
+}
+
+static double field_number(const JsonNode *obj, const char *key) {
+    const JsonNode *f = field(obj, key);
+    return f && f->type == JSON_NUMBER ? strtod(f->as.text, NULL) : 0;
+}
+
+static JsonDom* load_baseline(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: cannot open baseline %s\n", path);
+        return NULL;
+    }
+
+    JsonDom *dom = json_dom_new(NULL);
+    char buf[65536];
+    size_t n;
+    while (dom && (n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        json_dom_feed(dom, buf, n);
+    }
+    fclose(fp);
+
+    if (!dom || json_dom_finish(dom) != 0 || !json_dom_root(dom)) {
+        fprintf(stderr, "Error: invalid baseline %s\n", path);
+        json_dom_free(dom);
+        return NULL;
+    }
+    return dom;
+}
+
+// Throughput do mesmo caso no baseline, ou 0
+static double baseline_mb_per_s(const JsonDom *dom, const BenchResult *r) {
+    const JsonNode *results = field(json_dom_root(dom), "results");
+    if (!results || results->type != JSON_ARRAY) return 0;
+
+    for (uint32_t i = 0; i < results->len; i++) {
+        const JsonNode *e = &results->as.children[i];
+        if (field_is(e, "corpus", r->c->name) && field_is(e, "function", r->c->function) &&
+            (size_t)field_number(e, "size") == r->size &&
+            field(e, "color") && field(e, "color")->type == (r->color ? JSON_TRUE : JSON_FALSE)) {
+            return field_number(e, "mb_per_s");
+        }
+    }
+    return 0;
+}
+
+// Saida -------------------------------------------------------------------
+
+static void write_results(FILE *fp, const char *label, const BenchResult *results, size_t count) {
+    char date[32];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+    StrBuf sb = {0};
+    strbuf_json_string(&sb, label, strlen(label));
+
+    fprintf(fp, "{\n  \"label\": %s,\n  \"date\": \"%s\",\n  \"results\": [\n", sb.data, date);
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(fp, "    {\"function\": \"%s\", \"corpus\": \"%s\", \"size\": %zu, \"color\": %s, "
+                    "\"bytes\": %zu, \"runs\": %d, \"best_ns\": %.0f, \"median_ns\": %.0f, "
+                    "\"mb_per_s\": %.2f, \"ns_per_byte\": %.3f}%s\n",
+                r->c->function, r->c->name, r->size, r->color ? "true" : "false",
+                r->bytes, r->runs, r->best_ns, r->median_ns,
+                mb_per_s(r), r->best_ns / (double)r->bytes, i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    strbuf_free(&sb);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--out FILE] [--label TEXT] [--baseline FILE] [--quick]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *out_path = NULL;
+    const char *label = "";
+    const char *baseline_path = NULL;
+    size_t size_count = SIZE_COUNT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            size_count = SIZE_COUNT - 1;    // sem o corpus de 16 MiB
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    JsonDom *baseline = NULL;
+    if (baseline_path && !(baseline = load_baseline(baseline_path))) {
+        return 1;
+    }
+
+    // A saida formatada vai para /dev/null; os resultados para stderr e --out
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull < 0 || dup2(devnull, STDOUT_FILENO) < 0) {
+        perror("/dev/null");
+        return 1;
+    }
+    close(devnull);
+    out_init();
+
+    BenchResult results[CASE_COUNT * SIZE_COUNT * 2];
+    size_t count = 0;
+
+    fprintf(stderr, "%-14s %-13s %9s %6s %10s %9s%s\n", "function", "corpus", "size", "color",
+            "MB/s", "ns/byte", baseline ? "  vs baseline" : "");
+
+    for (size_t c = 0; c < CASE_COUNT; c++) {
+        for (size_t s = 0; s < size_count; s++) {
+            StrBuf corpus = {0};
+            corpus_generate(corpus_find(cases[c].name), &corpus, sizes[s]);
+
+            for (int color = 1; color >= 0; color--) {
+                BenchResult *r = &results[count++];
+                memset(r, 0, sizeof(*r));
+                r->c = &cases[c];
+                r->size = sizes[s];
+                r->color = color;
+                r->bytes = corpus.len;
+                measure(r, corpus.data);
+
+                fprintf(stderr, "%-14s %-13s %6zu KiB %6s %10.1f %9.3f", r->c->function, r->c->name,
+                        r->size / 1024, color ? "on" : "off", mb_per_s(r), r->best_ns / (double)r->bytes);
+                if (baseline) {
+                    double old = baseline_mb_per_s(baseline, r);
+                    if (old > 0) fprintf(stderr, "  %+6.1f%%", (mb_per_s(r) / old - 1) * 100);
+                    else fprintf(stderr, "  %7s", "new");
+                }
+                fputc('\n', stderr);
+            }
+            strbuf_free(&corpus);
+        }
+    }
+
+    if (out_path) {
+        FILE *fp = fopen(out_path, "w");
+        if (!fp) {
+            perror(out_path);
+            return 1;
+        }
+        write_results(fp, label, results, count);
+        fclose(fp);
+        fprintf(stderr, "\nResults written to %s\n", out_path);
+    } else {
+        write_results(stderr, label, results, count);
+    }
+
+    json_dom_free(baseline);
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Corpora sinteticos deterministicos: a mesma semente gera sempre os mesmos
+// bytes, entao os resultados de commits diferentes sao comparaveis
+
+#include "corpus.h"
+#include <string.h>
+
+// Gerador pseudoaleatorio com semente fixa: os corpora sao sempre iguais
+static unsigned long long rng_state;
+
+static void rng_seed(unsigned long long seed) {
+    rng_state = seed;
+}
+
+// xorshift64*; cada chamada e um comando separado, porque a ordem de
+// avaliacao dos argumentos de uma funcao nao e definida em C
+static unsigned rng(unsigned n) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (unsigned)(((rng_state * 0x2545F4914F6CDD1DULL) >> 32) % n);
+}
+
+static const char *words[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+    "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa",
+    "s\xc3\xa3o", "caf\xc3\xa9", "na\xc3\xafve", "\xe6\x97\xa5\xe6\x9c\xac"
+};
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+static void put_words(StrBuf *sb, int n) {
+    for (int i = 0; i < n; i++) {
+        if (i > 0) strbuf_putc(sb, ' ');
+        strbuf_puts(sb, words[rng(WORD_COUNT)]);
+    }
+}
+
+// Corpus nao depende da ordem de avaliacao: sorteia em sequencia
+static void draw(unsigned *v, const unsigned *ranges, int n) {
+    for (int i = 0; i < n; i++) v[i] = rng(ranges[i]);
+}
+
+// Geradores ---------------------------------------------------------------
+
+// Objetos aninhados 24 niveis, com campos escalares em cada nivel
+static void gen_json_nested(StrBuf *sb, size_t size) {
+    strbuf_putc(sb, '[');
+    for (int n = 0; sb->len < size; n++) {
+        if (n > 0) strbuf_putc(sb, ',');
+        for (int d = 0; d < 24; d++) {
+            strbuf_printf(sb, "{\"id\":%d,\"level\":%d,\"child\":", n, d);
+        }
+        strbuf_puts(sb, "null");
+        for (int d = 0; d < 24; d++) strbuf_putc(sb, '}');
+    }
+    strbuf_putc(sb, ']');
+}
+
+// Array largo de registros planos, como a resposta tipica de uma API
+static void gen_json_wide(StrBuf *sb, size_t size) {
+    strbuf_putc(sb, '[');
+    for (int n = 0; sb->len < size; n++) {
+        if (n > 0) strbuf_putc(sb, ',');
+        static const unsigned ranges[] = { 1u << 31, 65536, 65536, 10000, 100, 500, 2, 9, 10, 3,
+                                           WORD_COUNT, WORD_COUNT, 12, 28 };
+        unsigned v[14];
+        draw(v, ranges, 3);
+        strbuf_printf(sb, "{\"id\":%d,\"uuid\":\"%08x-%04x-%04x\",\"name\":\"", n, v[0], v[1], v[2]);
+        put_words(sb, 2);
+        draw(v + 3, ranges + 3, 11);
+        strbuf_printf(sb, "\",\"price\":%u.%02u,\"stock\":%u,\"active\":%s,\"rating\":%u.%ue-%u,"
+                      "\"tags\":[\"%s\",\"%s\"],\"parent\":null,\"created\":\"2024-%02u-%02uT12:00:00Z\"}",
+                      v[3], v[4], v[5], v[6] ? "true" : "false", v[7] + 1, v[8], v[9],
+                      words[v[10]], words[v[11]], v[12] + 1, v[13] + 1);
+    }
+    strbuf_putc(sb, ']');
+}
+
+// Strings longas com escapes e UTF-8
+static void gen_json_strings(StrBuf *sb, size_t size) {
+    strbuf_putc(sb, '[');
+    for (int n = 0; sb->len < size; n++) {
+        if (n > 0) strbuf_putc(sb, ',');
+        strbuf_puts(sb, "{\"text\":\"");
+        int words_n = 100 + rng(1000);
+        for (int i = 0; i < words_n; i++) {
+            strbuf_puts(sb, words[rng(WORD_COUNT)]);
+            switch (rng(16)) {
+                case 0: strbuf_puts(sb, "\\n"); break;
+                case 1: strbuf_puts(sb, "\\\"quoted\\\" "); break;
+                case 2: strbuf_puts(sb, "\\u00e9 "); break;
+                default: strbuf_putc(sb, ' ');
+            }
+        }
+        strbuf_puts(sb, "\"}");
+    }
+    strbuf_putc(sb, ']');
+}
+
+static void gen_xml_sitemap(StrBuf *sb, size_t size) {
+    strbuf_puts(sb, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    "<urlset xmlns=\"http://www.sitemaps.org/schemas/sitemap/0.9\">\n");
+    for (int n = 0; sb->len < size; n++) {
+        static const unsigned ranges[] = { 16, 16, 12, 28, 2, 10 };
+        unsigned v[6];
+        draw(v, ranges, 6);
+        strbuf_printf(sb, "<url><loc>https://www.example.com/%s/%s-%d.html</loc>"
+                      "<lastmod>2024-%02u-%02u</lastmod><changefreq>%s</changefreq>"
+                      "<priority>0.%u</priority></url>\n",
+                      words[v[0]], words[v[1]], n, v[2] + 1, v[3] + 1,
+                      v[4] ? "daily" : "weekly", v[5]);
+    }
+    strbuf_puts(sb, "</urlset>\n");
+}
+
+// Pagina com a cara de uma pagina real: head pesado, navegacao, artigos,
+// tabelas, comentarios, script e style inline
+static void gen_html_page(StrBuf *sb, size_t size) {
+    strbuf_puts(sb, "<!DOCTYPE html>\n<html lang=\"en\"><head><meta charset=\"utf-8\">"
+                    "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">"
+                    "<title>Example store</title><link rel=\"stylesheet\" href=\"/css/main.css\">"
+                    "<style>body{margin:0;font-family:sans-serif}.card{padding:8px}</style>"
+                    "<script>window.dataLayer=window.dataLayer||[];function gtag(){dataLayer.push(arguments)}</script>"
+                    "</head>\n<body class=\"home\"><nav><ul>");
+    for (int i = 0; i < 8; i++) {
+        strbuf_printf(sb, "<li><a href=\"/%s\">%s</a></li>", words[i], words[i]);
+    }
+    strbuf_puts(sb, "</ul></nav>\n<main>");
+
+    for (int n = 0; sb->len < size; n++) {
+        strbuf_printf(sb, "<!-- card %d -->\n<article class=\"card\" id=\"item-%d\" data-rank=\"%u\">"
+                      "<h2><a href=\"/p/%d\">", n, n, rng(100), n);
+        put_words(sb, 3);
+        strbuf_puts(sb, "</a></h2><p>");
+        put_words(sb, 20 + rng(40));
+        strbuf_puts(sb, " <strong>");
+        put_words(sb, 2);
+        strbuf_puts(sb, "</strong> &amp; more<br></p><img src=\"/img/a.jpg\" alt=\"\" loading=\"lazy\">");
+        if (n % 10 == 0) {
+            strbuf_puts(sb, "<table><tr><th>Size</th><th>Price</th></tr>");
+            for (int r = 0; r < 4; r++) {
+                const char *size_name = words[rng(16)];
+                strbuf_printf(sb, "<tr><td>%s</td><td>%u.99</td></tr>", size_name, rng(100));
+            }
+            strbuf_puts(sb, "</table>");
+        }
+        strbuf_puts(sb, "</article>\n");
+    }
+    strbuf_puts(sb, "</main><footer><p>&copy; Example</p></footer></body></html>\n");
+}
+
+// Blocos de headers de respostas (cadeias de redirect inclusas)
+static void gen_headers(StrBuf *sb, size_t size) {
+    for (int n = 0; sb->len < size; n++) {
+        strbuf_printf(sb, "HTTP/1.1 %s\r\n", n % 4 == 0 ? "301 Moved Permanently" : "200 OK");
+        strbuf_puts(sb, "Date: Mon, 01 Jan 2024 12:00:00 GMT\r\n"
+                        "Content-Type: application/json; charset=utf-8\r\n"
+                        "Cache-Control: public, max-age=3600\r\n");
+        static const unsigned ranges[] = { 100000, 1u << 31, 1u << 31 };
+        unsigned v[3];
+        draw(v, ranges, 3);
+        strbuf_printf(sb, "Content-Length: %u\r\nETag: \"%08x%08x\"\r\n", v[0], v[1], v[2]);
+        strbuf_printf(sb, "Set-Cookie: session=%08x; Path=/; HttpOnly; Secure\r\n", rng(1u << 31));
+        strbuf_puts(sb, "Strict-Transport-Security: max-age=63072000\r\nVary: Accept-Encoding\r\n"
+                        "X-Request-Id: 4f9d2a1c-8b7e-4c3d-9a2f-1e0d5c6b7a8f\r\n\r\n");
+    }
+}
+
+const Corpus corpora[] = {
+    { "json_nested",  "application/json", gen_json_nested },
+    { "json_wide",    "application/json", gen_json_wide },
+    { "json_strings", "application/json", gen_json_strings },
+    { "xml_sitemap",  "application/xml",  gen_xml_sitemap },
+    { "html_page",    "text/html",        gen_html_page },
+    { "headers",      "text/plain",       gen_headers },
+};
+const size_t corpus_count = sizeof(corpora) / sizeof(corpora[0]);
+
+const Corpus* corpus_find(const char *name) {
+    for (size_t i = 0; i < corpus_count; i++) {
+        if (strcmp(corpora[i].name, name) == 0) return &corpora[i];
+    }
+    return NULL;
+}
+
+void corpus_generate(const Corpus *c, StrBuf *sb, size_t size) {
+    rng_seed(0x2545F4914F6CDD1DULL + (unsigned long long)(c - corpora));
+    c->generate(sb, size);
+}
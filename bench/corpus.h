@@ -0,0 +1,23 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+#include "strbuf.h"
+
+// Entrada sintetica usada pelo bench e pelo servidor local
+typedef struct {
+    const char *name;
+    const char *content_type;
+    void (*generate)(StrBuf *sb, size_t size);
+} Corpus;
+
+extern const Corpus corpora[];
+extern const size_t corpus_count;
+
+// Corpus pelo nome, ou NULL
+const Corpus* corpus_find(const char *name);
+
+// Gera pelo menos size bytes (o ultimo registro e completado)
+void corpus_generate(const Corpus *c, StrBuf *sb, size_t size);
+
+#endif // CORPUS_H
@@ -0,0 +1,293 @@
+// Benchmark de ponta a ponta contra o servidor local (make bench-loopback)
+//
+// Sobe bin/curlser-server numa porta livre e executa o curlser em cada
+// cenario varias vezes, medindo requisicoes por segundo, MB/s do body,
+// tempo ate o primeiro byte de saida e pico de RSS. A saida do curlser e
+// lida de um pipe e descartada. Resultados em JSON, como no make bench.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "strbuf.h"
+#include "corpus.h"
+
+#define MAX_ARGS 16
+
+typedef struct {
+    const char *name;
+    const char *corpus;
+    size_t size;
+    const char *query;          // parametros extras do /payload
+    const char *args[4];        // opcoes extras do curlser
+    int runs;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    { "small_json",       "json_wide",   1024,             "",                   { NULL },             50 },
+    { "json_1m",          "json_wide",   1024 * 1024,      "",                   { NULL },             20 },
+    { "json_16m",         "json_wide",   16 * 1024 * 1024, "",                   { NULL },             3 },
+    { "json_16m_chunked", "json_wide",   16 * 1024 * 1024, "&chunked=1",         { NULL },             3 },
+    { "json_16m_gzip",    "json_wide",   16 * 1024 * 1024, "&gzip=1",            { "--compressed" },   3 },
+    { "json_16m_raw",     "json_wide",   16 * 1024 * 1024, "",                   { "-r" },             3 },
+    { "xml_4m",           "xml_sitemap", 4 * 1024 * 1024,  "",                   { NULL },             5 },
+    { "html_4m",          "html_page",   4 * 1024 * 1024,  "",                   { NULL },             5 },
+    { "delay_100ms",      "json_wide",   64 * 1024,        "&delay=100",         { NULL },             5 },
+    { "redirect_5",       "json_wide",   1024,             "&redirect=5",        { NULL },             20 },
+};
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+    const Scenario *s;
+    size_t body_bytes;          // tamanho do body sem compressao
+    int runs;
+    int failures;
+    double total_s;
+    double median_s;
+    double ttfo_ms;             // mediana do tempo ate o primeiro byte de saida
+    long max_rss_kb;
+} LoopbackResult;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Sobe o servidor e descobre a porta pela primeira linha que ele imprime
+static pid_t start_server(const char *path, int *port) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(path, path, "-p", "0", (char *)NULL);
+        perror(path);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    char line[128];
+    FILE *fp = fdopen(fds[0], "r");
+    if (pid < 0 || !fp || !fgets(line, sizeof(line), fp) ||
+        sscanf(line, "listening on 127.0.0.1:%d", port) != 1) {
+        if (pid > 0) kill(pid, SIGTERM);
+        if (fp) fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return pid;
+}
+
+// Executa o curlser uma vez; retorna o status de saida ou -1
+static int run_once(const char *curlser, const Scenario *s, const char *url,
+                    double *wall, double *ttfo, long *rss_kb) {
+    const char *argv[MAX_ARGS];
+    int argc = 0;
+    int fds[2];
+
+    argv[argc++] = curlser;
+    for (int i = 0; i < 4 && s->args[i]; i++) argv[argc++] = s->args[i];
+    argv[argc++] = url;
+    argv[argc] = NULL;
+
+    if (pipe(fds) != 0) return -1;
+
+    double t0 = now_s();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(fds[1], STDOUT_FILENO);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execv(curlser, (char *const *)argv);
+        _exit(127);
+    }
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    char buf[65536];
+    ssize_t n;
+    *ttfo = -1;
+    while ((n = read(fds[0], buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (*ttfo < 0) *ttfo = now_s() - t0;
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) return -1;
+    *wall = now_s() - t0;
+    *rss_kb = ru.ru_maxrss;
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void run_scenario(LoopbackResult *r, const char *curlser, int port, double scale) {
+    const Scenario *s = r->s;
+    StrBuf url = {0};
+    StrBuf body = {0};
+
+    strbuf_printf(&url, "http://127.0.0.1:%d/payload?type=%s&size=%zu%s", port, s->corpus, s->size, s->query);
+    corpus_generate(corpus_find(s->corpus), &body, s->size);
+    r->body_bytes = body.len;
+    strbuf_free(&body);
+
+    int runs = (int)(s->runs * scale);
+    if (runs < 1) runs = 1;
+
+    double *walls = calloc((size_t)runs, sizeof(double));
+    double *ttfos = calloc((size_t)runs, sizeof(double));
+
+    // Aquece o cache do servidor (o payload e gerado na primeira requisicao)
+    double wall, ttfo;
+    long rss;
+    run_once(curlser, s, url.data, &wall, &ttfo, &rss);
+
+    for (int i = 0; walls && ttfos && i < runs; i++) {
+        if (run_once(curlser, s, url.data, &wall, &ttfo, &rss) != 0) {
+            r->failures++;
+            continue;
+        }
+        walls[r->runs] = wall;
+        ttfos[r->runs] = ttfo < 0 ? wall : ttfo;
+        r->runs++;
+        r->total_s += wall;
+        if (rss > r->max_rss_kb) r->max_rss_kb = rss;
+    }
+
+    if (r->runs > 0) {
+        qsort(walls, (size_t)r->runs, sizeof(double), compare_double);
+        qsort(ttfos, (size_t)r->runs, sizeof(double), compare_double);
+        r->median_s = walls[r->runs / 2];
+        r->ttfo_ms = ttfos[r->runs / 2] * 1000;
+    }
+
+    free(walls);
+    free(ttfos);
+    strbuf_free(&url);
+}
+
+static double requests_per_s(const LoopbackResult *r) {
+    return r->total_s > 0 ? r->runs / r->total_s : 0;
+}
+
+static double mb_per_s(const LoopbackResult *r) {
+    return r->median_s > 0 ? (double)r->body_bytes / (1024.0 * 1024.0) / r->median_s : 0;
+}
+
+static void write_results(FILE *fp, const char *label, const LoopbackResult *results, size_t count) {
+    char date[32];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+    StrBuf sb = {0};
+    strbuf_json_string(&sb, label, strlen(label));
+
+    fprintf(fp, "{\n  \"label\": %s,\n  \"date\": \"%s\",\n  \"results\": [\n", sb.data, date);
+    for (size_t i = 0; i < count; i++) {
+        const LoopbackResult *r = &results[i];
+        fprintf(fp, "    {\"scenario\": \"%s\", \"body_bytes\": %zu, \"runs\": %d, \"failures\": %d, "
+                    "\"requests_per_s\": %.2f, \"mb_per_s\": %.2f, \"median_ms\": %.3f, "
+                    "\"ttfo_ms\": %.3f, \"max_rss_kb\": %ld}%s\n",
+                r->s->name, r->body_bytes, r->runs, r->failures, requests_per_s(r), mb_per_s(r),
+                r->median_s * 1000, r->ttfo_ms, r->max_rss_kb, i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    strbuf_free(&sb);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--curlser PATH] [--server PATH] [--out FILE] [--label TEXT] [--quick]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *curlser = "bin/curlser";
+    const char *server = "bin/curlser-server";
+    const char *out_path = NULL;
+    const char *label = "";
+    double scale = 1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--curlser") == 0 && i + 1 < argc) {
+            curlser = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            scale = 0.2;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int port;
+    pid_t server_pid = start_server(server, &port);
+    if (server_pid < 0) {
+        fprintf(stderr, "Error: could not start %s\n", server);
+        return 1;
+    }
+
+    LoopbackResult results[SCENARIO_COUNT];
+    int failed = 0;
+
+    fprintf(stderr, "%-18s %10s %8s %10s %10s %10s %10s\n", "scenario", "body", "runs",
+            "req/s", "MB/s", "ttfo ms", "rss KiB");
+
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        LoopbackResult *r = &results[i];
+        memset(r, 0, sizeof(*r));
+        r->s = &scenarios[i];
+        run_scenario(r, curlser, port, scale);
+
+        fprintf(stderr, "%-18s %10zu %8d %10.1f %10.1f %10.2f %10ld%s\n", r->s->name, r->body_bytes,
+                r->runs, requests_per_s(r), mb_per_s(r), r->ttfo_ms, r->max_rss_kb,
+                r->failures ? "  (failures)" : "");
+        failed |= r->failures > 0;
+    }
+
+    kill(server_pid, SIGTERM);
+    waitpid(server_pid, NULL, 0);
+
+    if (out_path) {
+        FILE *fp = fopen(out_path, "w");
+        if (!fp) {
+            perror(out_path);
+            return 1;
+        }
+        write_results(fp, label, results, SCENARIO_COUNT);
+        fclose(fp);
+        fprintf(stderr, "\nResults written to %s\n", out_path);
+    } else {
+        write_results(stderr, label, results, SCENARIO_COUNT);
+    }
+
+    return failed;
+}
@@ -0,0 +1,531 @@
+// Servidor HTTP/1.1 local para benchmarks e para o make test (bin/curlser-server)
+//
+// Escuta apenas em 127.0.0.1, uma thread por conexao, com keep-alive. Rotas:
+//
+//   /payload?type=T&size=N   corpus sintetico T (ver corpus.c; json, xml, html
+//                            e text sao atalhos) com pelo menos N bytes
+//       &chunked=1           Transfer-Encoding: chunked (blocos de &chunk=N)
+//       &gzip=1              gzip, se o cliente aceitar
+//       &delay=MS            espera antes dos headers
+//       &redirect=N          cadeia de N redirects 302 ate o payload
+//       &status=N            codigo de status da resposta final
+//   /events?count=N          text/event-stream com N eventos (JSON, texto em
+//                            varias linhas, comentarios); ids continuam do
+//                            Last-Event-ID e a conexao fecha no fim
+//       &interval=MS         espera entre eventos
+//       &retry=MS            envia "retry:" no primeiro evento
+//   /echo                    devolve o body da requisicao com o mesmo tipo
+//   /headers                 headers da requisicao como JSON
+//   /health                  "ok"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <zlib.h>
+#include "strbuf.h"
+#include "net.h"
+#include "corpus.h"
+
+#define REQUEST_MAX     (64 * 1024)     // linha de requisicao + headers
+#define BODY_MAX        (16 * 1024 * 1024)
+#define PAYLOAD_MAX     ((size_t)1 << 30)
+#define DEFAULT_CHUNK   16384
+
+// Payloads ja gerados, por corpus/tamanho/compressao
+typedef struct Payload {
+    const Corpus *corpus;
+    size_t size;
+    int gzip;
+    StrBuf data;
+    struct Payload *next;
+} Payload;
+
+static Payload *payloads = NULL;
+static pthread_mutex_t payloads_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    char method[16];
+    char path[2048];
+    char query[2048];
+    char content_type[256];
+    size_t content_length;
+    int accepts_gzip;
+    int close;
+    const char *headers;        // bloco de headers bruto
+    size_t headers_len;
+    long last_event_id;
+} Request;
+
+typedef struct {
+    const char *type;
+    size_t size;
+    int chunked;
+    size_t chunk;
+    int gzip;
+    long delay;
+    int redirect;
+    int status;
+} PayloadParams;
+
+// Utilitarios --------------------------------------------------------------
+
+static const char* reason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 302: return "Found";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        default:  return "Status";
+    }
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static int gzip_compress(const char *data, size_t len, StrBuf *out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return -1;
+    }
+
+    size_t cap = deflateBound(&zs, (uLong)len);
+    char *buf = malloc(cap + 1);
+    if (!buf) {
+        deflateEnd(&zs);
+        return -1;
+    }
+    strbuf_free(out);
+    out->data = buf;
+    out->cap = cap + 1;
+
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)len;
+    zs.next_out = (Bytef *)out->data;
+    zs.avail_out = (uInt)cap;
+    int rc = deflate(&zs, Z_FINISH);
+    out->len = zs.total_out;
+    out->data[out->len] = '\0';
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? 0 : -1;
+}
+
+// Gera ou reaproveita o payload pedido
+static const StrBuf* payload_get(const Corpus *corpus, size_t size, int gzip) {
+    pthread_mutex_lock(&payloads_lock);
+
+    Payload *p = payloads;
+    while (p && !(p->corpus == corpus && p->size == size && p->gzip == gzip)) p = p->next;
+
+    if (!p && (p = calloc(1, sizeof(Payload)))) {
+        p->corpus = corpus;
+        p->size = size;
+        p->gzip = gzip;
+        if (gzip) {
+            const StrBuf *plain = NULL;
+            pthread_mutex_unlock(&payloads_lock);
+            plain = payload_get(corpus, size, 0);
+            pthread_mutex_lock(&payloads_lock);
+            if (plain) gzip_compress(plain->data, plain->len, &p->data);
+        } else {
+            corpus_generate(corpus, &p->data, size);
+        }
+        p->next = payloads;
+        payloads = p;
+    }
+
+    pthread_mutex_unlock(&payloads_lock);
+    return p && p->data.data ? &p->data : NULL;
+}
+
+// Requisicao ---------------------------------------------------------------
+
+// Valor de um parametro da query; NULL se ausente
+static const char* query_param(const char *query, const char *name, char *value, size_t cap) {
+    size_t n = strlen(name);
+    const char *p = query;
+
+    while (p && *p) {
+        if (strncmp(p, name, n) == 0 && (p[n] == '=' || p[n] == '&' || p[n] == '\0')) {
+            const char *v = p[n] == '=' ? p + n + 1 : p + n;
+            size_t len = strcspn(v, "&");
+            if (len >= cap) len = cap - 1;
+            memcpy(value, v, len);
+            value[len] = '\0';
+            return value;
+        }
+        p = strchr(p, '&');
+        if (p) p++;
+    }
+    return NULL;
+}
+
+static long query_long(const char *query, const char *name, long fallback) {
+    char value[32];
+    return query_param(query, name, value, sizeof(value)) ? strtol(value, NULL, 10) : fallback;
+}
+
+static int header_is(const char *line, const char *name) {
+    size_t n = strlen(name);
+    return strncasecmp(line, name, n) == 0 && line[n] == ':';
+}
+
+static const char* header_value(const char *line, const char *name, char *value, size_t cap) {
+    const char *v = line + strlen(name) + 1;
+    while (*v == ' ' || *v == '\t') v++;
+    size_t len = strcspn(v, "\r\n");
+    if (len >= cap) len = cap - 1;
+    memcpy(value, v, len);
+    value[len] = '\0';
+    return value;
+}
+
+static int parse_request(Request *r, const char *buf, size_t head_len) {
+    char target[2048], version[16];
+
+    memset(r, 0, sizeof(*r));
+    if (sscanf(buf, "%15s %2047s %15s", r->method, target, version) != 3) return -1;
+
+    char *q = strchr(target, '?');
+    if (q) {
+        *q = '\0';
+        snprintf(r->query, sizeof(r->query), "%s", q + 1);
+    }
+    snprintf(r->path, sizeof(r->path), "%s", target);
+
+    // HTTP/1.0 fecha por padrao
+    r->close = strcmp(version, "HTTP/1.0") == 0;
+
+    const char *line = strstr(buf, "\r\n") + 2;
+    r->headers = line;
+    r->headers_len = head_len - (size_t)(line - buf);
+
+    while (line < buf + head_len && strncmp(line, "\r\n", 2) != 0) {
+        char value[256];
+        if (header_is(line, "Content-Length")) {
+            r->content_length = strtoul(header_value(line, "Content-Length", value, sizeof(value)), NULL, 10);
+        } else if (header_is(line, "Content-Type")) {
+            header_value(line, "Content-Type", r->content_type, sizeof(r->content_type));
+        } else if (header_is(line, "Accept-Encoding")) {
+            r->accepts_gzip = strstr(header_value(line, "Accept-Encoding", value, sizeof(value)), "gzip") != NULL;
+        } else if (header_is(line, "Last-Event-ID")) {
+            r->last_event_id = strtol(header_value(line, "Last-Event-ID", value, sizeof(value)), NULL, 10);
+        } else if (header_is(line, "Connection")) {
+            header_value(line, "Connection", value, sizeof(value));
+            r->close = strcasecmp(value, "close") == 0;
+        }
+        line = strstr(line, "\r\n") + 2;
+    }
+    return 0;
+}
+
+// Respostas ----------------------------------------------------------------
+
+static int send_simple(int fd, const Request *r, int status, const char *type, const char *body, size_t len) {
+    char head[512];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s\r\n",
+                     status, reason(status), type, len, r->close ? "Connection: close\r\n" : "");
+    if (net_send_all(fd, head, (size_t)n) != 0) return -1;
+    return strcmp(r->method, "HEAD") == 0 ? 0 : net_send_all(fd, body, len);
+}
+
+static int send_error(int fd, const Request *r, int status, const char *message) {
+    char body[256];
+    int n = snprintf(body, sizeof(body), "{\"error\":\"%s\"}", message);
+    return send_simple(fd, r, status, "application/json", body, (size_t)n);
+}
+
+static const Corpus* payload_corpus(const char *type) {
+    if (strcmp(type, "json") == 0) type = "json_wide";
+    else if (strcmp(type, "xml") == 0) type = "xml_sitemap";
+    else if (strcmp(type, "html") == 0) type = "html_page";
+    else if (strcmp(type, "text") == 0) type = "headers";
+    return corpus_find(type);
+}
+
+static int send_payload(int fd, const Request *r) {
+    PayloadParams pp;
+    char type[64];
+
+    pp.type = query_param(r->query, "type", type, sizeof(type)) ? type : "json";
+    pp.size = (size_t)query_long(r->query, "size", 1024);
+    pp.chunked = query_long(r->query, "chunked", 0) != 0;
+    pp.chunk = (size_t)query_long(r->query, "chunk", DEFAULT_CHUNK);
+    pp.gzip = query_long(r->query, "gzip", 0) != 0 && r->accepts_gzip;
+    pp.delay = query_long(r->query, "delay", 0);
+    pp.redirect = (int)query_long(r->query, "redirect", 0);
+    pp.status = (int)query_long(r->query, "status", 200);
+
+    const Corpus *corpus = payload_corpus(pp.type);
+    if (!corpus) return send_error(fd, r, 404, "unknown type");
+    if (pp.size == 0 || pp.size > PAYLOAD_MAX || pp.chunk == 0) return send_error(fd, r, 400, "bad size");
+
+    if (pp.delay > 0) sleep_ms(pp.delay);
+
+    if (pp.redirect > 0) {
+        // Mesmo pedido com um redirect a menos
+        StrBuf location = {0};
+        const char *p = r->query;
+        strbuf_printf(&location, "%s?", r->path);
+        while (*p) {
+            size_t len = strcspn(p, "&");
+            if (strncmp(p, "redirect=", 9) != 0 && strncmp(p, "delay=", 6) != 0) {
+                strbuf_append(&location, p, len);
+                strbuf_putc(&location, '&');
+            }
+            p += len;
+            if (*p == '&') p++;
+        }
+        strbuf_printf(&location, "redirect=%d", pp.redirect - 1);
+
+        StrBuf head = {0};
+        strbuf_printf(&head, "HTTP/1.1 302 Found\r\nLocation: %s\r\nContent-Length: 0\r\n%s\r\n",
+                      location.data, r->close ? "Connection: close\r\n" : "");
+        int rc = net_send_all(fd, head.data, head.len);
+        strbuf_free(&location);
+        strbuf_free(&head);
+        return rc;
+    }
+
+    const StrBuf *body = payload_get(corpus, pp.size, pp.gzip);
+    if (!body) return send_error(fd, r, 500, "out of memory");
+
+    StrBuf head = {0};
+    strbuf_printf(&head, "HTTP/1.1 %d %s\r\nContent-Type: %s; charset=utf-8\r\n",
+                  pp.status, reason(pp.status), corpus->content_type);
+    if (pp.gzip) strbuf_puts(&head, "Content-Encoding: gzip\r\n");
+    if (pp.chunked) strbuf_puts(&head, "Transfer-Encoding: chunked\r\n");
+    else strbuf_printf(&head, "Content-Length: %zu\r\n", body->len);
+    if (r->close) strbuf_puts(&head, "Connection: close\r\n");
+    strbuf_puts(&head, "\r\n");
+
+    int rc = net_send_all(fd, head.data, head.len);
+    strbuf_free(&head);
+    if (rc != 0 || strcmp(r->method, "HEAD") == 0) return rc;
+
+    if (!pp.chunked) return net_send_all(fd, body->data, body->len);
+
+    for (size_t off = 0; off < body->len; off += pp.chunk) {
+        size_t n = body->len - off < pp.chunk ? body->len - off : pp.chunk;
+        char size_line[32];
+        int sl = snprintf(size_line, sizeof(size_line), "%zx\r\n", n);
+        if (net_send_all(fd, size_line, (size_t)sl) != 0 ||
+            net_send_all(fd, body->data + off, n) != 0 ||
+            net_send_all(fd, "\r\n", 2) != 0) {
+            return -1;
+        }
+    }
+    return net_send_all(fd, "0\r\n\r\n", 5);
+}
+
+// Cada evento sai em duas escritas, cortado no meio, para exercitar o parse
+// incremental do cliente; as quebras de linha alternam entre \n e \r\n
+static int send_events(int fd, const Request *r) {
+    long count = query_long(r->query, "count", 5);
+    long interval = query_long(r->query, "interval", 0);
+    long retry = query_long(r->query, "retry", 0);
+
+    const char *head = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                       "Cache-Control: no-cache\r\nConnection: close\r\n\r\n";
+    if (net_send_all(fd, head, strlen(head)) != 0) return -1;
+    if (strcmp(r->method, "HEAD") == 0) return 0;
+
+    StrBuf ev = {0};
+    for (long i = 0; i < count; i++) {
+        long id = r->last_event_id + i + 1;
+        const char *eol = id % 2 ? "\n" : "\r\n";
+
+        ev.len = 0;
+        if (i == 0 && retry > 0) strbuf_printf(&ev, "retry: %ld%s", retry, eol);
+        strbuf_printf(&ev, ": keep-alive%s", eol);
+        if (id % 3 == 0) {
+            strbuf_printf(&ev, "event: log%sid: %ld%sdata: line one of %ld%sdata: line two%s%s",
+                          eol, id, eol, id, eol, eol, eol);
+        } else {
+            strbuf_printf(&ev, "event: update%sid: %ld%sdata: {\"id\": %ld, \"message\": \"event %ld\",%s"
+                               "data:  \"tags\": [\"a\", \"b\"], \"done\": %s}%s%s",
+                          eol, id, eol, id, id, eol, i + 1 == count ? "true" : "false", eol, eol);
+        }
+
+        size_t half = ev.len / 2;
+        if (net_send_all(fd, ev.data, half) != 0 || net_send_all(fd, ev.data + half, ev.len - half) != 0) {
+            strbuf_free(&ev);
+            return -1;
+        }
+        if (interval > 0 && i + 1 < count) sleep_ms(interval);
+    }
+    strbuf_free(&ev);
+    return 0;
+}
+
+static int send_headers_json(int fd, const Request *r) {
+    StrBuf sb = {0};
+    const char *line = r->headers;
+    const char *end = r->headers + r->headers_len;
+    int first = 1;
+
+    strbuf_puts(&sb, "{\"headers\":{");
+    while (line < end && strncmp(line, "\r\n", 2) != 0) {
+        const char *colon = memchr(line, ':', (size_t)(end - line));
+        const char *eol = strstr(line, "\r\n");
+        if (!eol) break;
+        if (colon && colon < eol) {
+            const char *v = colon + 1;
+            while (*v == ' ') v++;
+            if (!first) strbuf_putc(&sb, ',');
+            strbuf_json_string(&sb, line, (size_t)(colon - line));
+            strbuf_putc(&sb, ':');
+            strbuf_json_string(&sb, v, (size_t)(eol - v));
+            first = 0;
+        }
+        line = eol + 2;
+    }
+    strbuf_puts(&sb, "}}");
+
+    int rc = send_simple(fd, r, 200, "application/json", sb.data, sb.len);
+    strbuf_free(&sb);
+    return rc;
+}
+
+// Conexoes -----------------------------------------------------------------
+
+static void* serve_connection(void *arg) {
+    int fd = (int)(long)arg;
+    char *buf = malloc(REQUEST_MAX + 1);
+    size_t len = 0;
+
+    while (buf) {
+        // Le ate o fim dos headers
+        char *head_end;
+        buf[len] = '\0';
+        while (!(head_end = strstr(buf, "\r\n\r\n"))) {
+            if (len == REQUEST_MAX) goto done;
+            ssize_t n = recv(fd, buf + len, REQUEST_MAX - len, 0);
+            if (n <= 0) goto done;
+            len += (size_t)n;
+            buf[len] = '\0';
+        }
+        size_t head_len = (size_t)(head_end - buf) + 4;
+
+        Request r;
+        if (parse_request(&r, buf, head_len) != 0) goto done;
+
+        // Body da requisicao (apenas Content-Length)
+        StrBuf body = {0};
+        size_t have = len - head_len;
+        if (r.content_length > BODY_MAX) {
+            r.close = 1;
+            send_error(fd, &r, 413, "body too large");
+            goto done;
+        }
+        strbuf_append(&body, buf + head_len, have < r.content_length ? have : r.content_length);
+        while (body.len < r.content_length) {
+            char tmp[65536];
+            size_t want = r.content_length - body.len;
+            ssize_t n = recv(fd, tmp, want < sizeof(tmp) ? want : sizeof(tmp), 0);
+            if (n <= 0) {
+                strbuf_free(&body);
+                goto done;
+            }
+            strbuf_append(&body, tmp, (size_t)n);
+        }
+
+        int rc;
+        if (strcmp(r.path, "/payload") == 0) {
+            rc = send_payload(fd, &r);
+        } else if (strcmp(r.path, "/events") == 0) {
+            r.close = 1;
+            rc = send_events(fd, &r);
+        } else if (strcmp(r.path, "/echo") == 0) {
+            rc = send_simple(fd, &r, 200, r.content_type[0] ? r.content_type : "application/octet-stream",
+                             body.data ? body.data : "", body.len);
+        } else if (strcmp(r.path, "/headers") == 0) {
+            rc = send_headers_json(fd, &r);
+        } else if (strcmp(r.path, "/health") == 0) {
+            rc = send_simple(fd, &r, 200, "text/plain", "ok\n", 3);
+        } else {
+            rc = send_error(fd, &r, 404, "not found");
+        }
+        strbuf_free(&body);
+
+        if (rc != 0 || r.close) break;
+
+        // Guarda o que ja chegou da proxima requisicao (pipelining)
+        size_t used = head_len + (have < r.content_length ? have : r.content_length);
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+
+done:
+    free(buf);
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int port = 8080;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--port") == 0) && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-p PORT]   (PORT 0 picks a free port)\n", argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    int srv = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (srv < 0 || bind(srv, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(srv, 128) != 0) {
+        perror("curlser-server");
+        return 1;
+    }
+
+    socklen_t alen = sizeof(addr);
+    getsockname(srv, (struct sockaddr *)&addr, &alen);
+    printf("listening on 127.0.0.1:%d\n", ntohs(addr.sin_port));
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(srv, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            return 1;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        pthread_t t;
+        if (pthread_create(&t, NULL, serve_connection, (void *)(long)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(t);
+    }
+}
@@ -0,0 +1,297 @@
+// Tempo de exec ate a saida do curlser (make bench-startup)
+//
+// Executa o binario muitas vezes em casos triviais (--help, --version, uma
+// requisicao pequena ao servidor local, --diff entre arquivos) e mede o tempo
+// de parede do fork ate o wait4, alem da CPU e do RSS do processo filho. Como
+// quase nada e transferido, o resultado e dominado pelo carregamento do
+// binario e pela inicializacao: regressoes de startup aparecem aqui.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "strbuf.h"
+
+#define MAX_ARGS 8
+
+typedef struct {
+    const char *name;
+    const char *args[4];        // opcoes; "$URL" vira http://127.0.0.1:PORTA, "$A"/"$B" os arquivos
+    const char *path;           // caminho acrescentado a $URL
+    int exit_code;              // status esperado (--diff com diferencas e conexao recusada saem com 1)
+} Scenario;
+
+static const Scenario scenarios[] = {
+    { "help",           { "-h" },                       NULL,                            0 },
+    { "version",        { "-V" },                       NULL,                            0 },
+    { "diff_files",     { "--diff", "$A", "$B" },       NULL,                            1 },
+    { "http_health",    { "-r", "$URL" },               "/health",                       0 },
+    { "http_json_1k",   { "$URL" },                     "/payload?type=json&size=1024",  0 },
+    { "https_refused",  { "https://127.0.0.1:1/" },     NULL,                            1 },
+};
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+    const Scenario *s;
+    int runs;
+    int failures;
+    double min_ms;
+    double median_ms;
+    double p90_ms;
+    double cpu_ms;              // mediana de user + sys
+    long max_rss_kb;
+} StartupResult;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Sobe o servidor e descobre a porta pela primeira linha que ele imprime
+static pid_t start_server(const char *path, int *port) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(path, path, "-p", "0", (char *)NULL);
+        perror(path);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    char line[128];
+    FILE *fp = fdopen(fds[0], "r");
+    if (pid < 0 || !fp || !fgets(line, sizeof(line), fp) ||
+        sscanf(line, "listening on 127.0.0.1:%d", port) != 1) {
+        if (pid > 0) kill(pid, SIGTERM);
+        if (fp) fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    return pid;
+}
+
+static int write_file(const char *path, const char *text) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) return -1;
+    fputs(text, fp);
+    return fclose(fp);
+}
+
+// Executa o curlser uma vez, com stdout e stderr em /dev/null
+static int run_once(const char *const *argv, double *wall, double *cpu, long *rss_kb) {
+    double t0 = now_s();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        execv(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+    if (pid < 0) return -1;
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) < 0) return -1;
+    *wall = now_s() - t0;
+    *cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    *rss_kb = ru.ru_maxrss;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127) return -1;
+    return WEXITSTATUS(status);
+}
+
+static void run_scenario(StartupResult *r, const char *curlser, const char *base_url,
+                         const char *file_a, const char *file_b, int runs) {
+    const Scenario *s = r->s;
+    const char *argv[MAX_ARGS];
+    StrBuf url = {0};
+    int argc = 0;
+
+    argv[argc++] = curlser;
+    for (int i = 0; i < 4 && s->args[i]; i++) {
+        const char *arg = s->args[i];
+        if (strcmp(arg, "$URL") == 0) {
+            strbuf_printf(&url, "%s%s", base_url, s->path ? s->path : "");
+            arg = url.data;
+        } else if (strcmp(arg, "$A") == 0) {
+            arg = file_a;
+        } else if (strcmp(arg, "$B") == 0) {
+            arg = file_b;
+        }
+        argv[argc++] = arg;
+    }
+    argv[argc] = NULL;
+
+    double *walls = calloc((size_t)runs, sizeof(double));
+    double *cpus = calloc((size_t)runs, sizeof(double));
+    double wall, cpu;
+    long rss;
+
+    // Aquece o cache de paginas e o servidor
+    run_once(argv, &wall, &cpu, &rss);
+
+    for (int i = 0; walls && cpus && i < runs; i++) {
+        int code = run_once(argv, &wall, &cpu, &rss);
+        if (code != s->exit_code) {
+            r->failures++;
+            continue;
+        }
+        walls[r->runs] = wall;
+        cpus[r->runs] = cpu;
+        r->runs++;
+        if (rss > r->max_rss_kb) r->max_rss_kb = rss;
+    }
+
+    if (r->runs > 0) {
+        qsort(walls, (size_t)r->runs, sizeof(double), compare_double);
+        qsort(cpus, (size_t)r->runs, sizeof(double), compare_double);
+        r->min_ms = walls[0] * 1000;
+        r->median_ms = walls[r->runs / 2] * 1000;
+        r->p90_ms = walls[r->runs * 9 / 10] * 1000;
+        r->cpu_ms = cpus[r->runs / 2] * 1000;
+    }
+
+    free(walls);
+    free(cpus);
+    strbuf_free(&url);
+}
+
+static void write_results(FILE *fp, const char *label, const StartupResult *results, size_t count) {
+    char date[32];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+    StrBuf sb = {0};
+    strbuf_json_string(&sb, label, strlen(label));
+
+    fprintf(fp, "{\n  \"label\": %s,\n  \"date\": \"%s\",\n  \"results\": [\n", sb.data, date);
+    for (size_t i = 0; i < count; i++) {
+        const StartupResult *r = &results[i];
+        fprintf(fp, "    {\"scenario\": \"%s\", \"runs\": %d, \"failures\": %d, \"min_ms\": %.3f, "
+                    "\"median_ms\": %.3f, \"p90_ms\": %.3f, \"cpu_ms\": %.3f, \"max_rss_kb\": %ld}%s\n",
+                r->s->name, r->runs, r->failures, r->min_ms, r->median_ms, r->p90_ms,
+                r->cpu_ms, r->max_rss_kb, i + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    strbuf_free(&sb);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--curlser PATH] [--server PATH] [--out FILE] [--label TEXT] "
+                    "[--runs N] [--quick]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *curlser = "bin/curlser";
+    const char *server = "bin/curlser-server";
+    const char *out_path = NULL;
+    const char *label = "";
+    int runs = 200;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--curlser") == 0 && i + 1 < argc) {
+            curlser = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            label = argv[++i];
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            runs = 40;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (runs < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Documentos pequenos para o --diff
+    char file_a[] = "/tmp/curlser-startup-XXXXXX";
+    char file_b[] = "/tmp/curlser-startup-XXXXXX";
+    int fd_a = mkstemp(file_a);
+    int fd_b = mkstemp(file_b);
+    if (fd_a < 0 || fd_b < 0 ||
+        write_file(file_a, "{\"a\": 1, \"b\": [1, 2, 3]}\n") != 0 ||
+        write_file(file_b, "{\"a\": 2, \"b\": [1, 2, 3, 4]}\n") != 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd_a);
+    close(fd_b);
+
+    int port;
+    pid_t server_pid = start_server(server, &port);
+    if (server_pid < 0) {
+        fprintf(stderr, "Error: could not start %s\n", server);
+        unlink(file_a);
+        unlink(file_b);
+        return 1;
+    }
+
+    char base_url[64];
+    snprintf(base_url, sizeof(base_url), "http://127.0.0.1:%d", port);
+
+    StartupResult results[SCENARIO_COUNT];
+    int failed = 0;
+
+    fprintf(stderr, "%-16s %6s %9s %9s %9s %9s %10s\n", "scenario", "runs",
+            "min ms", "median ms", "p90 ms", "cpu ms", "rss KiB");
+
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        StartupResult *r = &results[i];
+        memset(r, 0, sizeof(*r));
+        r->s = &scenarios[i];
+        run_scenario(r, curlser, base_url, file_a, file_b, runs);
+
+        fprintf(stderr, "%-16s %6d %9.3f %9.3f %9.3f %9.3f %10ld%s\n", r->s->name, r->runs,
+                r->min_ms, r->median_ms, r->p90_ms, r->cpu_ms, r->max_rss_kb,
+                r->failures ? "  (failures)" : "");
+        failed |= r->failures > 0;
+    }
+
+    kill(server_pid, SIGTERM);
+    waitpid(server_pid, NULL, 0);
+    unlink(file_a);
+    unlink(file_b);
+
+    if (out_path) {
+        FILE *fp = fopen(out_path, "w");
+        if (!fp) {
+            perror(out_path);
+            return 1;
+        }
+        write_results(fp, label, results, SCENARIO_COUNT);
+        fclose(fp);
+        fprintf(stderr, "\nResults written to %s\n", out_path);
+    } else {
+        write_results(stderr, label, results, SCENARIO_COUNT);
+    }
+
+    return failed;
+}
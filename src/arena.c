@@ -0,0 +1,58 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaBlock {
+    ArenaBlock *next;
+};
+
+void arena_init(Arena *a) {
+    memset(a, 0, sizeof(*a));
+}
+
+void* arena_alloc(Arena *a, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+
+    if ((size_t)(a->end - a->ptr) < size) {
+        // Pedidos grandes ganham um bloco so para eles
+        size_t block = size > ARENA_BLOCK_SIZE / 4 ? size : ARENA_BLOCK_SIZE;
+        ArenaBlock *b = malloc(sizeof(ArenaBlock) + block);
+        if (!b) return NULL;
+
+        a->total += block;
+        a->blocks++;
+        if (block == size && a->head) {
+            // Mantem o bloco atual em uso para as proximas alocacoes pequenas
+            b->next = a->head->next;
+            a->head->next = b;
+            return b + 1;
+        }
+
+        b->next = a->head;
+        a->head = b;
+        a->ptr = (char *)(b + 1);
+        a->end = a->ptr + block;
+    }
+
+    void *p = a->ptr;
+    a->ptr += size;
+    return p;
+}
+
+char* arena_strndup(Arena *a, const char *s, size_t n) {
+    char *p = arena_alloc(a, n + 1);
+    if (!p) return NULL;
+    memcpy(p, s, n);
+    p[n] = '\0';
+    return p;
+}
+
+void arena_free(Arena *a) {
+    ArenaBlock *b = a->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    memset(a, 0, sizeof(*a));
+}
@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Alocador em blocos grandes: alocacoes sao so um incremento de ponteiro
+// e tudo e liberado de uma vez. Usado por estruturas com muitos objetos
+// pequenos que vivem o mesmo tempo (ex: a arvore de um documento JSON).
+
+#define ARENA_BLOCK_SIZE (1024 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    char *ptr;          // proximo byte livre do bloco atual
+    char *end;
+    size_t total;       // bytes reservados em blocos
+    size_t blocks;      // chamadas a malloc
+} Arena;
+
+void arena_init(Arena *a);
+
+// Memoria alinhada a 8 bytes; NULL sem memoria
+void* arena_alloc(Arena *a, size_t size);
+
+// Copia n bytes e termina com '\0'
+char* arena_strndup(Arena *a, const char *s, size_t n);
+
+void arena_free(Arena *a);
+
+#endif // ARENA_H
@@ -0,0 +1,186 @@
+#include "body.h"
+#include "stats.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+void body_store_init(BodyStore *b, size_t mem_limit) {
+    memset(b, 0, sizeof(*b));
+    b->mem_limit = mem_limit ? mem_limit : BODY_DEFAULT_MEM_LIMIT;
+    b->fd = -1;
+}
+
+#ifndef _WIN32
+// Move o conteudo em memoria para um arquivo temporario anonimo
+static int body_store_spill(BodyStore *b) {
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/curlser-body-XXXXXX", dir && *dir ? dir : "/tmp");
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Error: cannot create temporary file: %s\n", strerror(errno));
+        return -1;
+    }
+    // Sem nome no diretorio: o kernel remove o arquivo quando o fd fechar
+    unlink(path);
+
+    if (net_write_all(fd, b->mem, b->size) != 0) {
+        fprintf(stderr, "Error: cannot write temporary file: %s\n", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    free(b->mem);
+    b->mem = NULL;
+    b->mem_cap = 0;
+    b->fd = fd;
+    return 0;
+}
+#endif
+
+void body_store_borrow(BodyStore *b, const char *data, size_t len) {
+    body_store_free(b);
+    b->borrowed = data;
+    b->size = len;
+}
+
+int body_store_append(BodyStore *b, const char *data, size_t len) {
+    if (b->borrowed) return -1;
+
+#ifndef _WIN32
+    if (b->fd < 0 && b->size + len > b->mem_limit) {
+        if (body_store_spill(b) != 0) return -1;
+    }
+
+    if (b->fd >= 0) {
+        if (net_write_all(b->fd, data, len) != 0) {
+            fprintf(stderr, "Error: cannot write temporary file: %s\n", strerror(errno));
+            return -1;
+        }
+        b->size += len;
+        STATS_ADD(body_spilled, len);
+        return 0;
+    }
+#endif
+
+    if (b->size + len + 1 > b->mem_cap) {
+        // Crescimento geometrico: evita um realloc por bloco recebido
+        size_t cap = b->mem_cap ? b->mem_cap : 16384;
+        while (cap < b->size + len + 1) cap *= 2;
+        if (cap > b->mem_limit + 1 && b->size + len + 1 <= b->mem_limit + 1) {
+            cap = b->mem_limit + 1;
+        }
+
+        char *ptr = realloc(b->mem, cap);
+        if (!ptr) {
+            fprintf(stderr, "Error: out of memory\n");
+            return -1;
+        }
+        b->mem = ptr;
+        b->mem_cap = cap;
+        STATS_ADD(body_reallocs, 1);
+        STATS_PEAK(body_peak, cap);
+    }
+
+    memcpy(b->mem + b->size, data, len);
+    STATS_ADD(body_bytes_copied, len);
+    b->size += len;
+    b->mem[b->size] = '\0';
+    return 0;
+}
+
+const char* body_store_view(BodyStore *b) {
+    if (b->borrowed) {
+        return b->borrowed;
+    }
+    if (b->fd < 0) {
+        return b->mem ? b->mem : "";
+    }
+
+#ifndef _WIN32
+    if (!b->map && b->size > 0) {
+        void *map = mmap(NULL, b->size, PROT_READ, MAP_PRIVATE, b->fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "Error: cannot map temporary file: %s\n", strerror(errno));
+            return NULL;
+        }
+        madvise(map, b->size, MADV_SEQUENTIAL);
+        b->map = map;
+        b->map_len = b->size;
+        b->released = 0;
+    }
+#endif
+
+    return b->map ? b->map : "";
+}
+
+void body_store_consumed(BodyStore *b, size_t offset) {
+#ifndef _WIN32
+    if (!b->map) return;
+
+    // Paginas ja lidas saem do RSS; continuam no page cache se precisar
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t end = (offset < b->map_len ? offset : b->map_len) / page * page;
+
+    if (end > b->released) {
+        madvise(b->map + b->released, end - b->released, MADV_DONTNEED);
+        b->released = end;
+    }
+#else
+    (void)b;
+    (void)offset;
+#endif
+}
+
+uint64_t body_store_hash(BodyStore *b) {
+    const char *p = body_store_view(b);
+    size_t n = b->size;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+
+    if (!p) return h;
+
+    // Duas cadeias independentes para nao esperar a latencia da multiplicacao
+    uint64_t h2 = h ^ 0xc2b2ae3d27d4eb4fULL;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint64_t w1, w2;
+        memcpy(&w1, p + i, 8);
+        memcpy(&w2, p + i + 8, 8);
+        h = (h ^ w1) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 29;
+        h2 = (h2 ^ w2) * 0xc4ceb9fe1a85ec53ULL;
+        h2 ^= h2 >> 31;
+    }
+    for (; i < n; i++) {
+        h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+    }
+
+    h ^= h2 * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+int body_store_spilled(const BodyStore *b) {
+    return b->fd >= 0;
+}
+
+void body_store_free(BodyStore *b) {
+#ifndef _WIN32
+    if (b->map) munmap(b->map, b->map_len);
+    if (b->fd >= 0) close(b->fd);
+#endif
+    free(b->mem);
+    memset(b, 0, sizeof(*b));
+    b->fd = -1;
+}
@@ -0,0 +1,56 @@
+#ifndef BODY_H
+#define BODY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Limite padrao de memoria para o body antes de ir para o disco
+#define BODY_DEFAULT_MEM_LIMIT (16 * 1024 * 1024)
+
+// Tamanho dos blocos em que o body armazenado e entregue aos formatadores
+#define BODY_WINDOW (1024 * 1024)
+
+// Armazena o body de uma resposta. Enquanto cabe no limite fica em memoria;
+// ao ultrapassar, todo o conteudo vai para um arquivo temporario ja removido
+// do diretorio e a memoria e liberada, de modo que o pico de RSS fica
+// limitado pela configuracao e nao pelo tamanho da resposta.
+typedef struct {
+    char *mem;          // conteudo em memoria (terminado em '\0')
+    size_t mem_cap;
+    size_t mem_limit;   // acima disso o body vai para o disco
+    int fd;             // arquivo temporario; -1 enquanto estiver em memoria
+    size_t size;        // bytes armazenados
+    char *map;          // visao mmap do arquivo
+    size_t map_len;
+    size_t released;    // paginas da visao ja devolvidas ao kernel
+    const char *borrowed;   // conteudo de outro dono (body_store_borrow)
+} BodyStore;
+
+// Inicializa vazio; mem_limit 0 usa BODY_DEFAULT_MEM_LIMIT
+void body_store_init(BodyStore *b, size_t mem_limit);
+
+// Acrescenta um bloco; retorna 0 ou -1 em caso de erro
+int body_store_append(BodyStore *b, const char *data, size_t len);
+
+// Usa len bytes de data como body, sem copiar (ex: resposta vinda do mmap das
+// fixtures). data precisa ser seguido de '\0' e viver mais que o store.
+void body_store_borrow(BodyStore *b, const char *data, size_t len);
+
+// Visao contigua do body inteiro (memoria ou mmap do arquivo temporario).
+// Valida ate body_store_free; NULL se o mapeamento falhar.
+const char* body_store_view(BodyStore *b);
+
+// Indica que os primeiros offset bytes da visao ja foram consumidos,
+// permitindo devolver as paginas mapeadas correspondentes
+void body_store_consumed(BodyStore *b, size_t offset);
+
+// Hash rapido do conteudo (palavras de 64 bits), para detectar bodies identicos
+uint64_t body_store_hash(BodyStore *b);
+
+// O body foi para o disco
+int body_store_spilled(const BodyStore *b);
+
+// Libera memoria, mapeamento e arquivo temporario
+void body_store_free(BodyStore *b);
+
+#endif // BODY_H
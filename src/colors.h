@@ -36,7 +36,8 @@
 #include <unistd.h>
 #endif
 
-static int colors_enabled = 1;
+// Definido em output.c: um unico estado para todas as unidades de compilacao
+extern int colors_enabled;
 
 static inline void init_colors(void) {
     colors_enabled = isatty(STDOUT_FILENO);
@@ -0,0 +1,351 @@
+#include "diff.h"
+#include "output.h"
+#include "strbuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DIFF_VALUE_MAX      120     // bytes de um valor exibidos por linha
+#define DIFF_SMALL_OBJECT   16      // ate aqui as chaves sao comparadas sem tabela
+
+typedef struct {
+    StrBuf path;
+    JsonDiffStats *stats;
+    int stopped;
+} DiffState;
+
+// Saida -------------------------------------------------------------------
+
+static int is_identifier(const char *s, size_t n) {
+    if (n == 0) return 0;
+    for (size_t i = 0; i < n; i++) {
+        char c = s[i];
+        if (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) continue;
+        if (i > 0 && c >= '0' && c <= '9') continue;
+        return 0;
+    }
+    return 1;
+}
+
+// Acrescenta um segmento ao caminho; retorna o tamanho anterior
+static size_t path_push_key(DiffState *d, const JsonNode *n) {
+    size_t mark = d->path.len;
+
+    if (is_identifier(n->key, n->key_len)) {
+        strbuf_putc(&d->path, '.');
+        strbuf_append(&d->path, n->key, n->key_len);
+    } else {
+        strbuf_putc(&d->path, '[');
+        strbuf_json_string(&d->path, n->key, n->key_len);
+        strbuf_putc(&d->path, ']');
+    }
+    return mark;
+}
+
+static size_t path_push_index(DiffState *d, size_t index) {
+    size_t mark = d->path.len;
+    strbuf_printf(&d->path, "[%zu]", index);
+    return mark;
+}
+
+static void path_pop(DiffState *d, size_t mark) {
+    d->path.len = mark;
+    d->path.data[mark] = '\0';
+}
+
+// JSON compacto, cortado em DIFF_VALUE_MAX bytes
+static void compact(StrBuf *sb, const JsonNode *n) {
+    if (sb->len > DIFF_VALUE_MAX) return;
+
+    switch (n->type) {
+        case JSON_NULL:   strbuf_puts(sb, "null"); break;
+        case JSON_TRUE:   strbuf_puts(sb, "true"); break;
+        case JSON_FALSE:  strbuf_puts(sb, "false"); break;
+        case JSON_NUMBER: strbuf_append(sb, n->as.text, n->len); break;
+        case JSON_STRING: strbuf_json_string(sb, n->as.text, n->len); break;
+
+        case JSON_ARRAY:
+        case JSON_OBJECT:
+            strbuf_putc(sb, n->type == JSON_ARRAY ? '[' : '{');
+            for (uint32_t i = 0; i < n->len && sb->len <= DIFF_VALUE_MAX; i++) {
+                const JsonNode *c = &n->as.children[i];
+                if (i > 0) strbuf_putc(sb, ',');
+                if (n->type == JSON_OBJECT) {
+                    strbuf_json_string(sb, c->key, c->key_len);
+                    strbuf_putc(sb, ':');
+                }
+                compact(sb, c);
+            }
+            strbuf_putc(sb, n->type == JSON_ARRAY ? ']' : '}');
+            break;
+    }
+}
+
+static void put_value(const JsonNode *n, const char *value_color) {
+    StrBuf sb = {0};
+
+    compact(&sb, n);
+    out_color(value_color);
+    if (sb.len > DIFF_VALUE_MAX) {
+        // Nao corta no meio de um caractere UTF-8
+        size_t cut = DIFF_VALUE_MAX;
+        while (cut > 0 && ((unsigned char)sb.data[cut] & 0xC0) == 0x80) cut--;
+        out_write(sb.data, cut);
+        out_puts("\xE2\x80\xA6");
+    } else if (sb.data) {
+        out_write(sb.data, sb.len);
+    }
+    out_color(RESET);
+    strbuf_free(&sb);
+}
+
+// Verifica os limites de saida antes de cada linha
+static int line_allowed(DiffState *d) {
+    JsonDiffStats *s = d->stats;
+    unsigned long long lines = s->changed + s->added + s->removed;
+
+    if (d->stopped) return 0;
+    if ((out_max_items() > 0 && lines >= (unsigned long long)out_max_items()) || out_stopped()) {
+        if (!out_state.broken) {
+            out_elision();
+            out_putc('\n');
+        }
+        d->stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static void put_path(DiffState *d, char sign, const char *sign_color) {
+    out_color(sign_color);
+    out_putc(sign);
+    out_putc(' ');
+    out_color(RESET);
+    out_color(CYAN);
+    out_puts(d->path.data ? d->path.data : "$");
+    out_color(RESET);
+    out_color(BOLD_WHITE);
+    out_puts(": ");
+    out_color(RESET);
+}
+
+static void report_changed(DiffState *d, const JsonNode *a, const JsonNode *b) {
+    if (!line_allowed(d)) return;
+    put_path(d, '~', YELLOW);
+    put_value(a, RED);
+    out_color(DIM);
+    out_puts(" \xE2\x86\x92 ");
+    out_color(RESET);
+    put_value(b, GREEN);
+    out_putc('\n');
+    d->stats->changed++;
+}
+
+static void report_single(DiffState *d, const JsonNode *n, int added) {
+    if (!line_allowed(d)) return;
+    put_path(d, added ? '+' : '-', added ? GREEN : RED);
+    put_value(n, added ? GREEN : RED);
+    out_putc('\n');
+    if (added) d->stats->added++;
+    else d->stats->removed++;
+}
+
+// Comparacao ---------------------------------------------------------------
+
+static void diff_node(DiffState *d, const JsonNode *a, const JsonNode *b);
+
+static int same_key(const JsonNode *a, const JsonNode *b) {
+    return a->key_len == b->key_len &&
+           (a->key == b->key || memcmp(a->key, b->key, a->key_len) == 0);
+}
+
+static void diff_pair(DiffState *d, const JsonNode *a, const JsonNode *b) {
+    size_t mark = path_push_key(d, b);
+    diff_node(d, a, b);
+    path_pop(d, mark);
+}
+
+static void report_key(DiffState *d, const JsonNode *n, int added) {
+    size_t mark = path_push_key(d, n);
+    report_single(d, n, added);
+    path_pop(d, mark);
+}
+
+static void diff_object(DiffState *d, const JsonNode *a, const JsonNode *b) {
+    char *matched = calloc(a->len + 1, 1);
+    uint32_t *table = NULL;
+    size_t mask = 0;
+
+    if (!matched) {
+        report_changed(d, a, b);
+        return;
+    }
+
+    if (a->len > DIFF_SMALL_OBJECT) {
+        // Tabela de chaves de a (enderecamento aberto, indices + 1)
+        size_t size = 64;
+        while (size < (size_t)a->len * 2) size *= 2;
+        table = calloc(size, sizeof(uint32_t));
+        mask = size - 1;
+        for (uint32_t i = 0; table && i < a->len; i++) {
+            const JsonNode *c = &a->as.children[i];
+            size_t h = json_hash_bytes(0, c->key, c->key_len) & mask;
+            while (table[h]) h = (h + 1) & mask;
+            table[h] = i + 1;
+        }
+    }
+
+    // Campos de b: alterados ou adicionados, na ordem de b
+    for (uint32_t j = 0; j < b->len && !d->stopped; j++) {
+        const JsonNode *cb = &b->as.children[j];
+        long found = -1;
+
+        if (table) {
+            size_t h = json_hash_bytes(0, cb->key, cb->key_len) & mask;
+            for (; table[h]; h = (h + 1) & mask) {
+                uint32_t i = table[h] - 1;
+                if (!matched[i] && same_key(&a->as.children[i], cb)) {
+                    found = i;
+                    break;
+                }
+            }
+        } else {
+            for (uint32_t i = 0; i < a->len; i++) {
+                if (!matched[i] && same_key(&a->as.children[i], cb)) {
+                    found = i;
+                    break;
+                }
+            }
+        }
+
+        if (found < 0) {
+            report_key(d, cb, 1);
+        } else {
+            matched[found] = 1;
+            diff_pair(d, &a->as.children[found], cb);
+        }
+    }
+
+    // Campos de a que sumiram
+    for (uint32_t i = 0; i < a->len && !d->stopped; i++) {
+        if (!matched[i]) report_key(d, &a->as.children[i], 0);
+    }
+
+    free(table);
+    free(matched);
+}
+
+// Trecho entre dois itens iguais: pares na mesma posicao sao comparados,
+// o que sobra foi removido ou adicionado
+static void diff_gap(DiffState *d, const JsonNode *a, size_t a_from, size_t a_to,
+                     const JsonNode *b, size_t b_from, size_t b_to) {
+    size_t i = a_from, j = b_from;
+
+    for (; i < a_to && j < b_to && !d->stopped; i++, j++) {
+        size_t mark = path_push_index(d, j);
+        diff_node(d, &a->as.children[i], &b->as.children[j]);
+        path_pop(d, mark);
+    }
+    for (; i < a_to && !d->stopped; i++) {
+        size_t mark = path_push_index(d, i);
+        report_single(d, &a->as.children[i], 0);
+        path_pop(d, mark);
+    }
+    for (; j < b_to && !d->stopped; j++) {
+        size_t mark = path_push_index(d, j);
+        report_single(d, &b->as.children[j], 1);
+        path_pop(d, mark);
+    }
+}
+
+typedef struct {
+    uint64_t hash;
+    long cursor;        // menor indice ainda nao usado + 1 (0 = vazio, -1 = esgotado)
+} HashEntry;
+
+static void diff_array(DiffState *d, const JsonNode *a, const JsonNode *b) {
+    const JsonNode *ac = a->as.children;
+    const JsonNode *bc = b->as.children;
+    size_t n = a->len, m = b->len;
+    size_t start = 0;
+
+    // Prefixo e sufixo iguais sao pulados direto pelo hash
+    while (start < n && start < m && ac[start].hash == bc[start].hash) start++;
+    while (n > start && m > start && ac[n - 1].hash == bc[m - 1].hash) {
+        n--;
+        m--;
+    }
+    if (start == n || start == m) {
+        diff_gap(d, a, start, n, b, start, m);
+        return;
+    }
+
+    // Itens de a indexados por hash, em ordem crescente de posicao
+    size_t size = 64;
+    while (size < (n - start) * 2) size *= 2;
+    size_t mask = size - 1;
+    HashEntry *table = calloc(size, sizeof(HashEntry));
+    long *next = malloc((n - start) * sizeof(long));
+    if (!table || !next) {
+        free(table);
+        free(next);
+        diff_gap(d, a, start, n, b, start, m);
+        return;
+    }
+
+    for (size_t i = n; i-- > start;) {
+        size_t h = ac[i].hash & mask;
+        while (table[h].cursor && table[h].hash != ac[i].hash) h = (h + 1) & mask;
+        next[i - start] = table[h].cursor ? table[h].cursor - 1 : -1;
+        table[h].hash = ac[i].hash;
+        table[h].cursor = (long)i + 1;
+    }
+
+    // Casa cada item de b com o proximo item igual de a; o que fica entre
+    // dois casamentos e comparado por diff_gap
+    size_t ia = start, ib = start;
+    for (size_t j = start; j < m && !d->stopped; j++) {
+        size_t h = bc[j].hash & mask;
+        while (table[h].cursor && table[h].hash != bc[j].hash) h = (h + 1) & mask;
+        if (table[h].cursor <= 0) continue;
+
+        long k = table[h].cursor - 1;
+        while (k >= 0 && (size_t)k < ia) k = next[k - start];
+        table[h].cursor = k >= 0 ? k + 1 : -1;
+        if (k < 0) continue;
+
+        diff_gap(d, a, ia, (size_t)k, b, ib, j);
+        ia = (size_t)k + 1;
+        ib = j + 1;
+    }
+    diff_gap(d, a, ia, n, b, ib, m);
+
+    free(table);
+    free(next);
+}
+
+static void diff_node(DiffState *d, const JsonNode *a, const JsonNode *b) {
+    if (d->stopped) return;
+    if (a->type == b->type && a->hash == b->hash) return;
+
+    if (a->type == JSON_OBJECT && b->type == JSON_OBJECT) {
+        diff_object(d, a, b);
+    } else if (a->type == JSON_ARRAY && b->type == JSON_ARRAY) {
+        diff_array(d, a, b);
+    } else {
+        report_changed(d, a, b);
+    }
+}
+
+void json_diff(const JsonNode *a, const JsonNode *b, JsonDiffStats *stats) {
+    DiffState d;
+
+    memset(&d, 0, sizeof(d));
+    memset(stats, 0, sizeof(*stats));
+    d.stats = stats;
+    strbuf_puts(&d.path, "$");
+
+    diff_node(&d, a, b);
+
+    stats->truncated = d.stopped;
+    strbuf_free(&d.path);
+}
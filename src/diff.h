@@ -0,0 +1,23 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include "json_dom.h"
+
+// Diff estrutural entre dois documentos JSON (--diff). Subarvores com o
+// mesmo hash sao puladas sem descer nelas; so os caminhos alterados sao
+// impressos, um por linha:
+//   ~ $.a.b: 1 → 2      valor alterado
+//   + $.c: {...}        campo/item adicionado
+//   - $.d[3]: "x"       campo/item removido
+
+typedef struct {
+    unsigned long long changed;
+    unsigned long long added;
+    unsigned long long removed;
+    int truncated;      // parou em um limite de saida
+} JsonDiffStats;
+
+// a = antes, b = depois
+void json_diff(const JsonNode *a, const JsonNode *b, JsonDiffStats *stats);
+
+#endif // DIFF_H
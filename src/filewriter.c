@@ -0,0 +1,422 @@
+#include "filewriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_FILE_INDEX_ALLOC)
+#define HAVE_URING 1
+#endif
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#define OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_BINARY)
+
+// Uma chamada de write nunca grava mais que ~2 GiB; arquivos maiores viram
+// varias escritas encadeadas
+#define WRITE_CHUNK (1024 * 1024 * 1024)
+
+#define LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+enum { BACKEND_PWRITE, BACKEND_URING };
+
+enum { OP_OPEN = 1, OP_WRITE, OP_CLOSE, OP_RECOVER };
+
+// Um arquivo em andamento, ocupando um slot de descritor fixo
+typedef struct {
+    char *path;
+    size_t len;
+    size_t written;
+    FileWriterDone done;
+    void *tag;
+    unsigned pending;       // CQEs ainda esperadas
+    int error;
+    int opened;
+    int closed;
+} FileSlot;
+
+struct FileWriter {
+    int backend;
+
+#ifdef HAVE_URING
+    int ring_fd;
+    void *ring_map;
+    size_t ring_map_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned sq_entries, cq_entries;
+    unsigned to_submit;     // SQEs preenchidas e ainda nao entregues ao kernel
+    unsigned inflight;      // SQEs cuja CQE ainda nao chegou
+
+    FileSlot slots[FILE_WRITER_DEPTH];
+    unsigned free_slots[FILE_WRITER_DEPTH];
+    unsigned free_count;
+#endif
+};
+
+// pwrite ------------------------------------------------------------------
+
+static int write_file_sync(const char *path, const char *data, size_t len) {
+    int fd = open(path, OPEN_FLAGS, 0644);
+    if (fd < 0) return errno;
+
+    int error = 0;
+    size_t off = 0;
+    while (off < len) {
+        size_t chunk = len - off < WRITE_CHUNK ? len - off : WRITE_CHUNK;
+#ifdef _WIN32
+        ssize_t n = write(fd, data + off, chunk);
+#else
+        ssize_t n = pwrite(fd, data + off, chunk, (off_t)off);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = errno;
+            break;
+        }
+        off += (size_t)n;
+    }
+
+    if (close(fd) != 0 && !error) error = errno;
+    return error;
+}
+
+// io_uring ----------------------------------------------------------------
+
+#ifdef HAVE_URING
+
+static int uring_enter(FileWriter *w, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        long r = syscall(__NR_io_uring_enter, w->ring_fd, w->to_submit, min_complete, flags, NULL, 0);
+        if (r >= 0) {
+            w->to_submit -= (unsigned)r < w->to_submit ? (unsigned)r : w->to_submit;
+            return 0;
+        }
+        if (errno != EINTR) return -1;
+    }
+}
+
+static struct io_uring_sqe* uring_sqe(FileWriter *w) {
+    unsigned tail = *w->sq_tail;
+    if (tail - LOAD(w->sq_head) >= w->sq_entries) return NULL;
+
+    unsigned index = tail & *w->sq_mask;
+    struct io_uring_sqe *sqe = &w->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    w->sq_array[index] = index;
+    return sqe;
+}
+
+static void uring_push(FileWriter *w) {
+    STORE(w->sq_tail, *w->sq_tail + 1);
+    w->to_submit++;
+    w->inflight++;
+}
+
+// Fecha o descritor fixo do slot; op diz a quem pertence a CQE
+static int uring_close_slot(FileWriter *w, unsigned slot, int op) {
+    struct io_uring_sqe *sqe = uring_sqe(w);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = slot + 1;
+    sqe->user_data = ((uint64_t)slot << 8) | (uint64_t)op;
+    uring_push(w);
+    return 0;
+}
+
+static void uring_finish_slot(FileWriter *w, unsigned slot) {
+    FileSlot *s = &w->slots[slot];
+
+    // Escrita curta ou cadeia cancelada: o erro original ja foi registrado
+    if ((!s->error || s->error == ECANCELED) && s->written != s->len) s->error = EIO;
+    if (s->error == ECANCELED) s->error = EIO;
+
+    FileWriterDone done = s->done;
+    void *tag = s->tag;
+    int error = s->error;
+
+    free(s->path);
+    memset(s, 0, sizeof(*s));
+    w->free_slots[w->free_count++] = slot;
+
+    if (done) done(tag, error);
+}
+
+// Processa as CQEs disponiveis
+static void uring_reap(FileWriter *w) {
+    unsigned head = *w->cq_head;
+    unsigned tail = LOAD(w->cq_tail);
+
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &w->cqes[head & *w->cq_mask];
+        unsigned slot = (unsigned)(cqe->user_data >> 8);
+        int op = (int)(cqe->user_data & 0xff);
+        int res = cqe->res;
+        head++;
+        STORE(w->cq_head, head);
+        w->inflight--;
+
+        FileSlot *s = &w->slots[slot];
+        s->pending--;
+
+        if (res < 0) {
+            if (!s->error || s->error == ECANCELED) s->error = -res;
+        } else if (op == OP_OPEN) {
+            s->opened = 1;
+        } else if (op == OP_WRITE) {
+            s->written += (size_t)res;
+        } else {
+            s->closed = 1;
+        }
+
+        if (s->pending > 0) continue;
+
+        // Cadeia interrompida depois do open: o slot precisa ser fechado
+        // antes de ser reaproveitado
+        if (s->opened && !s->closed && op != OP_RECOVER && uring_close_slot(w, slot, OP_RECOVER) == 0) {
+            s->pending = 1;
+            continue;
+        }
+        uring_finish_slot(w, slot);
+    }
+}
+
+// Entrega o que esta na fila e espera pelo menos uma conclusao
+static int uring_wait(FileWriter *w) {
+    if (uring_enter(w, w->inflight ? 1 : 0) != 0) return -1;
+    uring_reap(w);
+    return 0;
+}
+
+static int uring_submit(FileWriter *w, const char *path, const char *data, size_t len,
+                        FileWriterDone done, void *tag) {
+    unsigned writes = len ? (unsigned)((len + WRITE_CHUNK - 1) / WRITE_CHUNK) : 0;
+    unsigned needed = writes + 2;
+    if (needed > w->sq_entries) return 1;   // grande demais para uma cadeia
+
+    // Espera slot livre, espaco no SQ e no CQ
+    while (w->free_count == 0 || *w->sq_tail - LOAD(w->sq_head) + needed > w->sq_entries ||
+           w->inflight + needed > w->cq_entries) {
+        if (uring_wait(w) != 0) return -1;
+    }
+
+    char *copy = strdup(path);
+    if (!copy) return -1;
+
+    unsigned slot = w->free_slots[--w->free_count];
+    FileSlot *s = &w->slots[slot];
+    memset(s, 0, sizeof(*s));
+    s->path = copy;
+    s->len = len;
+    s->done = done;
+    s->tag = tag;
+    s->pending = needed;
+
+    struct io_uring_sqe *sqe = uring_sqe(w);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)s->path;
+    sqe->len = 0644;
+    sqe->open_flags = OPEN_FLAGS & ~O_CLOEXEC;   // descritor fixo: o kernel recusa O_CLOEXEC
+    sqe->file_index = slot + 1;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = ((uint64_t)slot << 8) | OP_OPEN;
+    uring_push(w);
+
+    for (size_t off = 0; off < len; off += WRITE_CHUNK) {
+        size_t chunk = len - off < WRITE_CHUNK ? len - off : WRITE_CHUNK;
+        sqe = uring_sqe(w);
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = (int)slot;
+        sqe->addr = (uint64_t)(uintptr_t)(data + off);
+        sqe->len = (uint32_t)chunk;
+        sqe->off = off;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_LINK;
+        sqe->user_data = ((uint64_t)slot << 8) | OP_WRITE;
+        uring_push(w);
+    }
+
+    uring_close_slot(w, slot, OP_CLOSE);
+
+    // Envia em lote quando metade da fila de arquivos esta ocupada. O arquivo
+    // ja esta na fila: uma falha aqui volta no proximo envio ou no drain.
+    if (FILE_WRITER_DEPTH - w->free_count >= FILE_WRITER_DEPTH / 2 && uring_enter(w, 0) == 0) {
+        uring_reap(w);
+    }
+    return 0;
+}
+
+static void uring_teardown(FileWriter *w) {
+    if (w->sqes) munmap(w->sqes, w->sqes_len);
+    if (w->ring_map) munmap(w->ring_map, w->ring_map_len);
+    if (w->ring_fd >= 0) close(w->ring_fd);
+    w->sqes = NULL;
+    w->ring_map = NULL;
+    w->ring_fd = -1;
+}
+
+// Abre e fecha "." num slot fixo: confirma openat/close com descritor fixo
+// (kernel 5.15+) antes de confiar no caminho rapido
+static int uring_probe(FileWriter *w) {
+    struct io_uring_sqe *sqe = uring_sqe(w);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)".";
+    sqe->open_flags = O_RDONLY | O_DIRECTORY;
+    sqe->file_index = 1;
+    sqe->flags = IOSQE_IO_LINK;
+    uring_push(w);
+
+    sqe = uring_sqe(w);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = 1;
+    uring_push(w);
+
+    if (uring_enter(w, 2) != 0) return -1;
+
+    int ok = 1;
+    unsigned head = *w->cq_head;
+    while (head != LOAD(w->cq_tail)) {
+        if (w->cqes[head & *w->cq_mask].res < 0) ok = 0;
+        head++;
+        w->inflight--;
+    }
+    STORE(w->cq_head, head);
+    return ok && w->inflight == 0 ? 0 : -1;
+}
+
+static int uring_init(FileWriter *w) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    w->ring_fd = (int)syscall(__NR_io_uring_setup, FILE_WRITER_DEPTH * 8, &p);
+    if (w->ring_fd < 0) return -1;
+
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        uring_teardown(w);
+        return -1;
+    }
+
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    w->ring_map_len = sq_len > cq_len ? sq_len : cq_len;
+    w->ring_map = mmap(NULL, w->ring_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       w->ring_fd, IORING_OFF_SQ_RING);
+    if (w->ring_map == MAP_FAILED) {
+        w->ring_map = NULL;
+        uring_teardown(w);
+        return -1;
+    }
+
+    w->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    w->sqes = mmap(NULL, w->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   w->ring_fd, IORING_OFF_SQES);
+    if (w->sqes == MAP_FAILED) {
+        w->sqes = NULL;
+        uring_teardown(w);
+        return -1;
+    }
+
+    char *ring = w->ring_map;
+    w->sq_head = (unsigned *)(ring + p.sq_off.head);
+    w->sq_tail = (unsigned *)(ring + p.sq_off.tail);
+    w->sq_mask = (unsigned *)(ring + p.sq_off.ring_mask);
+    w->sq_array = (unsigned *)(ring + p.sq_off.array);
+    w->cq_head = (unsigned *)(ring + p.cq_off.head);
+    w->cq_tail = (unsigned *)(ring + p.cq_off.tail);
+    w->cq_mask = (unsigned *)(ring + p.cq_off.ring_mask);
+    w->cqes = (struct io_uring_cqe *)(ring + p.cq_off.cqes);
+    w->sq_entries = p.sq_entries;
+    w->cq_entries = p.cq_entries;
+
+    // Tabela de descritores fixos, toda vazia (-1)
+    int files[FILE_WRITER_DEPTH];
+    for (int i = 0; i < FILE_WRITER_DEPTH; i++) files[i] = -1;
+    if (syscall(__NR_io_uring_register, w->ring_fd, IORING_REGISTER_FILES, files, FILE_WRITER_DEPTH) < 0 ||
+        uring_probe(w) != 0) {
+        uring_teardown(w);
+        return -1;
+    }
+
+    for (unsigned i = 0; i < FILE_WRITER_DEPTH; i++) {
+        w->free_slots[i] = FILE_WRITER_DEPTH - 1 - i;
+    }
+    w->free_count = FILE_WRITER_DEPTH;
+    return 0;
+}
+
+#endif // HAVE_URING
+
+// API ---------------------------------------------------------------------
+
+FileWriter* file_writer_new(void) {
+    FileWriter *w = calloc(1, sizeof(FileWriter));
+    if (!w) return NULL;
+    w->backend = BACKEND_PWRITE;
+
+#ifdef HAVE_URING
+    w->ring_fd = -1;
+    const char *env = getenv("CURLSER_NO_URING");
+    if ((!env || !*env) && uring_init(w) == 0) {
+        w->backend = BACKEND_URING;
+    }
+#endif
+    return w;
+}
+
+int file_writer_submit(FileWriter *w, const char *path, const char *data, size_t len,
+                       FileWriterDone done, void *tag) {
+#ifdef HAVE_URING
+    if (w->backend == BACKEND_URING) {
+        int r = uring_submit(w, path, data, len, done, tag);
+        if (r <= 0) return r;
+        // Nao coube numa cadeia: grava direto
+    }
+#endif
+    int error = write_file_sync(path, data, len);
+    if (done) done(tag, error);
+    return 0;
+}
+
+void file_writer_drain(FileWriter *w) {
+#ifdef HAVE_URING
+    if (w->backend != BACKEND_URING) return;
+    while (w->inflight > 0 || w->to_submit > 0) {
+        if (uring_wait(w) != 0) break;
+    }
+#else
+    (void)w;
+#endif
+}
+
+const char* file_writer_backend(const FileWriter *w) {
+    return w->backend == BACKEND_URING ? "io_uring" : "pwrite";
+}
+
+void file_writer_free(FileWriter *w) {
+    if (!w) return;
+    file_writer_drain(w);
+#ifdef HAVE_URING
+    if (w->backend == BACKEND_URING) uring_teardown(w);
+#endif
+    free(w);
+}
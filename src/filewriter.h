@@ -0,0 +1,40 @@
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <stddef.h>
+
+// Grava muitos arquivos, cada um de uma vez (--output-dir). Com io_uring cada
+// arquivo e um openat + write(s) + close encadeados (IOSQE_IO_LINK) num slot
+// de descritor fixo, e varios arquivos vao ao kernel na mesma chamada: nao ha
+// uma syscall por etapa. Sem io_uring (kernel antigo, seccomp, outros
+// sistemas, ou CURLSER_NO_URING no ambiente) usa open + pwrite + close.
+//
+// Os dados nao sao copiados: o buffer passado precisa continuar valido ate
+// o callback de conclusao daquele arquivo ser chamado.
+
+// Arquivos em andamento ao mesmo tempo
+#define FILE_WRITER_DEPTH 32
+
+typedef struct FileWriter FileWriter;
+
+// Chamado quando o arquivo terminou de ser gravado; error e um errno ou 0
+typedef void (*FileWriterDone)(void *tag, int error);
+
+FileWriter* file_writer_new(void);
+
+// Enfileira a gravacao de path (criado ou truncado) com len bytes de data.
+// Pode esperar arquivos anteriores terminarem se a fila estiver cheia.
+// Retorna 0, ou -1 se o arquivo nem pode ser enfileirado (done nao e chamado).
+int file_writer_submit(FileWriter *w, const char *path, const char *data, size_t len,
+                       FileWriterDone done, void *tag);
+
+// Espera todos os arquivos enfileirados
+void file_writer_drain(FileWriter *w);
+
+// "io_uring" ou "pwrite"
+const char* file_writer_backend(const FileWriter *w);
+
+// Espera o que faltar e libera
+void file_writer_free(FileWriter *w);
+
+#endif // FILEWRITER_H
@@ -0,0 +1,736 @@
+#include "fixtures.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+#define FIXTURE_MAGIC       "CURLSFX1"
+#define FIXTURE_VERSION     1
+#define RECORD_MAGIC        0x52584643u     // "CFXR"
+
+// Inicio do arquivo; record_size tambem denuncia outra ordem de bytes
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+} FileHeader;
+
+// Cabecalho de cada registro, seguido de chave, Content-Type, headers, body,
+// um '\0' e preenchimento ate multiplo de 8
+typedef struct {
+    uint32_t magic;
+    uint32_t status;
+    uint64_t hash;              // hash da chave
+    uint64_t size;              // registro inteiro, cabecalho incluido
+    uint32_t key_len;
+    uint32_t content_type_len;
+    uint32_t headers_len;
+    uint32_t first_byte_us;
+    uint64_t total_us;
+    uint64_t body_len;
+} RecordHeader;
+
+// Tabela aberta (sondagem linear); offset 0 = vazio, ja que o primeiro
+// registro comeca depois do FileHeader
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;
+} IndexSlot;
+
+typedef struct {
+    IndexSlot *slots;
+    size_t mask;
+    size_t count;
+} FixtureIndex;
+
+struct FixtureStore {
+    const char *path;
+    int fd;
+    const char *map;
+    size_t map_len;
+    FixtureIndex index;         // chave completa
+    FixtureIndex path_index;    // chave sem esquema e host (servidor local)
+    int path_indexed;
+};
+
+// FNV-1a com finalizador splitmix64
+static uint64_t key_hash(const char *s, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ (unsigned char)s[i]) * 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void fixture_key(StrBuf *key, const char *method, const char *url,
+                 const char *const *headers, int header_count,
+                 const char *const *key_headers, int key_header_count) {
+    key->len = 0;
+    strbuf_printf(key, "%s %s", method ? method : "GET", url);
+
+    for (int i = 0; i < key_header_count; i++) {
+        size_t name_len = strlen(key_headers[i]);
+        const char *value = "";
+        size_t value_len = 0;
+
+        // Vale a ultima ocorrencia, como para o servidor
+        for (int j = 0; j < header_count; j++) {
+            const char *h = headers[j];
+            if (strncasecmp(h, key_headers[i], name_len) == 0 && h[name_len] == ':') {
+                value = h + name_len + 1;
+                while (*value == ' ' || *value == '\t') value++;
+                value_len = strcspn(value, "\r\n");
+                while (value_len > 0 && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) value_len--;
+            }
+        }
+
+        strbuf_putc(key, '\n');
+        for (size_t k = 0; k < name_len; k++) {
+            char c = key_headers[i][k];
+            strbuf_putc(key, c >= 'A' && c <= 'Z' ? (char)(c + 32) : c);
+        }
+        strbuf_puts(key, ": ");
+        strbuf_append(key, value, value_len);
+    }
+}
+
+// Chave sem esquema, host e fragmento: "GET https://h:1/a?b#c" -> "GET /a?b"
+static void path_key(StrBuf *out, const char *key, size_t len) {
+    const char *end = key + len;
+    const char *url = memchr(key, ' ', len);
+    url = url ? url + 1 : end;
+    const char *url_end = memchr(url, '\n', (size_t)(end - url));
+    if (!url_end) url_end = end;
+
+    const char *path = url;
+    const char *scheme = NULL;
+    for (const char *p = url; p + 3 <= url_end; p++) {
+        if (*p == '/' || *p == '?') break;
+        if (memcmp(p, "://", 3) == 0) {
+            scheme = p + 3;
+            break;
+        }
+    }
+    if (scheme) {
+        path = scheme;
+        while (path < url_end && *path != '/' && *path != '?' && *path != '#') path++;
+    }
+    const char *path_end = path;
+    while (path_end < url_end && *path_end != '#') path_end++;
+
+    out->len = 0;
+    strbuf_append(out, key, (size_t)(url - key));
+    if (path == path_end || *path != '/') strbuf_putc(out, '/');
+    strbuf_append(out, path, (size_t)(path_end - path));
+    strbuf_append(out, url_end, (size_t)(end - url_end));
+}
+
+#ifndef _WIN32
+
+static const RecordHeader* record_at(const FixtureStore *s, uint64_t offset) {
+    return (const RecordHeader *)(s->map + offset);
+}
+
+static void fill_fixture(const FixtureStore *s, uint64_t offset, Fixture *f) {
+    const RecordHeader *r = record_at(s, offset);
+    const char *p = (const char *)(r + 1);
+
+    f->key = p;
+    f->key_len = r->key_len;
+    p += r->key_len;
+    f->content_type = p;
+    f->content_type_len = r->content_type_len;
+    p += r->content_type_len;
+    f->headers = p;
+    f->headers_len = r->headers_len;
+    p += r->headers_len;
+    f->body = p;
+    f->body_len = (size_t)r->body_len;
+    f->status = (long)r->status;
+    f->first_byte_time = r->first_byte_us / 1e6;
+    f->total_time = r->total_us / 1e6;
+}
+
+typedef int (*SameKey)(const FixtureStore *s, uint64_t offset, const char *key, size_t len);
+
+static int same_key(const FixtureStore *s, uint64_t offset, const char *key, size_t len) {
+    const RecordHeader *r = record_at(s, offset);
+    return r->key_len == len && memcmp(r + 1, key, len) == 0;
+}
+
+static int same_path(const FixtureStore *s, uint64_t offset, const char *key, size_t len) {
+    const RecordHeader *r = record_at(s, offset);
+    StrBuf pk = {0};
+    path_key(&pk, (const char *)(r + 1), r->key_len);
+    int same = pk.len == len && memcmp(pk.data, key, len) == 0;
+    strbuf_free(&pk);
+    return same;
+}
+
+static int index_init(FixtureIndex *idx, size_t records) {
+    size_t cap = 16;
+    while (cap < records * 2) cap *= 2;
+    idx->slots = calloc(cap, sizeof(IndexSlot));
+    idx->mask = cap - 1;
+    idx->count = 0;
+    return idx->slots ? 0 : -1;
+}
+
+// Insere ou substitui (registro mais novo vence)
+static void index_put(const FixtureStore *s, FixtureIndex *idx, uint64_t hash, uint64_t offset,
+                      const char *key, size_t len, SameKey same) {
+    size_t i = (size_t)hash & idx->mask;
+    while (idx->slots[i].offset) {
+        if (idx->slots[i].hash == hash && same(s, idx->slots[i].offset, key, len)) {
+            idx->slots[i].offset = offset;
+            return;
+        }
+        i = (i + 1) & idx->mask;
+    }
+    idx->slots[i].hash = hash;
+    idx->slots[i].offset = offset;
+    idx->count++;
+}
+
+static uint64_t index_get(const FixtureStore *s, const FixtureIndex *idx, const char *key, size_t len,
+                          SameKey same) {
+    if (!idx->slots) return 0;
+    uint64_t hash = key_hash(key, len);
+    size_t i = (size_t)hash & idx->mask;
+    while (idx->slots[i].offset) {
+        if (idx->slots[i].hash == hash && same(s, idx->slots[i].offset, key, len)) {
+            return idx->slots[i].offset;
+        }
+        i = (i + 1) & idx->mask;
+    }
+    return 0;
+}
+
+// Registro inteiro dentro do arquivo e coerente
+static int record_valid(const FixtureStore *s, uint64_t offset) {
+    if (offset + sizeof(RecordHeader) > s->map_len) return 0;
+    const RecordHeader *r = record_at(s, offset);
+    uint64_t payload = (uint64_t)r->key_len + r->content_type_len + r->headers_len + r->body_len + 1;
+    return r->magic == RECORD_MAGIC && r->size >= sizeof(RecordHeader) + payload &&
+           r->size % 8 == 0 && r->size <= s->map_len - offset;
+}
+
+FixtureStore* fixture_store_open(const char *path) {
+    FixtureStore *s = calloc(1, sizeof(FixtureStore));
+    if (!s) return NULL;
+    s->path = path;
+
+    s->fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (s->fd < 0 || fstat(s->fd, &st) != 0) {
+        fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno));
+        fixture_store_close(s);
+        return NULL;
+    }
+
+    FileHeader fh;
+    s->map_len = (size_t)st.st_size;
+    if (s->map_len < sizeof(FileHeader) ||
+        pread(s->fd, &fh, sizeof(fh), 0) != (ssize_t)sizeof(fh) ||
+        memcmp(fh.magic, FIXTURE_MAGIC, 8) != 0 || fh.version != FIXTURE_VERSION ||
+        fh.record_size != sizeof(RecordHeader)) {
+        fprintf(stderr, "Error: %s is not a curlser fixture file\n", path);
+        fixture_store_close(s);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, s->map_len, PROT_READ, MAP_PRIVATE, s->fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: cannot map %s: %s\n", path, strerror(errno));
+        fixture_store_close(s);
+        return NULL;
+    }
+    s->map = map;
+    madvise(map, s->map_len, MADV_WILLNEED);
+
+    // Primeira passada so conta; um registro cortado no fim (gravacao
+    // interrompida) encerra o arquivo
+    size_t records = 0;
+    uint64_t offset = sizeof(FileHeader);
+    while (offset < s->map_len && record_valid(s, offset)) {
+        offset += record_at(s, offset)->size;
+        records++;
+    }
+    if (offset < s->map_len) {
+        fprintf(stderr, "Warning: %s: damaged record at offset %llu, ignoring the rest of the file\n",
+                path, (unsigned long long)offset);
+    }
+    uint64_t valid_end = offset;
+
+    if (index_init(&s->index, records) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        fixture_store_close(s);
+        return NULL;
+    }
+    for (offset = sizeof(FileHeader); offset < valid_end; offset += record_at(s, offset)->size) {
+        const RecordHeader *r = record_at(s, offset);
+        index_put(s, &s->index, r->hash, offset, (const char *)(r + 1), r->key_len, same_key);
+    }
+    return s;
+}
+
+static int write_all_v(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+FixtureStore* fixture_store_create(const char *path) {
+    FixtureStore *s = calloc(1, sizeof(FixtureStore));
+    if (!s) return NULL;
+    s->path = path;
+
+    s->fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    struct stat st;
+    if (s->fd < 0 || fstat(s->fd, &st) != 0) {
+        fprintf(stderr, "Error: cannot open %s: %s\n", path, strerror(errno));
+        fixture_store_close(s);
+        return NULL;
+    }
+
+    FileHeader fh;
+    if (st.st_size == 0) {
+        memset(&fh, 0, sizeof(fh));
+        memcpy(fh.magic, FIXTURE_MAGIC, 8);
+        fh.version = FIXTURE_VERSION;
+        fh.record_size = sizeof(RecordHeader);
+        struct iovec iov = { &fh, sizeof(fh) };
+        if (write_all_v(s->fd, &iov, 1) != 0) {
+            fprintf(stderr, "Error: cannot write %s: %s\n", path, strerror(errno));
+            fixture_store_close(s);
+            return NULL;
+        }
+    } else if (pread(s->fd, &fh, sizeof(fh), 0) != (ssize_t)sizeof(fh) ||
+               memcmp(fh.magic, FIXTURE_MAGIC, 8) != 0 || fh.version != FIXTURE_VERSION ||
+               fh.record_size != sizeof(RecordHeader)) {
+        fprintf(stderr, "Error: %s is not a curlser fixture file\n", path);
+        fixture_store_close(s);
+        return NULL;
+    }
+    return s;
+}
+
+int fixture_store_append(FixtureStore *s, const Fixture *f) {
+    static const char zeros[8] = {0};
+    RecordHeader r;
+    memset(&r, 0, sizeof(r));
+
+    uint64_t payload = (uint64_t)f->key_len + f->content_type_len + f->headers_len + f->body_len + 1;
+    r.magic = RECORD_MAGIC;
+    r.status = (uint32_t)f->status;
+    r.hash = key_hash(f->key, f->key_len);
+    r.size = (sizeof(RecordHeader) + payload + 7) / 8 * 8;
+    r.key_len = (uint32_t)f->key_len;
+    r.content_type_len = (uint32_t)f->content_type_len;
+    r.headers_len = (uint32_t)f->headers_len;
+    r.first_byte_us = (uint32_t)(f->first_byte_time * 1e6);
+    r.total_us = (uint64_t)(f->total_time * 1e6);
+    r.body_len = f->body_len;
+
+    // Um unico writev com O_APPEND: registros de processos diferentes nao
+    // se misturam
+    struct iovec iov[6] = {
+        { &r, sizeof(r) },
+        { (void *)f->key, f->key_len },
+        { (void *)f->content_type, f->content_type_len },
+        { (void *)f->headers, f->headers_len },
+        { (void *)f->body, f->body_len },
+        { (void *)zeros, (size_t)(r.size - sizeof(RecordHeader) - payload + 1) },
+    };
+    if (write_all_v(s->fd, iov, 6) != 0) {
+        fprintf(stderr, "Error: cannot write %s: %s\n", s->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int fixture_store_find(const FixtureStore *s, const char *key, size_t key_len, Fixture *out) {
+    uint64_t offset = index_get(s, &s->index, key, key_len, same_key);
+    if (!offset) return 0;
+    fill_fixture(s, offset, out);
+    return 1;
+}
+
+// Indice por caminho: percorre os registros que o indice principal manteve
+static int build_path_index(FixtureStore *s) {
+    s->path_indexed = 1;
+    if (index_init(&s->path_index, s->index.count) != 0) return -1;
+
+    StrBuf pk = {0};
+    for (size_t i = 0; i <= s->index.mask; i++) {
+        uint64_t offset = s->index.slots[i].offset;
+        if (!offset) continue;
+        const RecordHeader *r = record_at(s, offset);
+        path_key(&pk, (const char *)(r + 1), r->key_len);
+        index_put(s, &s->path_index, key_hash(pk.data, pk.len), offset, pk.data, pk.len, same_path);
+    }
+    strbuf_free(&pk);
+    return 0;
+}
+
+int fixture_store_find_path(FixtureStore *s, const char *key, size_t key_len, Fixture *out) {
+    if (!s->path_indexed) build_path_index(s);
+
+    StrBuf pk = {0};
+    path_key(&pk, key, key_len);
+    uint64_t offset = index_get(s, &s->path_index, pk.data, pk.len, same_path);
+    strbuf_free(&pk);
+
+    if (!offset) return 0;
+    fill_fixture(s, offset, out);
+    return 1;
+}
+
+size_t fixture_store_count(const FixtureStore *s) {
+    return s->index.count;
+}
+
+void fixture_store_close(FixtureStore *s) {
+    if (!s) return;
+    if (s->map) munmap((void *)s->map, s->map_len);
+    if (s->fd >= 0) close(s->fd);
+    free(s->index.slots);
+    free(s->path_index.slots);
+    free(s);
+}
+
+// Servidor local --------------------------------------------------------------
+
+#define SERVE_REQUEST_MAX (64 * 1024)
+
+typedef struct {
+    FixtureStore *store;
+    const char *const *key_headers;
+    int key_header_count;
+    double latency;
+} ServeConfig;
+
+typedef struct {
+    const ServeConfig *config;
+    int fd;
+} ServeConnection;
+
+static void sleep_seconds(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static int header_is(const char *line, const char *end, const char *name) {
+    size_t n = strlen(name);
+    return (size_t)(end - line) > n && strncasecmp(line, name, n) == 0 && line[n] == ':';
+}
+
+// Headers da resposta final gravada, sem os que dependem da transferencia
+static void response_head(StrBuf *head, const Fixture *f, int close_connection) {
+    const char *start = f->headers;
+    const char *end = f->headers + f->headers_len;
+
+    // Com redirects ha varios blocos: vale o ultimo
+    for (const char *p = f->headers; p + 5 <= end; p++) {
+        if ((p == f->headers || p[-1] == '\n') && memcmp(p, "HTTP/", 5) == 0) start = p;
+    }
+
+    const char *line_end = memchr(start, '\n', (size_t)(end - start));
+    const char *reason = start < end ? memchr(start, ' ', (size_t)(end - start)) : NULL;
+    if (reason && line_end && reason < line_end) reason = memchr(reason + 1, ' ', (size_t)(line_end - reason - 1));
+    size_t reason_len = 0;
+    if (reason && line_end && reason < line_end) {
+        reason++;
+        reason_len = (size_t)(line_end - reason);
+        while (reason_len > 0 && (reason[reason_len - 1] == '\r' || reason[reason_len - 1] == ' ')) reason_len--;
+    }
+
+    head->len = 0;
+    strbuf_printf(head, "HTTP/1.1 %ld ", f->status);
+    if (reason_len) strbuf_append(head, reason, reason_len);
+    else strbuf_puts(head, "OK");
+    strbuf_puts(head, "\r\n");
+
+    const char *line = line_end ? line_end + 1 : end;
+    while (line < end) {
+        const char *next = memchr(line, '\n', (size_t)(end - line));
+        next = next ? next + 1 : end;
+        size_t len = (size_t)(next - line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+
+        // O body gravado ja esta decodificado e sera enviado de uma vez
+        if (len > 0 && !header_is(line, next, "Content-Length") && !header_is(line, next, "Transfer-Encoding") &&
+            !header_is(line, next, "Content-Encoding") && !header_is(line, next, "Connection") &&
+            !header_is(line, next, "Keep-Alive")) {
+            strbuf_append(head, line, len);
+            strbuf_puts(head, "\r\n");
+        }
+        line = next;
+    }
+
+    strbuf_printf(head, "Content-Length: %zu\r\n", f->body_len);
+    if (close_connection) strbuf_puts(head, "Connection: close\r\n");
+    strbuf_puts(head, "\r\n");
+}
+
+// Atende uma requisicao cujos headers estao em buf. buffered bytes depois
+// deles ja foram lidos; *consumed diz quantos eram do body. Retorna -1 para
+// fechar a conexao.
+static int serve_request(const ServeConfig *cfg, int fd, char *buf, size_t head_len, size_t buffered,
+                         size_t *consumed, int *close_connection) {
+    char method[16], target[8192], version[16];
+    if (sscanf(buf, "%15s %8191s %15s", method, target, version) != 3) return -1;
+
+    // Linhas de header, cada uma terminada em \r\n dentro de buf
+    const char *lines[128];
+    int count = 0;
+    size_t content_length = 0;
+    *close_connection = strcmp(version, "HTTP/1.0") == 0;
+
+    const char *line = strstr(buf, "\r\n") + 2;
+    const char *end = buf + head_len - 2;
+    while (line < end) {
+        const char *next = strstr(line, "\r\n");
+        if (header_is(line, next, "Content-Length")) {
+            content_length = strtoul(line + 15, NULL, 10);
+        } else if (header_is(line, next, "Connection")) {
+            const char *v = line + 11;
+            while (*v == ' ') v++;
+            *close_connection = strncasecmp(v, "close", 5) == 0;
+        }
+        if (count < 128) lines[count++] = line;
+        line = next + 2;
+    }
+
+    // Descarta o body da requisicao
+    size_t have = buffered < content_length ? buffered : content_length;
+    *consumed = have;
+    while (have < content_length) {
+        char tmp[16384];
+        size_t want = content_length - have < sizeof(tmp) ? content_length - have : sizeof(tmp);
+        ssize_t n = recv(fd, tmp, want, 0);
+        if (n <= 0) return -1;
+        have += (size_t)n;
+    }
+
+    StrBuf key = {0}, head = {0};
+    fixture_key(&key, method, target, lines, count, cfg->key_headers, cfg->key_header_count);
+
+    Fixture f;
+    int found = target[0] != '/' && fixture_store_find(cfg->store, key.data, key.len, &f);
+    if (!found) found = fixture_store_find_path(cfg->store, key.data, key.len, &f);
+
+    int rc;
+    if (!found) {
+        fprintf(stderr, "%s %s -> no fixture\n", method, target);
+        StrBuf body = {0};
+        strbuf_puts(&body, "{\"error\":\"no fixture\",\"key\":");
+        strbuf_json_string(&body, key.data, key.len);
+        strbuf_puts(&body, "}");
+        strbuf_printf(&head, "HTTP/1.1 404 Not Found\r\nContent-Type: application/json\r\n"
+                             "Content-Length: %zu\r\n%s\r\n", body.len,
+                      *close_connection ? "Connection: close\r\n" : "");
+        rc = net_send_all(fd, head.data, head.len);
+        if (rc == 0 && strcmp(method, "HEAD") != 0) rc = net_send_all(fd, body.data, body.len);
+        strbuf_free(&body);
+    } else {
+        fprintf(stderr, "%s %s -> %ld (%zu bytes)\n", method, target, f.status, f.body_len);
+        response_head(&head, &f, *close_connection);
+
+        sleep_seconds(f.first_byte_time * cfg->latency);
+        rc = net_send_all(fd, head.data, head.len);
+        sleep_seconds((f.total_time - f.first_byte_time) * cfg->latency);
+        if (rc == 0 && strcmp(method, "HEAD") != 0) rc = net_send_all(fd, f.body, f.body_len);
+    }
+
+    strbuf_free(&key);
+    strbuf_free(&head);
+    return rc;
+}
+
+static void* serve_connection(void *arg) {
+    ServeConnection *conn = (ServeConnection *)arg;
+    char *buf = malloc(SERVE_REQUEST_MAX + 1);
+    size_t len = 0;
+
+    while (buf) {
+        char *head_end;
+        buf[len] = '\0';
+        while (!(head_end = strstr(buf, "\r\n\r\n"))) {
+            if (len == SERVE_REQUEST_MAX) goto done;
+            ssize_t n = recv(conn->fd, buf + len, SERVE_REQUEST_MAX - len, 0);
+            if (n <= 0) goto done;
+            len += (size_t)n;
+            buf[len] = '\0';
+        }
+        size_t head_len = (size_t)(head_end - buf) + 4;
+
+        int close_connection;
+        size_t consumed = 0;
+        char saved = buf[head_len];
+        buf[head_len] = '\0';
+        int rc = serve_request(conn->config, conn->fd, buf, head_len, len - head_len, &consumed, &close_connection);
+        buf[head_len] = saved;
+        if (rc != 0 || close_connection) break;
+
+        // Guarda o que ja chegou da proxima requisicao
+        size_t used = head_len + consumed;
+        memmove(buf, buf + used, len - used);
+        len -= used;
+    }
+
+done:
+    free(buf);
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+int fixture_serve(FixtureStore *store, int port, const char *const *key_headers, int key_header_count,
+                  double latency) {
+    ServeConfig config = { store, key_headers, key_header_count, latency };
+
+    // Montado antes das threads: as buscas depois disso so leem
+    if (!store->path_indexed && build_path_index(store) != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        return -1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)port);
+    socklen_t addr_len = sizeof(addr);
+
+    if (listen_fd < 0 ||
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 128) != 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        fprintf(stderr, "Error: cannot listen on 127.0.0.1:%d: %s\n", port, strerror(errno));
+        if (listen_fd >= 0) close(listen_fd);
+        return -1;
+    }
+
+    printf("listening on 127.0.0.1:%d (%zu fixtures)\n", ntohs(addr.sin_port), fixture_store_count(store));
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "Error: accept: %s\n", strerror(errno));
+            close(listen_fd);
+            return -1;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        ServeConnection *conn = malloc(sizeof(ServeConnection));
+        pthread_t thread;
+        if (!conn) {
+            close(fd);
+            continue;
+        }
+        conn->config = &config;
+        conn->fd = fd;
+        if (pthread_create(&thread, NULL, serve_connection, conn) != 0) {
+            close(fd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+#else
+
+FixtureStore* fixture_store_create(const char *path) {
+    fprintf(stderr, "Error: fixture files are not supported on this platform (%s)\n", path);
+    return NULL;
+}
+
+FixtureStore* fixture_store_open(const char *path) {
+    return fixture_store_create(path);
+}
+
+int fixture_store_append(FixtureStore *s, const Fixture *f) {
+    (void)s;
+    (void)f;
+    return -1;
+}
+
+int fixture_store_find(const FixtureStore *s, const char *key, size_t key_len, Fixture *out) {
+    (void)s;
+    (void)key;
+    (void)key_len;
+    (void)out;
+    return 0;
+}
+
+int fixture_store_find_path(FixtureStore *s, const char *key, size_t key_len, Fixture *out) {
+    (void)path_key;
+    return fixture_store_find(s, key, key_len, out);
+}
+
+size_t fixture_store_count(const FixtureStore *s) {
+    (void)s;
+    return 0;
+}
+
+void fixture_store_close(FixtureStore *s) {
+    (void)s;
+}
+
+int fixture_serve(FixtureStore *store, int port, const char *const *key_headers, int key_header_count,
+                  double latency) {
+    (void)store;
+    (void)port;
+    (void)key_headers;
+    (void)key_header_count;
+    (void)latency;
+    return -1;
+}
+
+#endif // _WIN32
@@ -0,0 +1,73 @@
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "strbuf.h"
+
+// Arquivo de fixtures (--record, --replay): pares requisicao/resposta
+// acrescentados um depois do outro, sem reescrever nada. Cada registro traz o
+// hash da sua chave (metodo + URL + headers escolhidos), entao abrir o arquivo
+// para reproducao so percorre os cabecalhos dos registros para montar o
+// indice; headers e bodies sao servidos direto do mmap. Um registro posterior
+// com a mesma chave substitui o anterior. Os inteiros ficam na ordem de bytes
+// da maquina que gravou.
+
+#define FIXTURE_MAX_KEY_HEADERS 16
+
+// Resposta gravada. Nas consultas os ponteiros apontam para o mmap e valem
+// ate fixture_store_close; body e seguido de um '\0'.
+typedef struct {
+    const char *key;
+    size_t key_len;
+    long status;
+    const char *content_type;       // como veio no header, com parametros
+    size_t content_type_len;
+    const char *headers;            // headers de todas as respostas (redirects)
+    size_t headers_len;
+    const char *body;
+    size_t body_len;
+    double first_byte_time;         // segundos
+    double total_time;
+} Fixture;
+
+typedef struct FixtureStore FixtureStore;
+
+// Abre para gravacao (cria o arquivo se preciso; os registros sao
+// acrescentados com O_APPEND, inclusive por processos diferentes)
+FixtureStore* fixture_store_create(const char *path);
+
+// Abre para reproducao: mapeia o arquivo e monta o indice
+FixtureStore* fixture_store_open(const char *path);
+
+// Monta a chave de uma requisicao: "METODO URL" e, para cada nome em
+// key_headers, "\nnome: valor" com o valor do header da requisicao (vazio
+// se ausente). headers sao linhas "Nome: valor".
+void fixture_key(StrBuf *key, const char *method, const char *url,
+                 const char *const *headers, int header_count,
+                 const char *const *key_headers, int key_header_count);
+
+// Acrescenta um registro; retorna 0 ou -1
+int fixture_store_append(FixtureStore *store, const Fixture *fixture);
+
+// Procura a chave; retorna 1 e preenche *out, ou 0
+int fixture_store_find(const FixtureStore *store, const char *key, size_t key_len, Fixture *out);
+
+// Procura ignorando esquema e host da URL (a chave traz so o caminho, como
+// chega ao servidor local). O indice por caminho e montado na primeira busca.
+int fixture_store_find_path(FixtureStore *store, const char *key, size_t key_len, Fixture *out);
+
+// Registros distintos no indice
+size_t fixture_store_count(const FixtureStore *store);
+
+void fixture_store_close(FixtureStore *store);
+
+// Servidor HTTP local em 127.0.0.1:port (0 = porta livre) que responde com as
+// fixtures, casando metodo + caminho + key_headers; com URL absoluta na
+// linha de requisicao (uso como proxy) a URL inteira e usada. latency > 0
+// reproduz os tempos gravados multiplicados por esse fator. So retorna em
+// erro.
+int fixture_serve(FixtureStore *store, int port, const char *const *key_headers, int key_header_count,
+                  double latency);
+
+#endif // FIXTURES_H
@@ -0,0 +1,551 @@
+#include "binary.h"
+#include "../output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define BIN_MAX_DEPTH   1024
+#define BIN_MAX_HEADER  16      // maior cabecalho possivel (MessagePack ext32: 6, CBOR: 9)
+#define BIN_PREVIEW     32      // bytes de um binario exibidos em hexa
+
+// Payload em andamento
+enum {
+    PAYLOAD_NONE,
+    PAYLOAD_STRING,
+    PAYLOAD_BINARY,     // binario ou ext
+    PAYLOAD_TIMESTAMP   // ext -1 do MessagePack, decodificado no fim
+};
+
+typedef struct {
+    char type;                      // '{', '[' ou '(' (tag)
+    unsigned long long remaining;   // itens/pares restantes ou BIN_INDEFINITE
+    unsigned long long count;       // itens/pares completos
+    int key_next;                   // mapa: o proximo item e uma chave
+} BinFrame;
+
+typedef struct {
+    Formatter base;
+    BinDecoder decode;
+    const char *name;
+
+    unsigned char header[BIN_MAX_HEADER];  // cabecalho cortado entre blocos
+    size_t header_len;
+    unsigned long long offset;             // bytes consumidos
+
+    int payload;
+    unsigned long long payload_left;
+    unsigned long long payload_total;      // bytes do binario atual
+    const char *payload_close;             // "'" ou "')"
+    int indefinite;                        // string/binario CBOR em pedacos (BIN_STRING/BIN_BINARY)
+    unsigned char stamp[12];
+    size_t stamp_len;
+
+    BinFrame stack[BIN_MAX_DEPTH];
+    int depth;
+    int indent;
+    int line_start;
+    int failed;
+} BinaryFormatter;
+
+// Saida -------------------------------------------------------------------
+
+static void put_punct(char c) {
+    out_color(BOLD_WHITE);
+    out_putc(c);
+    out_color(RESET);
+}
+
+// Menor representacao que volta ao mesmo double
+static void put_double(double d) {
+    char buf[32];
+
+    if (isnan(d)) {
+        out_puts("NaN");
+        return;
+    }
+    if (isinf(d)) {
+        out_puts(d < 0 ? "-Infinity" : "Infinity");
+        return;
+    }
+
+    for (int prec = 1; prec <= 17; prec++) {
+        snprintf(buf, sizeof(buf), "%.*g", prec, d);
+        if (strtod(buf, NULL) == d) break;
+    }
+    out_puts(buf);
+
+    // Deixa claro que e ponto flutuante: 1.0 e nao 1
+    if (!strpbrk(buf, ".eE")) out_puts(".0");
+}
+
+static void put_string_bytes(const unsigned char *s, size_t n) {
+    size_t run = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = s[i];
+        if (c != '"' && c != '\\' && c >= 0x20) continue;
+
+        out_write((const char *)s + run, i - run);
+        run = i + 1;
+        switch (c) {
+            case '"':  out_puts("\\\""); break;
+            case '\\': out_puts("\\\\"); break;
+            case '\n': out_puts("\\n"); break;
+            case '\r': out_puts("\\r"); break;
+            case '\t': out_puts("\\t"); break;
+            default:   out_printf("\\u%04x", c); break;
+        }
+    }
+    out_write((const char *)s + run, n - run);
+}
+
+static void put_binary_bytes(BinaryFormatter *f, const unsigned char *s, size_t n) {
+    static const char hex[] = "0123456789abcdef";
+    size_t show = 0;
+
+    // So os primeiros BIN_PREVIEW bytes aparecem; o restante e so contado
+    if (f->payload_total < BIN_PREVIEW) {
+        show = BIN_PREVIEW - f->payload_total;
+        if (show > n) show = n;
+    }
+    for (size_t i = 0; i < show; i++) {
+        out_putc(hex[s[i] >> 4]);
+        out_putc(hex[s[i] & 0xF]);
+    }
+    f->payload_total += n;
+}
+
+// Estrutura ---------------------------------------------------------------
+
+static void close_payload(BinaryFormatter *f) {
+    if (f->payload == PAYLOAD_STRING || f->indefinite == BIN_STRING) {
+        out_putc('"');
+    } else if (f->payload == PAYLOAD_BINARY || f->indefinite == BIN_BINARY) {
+        if (f->payload_total > BIN_PREVIEW) out_puts("\xE2\x80\xA6");
+        out_puts(f->payload_close);
+        if (f->payload_total > BIN_PREVIEW) {
+            out_color(DIM);
+            out_printf(" (%llu bytes)", f->payload_total);
+        }
+    }
+    out_color(RESET);
+    f->payload = PAYLOAD_NONE;
+    f->indefinite = 0;
+}
+
+// Para a formatacao: fecha o valor atual, imprime o marcador de elisao
+// e fecha todas as estruturas abertas
+static void binary_truncate(BinaryFormatter *f) {
+    if (f->payload != PAYLOAD_NONE || f->indefinite) {
+        close_payload(f);
+    }
+
+    if (!f->line_start) {
+        out_putc('\n');
+        out_indent(f->indent);
+    }
+    out_elision();
+
+    while (f->depth > 0) {
+        BinFrame *fr = &f->stack[--f->depth];
+        if (fr->type == '(') {
+            out_color(BLUE);
+            out_putc(')');
+            out_color(RESET);
+            continue;
+        }
+        f->indent--;
+        out_putc('\n');
+        out_indent(f->indent);
+        put_punct(fr->type == '{' ? '}' : ']');
+    }
+    out_putc('\n');
+
+    f->base.stopped = 1;
+}
+
+static void value_done(BinaryFormatter *f);
+
+static void close_container(BinaryFormatter *f) {
+    BinFrame *fr = &f->stack[--f->depth];
+
+    if (fr->type == '(') {
+        out_color(BLUE);
+        out_putc(')');
+        out_color(RESET);
+    } else {
+        f->indent--;
+        if (fr->count > 0) {
+            out_putc('\n');
+            out_indent(f->indent);
+        }
+        put_punct(fr->type == '{' ? '}' : ']');
+    }
+
+    value_done(f);
+}
+
+static void value_done(BinaryFormatter *f) {
+    f->line_start = 0;
+
+    if (f->depth == 0) {
+        // Varias mensagens seguidas: uma por linha
+        out_putc('\n');
+        return;
+    }
+
+    BinFrame *fr = &f->stack[f->depth - 1];
+    if (fr->type == '{' && fr->key_next) {
+        fr->key_next = 0;
+        put_punct(':');
+        out_putc(' ');
+        return;
+    }
+
+    fr->count++;
+    fr->key_next = 1;
+    if (fr->remaining != BIN_INDEFINITE && --fr->remaining == 0) {
+        close_container(f);
+    }
+}
+
+// Separador e indentacao antes de um item; retorna 0 se a saida parou
+static int begin_value(BinaryFormatter *f) {
+    if (f->depth > 0) {
+        BinFrame *fr = &f->stack[f->depth - 1];
+
+        if (fr->type != '(' && fr->key_next) {
+            if (fr->count > 0) put_punct(',');
+            out_putc('\n');
+            out_indent(f->indent);
+            f->line_start = 1;
+
+            if (f->depth == 1 && out_max_items() > 0 && (long long)fr->count >= out_max_items()) {
+                binary_truncate(f);
+                return 0;
+            }
+        }
+    }
+
+    if (out_limit_reached()) {
+        binary_truncate(f);
+        return 0;
+    }
+
+    f->line_start = 0;
+    return 1;
+}
+
+static int push_frame(BinaryFormatter *f, char type, unsigned long long remaining) {
+    if (f->depth == BIN_MAX_DEPTH) {
+        f->failed = 1;
+        return -1;
+    }
+
+    BinFrame *fr = &f->stack[f->depth++];
+    fr->type = type;
+    fr->remaining = remaining;
+    fr->count = 0;
+    fr->key_next = 1;
+    if (type != '(') f->indent++;
+    return 0;
+}
+
+static void print_timestamp(BinaryFormatter *f) {
+    const unsigned char *b = f->stamp;
+    long long sec;
+    unsigned long nsec = 0;
+
+    if (f->stamp_len == 4) {
+        sec = ((long long)b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+    } else if (f->stamp_len == 8) {
+        unsigned long long v = 0;
+        for (int i = 0; i < 8; i++) v = (v << 8) | b[i];
+        nsec = (unsigned long)(v >> 34);
+        sec = (long long)(v & 0x3FFFFFFFFULL);
+    } else {
+        unsigned long long v = 0;
+        nsec = ((unsigned long)b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+        for (int i = 4; i < 12; i++) v = (v << 8) | b[i];
+        sec = (long long)v;
+    }
+
+    char date[64];
+    time_t t = (time_t)sec;
+    struct tm *tm = gmtime(&t);
+
+    out_color(CYAN);
+    if (tm && strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", tm) > 0) {
+        out_printf("timestamp(%s", date);
+        if (nsec) out_printf(".%09lu", nsec);
+        out_puts("Z)");
+    } else {
+        out_printf("timestamp(%lld, %lu)", sec, nsec);
+    }
+    out_color(RESET);
+}
+
+static void payload_done(BinaryFormatter *f) {
+    if (f->payload == PAYLOAD_TIMESTAMP) {
+        print_timestamp(f);
+        f->payload = PAYLOAD_NONE;
+        value_done(f);
+        return;
+    }
+
+    // Pedaco de uma string indefinida: o valor so termina no break
+    if (f->indefinite) {
+        f->payload = PAYLOAD_NONE;
+        return;
+    }
+
+    close_payload(f);
+    value_done(f);
+}
+
+static void begin_payload(BinaryFormatter *f, int payload, unsigned long long len) {
+    f->payload = payload;
+    f->payload_left = len;
+    if (len == 0) payload_done(f);
+}
+
+static void print_token(BinaryFormatter *f, const BinToken *t) {
+    // Pedacos de string/binario indefinido (CBOR) nao sao itens novos
+    if (f->indefinite && t->kind != BIN_BREAK) {
+        if ((int)t->kind != f->indefinite || t->len == BIN_INDEFINITE) {
+            f->failed = 1;
+            return;
+        }
+        begin_payload(f, t->kind == BIN_STRING ? PAYLOAD_STRING : PAYLOAD_BINARY, t->len);
+        return;
+    }
+
+    if (t->kind == BIN_BREAK) {
+        if (f->indefinite) {
+            f->payload = PAYLOAD_NONE;
+            close_payload(f);
+            value_done(f);
+        } else if (f->depth > 0 && f->stack[f->depth - 1].remaining == BIN_INDEFINITE &&
+                   f->stack[f->depth - 1].key_next) {
+            close_container(f);
+        } else {
+            f->failed = 1;
+        }
+        return;
+    }
+
+    if (!begin_value(f)) return;
+
+    switch (t->kind) {
+        case BIN_UINT:
+            out_color(YELLOW);
+            out_printf("%llu", t->u);
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_NINT:
+            out_color(YELLOW);
+            if (t->u == BIN_INDEFINITE) out_puts("-18446744073709551616");
+            else out_printf("-%llu", t->u + 1);
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_INT:
+            out_color(YELLOW);
+            out_printf("%lld", t->i);
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_FLOAT:
+            out_color(YELLOW);
+            put_double(t->d);
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_BOOL:
+            out_color(MAGENTA);
+            out_puts(t->u ? "true" : "false");
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_NULL:
+        case BIN_UNDEFINED:
+            out_color(DIM);
+            out_puts(t->kind == BIN_NULL ? "null" : "undefined");
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_SIMPLE:
+            out_color(DIM);
+            out_printf("simple(%llu)", t->u);
+            out_color(RESET);
+            value_done(f);
+            break;
+
+        case BIN_STRING:
+            out_color(GREEN);
+            out_putc('"');
+            if (t->len == BIN_INDEFINITE) f->indefinite = BIN_STRING;
+            else begin_payload(f, PAYLOAD_STRING, t->len);
+            break;
+
+        case BIN_BINARY:
+            out_color(CYAN);
+            out_puts("h'");
+            f->payload_total = 0;
+            f->payload_close = "'";
+            if (t->len == BIN_INDEFINITE) f->indefinite = BIN_BINARY;
+            else begin_payload(f, PAYLOAD_BINARY, t->len);
+            break;
+
+        case BIN_EXT:
+            if (t->ext_type == -1 && (t->len == 4 || t->len == 8 || t->len == 12)) {
+                f->stamp_len = 0;
+                begin_payload(f, PAYLOAD_TIMESTAMP, t->len);
+                break;
+            }
+            out_color(CYAN);
+            out_printf("ext(%d, h'", t->ext_type);
+            f->payload_total = 0;
+            f->payload_close = "')";
+            begin_payload(f, PAYLOAD_BINARY, t->len);
+            break;
+
+        case BIN_ARRAY:
+        case BIN_MAP:
+            put_punct(t->kind == BIN_MAP ? '{' : '[');
+            if (t->len == 0) {
+                put_punct(t->kind == BIN_MAP ? '}' : ']');
+                value_done(f);
+            } else {
+                push_frame(f, t->kind == BIN_MAP ? '{' : '[', t->len);
+            }
+            break;
+
+        case BIN_TAG:
+            out_color(BLUE);
+            out_printf("%llu(", t->u);
+            out_color(RESET);
+            push_frame(f, '(', 1);
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Consome bytes de payload; retorna quantos foram usados
+static size_t feed_payload(BinaryFormatter *f, const unsigned char *p, size_t n) {
+    size_t take = n < f->payload_left ? n : (size_t)f->payload_left;
+
+    switch (f->payload) {
+        case PAYLOAD_STRING:
+            put_string_bytes(p, take);
+            break;
+        case PAYLOAD_BINARY:
+            put_binary_bytes(f, p, take);
+            break;
+        case PAYLOAD_TIMESTAMP:
+            memcpy(f->stamp + f->stamp_len, p, take);
+            f->stamp_len += take;
+            break;
+    }
+
+    f->payload_left -= take;
+    if (f->payload_left == 0) payload_done(f);
+    return take;
+}
+
+// Formatador ----------------------------------------------------------------
+
+static int binary_feed(Formatter *base, const char *data, size_t len) {
+    BinaryFormatter *f = (BinaryFormatter *)base;
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + len;
+    BinToken t;
+
+    while (p < end && !f->base.stopped && !f->failed) {
+        if (f->payload != PAYLOAD_NONE) {
+            size_t used = feed_payload(f, p, end - p);
+            p += used;
+            f->offset += used;
+            if (f->payload != PAYLOAD_NONE && out_limit_reached()) binary_truncate(f);
+            continue;
+        }
+
+        int used;
+        if (f->header_len == 0) {
+            used = f->decode(p, end - p, &t);
+            if (used == 0) {
+                // Cabecalho cortado no fim do bloco
+                f->header_len = end - p;
+                memcpy(f->header, p, f->header_len);
+                f->offset += f->header_len;
+                break;
+            }
+        } else {
+            // Completa o cabecalho guardado, um byte por vez
+            f->header[f->header_len++] = *p++;
+            f->offset++;
+            used = f->decode(f->header, f->header_len, &t);
+            if (used == 0) {
+                if (f->header_len == BIN_MAX_HEADER) used = -1;
+                else continue;
+            }
+            if (used > 0) {
+                f->header_len = 0;
+                used = 0;   // bytes ja contados
+            }
+        }
+
+        if (used < 0) {
+            f->failed = 1;
+            break;
+        }
+        p += used;
+        f->offset += used;
+        print_token(f, &t);
+    }
+
+    if (f->failed) {
+        binary_truncate(f);
+        out_flush();
+        fprintf(stderr, "%sError: invalid %s data at byte %llu%s\n",
+                color(RED), f->name, f->offset, color(RESET));
+    }
+
+    return f->base.stopped;
+}
+
+static void binary_finish(Formatter *base) {
+    BinaryFormatter *f = (BinaryFormatter *)base;
+
+    if (!f->base.stopped && !out_state.broken &&
+        (f->depth > 0 || f->payload != PAYLOAD_NONE || f->indefinite || f->header_len > 0)) {
+        binary_truncate(f);
+        out_flush();
+        fprintf(stderr, "%sError: unexpected end of %s data%s\n", color(RED), f->name, color(RESET));
+    }
+
+    out_color(RESET);
+    free(f);
+}
+
+Formatter* binary_formatter_new(BinDecoder decode, const char *name) {
+    BinaryFormatter *f = calloc(1, sizeof(BinaryFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = binary_feed;
+    f->base.finish = binary_finish;
+    f->decode = decode;
+    f->name = name;
+    return &f->base;
+}
@@ -0,0 +1,46 @@
+#ifndef BINARY_H
+#define BINARY_H
+
+#include "formatters.h"
+
+// Base comum dos formatadores de formatos binarios (MessagePack, CBOR).
+// Cada formato so decodifica o cabecalho de cada item; o formatador cuida
+// do payload de strings/binarios em streaming e imprime tudo no mesmo
+// layout colorido do JSON.
+
+#define BIN_INDEFINITE ((unsigned long long)-1)
+
+typedef enum {
+    BIN_UINT,           // u
+    BIN_NINT,           // -1 - u (inteiros negativos do CBOR)
+    BIN_INT,            // i
+    BIN_FLOAT,          // d
+    BIN_BOOL,           // u = 0 ou 1
+    BIN_NULL,
+    BIN_UNDEFINED,
+    BIN_SIMPLE,         // u
+    BIN_STRING,         // len bytes de payload (ou BIN_INDEFINITE)
+    BIN_BINARY,         // len bytes de payload (ou BIN_INDEFINITE)
+    BIN_ARRAY,          // len itens (ou BIN_INDEFINITE)
+    BIN_MAP,            // len pares (ou BIN_INDEFINITE)
+    BIN_EXT,            // ext_type + len bytes de payload (MessagePack)
+    BIN_TAG,            // u = numero da tag; o proximo item e o valor (CBOR)
+    BIN_BREAK           // fim de item de tamanho indefinido (CBOR)
+} BinKind;
+
+typedef struct {
+    BinKind kind;
+    unsigned long long u;
+    long long i;
+    double d;
+    unsigned long long len;
+    int ext_type;
+} BinToken;
+
+// Decodifica o cabecalho do item em p. Retorna os bytes consumidos,
+// 0 se ainda faltam bytes ou -1 se o byte inicial e invalido.
+typedef int (*BinDecoder)(const unsigned char *p, size_t n, BinToken *t);
+
+Formatter* binary_formatter_new(BinDecoder decode, const char *name);
+
+#endif // BINARY_H
@@ -0,0 +1,104 @@
+#include "binary.h"
+#include <string.h>
+#include <math.h>
+
+// Meia precisao (IEEE 754 binary16), RFC 8949 apendice D
+static double half_to_double(unsigned int half) {
+    int exp = (half >> 10) & 0x1f;
+    int mant = half & 0x3ff;
+    double v;
+
+    if (exp == 0) v = ldexp(mant, -24);
+    else if (exp != 31) v = ldexp(mant + 1024, exp - 25);
+    else v = mant == 0 ? INFINITY : NAN;
+
+    return (half & 0x8000) ? -v : v;
+}
+
+static int cbor_decode(const unsigned char *p, size_t avail, BinToken *t) {
+    if (avail == 0) return 0;
+
+    int major = p[0] >> 5;
+    int info = p[0] & 0x1f;
+    int extra;
+    unsigned long long arg = 0;
+
+    memset(t, 0, sizeof(*t));
+
+    // Argumento: no proprio byte ou em 1, 2, 4 ou 8 bytes seguintes
+    if (info < 24) {
+        extra = 0;
+        arg = (unsigned long long)info;
+    } else if (info <= 27) {
+        extra = 1 << (info - 24);
+        if (avail < (size_t)1 + extra) return 0;
+        for (int i = 1; i <= extra; i++) arg = (arg << 8) | p[i];
+    } else if (info == 31) {
+        extra = 0;
+        arg = BIN_INDEFINITE;
+    } else {
+        return -1;
+    }
+
+    switch (major) {
+        case 0:
+        case 1:
+            if (info == 31) return -1;
+            t->kind = major == 0 ? BIN_UINT : BIN_NINT;
+            t->u = arg;
+            break;
+
+        case 2:
+        case 3:
+        case 4:
+        case 5: {
+            static const BinKind kinds[] = { BIN_BINARY, BIN_STRING, BIN_ARRAY, BIN_MAP };
+            t->kind = kinds[major - 2];
+            t->len = arg;
+            break;
+        }
+
+        case 6:
+            if (info == 31) return -1;
+            t->kind = BIN_TAG;
+            t->u = arg;
+            break;
+
+        default:
+            // Tipo 7: simples, floats e break
+            if (info == 31) {
+                t->kind = BIN_BREAK;
+            } else if (info == 25) {
+                t->kind = BIN_FLOAT;
+                t->d = half_to_double((unsigned int)arg);
+            } else if (info == 26) {
+                unsigned int bits = (unsigned int)arg;
+                float v;
+                memcpy(&v, &bits, sizeof(v));
+                t->kind = BIN_FLOAT;
+                t->d = v;
+            } else if (info == 27) {
+                double v;
+                memcpy(&v, &arg, sizeof(v));
+                t->kind = BIN_FLOAT;
+                t->d = v;
+            } else if (arg == 20 || arg == 21) {
+                t->kind = BIN_BOOL;
+                t->u = arg == 21;
+            } else if (arg == 22) {
+                t->kind = BIN_NULL;
+            } else if (arg == 23) {
+                t->kind = BIN_UNDEFINED;
+            } else {
+                t->kind = BIN_SIMPLE;
+                t->u = arg;
+            }
+            break;
+    }
+
+    return 1 + extra;
+}
+
+Formatter* cbor_formatter_new(void) {
+    return binary_formatter_new(cbor_decode, "CBOR");
+}
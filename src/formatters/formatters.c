@@ -1,8 +1,17 @@
 #include "formatters.h"
-#include "../colors.h"
+#include "../output.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <strings.h>
+
+// Texto simples e saida raw: repassa os bytes, cortando no limite exato
+typedef struct {
+    Formatter base;
+    int raw;
+    char last;  // ultimo byte impresso
+} TextFormatter;
 
 // Converte string para minusculo para comparacao
 static void to_lower(char *str) {
@@ -39,6 +48,22 @@ ContentType detect_content_type(const char *content_type) {
         return CONTENT_HTML;
     }
 
+    // MessagePack
+    if (strstr(ct, "msgpack")) {
+        return CONTENT_MSGPACK;
+    }
+
+    // CBOR
+    if (strstr(ct, "application/cbor") ||
+        strstr(ct, "+cbor")) {
+        return CONTENT_CBOR;
+    }
+
+    // Server-Sent Events (antes de text/*)
+    if (strstr(ct, "text/event-stream")) {
+        return CONTENT_SSE;
+    }
+
     // Texto simples
     if (strstr(ct, "text/plain") ||
         strstr(ct, "text/")) {
@@ -48,30 +73,183 @@ ContentType detect_content_type(const char *content_type) {
     return CONTENT_UNKNOWN;
 }
 
-void format_text(const char *data) {
-    if (!data) return;
-    printf("%s%s%s\n", color(WHITE), data, color(RESET));
+int content_type_from_name(const char *name, ContentType *type) {
+    static const struct {
+        const char *name;
+        ContentType type;
+    } names[] = {
+        { "json", CONTENT_JSON },
+        { "xml", CONTENT_XML },
+        { "html", CONTENT_HTML },
+        { "text", CONTENT_TEXT },
+        { "msgpack", CONTENT_MSGPACK },
+        { "cbor", CONTENT_CBOR },
+        { "sse", CONTENT_SSE },
+    };
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcasecmp(name, names[i].name) == 0) {
+            *type = names[i].type;
+            return 0;
+        }
+    }
+
+    if (strchr(name, '/')) {
+        *type = detect_content_type(name);
+        return *type == CONTENT_UNKNOWN ? -1 : 0;
+    }
+    return -1;
 }
 
-void format_output(const char *content_type, const char *data) {
-    if (!data) return;
+// p comeca com s (sem diferenciar maiusculas)?
+static int starts_with(const char *p, const char *end, const char *s) {
+    size_t n = strlen(s);
+    return (size_t)(end - p) >= n && strncasecmp(p, s, n) == 0;
+}
 
-    ContentType type = detect_content_type(content_type);
+// Alguma tag tipica de HTML no trecho?
+static int has_html_tag(const char *p, const char *end) {
+    static const char *const tags[] = { "<html", "<head", "<body", "<div", "<meta", "<script", "<p>", "<br" };
 
+    for (; p < end; p++) {
+        if (*p != '<') continue;
+        for (size_t i = 0; i < sizeof(tags) / sizeof(tags[0]); i++) {
+            if (starts_with(p, end, tags[i])) return 1;
+        }
+    }
+    return 0;
+}
+
+ContentType sniff_content_type(const char *data, size_t len) {
+    const char *p = data;
+    const char *end = data + len;
+
+    // CBOR com a tag de autodescricao (55799)
+    if (len >= 3 && memcmp(p, "\xD9\xD9\xF7", 3) == 0) return CONTENT_CBOR;
+
+    if (starts_with(p, end, "\xEF\xBB\xBF")) p += 3;
+    while (p < end && isspace((unsigned char)*p)) p++;
+    if (p == end) return CONTENT_TEXT;
+
+    if (*p == '{' || *p == '[') return CONTENT_JSON;
+
+    if (*p == '<') {
+        if (starts_with(p, end, "<!doctype html") || starts_with(p, end, "<html")) return CONTENT_HTML;
+        if (starts_with(p, end, "<?xml")) return CONTENT_XML;
+        return has_html_tag(p, end) ? CONTENT_HTML : CONTENT_XML;
+    }
+
+    if (starts_with(p, end, "event:") || starts_with(p, end, "data:")) return CONTENT_SSE;
+
+    // Bytes de controle: binario desconhecido
+    for (const char *q = p; q < end; q++) {
+        unsigned char c = (unsigned char)*q;
+        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r' && c != '\f') return CONTENT_UNKNOWN;
+    }
+    return CONTENT_TEXT;
+}
+
+static int text_feed(Formatter *base, const char *data, size_t len) {
+    TextFormatter *f = (TextFormatter *)base;
+    size_t fit = out_fit(data, len);
+
+    out_write(data, fit);
+    if (fit > 0) f->last = data[fit - 1];
+
+    if (fit < len) {
+        // Ainda havia conteudo alem do limite
+        if (!f->raw) {
+            out_color(RESET);
+            if (f->last != '\n') out_putc('\n');
+            out_elision();
+        }
+        f->base.stopped = 1;
+    }
+
+    return f->base.stopped;
+}
+
+static void text_finish(Formatter *base) {
+    TextFormatter *f = (TextFormatter *)base;
+
+    if (!f->raw) {
+        out_color(RESET);
+        out_putc('\n');
+    }
+    free(f);
+}
+
+static Formatter* text_formatter_create(int raw) {
+    TextFormatter *f = calloc(1, sizeof(TextFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = text_feed;
+    f->base.finish = text_finish;
+    f->raw = raw;
+    if (!raw) out_color(WHITE);
+    return &f->base;
+}
+
+Formatter* text_formatter_new(void) {
+    return text_formatter_create(0);
+}
+
+Formatter* raw_formatter_new(void) {
+    return text_formatter_create(1);
+}
+
+Formatter* formatter_new(ContentType type) {
     switch (type) {
         case CONTENT_JSON:
-            format_json(data);
-            break;
+            return json_formatter_new();
         case CONTENT_XML:
-            format_xml(data);
-            break;
+            return xml_formatter_new();
         case CONTENT_HTML:
-            format_html(data);
-            break;
+            return html_formatter_new();
+        case CONTENT_MSGPACK:
+            return msgpack_formatter_new();
+        case CONTENT_CBOR:
+            return cbor_formatter_new();
+        case CONTENT_SSE:
+            return sse_formatter_new(NULL);
         case CONTENT_TEXT:
         case CONTENT_UNKNOWN:
         default:
-            format_text(data);
-            break;
+            return text_formatter_new();
     }
 }
+
+int formatter_feed(Formatter *f, const char *data, size_t len) {
+    if (!f->stopped && !out_state.broken && len > 0) {
+        STATS_CPU_BEGIN(t0);
+        f->feed(f, data, len);
+        STATS_CPU_END(t0, format_cpu_ns);
+    }
+    return f->stopped || out_state.broken;
+}
+
+void formatter_finish(Formatter *f) {
+    STATS_CPU_BEGIN(t0);
+    f->finish(f);
+    STATS_CPU_END(t0, format_cpu_ns);
+}
+
+void format_text(const char *data) {
+    if (!data) return;
+
+    Formatter *f = text_formatter_new();
+    if (!f) return;
+
+    formatter_feed(f, data, strlen(data));
+    formatter_finish(f);
+}
+
+void format_output(const char *content_type, const char *data) {
+    if (!data) return;
+
+    Formatter *f = formatter_new(detect_content_type(content_type));
+    if (!f) return;
+
+    formatter_feed(f, data, strlen(data));
+    formatter_finish(f);
+}
@@ -1,18 +1,131 @@
 #ifndef FORMATTERS_H
 #define FORMATTERS_H
 
+#include <stddef.h>
+
 // Tipos de conteudo suportados
 typedef enum {
     CONTENT_JSON,
     CONTENT_XML,
     CONTENT_HTML,
     CONTENT_TEXT,
+    CONTENT_MSGPACK,
+    CONTENT_CBOR,
+    CONTENT_SSE,
     CONTENT_UNKNOWN
 } ContentType;
 
+// Formatador incremental: recebe o body em blocos, na ordem em que chegam
+// da rede, e imprime a medida que processa. Cada formatador concreto
+// embute esta estrutura como primeiro campo.
+typedef struct Formatter Formatter;
+struct Formatter {
+    // Processa um bloco; retorna 1 quando nao precisa de mais dados
+    int (*feed)(Formatter *f, const char *data, size_t len);
+    // Fecha o que estiver aberto, imprime o final e libera o formatador
+    void (*finish)(Formatter *f);
+    // Limite de saida atingido: o restante do body e descartado
+    int stopped;
+};
+
 // Detecta o tipo de conteudo baseado no Content-Type header
 ContentType detect_content_type(const char *content_type);
 
+// Tipo pelo nome dado em --type: json, xml, html, text, msgpack, cbor, sse
+// ou um Content-Type ("application/ld+json"). Retorna 0, ou -1 se desconhecido.
+int content_type_from_name(const char *name, ContentType *type);
+
+// Adivinha o tipo pelos primeiros bytes de um body sem Content-Type
+// (arquivos e stdin). MessagePack e CBOR sem marca precisam de --type.
+ContentType sniff_content_type(const char *data, size_t len);
+
+// Cria o formatador adequado para o tipo de conteudo
+Formatter* formatter_new(ContentType type);
+
+// Formatador que repassa o body sem nenhuma formatacao (-r)
+Formatter* raw_formatter_new(void);
+
+// Alimenta o formatador; retorna 1 quando a transferencia pode ser abortada
+int formatter_feed(Formatter *f, const char *data, size_t len);
+
+// Finaliza a saida e libera o formatador
+void formatter_finish(Formatter *f);
+
+// Construtores dos formatadores incrementais
+Formatter* json_formatter_new(void);
+Formatter* xml_formatter_new(void);
+Formatter* html_formatter_new(void);
+Formatter* text_formatter_new(void);
+Formatter* msgpack_formatter_new(void);
+Formatter* cbor_formatter_new(void);
+
+// --unicode: o formatador JSON mostra \uXXXX fora do ASCII como UTF-8 e
+// destaca bytes UTF-8 invalidos e surrogates sem par dentro das strings
+extern int json_unicode;
+
+// Infere o esquema de um body JSON (--schema); json_schema = 1 imprime
+// um documento JSON Schema em vez do resumo compacto
+Formatter* schema_formatter_new(int json_schema);
+
+// Colunas do --csv que valem para todas as respostas de uma lista de URLs:
+// a primeira resposta com registros escolhe as colunas e imprime o
+// cabecalho; as seguintes so imprimem linhas
+#define TABLE_MAX_COLUMNS 64
+
+typedef struct {
+    char *names[TABLE_MAX_COLUMNS];
+    int count;                  // 0 = colunas ainda nao escolhidas
+} CsvColumns;
+
+void csv_columns_free(CsvColumns *columns);
+
+// Imprime um array JSON de objetos como tabela alinhada (--table) ou
+// CSV RFC 4180 (--csv), com colunas escolhidas pelos primeiros registros.
+// shared (so no CSV) pode ser NULL.
+Formatter* table_formatter_new(int csv, CsvColumns *shared);
+
+// JSON reimpresso a partir da arvore do documento inteiro. CANONICAL segue a
+// RFC 8785 (JCS): chaves ordenadas e unicas, numeros como no JavaScript, sem
+// espacos nem cores, para comparar ou assinar respostas.
+#define JSON_TREE_SORT_KEYS 1
+#define JSON_TREE_COMPACT   2
+#define JSON_TREE_CANONICAL 4
+Formatter* json_tree_formatter_new(int flags);
+
+// Seletor CSS compilado (--select): tag, #id, .classe, [atributo], os
+// combinadores descendente e '>', listas com ',' e, no fim, ::text ou
+// ::attr(nome). Retorna NULL com a mensagem em error.
+typedef struct HtmlSelector HtmlSelector;
+HtmlSelector* html_selector_parse(const char *css, char *error, size_t error_size);
+void html_selector_free(HtmlSelector *sel);
+
+// Imprime so os elementos (ou textos/atributos) de um HTML que casam com sel,
+// avaliado enquanto o body chega; sel precisa viver ate o finish
+Formatter* html_select_formatter_new(const HtmlSelector *sel);
+
+// Server-Sent Events: o que precisa sobreviver a uma resposta para
+// reconectar de onde o stream parou (--reconnect)
+#define SSE_MAX_ID 256
+
+typedef struct {
+    char last_id[SSE_MAX_ID];   // id do ultimo evento ("" = nenhum)
+    long retry_ms;              // ultimo "retry:" recebido (0 = nenhum)
+    unsigned long events;       // eventos impressos
+} SseState;
+
+// Imprime cada evento de um text/event-stream assim que ele termina, com o
+// "data" formatado como JSON quando for JSON. state pode ser NULL.
+Formatter* sse_formatter_new(SseState *state);
+
+// Cor da classe do codigo de status (2xx verde, 3xx amarelo, ...)
+const char* status_color(long status_code);
+
+// Imprime a linha de status com a cor da classe do codigo
+void print_status(long status_code);
+
+// Imprime os headers da resposta (todas as respostas, em caso de redirect)
+void print_headers(const char *headers);
+
 // Formata e imprime JSON com syntax highlighting
 void format_json(const char *data);
 
@@ -0,0 +1,72 @@
+#include "formatters.h"
+#include "../output.h"
+#include <ctype.h>
+#include <string.h>
+
+const char* status_color(long status_code) {
+    if (status_code >= 200 && status_code < 300) {
+        return GREEN;
+    } else if (status_code >= 300 && status_code < 400) {
+        return YELLOW;
+    } else if (status_code >= 400 && status_code < 500) {
+        return RED;
+    } else if (status_code >= 500) {
+        return BOLD_RED;
+    }
+    return WHITE;
+}
+
+void print_status(long status_code) {
+    out_color(status_color(status_code));
+    out_printf("HTTP Status: %ld", status_code);
+    out_color(RESET);
+    out_puts("\n\n");
+}
+
+void print_headers(const char *headers) {
+    if (!headers) return;
+
+    const char *p = headers;
+    while (*p) {
+        // Linha de status HTTP
+        if (strncmp(p, "HTTP/", 5) == 0) {
+            out_color(BOLD_CYAN);
+            while (*p && *p != '\r' && *p != '\n') {
+                out_putc(*p);
+                p++;
+            }
+            out_color(RESET);
+        }
+        // Nome do header
+        else if (isalpha(*p) || *p == '-') {
+            out_color(CYAN);
+            while (*p && *p != ':') {
+                out_putc(*p);
+                p++;
+            }
+            out_color(RESET);
+
+            if (*p == ':') {
+                out_color(BOLD_WHITE);
+                out_putc(':');
+                out_color(RESET);
+                p++;
+            }
+
+            // Valor do header
+            out_color(WHITE);
+            while (*p && *p != '\r' && *p != '\n') {
+                out_putc(*p);
+                p++;
+            }
+            out_color(RESET);
+        }
+
+        // Avanca para proxima linha
+        while (*p == '\r' || *p == '\n') {
+            out_putc(*p);
+            p++;
+        }
+    }
+    out_putc('\n');
+}
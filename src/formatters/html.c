@@ -1,6 +1,6 @@
 #include "formatters.h"
-#include "../colors.h"
-#include <stdio.h>
+#include "../output.h"
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
@@ -33,225 +33,405 @@ static int is_preformatted_tag(const char *tag, size_t len) {
     return 0;
 }
 
-void format_html(const char *data) {
-    if (!data) return;
+// Estados do formatador HTML
+typedef enum {
+    HTML_OUTSIDE,       // entre tags
+    HTML_WORD,          // palavra de texto
+    HTML_WORD_SPACE,    // whitespace depois de uma palavra
+    HTML_MARKUP,        // '<' pendente: tag, comentario, doctype ou fim de script
+    HTML_TAG_NAME,
+    HTML_TAG,           // dentro da tag, entre atributos
+    HTML_ATTR_NAME,
+    HTML_STRING,        // valor de atributo
+    HTML_COMMENT,
+    HTML_SCRIPT         // conteudo de <script>/<style>
+} HtmlState;
+
+typedef struct {
+    Formatter base;
+    HtmlState state;
+    HtmlState resume;       // estado ao sair de um comentario
+    int indent;
+    int in_script;
+    int in_style;
+    int is_closing_tag;
+    int needs_newline;
+    int script_run;         // cor do script/style ja aberta
+    int marker;             // '-' consecutivos no fim de comentario
+    char prev;              // ultimo byte processado
+    char pend[16];
+    int pend_len;
+    char current_tag[64];
+    int tag_name_idx;
+} HtmlFormatter;
+
+static void html_step(HtmlFormatter *f, char c);
+
+static void html_newline(HtmlFormatter *f) {
+    if (f->needs_newline) {
+        out_putc('\n');
+        out_indent(f->indent);
+        f->needs_newline = 0;
+    }
+}
 
-    int indent = 0;
-    int in_tag = 0;
-    int in_string = 0;
-    int in_comment = 0;
-    int in_script = 0;
-    int in_style = 0;
-    int is_closing_tag = 0;
-    int is_doctype = 0;
-    int needs_newline = 0;
-    char current_tag[64] = {0};
-    int tag_name_idx = 0;
-    const char *p = data;
+static void html_truncate(HtmlFormatter *f) {
+    if (f->state == HTML_STRING) out_putc('"');
+    out_color(RESET);
+    f->state = HTML_OUTSIDE;
 
-    while (*p) {
-        // Detect HTML comments
-        if (!in_string && strncmp(p, "<!--", 4) == 0) {
-            if (needs_newline) {
-                putchar('\n');
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
-                needs_newline = 0;
-            }
-            printf("%s<!--", color(DIM));
-            p += 4;
-            in_comment = 1;
-            continue;
-        }
+    out_putc('\n');
+    out_indent(f->indent);
+    out_elision();
 
-        if (in_comment) {
-            if (strncmp(p, "-->", 3) == 0) {
-                printf("-->%s", color(RESET));
-                p += 3;
-                in_comment = 0;
-                needs_newline = 1;
-                continue;
-            }
-            putchar(*p);
-            p++;
-            continue;
-        }
+    f->base.stopped = 1;
+}
 
-        // Script/style content (no formatting)
-        if (in_script || in_style) {
-            const char *end_tag = in_script ? "</script" : "</style";
-            if (strncasecmp(p, end_tag, strlen(end_tag)) == 0) {
-                in_script = 0;
-                in_style = 0;
-            } else {
-                printf("%s", color(in_script ? YELLOW : MAGENTA));
-                putchar(*p);
-                printf("%s", color(RESET));
-                p++;
-                continue;
-            }
-        }
+// Compara o markup pendente com um padrao: 2 = completo, 1 = prefixo, 0 = diferente
+static int html_match(const char *pend, int len, const char *pattern) {
+    int plen = (int)strlen(pattern);
+    if (len > plen || strncasecmp(pend, pattern, len) != 0) return 0;
+    return len == plen ? 2 : 1;
+}
 
-        // Inside string (attribute)
-        if (in_tag && (*p == '"' || *p == '\'')) {
-            char quote = *p;
-            if (!in_string) {
-                printf("%s%c", color(GREEN), quote);
-                in_string = 1;
-            } else {
-                printf("%c%s", quote, color(RESET));
-                in_string = 0;
-            }
-            p++;
-            continue;
-        }
+static void html_tag_start(HtmlFormatter *f, char next, int is_doctype) {
+    if (out_limit_reached()) {
+        html_truncate(f);
+        return;
+    }
 
-        if (in_string) {
-            putchar(*p);
-            p++;
-            continue;
-        }
+    f->is_closing_tag = (next == '/');
+    f->tag_name_idx = 0;
+    memset(f->current_tag, 0, sizeof(f->current_tag));
 
-        // Tag start
-        if (*p == '<') {
-            in_tag = 1;
-            is_closing_tag = (*(p + 1) == '/');
-            is_doctype = (strncasecmp(p + 1, "!doctype", 8) == 0);
-            tag_name_idx = 0;
-            memset(current_tag, 0, sizeof(current_tag));
-
-            if (is_closing_tag) {
-                indent--;
-                if (indent < 0) indent = 0;
-            }
+    if (f->is_closing_tag) {
+        f->indent--;
+        if (f->indent < 0) f->indent = 0;
+    }
 
-            if (needs_newline) {
-                putchar('\n');
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
-                needs_newline = 0;
-            }
+    html_newline(f);
 
-            printf("%s<%s", color(BLUE), color(RESET));
+    out_color(BLUE);
+    out_putc('<');
+    out_color(RESET);
 
-            if (is_doctype) {
-                printf("%s!DOCTYPE%s", color(MAGENTA), color(RESET));
-                p += 9;
-                continue;
-            }
+    if (is_doctype) {
+        out_color(MAGENTA);
+        out_puts("!DOCTYPE");
+        out_color(RESET);
+        f->state = HTML_TAG;
+        return;
+    }
 
-            if (is_closing_tag) {
-                printf("%s/", color(BLUE));
-                p += 2;
-            } else {
-                p++;
-            }
+    if (f->is_closing_tag) {
+        out_color(BLUE);
+        out_putc('/');
+    }
 
-            // Capture tag name
-            printf("%s", color(CYAN));
-            while (*p && *p != '>' && *p != '/' && !isspace(*p)) {
-                if (tag_name_idx < 63) {
-                    current_tag[tag_name_idx++] = tolower(*p);
-                }
-                putchar(*p);
-                p++;
-            }
-            printf("%s", color(RESET));
-            continue;
-        }
+    // Capture tag name
+    out_color(CYAN);
+    f->state = HTML_TAG_NAME;
+}
 
-        // Tag end
-        if (*p == '>') {
-            int is_self_closing = (p > data && *(p - 1) == '/');
-            size_t tag_len = strlen(current_tag);
+// O markup pendente nao e comentario nem doctype
+static void html_markup_resolve(HtmlFormatter *f) {
+    char pending[16];
+    int n = f->pend_len;
+
+    memcpy(pending, f->pend, n);
+    f->pend_len = 0;
+
+    if (f->in_script || f->in_style) {
+        const char *end_tag = f->in_script ? "</script" : "</style";
+        if (html_match(pending, n, end_tag) != 2) {
+            // Era so um '<' dentro do script
+            f->state = HTML_SCRIPT;
+            out_color(f->in_script ? YELLOW : MAGENTA);
+            out_putc(pending[0]);
+            f->script_run = 1;
+            for (int i = 1; i < n; i++) html_step(f, pending[i]);
+            return;
+        }
+        f->in_script = 0;
+        f->in_style = 0;
+    }
 
-            printf("%s>%s", color(BLUE), color(RESET));
-            in_tag = 0;
+    html_tag_start(f, n > 1 ? pending[1] : '\0', 0);
+    if (f->base.stopped) return;
 
-            if (!is_closing_tag && !is_self_closing && !is_void_tag(current_tag, tag_len)) {
-                indent++;
-            }
+    int skip = (n > 1 && pending[1] == '/') ? 2 : 1;
+    for (int i = skip; i < n && !f->base.stopped; i++) {
+        html_step(f, pending[i]);
+    }
+}
 
-            // Detect script/style
-            if (!is_closing_tag && tag_len > 0) {
-                if (strcmp(current_tag, "script") == 0) in_script = 1;
-                if (strcmp(current_tag, "style") == 0) in_style = 1;
-            }
+static void html_markup(HtmlFormatter *f, char c) {
+    f->pend[f->pend_len++] = c;
+
+    int comment = html_match(f->pend, f->pend_len, "<!--");
+    if (comment == 2) {
+        f->pend_len = 0;
+        html_newline(f);
+        out_color(DIM);
+        out_puts("<!--");
+        f->marker = 0;
+        f->state = HTML_COMMENT;
+        return;
+    }
 
-            needs_newline = 1;
-            is_doctype = 0;
-            p++;
-            continue;
+    int other;
+    if (f->in_script || f->in_style) {
+        other = html_match(f->pend, f->pend_len, f->in_script ? "</script" : "</style");
+        if (other == 2) {
+            html_markup_resolve(f);
+            return;
         }
-
-        // Self-closing tag slash
-        if (in_tag && *p == '/') {
-            printf("%s/", color(BLUE));
-            p++;
-            continue;
+    } else {
+        other = html_match(f->pend, f->pend_len, "<!doctype");
+        if (other == 2) {
+            f->pend_len = 0;
+            html_tag_start(f, '!', 1);
+            return;
         }
+    }
 
-        // Attribute name
-        if (in_tag && (isalpha(*p) || *p == '-' || *p == '_')) {
-            printf(" %s", color(YELLOW));
-            while (*p && *p != '=' && *p != '>' && *p != '/' && !isspace(*p)) {
-                putchar(*p);
-                p++;
-            }
-            printf("%s", color(RESET));
-            continue;
-        }
+    if (comment == 1 || other == 1) return;
 
-        // Equals sign in attribute
-        if (in_tag && *p == '=') {
-            printf("%s=%s", color(BOLD_WHITE), color(RESET));
-            p++;
-            continue;
-        }
+    html_markup_resolve(f);
+}
 
-        // Text content
-        if (!in_tag) {
-            // Skip whitespace between tags
-            if (isspace(*p)) {
-                const char *look = p;
-                while (*look && isspace(*look)) look++;
-                if (*look == '<') {
-                    p = look;
-                    continue;
-                }
-                // Significant whitespace
-                p++;
-                continue;
-            }
+static void html_tag_end(HtmlFormatter *f) {
+    int is_self_closing = (f->prev == '/');
+    size_t tag_len = strlen(f->current_tag);
 
-            // Actual text content
-            if (needs_newline) {
-                putchar('\n');
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
-                needs_newline = 0;
-            }
+    out_color(BLUE);
+    out_putc('>');
+    out_color(RESET);
+    f->state = HTML_OUTSIDE;
+
+    if (!f->is_closing_tag && !is_self_closing && !is_void_tag(f->current_tag, tag_len)) {
+        f->indent++;
+    }
+
+    // Detect script/style
+    if (!f->is_closing_tag && tag_len > 0) {
+        if (strcmp(f->current_tag, "script") == 0) f->in_script = 1;
+        if (strcmp(f->current_tag, "style") == 0) f->in_style = 1;
+    }
+    if (f->in_script || f->in_style) {
+        f->state = HTML_SCRIPT;
+        f->script_run = 0;
+    }
 
-            printf("%s", color(WHITE));
-            while (*p && *p != '<' && !isspace(*p)) {
-                putchar(*p);
-                p++;
+    f->needs_newline = 1;
+}
+
+static void html_markup_begin(HtmlFormatter *f, char c) {
+    f->resume = (f->in_script || f->in_style) ? HTML_SCRIPT : HTML_OUTSIDE;
+    f->pend[0] = c;
+    f->pend_len = 1;
+    f->state = HTML_MARKUP;
+}
+
+static void html_step(HtmlFormatter *f, char c) {
+    switch (f->state) {
+        case HTML_OUTSIDE:
+            if (c == '<') {
+                html_markup_begin(f, c);
+            } else if (!isspace((unsigned char)c)) {
+                // Actual text content
+                html_newline(f);
+                out_color(WHITE);
+                out_putc(c);
+                f->state = HTML_WORD;
             }
-            // Include spaces in text
-            while (*p && isspace(*p) && *(p + 1) && *(p + 1) != '<') {
-                putchar(' ');
-                while (*p && isspace(*p)) p++;
+            // Whitespace entre tags e no inicio do texto e descartado
+            break;
+
+        case HTML_WORD:
+            if (c == '<') {
+                out_color(RESET);
+                f->state = HTML_OUTSIDE;
+                html_step(f, c);
+                return;
             }
-            printf("%s", color(RESET));
-            continue;
-        }
+            if (isspace((unsigned char)c)) {
+                f->state = HTML_WORD_SPACE;
+            } else {
+                out_putc(c);
+            }
+            break;
+
+        case HTML_WORD_SPACE:
+            // Include spaces in text (whitespace colado na proxima tag e descartado)
+            if (c != '<') out_putc(' ');
+            out_color(RESET);
+            f->state = HTML_OUTSIDE;
+            html_step(f, c);
+            return;
+
+        case HTML_MARKUP:
+            html_markup(f, c);
+            break;
+
+        case HTML_TAG_NAME:
+            if (c == '>' || c == '/' || isspace((unsigned char)c)) {
+                out_color(RESET);
+                f->state = HTML_TAG;
+                html_step(f, c);
+                return;
+            }
+            if (f->tag_name_idx < 63) {
+                f->current_tag[f->tag_name_idx++] = tolower((unsigned char)c);
+            }
+            out_putc(c);
+            break;
+
+        case HTML_TAG:
+            if (c == '"' || c == '\'') {
+                out_color(GREEN);
+                out_putc(c);
+                f->state = HTML_STRING;
+            } else if (c == '<') {
+                html_markup_begin(f, c);
+                f->resume = HTML_TAG;
+            } else if (c == '>') {
+                html_tag_end(f);
+            } else if (c == '/') {
+                // Self-closing tag slash
+                out_color(BLUE);
+                out_putc('/');
+            } else if (isalpha((unsigned char)c) || c == '-' || c == '_') {
+                // Attribute name
+                out_putc(' ');
+                out_color(YELLOW);
+                out_putc(c);
+                f->state = HTML_ATTR_NAME;
+            } else if (c == '=') {
+                out_color(BOLD_WHITE);
+                out_putc('=');
+                out_color(RESET);
+            } else if (!isspace((unsigned char)c)) {
+                out_putc(c);
+            }
+            break;
+
+        case HTML_ATTR_NAME:
+            if (c == '=' || c == '>' || c == '/' || isspace((unsigned char)c)) {
+                out_color(RESET);
+                f->state = HTML_TAG;
+                html_step(f, c);
+                return;
+            }
+            out_putc(c);
+            break;
+
+        case HTML_STRING:
+            out_putc(c);
+            if (c == '"' || c == '\'') {
+                out_color(RESET);
+                f->state = HTML_TAG;
+            }
+            break;
+
+        case HTML_COMMENT:
+            if (c == '-') {
+                f->marker++;
+            } else if (c == '>' && f->marker >= 2) {
+                for (int i = 2; i < f->marker; i++) out_putc('-');
+                out_puts("-->");
+                out_color(RESET);
+                f->marker = 0;
+                f->needs_newline = 1;
+                f->state = f->resume;
+                f->script_run = 0;
+            } else {
+                for (int i = 0; i < f->marker; i++) out_putc('-');
+                f->marker = 0;
+                out_putc(c);
+            }
+            break;
+
+        case HTML_SCRIPT:
+            // Script/style content (no formatting)
+            if (c == '<') {
+                if (f->script_run) out_color(RESET);
+                f->script_run = 0;
+                html_markup_begin(f, c);
+                break;
+            }
+            if (!f->script_run) {
+                out_color(f->in_script ? YELLOW : MAGENTA);
+                f->script_run = 1;
+            }
+            out_putc(c);
+            break;
+    }
+
+    f->prev = c;
+}
 
-        // Spaces inside tag
-        if (in_tag && isspace(*p)) {
-            p++;
-            continue;
+static int html_feed(Formatter *base, const char *data, size_t len) {
+    HtmlFormatter *f = (HtmlFormatter *)base;
+    const char *p = data;
+    const char *end = data + len;
+
+    while (p < end && !f->base.stopped) {
+        if (f->state == HTML_SCRIPT && f->script_run) {
+            // Conteudo de script/style sai em blocos ate o proximo '<'
+            const char *run = p;
+            while (p < end && *p != '<') p++;
+            if (p > run) {
+                out_write(run, p - run);
+                f->prev = p[-1];
+            }
+            if (p == end) break;
         }
+        html_step(f, *p++);
+    }
+
+    if (!f->base.stopped && out_limit_reached() &&
+        (f->state == HTML_WORD || f->state == HTML_STRING ||
+         f->state == HTML_COMMENT || f->state == HTML_SCRIPT)) {
+        html_truncate(f);
+    }
+
+    return f->base.stopped;
+}
+
+static void html_finish(Formatter *base) {
+    HtmlFormatter *f = (HtmlFormatter *)base;
 
-        putchar(*p);
-        p++;
+    if (!f->base.stopped) {
+        if (f->state == HTML_MARKUP) {
+            html_markup_resolve(f);
+        }
+        if (f->state == HTML_COMMENT) {
+            for (int i = 0; i < f->marker; i++) out_putc('-');
+        }
     }
 
-    printf("%s\n", color(RESET));
+    out_color(RESET);
+    out_putc('\n');
+    free(f);
+}
+
+Formatter* html_formatter_new(void) {
+    HtmlFormatter *f = calloc(1, sizeof(HtmlFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = html_feed;
+    f->base.finish = html_finish;
+    f->state = HTML_OUTSIDE;
+    return &f->base;
+}
+
+void format_html(const char *data) {
+    if (!data) return;
+
+    Formatter *f = html_formatter_new();
+    if (!f) return;
+
+    formatter_feed(f, data, strlen(data));
+    formatter_finish(f);
 }
@@ -0,0 +1,1018 @@
+#include "formatters.h"
+#include "../output.h"
+#include "../strbuf.h"
+#include "../utf8.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+
+// Extracao por seletor CSS (--select). O HTML e tokenizado conforme chega e
+// cada elemento aberto fica numa pilha com dois mapas de bits: as posicoes
+// do seletor que um descendente ainda pode continuar e as que so um filho
+// direto continua. Um elemento novo testa apenas as posicoes que o pai deixou
+// abertas, entao casar custa O(1) por tag e nada do documento e guardado.
+// So os elementos que casam sao formatados; o resto e so tokenizado.
+
+#define SEL_MAX_COMPOUNDS   64      // um bit por posicao
+#define SEL_MAX_TESTS       16      // atributos, id e classes de uma posicao
+#define SEL_MAX_ATTRS       32      // atributos distintos citados no seletor
+#define SEL_MAX_NAME        32
+#define SEL_MAX_DEPTH       512
+#define SEL_MAX_TEXT        (1024 * 1024)
+
+typedef enum {
+    ATTR_EXISTS,        // [a]
+    ATTR_EQUALS,        // [a=v]
+    ATTR_WORD,          // [a~=v] e .classe
+    ATTR_PREFIX,        // [a^=v]
+    ATTR_SUFFIX,        // [a$=v]
+    ATTR_CONTAINS,      // [a*=v]
+    ATTR_LANG           // [a|=v]
+} AttrOp;
+
+typedef struct {
+    int attr;           // indice em HtmlSelector.attrs
+    AttrOp op;
+    char *value;
+    size_t value_len;
+} AttrTest;
+
+typedef enum {
+    OUTPUT_ELEMENT,
+    OUTPUT_TEXT,        // ::text
+    OUTPUT_ATTR         // ::attr(nome)
+} SelOutput;
+
+typedef struct {
+    char *tag;          // NULL = qualquer elemento
+    AttrTest tests[SEL_MAX_TESTS];
+    int test_count;
+    SelOutput output;   // so na ultima posicao de cada seletor
+    int output_attr;
+} Compound;
+
+struct HtmlSelector {
+    Compound compounds[SEL_MAX_COMPOUNDS];
+    int count;
+    uint64_t first;     // posicoes que comecam um seletor
+    uint64_t last;      // posicoes que terminam um seletor
+    uint64_t child;     // a posicao seguinte e filho direto ('>')
+    char *attrs[SEL_MAX_ATTRS];
+    int attr_count;
+    int has_element;
+};
+
+// Parser do seletor ------------------------------------------------------------
+
+typedef struct {
+    HtmlSelector *sel;
+    const char *p;
+    char *error;
+    size_t error_size;
+} SelParser;
+
+static int sel_fail(SelParser *ps, const char *what) {
+    snprintf(ps->error, ps->error_size, "%s at \"%s\"", what, *ps->p ? ps->p : "end");
+    return -1;
+}
+
+static int is_ident_char(char c) {
+    return isalnum((unsigned char)c) || c == '-' || c == '_' || (unsigned char)c >= 0x80;
+}
+
+static void skip_spaces(SelParser *ps) {
+    while (isspace((unsigned char)*ps->p)) ps->p++;
+}
+
+static char* sel_copy(const char *start, size_t n, int lower) {
+    char *s = malloc(n + 1);
+    if (!s) return NULL;
+    for (size_t i = 0; i < n; i++) s[i] = lower ? (char)tolower((unsigned char)start[i]) : start[i];
+    s[n] = '\0';
+    return s;
+}
+
+static char* sel_ident(SelParser *ps, int lower) {
+    const char *start = ps->p;
+    while (is_ident_char(*ps->p)) ps->p++;
+    size_t n = (size_t)(ps->p - start);
+    return n > 0 ? sel_copy(start, n, lower) : NULL;
+}
+
+// Indice do atributo na lista dos que o tokenizador guarda
+static int sel_attr_index(SelParser *ps, const char *name) {
+    HtmlSelector *sel = ps->sel;
+    for (int i = 0; i < sel->attr_count; i++) {
+        if (strcmp(sel->attrs[i], name) == 0) return i;
+    }
+    if (sel->attr_count == SEL_MAX_ATTRS) return -1;
+    sel->attrs[sel->attr_count] = strdup(name);
+    return sel->attrs[sel->attr_count] ? sel->attr_count++ : -1;
+}
+
+static int sel_add_test(SelParser *ps, Compound *c, const char *name, AttrOp op, char *value) {
+    int attr = sel_attr_index(ps, name);
+    if (attr < 0 || c->test_count == SEL_MAX_TESTS) {
+        free(value);
+        return sel_fail(ps, "too many attributes");
+    }
+    AttrTest *t = &c->tests[c->test_count++];
+    t->attr = attr;
+    t->op = op;
+    t->value = value;
+    t->value_len = value ? strlen(value) : 0;
+    return 0;
+}
+
+// [nome], [nome=valor], [nome="valor"] e os operadores ~= ^= $= *= |=
+static int sel_attribute(SelParser *ps, Compound *c) {
+    ps->p++;
+    skip_spaces(ps);
+    char *name = sel_ident(ps, 1);
+    if (!name) return sel_fail(ps, "expected an attribute name");
+    skip_spaces(ps);
+
+    AttrOp op = ATTR_EXISTS;
+    char *value = NULL;
+    if (*ps->p != ']') {
+        static const char ops[] = "~^$*|";
+        static const AttrOp op_codes[] = { ATTR_WORD, ATTR_PREFIX, ATTR_SUFFIX, ATTR_CONTAINS, ATTR_LANG };
+        const char *o = *ps->p ? strchr(ops, *ps->p) : NULL;
+
+        if (o && ps->p[1] == '=') {
+            op = op_codes[o - ops];
+            ps->p += 2;
+        } else if (*ps->p == '=') {
+            op = ATTR_EQUALS;
+            ps->p++;
+        } else {
+            free(name);
+            return sel_fail(ps, "expected ] or an attribute operator");
+        }
+        skip_spaces(ps);
+
+        if (*ps->p == '"' || *ps->p == '\'') {
+            char quote = *ps->p++;
+            const char *end = strchr(ps->p, quote);
+            if (!end) {
+                free(name);
+                return sel_fail(ps, "unterminated string");
+            }
+            value = sel_copy(ps->p, (size_t)(end - ps->p), 0);
+            ps->p = end + 1;
+        } else {
+            value = sel_ident(ps, 0);
+        }
+        if (!value) {
+            free(name);
+            return sel_fail(ps, "expected an attribute value");
+        }
+        skip_spaces(ps);
+    }
+
+    if (*ps->p != ']') {
+        free(name);
+        free(value);
+        return sel_fail(ps, "expected ]");
+    }
+    ps->p++;
+
+    int rc = sel_add_test(ps, c, name, op, value);
+    free(name);
+    return rc;
+}
+
+static int sel_compound(SelParser *ps, Compound *c) {
+    const char *start = ps->p;
+
+    if (*ps->p == '*') {
+        ps->p++;
+    } else if (is_ident_char(*ps->p)) {
+        c->tag = sel_ident(ps, 1);
+        if (!c->tag) return sel_fail(ps, "out of memory");
+    }
+
+    for (;;) {
+        if (*ps->p == '#' || *ps->p == '.') {
+            int id = *ps->p++ == '#';
+            char *value = sel_ident(ps, 0);
+            if (!value) return sel_fail(ps, id ? "expected an id" : "expected a class name");
+            if (sel_add_test(ps, c, id ? "id" : "class", id ? ATTR_EQUALS : ATTR_WORD, value) != 0) return -1;
+        } else if (*ps->p == '[') {
+            if (sel_attribute(ps, c) != 0) return -1;
+        } else {
+            break;
+        }
+    }
+
+    if (ps->p == start) return sel_fail(ps, "expected a selector");
+    if (*ps->p == ':' && ps->p[1] != ':') return sel_fail(ps, "pseudo-classes are not supported");
+    return 0;
+}
+
+// ::text ou ::attr(nome), so no fim de um seletor
+static int sel_pseudo(SelParser *ps, Compound *c) {
+    ps->p += 2;
+    if (strncmp(ps->p, "text", 4) == 0 && !is_ident_char(ps->p[4])) {
+        ps->p += 4;
+        c->output = OUTPUT_TEXT;
+        return 0;
+    }
+    if (strncmp(ps->p, "attr(", 5) == 0) {
+        ps->p += 5;
+        skip_spaces(ps);
+        char *name = sel_ident(ps, 1);
+        if (!name) return sel_fail(ps, "expected an attribute name");
+        skip_spaces(ps);
+        int attr = *ps->p == ')' ? sel_attr_index(ps, name) : -1;
+        free(name);
+        if (attr < 0) return sel_fail(ps, "expected )");
+        ps->p++;
+        c->output = OUTPUT_ATTR;
+        c->output_attr = attr;
+        return 0;
+    }
+    return sel_fail(ps, "expected ::text or ::attr(name)");
+}
+
+static int sel_complex(SelParser *ps) {
+    HtmlSelector *sel = ps->sel;
+    int child = 0;
+
+    skip_spaces(ps);
+    if (sel->count == SEL_MAX_COMPOUNDS) return sel_fail(ps, "selector too long");
+    sel->first |= 1ULL << sel->count;
+
+    for (;;) {
+        if (sel->count == SEL_MAX_COMPOUNDS) return sel_fail(ps, "selector too long");
+        if (child) sel->child |= 1ULL << (sel->count - 1);
+
+        Compound *c = &sel->compounds[sel->count++];
+        if (sel_compound(ps, c) != 0) return -1;
+
+        if (ps->p[0] == ':' && ps->p[1] == ':') {
+            if (sel_pseudo(ps, c) != 0) return -1;
+            skip_spaces(ps);
+            if (*ps->p && *ps->p != ',') return sel_fail(ps, "::text and ::attr() must end the selector");
+        }
+
+        const char *before = ps->p;
+        skip_spaces(ps);
+        if (*ps->p == '\0' || *ps->p == ',') {
+            sel->last |= 1ULL << (sel->count - 1);
+            return 0;
+        }
+        if (*ps->p == '+' || *ps->p == '~') return sel_fail(ps, "only the descendant and > combinators are supported");
+
+        child = *ps->p == '>';
+        if (child) {
+            ps->p++;
+            skip_spaces(ps);
+        } else if (ps->p == before) {
+            return sel_fail(ps, "unexpected character");
+        }
+    }
+}
+
+HtmlSelector* html_selector_parse(const char *css, char *error, size_t error_size) {
+    HtmlSelector *sel = calloc(1, sizeof(HtmlSelector));
+    if (!sel) {
+        snprintf(error, error_size, "out of memory");
+        return NULL;
+    }
+
+    SelParser ps = { sel, css, error, error_size };
+    for (;;) {
+        if (sel_complex(&ps) != 0) {
+            html_selector_free(sel);
+            return NULL;
+        }
+        if (*ps.p == '\0') break;
+        ps.p++;     // ','
+    }
+
+    // Saida de elemento precisa dos bytes de cada tag
+    for (int i = 0; i < sel->count; i++) {
+        if ((sel->last >> i & 1) && sel->compounds[i].output == OUTPUT_ELEMENT) sel->has_element = 1;
+    }
+    return sel;
+}
+
+void html_selector_free(HtmlSelector *sel) {
+    if (!sel) return;
+    for (int i = 0; i < sel->count; i++) {
+        Compound *c = &sel->compounds[i];
+        free(c->tag);
+        for (int t = 0; t < c->test_count; t++) free(c->tests[t].value);
+    }
+    for (int i = 0; i < sel->attr_count; i++) free(sel->attrs[i]);
+    free(sel);
+}
+
+// Tokenizador ------------------------------------------------------------------
+
+typedef enum {
+    SEL_TEXT,
+    SEL_RAW,            // conteudo de script/style/textarea/title
+    SEL_RAW_END,        // possivel "</script" dentro do conteudo
+    SEL_TAG_OPEN,       // logo depois de '<'
+    SEL_TAG_NAME,
+    SEL_ATTRS,
+    SEL_ATTR_NAME,
+    SEL_ATTR_EQ,        // depois do nome: '=' ou outro atributo
+    SEL_VALUE_START,
+    SEL_VALUE,
+    SEL_END_NAME,
+    SEL_END_REST,
+    SEL_BANG,           // "<!"
+    SEL_BANG_DASH,      // "<!-"
+    SEL_COMMENT,
+    SEL_DECL            // <!DOCTYPE ...>, <?...>
+} SelState;
+
+typedef struct {
+    char name[SEL_MAX_NAME];
+    uint64_t child;     // posicoes que um filho direto continua
+    uint64_t desc;      // posicoes que qualquer descendente continua
+} SelFrame;
+
+typedef struct {
+    Formatter base;
+    const HtmlSelector *sel;
+    SelState state;
+
+    char name[SEL_MAX_NAME];        // nome da tag atual (minusculo)
+    size_t name_len;
+    int self_closing;
+    char attr[64];                  // nome do atributo atual
+    size_t attr_len;
+    int attr_index;                 // em sel->attrs, -1 = nao interessa
+    char quote;                     // aspas do valor, 0 = sem aspas
+    size_t value_start;
+
+    // Valores dos atributos citados no seletor, da tag atual
+    StrBuf values;
+    size_t value_off[SEL_MAX_ATTRS];
+    size_t value_len[SEL_MAX_ATTRS];
+    uint32_t present;
+
+    char raw[SEL_MAX_NAME + 2];     // "</script" enquanto em SEL_RAW
+    size_t raw_len;
+    size_t raw_match;
+    int raw_text;                   // textarea/title contam para ::text
+    int dashes;                     // '-' seguidos dentro de um comentario
+
+    StrBuf tag;                     // bytes da tag atual (so com saida de elemento)
+
+    SelFrame *stack;
+    int depth;
+    int overflow;                   // aberturas alem de SEL_MAX_DEPTH
+
+    Formatter *element;             // elemento sendo impresso
+    int element_depth;              // profundidade dele (0 = nenhum)
+    StrBuf text;                    // ::text sendo montado
+    int text_depth;
+
+    long matches;
+} SelectFormatter;
+
+static const char *const void_elements[] = {
+    "area", "base", "br", "col", "embed", "hr", "img", "input",
+    "link", "meta", "param", "source", "track", "wbr", NULL
+};
+
+// Nao separam palavras no ::text
+static const char *const inline_elements[] = {
+    "a", "abbr", "b", "cite", "code", "em", "i", "kbd", "mark", "q", "s",
+    "small", "span", "strong", "sub", "sup", "time", "u", NULL
+};
+
+static int in_list(const char *const *list, const char *name) {
+    for (int i = 0; list[i]; i++) {
+        if (strcmp(list[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+static int is_raw_element(const char *name) {
+    return strcmp(name, "script") == 0 || strcmp(name, "style") == 0 ||
+           strcmp(name, "textarea") == 0 || strcmp(name, "title") == 0;
+}
+
+// Fechamentos implicitos mais comuns: <li> fecha o <li> aberto, <td> o
+// <td>/<th>, um bloco fecha o <p>
+static int closes_open(const char *name, const char *open) {
+    static const char *const blocks[] = {
+        "p", "div", "ul", "ol", "dl", "table", "h1", "h2", "h3", "h4", "h5", "h6",
+        "section", "article", "aside", "header", "footer", "nav", "pre", "form",
+        "blockquote", "hr", "main", "figure", NULL
+    };
+
+    if (strcmp(open, "p") == 0) return in_list(blocks, name);
+    if (strcmp(name, "li") == 0 || strcmp(name, "option") == 0) return strcmp(open, name) == 0;
+    if (strcmp(name, "td") == 0 || strcmp(name, "th") == 0) return strcmp(open, "td") == 0 || strcmp(open, "th") == 0;
+    if (strcmp(name, "dt") == 0 || strcmp(name, "dd") == 0) return strcmp(open, "dt") == 0 || strcmp(open, "dd") == 0;
+    if (strcmp(name, "tr") == 0) {
+        return strcmp(open, "tr") == 0 || strcmp(open, "td") == 0 || strcmp(open, "th") == 0;
+    }
+    return 0;
+}
+
+// Entidades mais comuns e numericas; as demais ficam como estao
+static size_t decode_entities(char *s, size_t n) {
+    static const struct { const char *name; const char *text; } entities[] = {
+        { "amp;", "&" }, { "lt;", "<" }, { "gt;", ">" }, { "quot;", "\"" },
+        { "apos;", "'" }, { "nbsp;", "\xc2\xa0" }
+    };
+
+    size_t o = 0;
+    for (size_t i = 0; i < n;) {
+        if (s[i] != '&') {
+            s[o++] = s[i++];
+            continue;
+        }
+
+        const char *rest = s + i + 1;
+        size_t left = n - i - 1;
+        size_t used = 0;
+        char buf[4];
+        size_t len = 0;
+
+        if (left > 2 && rest[0] == '#') {
+            int hex = rest[1] == 'x' || rest[1] == 'X';
+            size_t j = hex ? 2 : 1;
+            uint32_t cp = 0;
+            size_t digits = 0;
+            for (; j < left && digits < 8; j++, digits++) {
+                int d = utf8_hex_digit(rest[j]);
+                if (d < 0 || (!hex && d > 9)) break;
+                cp = cp * (hex ? 16 : 10) + (uint32_t)d;
+            }
+            if (digits > 0 && j < left && rest[j] == ';' && cp > 0 && cp <= 0x10FFFF &&
+                (cp < 0xD800 || cp > 0xDFFF)) {
+                len = utf8_encode(cp, buf);
+                used = j + 1;
+            }
+        } else {
+            for (size_t e = 0; e < sizeof(entities) / sizeof(entities[0]); e++) {
+                size_t m = strlen(entities[e].name);
+                if (left >= m && memcmp(rest, entities[e].name, m) == 0) {
+                    len = strlen(entities[e].text);
+                    memcpy(buf, entities[e].text, len);
+                    used = m;
+                    break;
+                }
+            }
+        }
+
+        if (used == 0) {
+            s[o++] = s[i++];
+            continue;
+        }
+        memcpy(s + o, buf, len);
+        o += len;
+        i += 1 + used;
+    }
+    return o;
+}
+
+// Emissao ----------------------------------------------------------------------
+
+// Antes de imprimir um resultado: para no limite de linhas/bytes
+static int select_can_emit(SelectFormatter *f) {
+    if (f->base.stopped) return 0;
+    if (out_limit_reached()) {
+        out_elision();
+        out_putc('\n');
+        f->base.stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+// Depois de um resultado: --max-items conta resultados, e a transferencia
+// para assim que o ultimo e impresso
+static void select_emitted(SelectFormatter *f) {
+    f->matches++;
+    if (!f->base.stopped && out_max_items() > 0 && f->matches >= out_max_items()) {
+        out_elision();
+        out_putc('\n');
+        f->base.stopped = 1;
+    }
+}
+
+static void select_print_value(SelectFormatter *f, const char *color, const char *s, size_t n) {
+    size_t fit = out_fit(s, n);
+    out_color(color);
+    out_write(s, fit);
+    out_color(RESET);
+    out_putc('\n');
+    if (fit < n) {
+        out_elision();
+        out_putc('\n');
+        f->base.stopped = 1;
+    }
+}
+
+static void select_element_end(SelectFormatter *f) {
+    Formatter *element = f->element;
+    f->element = NULL;
+    f->element_depth = 0;
+
+    int stopped = element->stopped;
+    element->finish(element);
+    if (stopped) f->base.stopped = 1;
+    select_emitted(f);
+}
+
+static void select_text_end(SelectFormatter *f) {
+    f->text_depth = 0;
+    if (!f->text.data) return;
+
+    // Espacos em sequencia viram um so
+    size_t n = decode_entities(f->text.data, f->text.len);
+    size_t o = 0;
+    int space = 1;
+    for (size_t i = 0; i < n; i++) {
+        char c = f->text.data[i];
+        if (isspace((unsigned char)c)) {
+            if (!space) f->text.data[o++] = ' ';
+            space = 1;
+        } else {
+            f->text.data[o++] = c;
+            space = 0;
+        }
+    }
+    if (o > 0 && f->text.data[o - 1] == ' ') o--;
+
+    if (o > 0 && select_can_emit(f)) {
+        select_print_value(f, WHITE, f->text.data, o);
+        select_emitted(f);
+    }
+    strbuf_reset(&f->text);
+}
+
+// Conteudo entre tags: vai para o elemento e o ::text abertos
+static void select_content(SelectFormatter *f, const char *s, size_t n, int is_text) {
+    if (n == 0) return;
+    if (f->element) {
+        if (f->element->feed(f->element, s, n)) f->base.stopped = 1;
+    }
+    if (f->text_depth && is_text && f->text.len < SEL_MAX_TEXT) {
+        strbuf_append(&f->text, s, n);
+    }
+}
+
+// A tag atual inteira, para o elemento sendo impresso
+static void select_feed_tag(SelectFormatter *f) {
+    if (f->element && f->tag.len > 0) {
+        if (f->element->feed(f->element, f->tag.data, f->tag.len)) f->base.stopped = 1;
+    }
+}
+
+static void select_text_break(SelectFormatter *f) {
+    if (f->text_depth && !in_list(inline_elements, f->name)) strbuf_putc(&f->text, ' ');
+}
+
+// Fecha os elementos acima de depth, encerrando o que era impresso neles
+static void select_pop_to(SelectFormatter *f, int depth) {
+    f->depth = depth;
+    if (f->element_depth > depth) select_element_end(f);
+    if (f->text_depth > depth) select_text_end(f);
+}
+
+// Valor do atributo i da tag atual (presente)
+static const char* attr_value(const SelectFormatter *f, int i, size_t *n) {
+    *n = f->value_len[i];
+    return f->values.data ? f->values.data + f->value_off[i] : "";
+}
+
+static int attr_test(const SelectFormatter *f, const AttrTest *t) {
+    if (!(f->present >> t->attr & 1)) return 0;
+    if (t->op == ATTR_EXISTS) return 1;
+
+    size_t n;
+    const char *v = attr_value(f, t->attr, &n);
+    size_t m = t->value_len;
+
+    switch (t->op) {
+        case ATTR_EQUALS:
+            return n == m && memcmp(v, t->value, m) == 0;
+        case ATTR_PREFIX:
+            return m > 0 && n >= m && memcmp(v, t->value, m) == 0;
+        case ATTR_SUFFIX:
+            return m > 0 && n >= m && memcmp(v + n - m, t->value, m) == 0;
+        case ATTR_LANG:
+            return n >= m && memcmp(v, t->value, m) == 0 && (n == m || v[m] == '-');
+        case ATTR_CONTAINS:
+            for (size_t i = 0; m > 0 && i + m <= n; i++) {
+                if (memcmp(v + i, t->value, m) == 0) return 1;
+            }
+            return 0;
+        case ATTR_WORD:
+            for (size_t i = 0; i < n;) {
+                while (i < n && isspace((unsigned char)v[i])) i++;
+                size_t start = i;
+                while (i < n && !isspace((unsigned char)v[i])) i++;
+                if (i - start == m && m > 0 && memcmp(v + start, t->value, m) == 0) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int compound_match(const SelectFormatter *f, const Compound *c) {
+    if (c->tag && strcmp(c->tag, f->name) != 0) return 0;
+    for (int i = 0; i < c->test_count; i++) {
+        if (!attr_test(f, &c->tests[i])) return 0;
+    }
+    return 1;
+}
+
+static void select_start_tag(SelectFormatter *f) {
+    const HtmlSelector *sel = f->sel;
+    int is_void = in_list(void_elements, f->name);
+    int leaf = is_void || f->self_closing;
+
+    while (f->depth > 0 && closes_open(f->name, f->stack[f->depth - 1].name)) {
+        select_pop_to(f, f->depth - 1);
+    }
+
+    select_text_break(f);
+    select_feed_tag(f);
+
+    // Posicoes que este elemento pode casar: o comeco de cada seletor e as
+    // que o pai deixou abertas
+    const SelFrame *parent = f->depth > 0 ? &f->stack[f->depth - 1] : NULL;
+    uint64_t open = parent ? parent->child | parent->desc : 0;
+    uint64_t candidates = sel->first | ((open & ~sel->last) << 1);
+    uint64_t matched = 0;
+
+    for (int i = 0; i < sel->count && (candidates >> i); i++) {
+        if ((candidates >> i & 1) && compound_match(f, &sel->compounds[i])) matched |= 1ULL << i;
+    }
+
+    // Resultados: um atributo sai na hora; elemento e ::text ate o fechamento
+    uint64_t hits = matched & sel->last;
+    for (int i = 0; hits >> i && !f->base.stopped; i++) {
+        if (!(hits >> i & 1)) continue;
+        const Compound *c = &sel->compounds[i];
+
+        if (c->output == OUTPUT_ATTR) {
+            if ((f->present >> c->output_attr & 1) && select_can_emit(f)) {
+                size_t n;
+                const char *value = attr_value(f, c->output_attr, &n);
+                select_print_value(f, GREEN, value, n);
+                select_emitted(f);
+            }
+        } else if (c->output == OUTPUT_TEXT) {
+            if (!f->text_depth && !leaf) f->text_depth = f->depth + 1;
+        } else if (!f->element && select_can_emit(f)) {
+            f->element = html_formatter_new();
+            if (!f->element) {
+                f->base.stopped = 1;
+                break;
+            }
+            f->element_depth = f->depth + 1;
+            select_feed_tag(f);
+        }
+    }
+
+    if (leaf) {
+        if (f->element_depth == f->depth + 1) select_element_end(f);
+        return;
+    }
+
+    if (f->depth == SEL_MAX_DEPTH) {
+        f->overflow++;
+    } else {
+        SelFrame *frame = &f->stack[f->depth++];
+        memcpy(frame->name, f->name, sizeof(frame->name));
+        frame->child = matched & sel->child & ~sel->last;
+        frame->desc = (parent ? parent->desc : 0) | (matched & ~sel->child & ~sel->last);
+    }
+
+    if (is_raw_element(f->name)) {
+        f->raw[0] = '<';
+        f->raw[1] = '/';
+        memcpy(f->raw + 2, f->name, f->name_len);
+        f->raw_len = f->name_len + 2;
+        f->raw_text = f->name[0] == 't';    // textarea, title
+        f->state = SEL_RAW;
+    }
+}
+
+static void select_end_tag(SelectFormatter *f) {
+    if (f->overflow > 0) {
+        f->overflow--;
+        select_feed_tag(f);
+        return;
+    }
+
+    int k = f->depth - 1;
+    while (k >= 0 && strcmp(f->stack[k].name, f->name) != 0) k--;
+
+    select_text_break(f);
+    // A tag vai para o elemento impresso se fecha ele ou algo dentro dele
+    if (k < 0 || f->element_depth <= k + 1) select_feed_tag(f);
+    if (k >= 0) select_pop_to(f, k);
+}
+
+// Tokenizador ------------------------------------------------------------------
+
+static void select_tag_begin(SelectFormatter *f) {
+    f->name_len = 0;
+    f->name[0] = '\0';
+    f->self_closing = 0;
+    f->present = 0;
+    strbuf_reset(&f->values);
+    strbuf_reset(&f->tag);
+}
+
+static void select_name_putc(SelectFormatter *f, char c) {
+    if (f->name_len < SEL_MAX_NAME - 1) {
+        f->name[f->name_len++] = (char)tolower((unsigned char)c);
+        f->name[f->name_len] = '\0';
+    }
+}
+
+static void select_attr_name_done(SelectFormatter *f) {
+    f->attr[f->attr_len < sizeof(f->attr) ? f->attr_len : sizeof(f->attr) - 1] = '\0';
+    f->attr_index = -1;
+    if (f->attr_len >= sizeof(f->attr)) return;
+
+    for (int i = 0; i < f->sel->attr_count; i++) {
+        if (strcmp(f->sel->attrs[i], f->attr) == 0) {
+            // Atributo repetido: vale o primeiro
+            if (!(f->present >> i & 1)) f->attr_index = i;
+            break;
+        }
+    }
+    f->value_start = f->values.len;
+}
+
+static void select_attr_done(SelectFormatter *f) {
+    int i = f->attr_index;
+    if (i < 0) return;
+
+    size_t n = f->values.data ? decode_entities(f->values.data + f->value_start, f->values.len - f->value_start) : 0;
+    f->values.len = f->value_start + n;
+    f->value_off[i] = f->value_start;
+    f->value_len[i] = n;
+    f->present |= 1u << i;
+    f->attr_index = -1;
+}
+
+static void select_value_append(SelectFormatter *f, const char *s, size_t n) {
+    if (f->attr_index >= 0) strbuf_append(&f->values, s, n);
+}
+
+static int select_feed(Formatter *base, const char *data, size_t len) {
+    SelectFormatter *f = (SelectFormatter *)base;
+    int keep_tags = f->sel->has_element;
+    size_t mark = 0;        // inicio da tag atual neste bloco
+    size_t i = 0;
+
+    while (i < len && !f->base.stopped) {
+        char c = data[i];
+
+        switch (f->state) {
+            case SEL_TEXT:
+            case SEL_RAW: {
+                const char *lt = memchr(data + i, '<', len - i);
+                size_t stop = lt ? (size_t)(lt - data) : len;
+                select_content(f, data + i, stop - i, f->state == SEL_TEXT || f->raw_text);
+                i = stop;
+                if (!lt) break;
+
+                select_tag_begin(f);
+                mark = i++;
+                if (f->state == SEL_RAW) {
+                    f->raw_match = 1;
+                    f->state = SEL_RAW_END;
+                } else {
+                    f->state = SEL_TAG_OPEN;
+                }
+                break;
+            }
+
+            case SEL_RAW_END:
+                if (f->raw_match == f->raw_len) {
+                    if (c == '>' || c == '/' || isspace((unsigned char)c)) {
+                        memcpy(f->name, f->raw + 2, f->raw_len - 2);
+                        f->name[f->raw_len - 2] = '\0';
+                        f->name_len = f->raw_len - 2;
+                        f->state = SEL_END_REST;
+                        break;      // reprocessa c
+                    }
+                } else if (tolower((unsigned char)c) == f->raw[f->raw_match]) {
+                    f->raw_match++;
+                    i++;
+                    break;
+                }
+                // Era so um '<' no conteudo
+                select_content(f, f->raw, f->raw_match, f->raw_text);
+                f->state = SEL_RAW;
+                break;
+
+            case SEL_TAG_OPEN:
+                if (isalpha((unsigned char)c)) {
+                    select_name_putc(f, c);
+                    f->state = SEL_TAG_NAME;
+                } else if (c == '/') {
+                    f->state = SEL_END_NAME;
+                } else if (c == '!') {
+                    f->state = SEL_BANG;
+                } else if (c == '?') {
+                    f->state = SEL_DECL;
+                } else {
+                    // '<' solto no texto
+                    select_content(f, "<", 1, 1);
+                    f->state = SEL_TEXT;
+                    break;
+                }
+                i++;
+                break;
+
+            case SEL_TAG_NAME:
+                if (c == '>' || c == '/' || isspace((unsigned char)c)) {
+                    f->state = SEL_ATTRS;
+                    break;
+                }
+                select_name_putc(f, c);
+                i++;
+                break;
+
+            case SEL_ATTRS:
+                if (c == '>') {
+                    if (keep_tags) strbuf_append(&f->tag, data + mark, i + 1 - mark);
+                    f->state = SEL_TEXT;
+                    i++;
+                    select_start_tag(f);
+                    break;
+                }
+                if (!isspace((unsigned char)c)) {
+                    f->self_closing = c == '/';
+                    if (c != '/' && c != '=') {
+                        f->attr[0] = (char)tolower((unsigned char)c);
+                        f->attr_len = 1;
+                        f->state = SEL_ATTR_NAME;
+                    }
+                }
+                i++;
+                break;
+
+            case SEL_ATTR_NAME:
+                if (c == '=' || c == '>' || c == '/' || isspace((unsigned char)c)) {
+                    select_attr_name_done(f);
+                    f->state = c == '=' ? SEL_VALUE_START : SEL_ATTR_EQ;
+                    if (c == '=') i++;
+                    break;
+                }
+                if (f->attr_len < sizeof(f->attr)) f->attr[f->attr_len] = (char)tolower((unsigned char)c);
+                f->attr_len++;
+                i++;
+                break;
+
+            case SEL_ATTR_EQ:
+                if (isspace((unsigned char)c)) {
+                    i++;
+                } else if (c == '=') {
+                    f->state = SEL_VALUE_START;
+                    i++;
+                } else {
+                    // Atributo sem valor
+                    select_attr_done(f);
+                    f->state = SEL_ATTRS;
+                }
+                break;
+
+            case SEL_VALUE_START:
+                if (isspace((unsigned char)c)) {
+                    i++;
+                } else if (c == '>') {
+                    select_attr_done(f);
+                    f->state = SEL_ATTRS;
+                } else {
+                    f->quote = (c == '"' || c == '\'') ? c : 0;
+                    if (f->quote) i++;
+                    f->state = SEL_VALUE;
+                }
+                break;
+
+            case SEL_VALUE:
+                if (f->quote) {
+                    const char *q = memchr(data + i, f->quote, len - i);
+                    size_t stop = q ? (size_t)(q - data) : len;
+                    select_value_append(f, data + i, stop - i);
+                    i = stop;
+                    if (!q) break;
+                    i++;
+                } else {
+                    size_t start = i;
+                    while (i < len && data[i] != '>' && !isspace((unsigned char)data[i])) i++;
+                    select_value_append(f, data + start, i - start);
+                    if (i == len) break;
+                }
+                select_attr_done(f);
+                f->state = SEL_ATTRS;
+                break;
+
+            case SEL_END_NAME:
+                if (c == '>' || c == '/' || isspace((unsigned char)c)) {
+                    f->state = SEL_END_REST;
+                    break;
+                }
+                select_name_putc(f, c);
+                i++;
+                break;
+
+            case SEL_END_REST: {
+                const char *gt = memchr(data + i, '>', len - i);
+                if (!gt) {
+                    i = len;
+                    break;
+                }
+                i = (size_t)(gt - data) + 1;
+                if (keep_tags) strbuf_append(&f->tag, data + mark, i - mark);
+                f->state = SEL_TEXT;
+                select_end_tag(f);
+                break;
+            }
+
+            case SEL_BANG:
+            case SEL_BANG_DASH:
+                if (c == '-') {
+                    f->state = f->state == SEL_BANG ? SEL_BANG_DASH : SEL_COMMENT;
+                    f->dashes = 0;
+                    i++;
+                } else {
+                    f->state = SEL_DECL;
+                }
+                break;
+
+            case SEL_COMMENT:
+            case SEL_DECL:
+                if (c == '>' && (f->state == SEL_DECL || f->dashes >= 2)) {
+                    i++;
+                    if (keep_tags) strbuf_append(&f->tag, data + mark, i - mark);
+                    f->state = SEL_TEXT;
+                    select_feed_tag(f);
+                    break;
+                }
+                f->dashes = c == '-' ? f->dashes + 1 : 0;
+                i++;
+                break;
+        }
+    }
+
+    // Tag cortada no fim do bloco: o resto chega no proximo
+    if (keep_tags && f->state != SEL_TEXT && f->state != SEL_RAW && mark < len) {
+        strbuf_append(&f->tag, data + mark, len - mark);
+    }
+
+    return f->base.stopped;
+}
+
+static void select_finish(Formatter *base) {
+    SelectFormatter *f = (SelectFormatter *)base;
+
+    // Documento cortado: imprime o que estava aberto
+    if (f->element) {
+        if (f->base.stopped) {
+            f->element->finish(f->element);
+            f->element = NULL;
+        } else {
+            select_element_end(f);
+        }
+    }
+    if (f->text_depth && !f->base.stopped) select_text_end(f);
+
+    out_color(RESET);
+    strbuf_free(&f->values);
+    strbuf_free(&f->tag);
+    strbuf_free(&f->text);
+    free(f->stack);
+    free(f);
+}
+
+Formatter* html_select_formatter_new(const HtmlSelector *sel) {
+    SelectFormatter *f = calloc(1, sizeof(SelectFormatter));
+    if (!f) return NULL;
+
+    f->stack = malloc(SEL_MAX_DEPTH * sizeof(SelFrame));
+    if (!f->stack) {
+        free(f);
+        return NULL;
+    }
+
+    f->base.feed = select_feed;
+    f->base.finish = select_finish;
+    f->sel = sel;
+    f->state = SEL_TEXT;
+    f->attr_index = -1;
+    return &f->base;
+}
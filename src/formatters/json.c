@@ -1,124 +1,445 @@
 #include "formatters.h"
-#include "../colors.h"
+#include "../output.h"
+#include "../utf8.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+// Profundidade maxima rastreada para fechar estruturas ao truncar
+#define JSON_MAX_DEPTH 1024
+
+int json_unicode = 0;
+
 // Estados do parser JSON
 typedef enum {
     STATE_NORMAL,
     STATE_STRING,
     STATE_STRING_ESCAPE,
+    STATE_STRING_UNICODE,       // \uXXXX sendo decodificado (--unicode)
     STATE_NUMBER,
     STATE_KEYWORD
 } JsonState;
 
-void format_json(const char *data) {
-    if (!data) return;
+typedef struct {
+    Formatter base;
+    JsonState state;
+    int indent;
+    int line_start;             // acabamos de imprimir quebra de linha + indentacao
+    char keyword[8];            // true/false/null ainda incompleto no fim do bloco
+    int keyword_len;
+    char stack[JSON_MAX_DEPTH]; // '{' ou '[' de cada nivel aberto
+    int depth;
+    long items;                 // itens completos no nivel mais externo
 
-    int indent = 0;
-    int in_string = 0;
-    int escape_next = 0;
-    const char *p = data;
+    // --unicode
+    char esc[12];               // "uXXXX" ou "uXXXX\uXXXX" depois da barra
+    int esc_len;
+    unsigned char utf8[4];      // sequencia multibyte cortada no fim do bloco
+    int utf8_len;
+    long invalid;               // bytes invalidos e surrogates sem par destacados
+} JsonFormatter;
+
+static const char *keywords[] = { "true", "false", "null", NULL };
+
+static void json_step(JsonFormatter *f, char c);
+
+static int is_number_char(char c) {
+    return isdigit((unsigned char)c) || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E';
+}
+
+// Para a formatacao: fecha o token atual, imprime o marcador de elisao
+// e fecha todos os objetos/arrays ainda abertos
+static void json_truncate(JsonFormatter *f) {
+    if (f->state == STATE_STRING || f->state == STATE_STRING_ESCAPE || f->state == STATE_STRING_UNICODE) {
+        out_putc('"');
+        out_color(RESET);
+    } else if (f->state == STATE_NUMBER) {
+        out_color(RESET);
+    }
+    f->state = STATE_NORMAL;
+    f->keyword_len = 0;
+
+    if (!f->line_start) {
+        out_putc('\n');
+        out_indent(f->indent);
+    }
+    out_elision();
 
-    // Pula whitespace inicial
-    while (*p && isspace(*p)) p++;
+    while (f->depth > 0) {
+        f->depth--;
+        char open = f->stack[f->depth < JSON_MAX_DEPTH ? f->depth : JSON_MAX_DEPTH - 1];
+        f->indent--;
+        out_putc('\n');
+        out_indent(f->indent);
+        out_color(BOLD_WHITE);
+        out_putc(open == '{' ? '}' : ']');
+        out_color(RESET);
+    }
+
+    f->base.stopped = 1;
+}
+
+// Prefixo pendente nao e keyword: imprime o primeiro caractere como veio
+// e reprocessa o restante
+static void json_keyword_fail(JsonFormatter *f) {
+    char pending[8];
+    int n = f->keyword_len - 1;
 
-    while (*p) {
-        if (escape_next) {
-            putchar(*p);
-            escape_next = 0;
-            p++;
-            continue;
+    memcpy(pending, f->keyword + 1, n);
+    out_putc(f->keyword[0]);
+    f->line_start = 0;
+    f->keyword_len = 0;
+    f->state = STATE_NORMAL;
+
+    for (int i = 0; i < n; i++) {
+        json_step(f, pending[i]);
+    }
+}
+
+static void json_keyword(JsonFormatter *f, char c) {
+    f->keyword[f->keyword_len++] = c;
+
+    for (int i = 0; keywords[i]; i++) {
+        size_t kw_len = strlen(keywords[i]);
+        if ((size_t)f->keyword_len <= kw_len &&
+            strncmp(keywords[i], f->keyword, f->keyword_len) == 0) {
+            if ((size_t)f->keyword_len == kw_len) {
+                out_color(keywords[i][0] == 'n' ? DIM : MAGENTA);
+                out_write(keywords[i], kw_len);
+                out_color(RESET);
+                f->keyword_len = 0;
+                f->line_start = 0;
+                f->state = STATE_NORMAL;
+            }
+            return;
         }
+    }
+
+    json_keyword_fail(f);
+}
 
-        if (*p == '\\' && in_string) {
-            printf("%s\\", color(YELLOW));
-            escape_next = 1;
-            p++;
-            continue;
+// UTF-8 e escapes \uXXXX (--unicode) ---------------------------------------
+
+// Bytes invalidos aparecem como \xHH destacados, visiveis mesmo sem cores
+static void json_invalid(JsonFormatter *f, const unsigned char *s, size_t n) {
+    out_color(BOLD_RED);
+    for (size_t i = 0; i < n; i++) out_printf("\\x%02X", s[i]);
+    out_color(GREEN);
+    f->invalid += (long)n;
+}
+
+// Sequencia multibyte em p, ou o resto da que ficou pendente no bloco
+// anterior; retorna onde a string continua
+static const char* json_utf8(JsonFormatter *f, const char *p, const char *end) {
+    unsigned char seq[4];
+    size_t have = (size_t)f->utf8_len;
+    size_t take = 0;
+
+    memcpy(seq, f->utf8, have);
+    while (have + take < 4 && p + take < end) {
+        seq[have + take] = (unsigned char)p[take];
+        take++;
+    }
+
+    int len = utf8_sequence(seq, have + take);
+    if (len < 0) {
+        memcpy(f->utf8, seq, have + take);
+        f->utf8_len = (int)(have + take);
+        return end;
+    }
+
+    f->utf8_len = 0;
+    if (len == 0) {
+        // Com bytes pendentes, o que faltava nao veio: o inicial e as
+        // continuacoes ja guardadas sao todos invalidos
+        json_invalid(f, seq, have ? have : 1);
+        return have ? p : p + 1;
+    }
+    out_write((const char *)seq, (size_t)len);
+    return p + (len - (int)have);
+}
+
+static unsigned hex4(const char *s) {
+    return (unsigned)(utf8_hex_digit(s[0]) << 12 | utf8_hex_digit(s[1]) << 8 | utf8_hex_digit(s[2]) << 4 | utf8_hex_digit(s[3]));
+}
+
+// Escape que fica como veio; surrogate sem par e destacado
+static void json_escape_literal(JsonFormatter *f, const char *s, int n, int invalid) {
+    out_color(invalid ? BOLD_RED : YELLOW);
+    out_putc('\\');
+    out_write(s, (size_t)n);
+    out_color(GREEN);
+    if (invalid) f->invalid++;
+}
+
+// Volta para a string e reprocessa o que foi lido alem do escape
+static void json_escape_replay(JsonFormatter *f, const char *s, int n) {
+    char pending[sizeof(f->esc)];
+
+    memcpy(pending, s, (size_t)n);
+    f->state = STATE_STRING;
+    f->esc_len = 0;
+    for (int i = 0; i < n; i++) {
+        json_step(f, pending[i]);
+    }
+}
+
+static void json_unicode_done(JsonFormatter *f, unsigned cp) {
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        json_escape_literal(f, f->esc, 5, 1);
+    } else if (cp < 0xA0) {
+        // ASCII e controles C1 continuam escapados
+        json_escape_literal(f, f->esc, 5, 0);
+    } else {
+        char buf[4];
+        out_write(buf, utf8_encode(cp, buf));
+    }
+    f->state = STATE_STRING;
+    f->esc_len = 0;
+}
+
+static void json_unicode_escape(JsonFormatter *f, char c) {
+    f->esc[f->esc_len++] = c;
+    int n = f->esc_len;
+
+    if (n <= 5) {
+        if (utf8_hex_digit(c) < 0) {
+            // Escape malformado: sai como veio
+            json_escape_literal(f, f->esc, n - 1, 0);
+            json_escape_replay(f, &c, 1);
+        } else if (n == 5) {
+            unsigned cp = hex4(f->esc + 1);
+            if (cp < 0xD800 || cp > 0xDBFF) json_unicode_done(f, cp);
+            // surrogate alto: espera o "\uDC00".."\uDFFF" seguinte
         }
+        return;
+    }
 
-        if (*p == '"') {
-            if (!in_string) {
-                printf("%s\"", color(GREEN));
-                in_string = 1;
+    int ok = n == 6 ? c == '\\' : n == 7 ? c == 'u' : utf8_hex_digit(c) >= 0;
+    if (ok && n == 11) {
+        unsigned low = hex4(f->esc + 7);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            json_unicode_done(f, 0x10000 + ((hex4(f->esc + 1) - 0xD800) << 10) + (low - 0xDC00));
+            return;
+        }
+        ok = 0;
+    }
+    if (ok) return;
+
+    json_escape_literal(f, f->esc, 5, 1);
+    json_escape_replay(f, f->esc + 5, n - 5);
+}
+
+// Fora de string
+static void json_normal(JsonFormatter *f, char c) {
+    if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        // Ignora whitespace extra
+        return;
+    }
+
+    if (out_limit_reached()) {
+        json_truncate(f);
+        return;
+    }
+
+    f->line_start = 0;
+
+    switch (c) {
+        case '"':
+            out_color(GREEN);
+            out_putc('"');
+            f->state = STATE_STRING;
+            break;
+
+        case '{':
+        case '[':
+            out_color(BOLD_WHITE);
+            out_putc(c);
+            out_color(RESET);
+            out_putc('\n');
+            f->indent++;
+            out_indent(f->indent);
+            f->line_start = 1;
+            if (f->depth < JSON_MAX_DEPTH) f->stack[f->depth] = c;
+            f->depth++;
+            break;
+
+        case '}':
+        case ']':
+            out_putc('\n');
+            f->indent--;
+            out_indent(f->indent);
+            out_color(BOLD_WHITE);
+            out_putc(c);
+            out_color(RESET);
+            if (f->depth > 0) f->depth--;
+            break;
+
+        case ':':
+            out_color(BOLD_WHITE);
+            out_putc(':');
+            out_color(RESET);
+            out_putc(' ');
+            break;
+
+        case ',':
+            out_color(BOLD_WHITE);
+            out_putc(',');
+            out_color(RESET);
+            out_putc('\n');
+            out_indent(f->indent);
+            f->line_start = 1;
+            if (f->depth == 1 && out_max_items() > 0 && ++f->items >= out_max_items()) {
+                json_truncate(f);
+            }
+            break;
+
+        default:
+            // Numeros, true, false, null
+            if (isdigit((unsigned char)c) || c == '-' || c == '.') {
+                out_color(YELLOW);
+                out_putc(c);
+                f->state = STATE_NUMBER;
+            } else if (c == 't' || c == 'f' || c == 'n') {
+                f->keyword[0] = c;
+                f->keyword_len = 1;
+                f->state = STATE_KEYWORD;
             } else {
-                printf("\"%s", color(RESET));
-                in_string = 0;
+                out_putc(c);
             }
-            p++;
-            continue;
-        }
+            break;
+    }
+}
 
-        if (in_string) {
-            putchar(*p);
-            p++;
-            continue;
-        }
+// Processa um unico caractere em qualquer estado
+static void json_step(JsonFormatter *f, char c) {
+    switch (f->state) {
+        case STATE_STRING:
+            if (c == '\\') {
+                // A barra so sai com o caractere seguinte: \uXXXX pode virar UTF-8
+                f->state = STATE_STRING_ESCAPE;
+            } else if (c == '"') {
+                out_putc('"');
+                out_color(RESET);
+                f->state = STATE_NORMAL;
+            } else if (json_unicode && (unsigned char)c >= 0x80) {
+                json_utf8(f, &c, &c + 1);
+            } else {
+                out_putc(c);
+            }
+            break;
 
-        // Fora de string
-        switch (*p) {
-            case '{':
-            case '[':
-                printf("%s%c%s\n", color(BOLD_WHITE), *p, color(RESET));
-                indent++;
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
+        case STATE_STRING_ESCAPE:
+            if (c == 'u' && json_unicode) {
+                f->esc[0] = c;
+                f->esc_len = 1;
+                f->state = STATE_STRING_UNICODE;
                 break;
+            }
+            out_color(YELLOW);
+            out_putc('\\');
+            out_putc(c);
+            out_color(GREEN);
+            f->state = STATE_STRING;
+            break;
 
-            case '}':
-            case ']':
-                putchar('\n');
-                indent--;
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
-                printf("%s%c%s", color(BOLD_WHITE), *p, color(RESET));
-                break;
+        case STATE_STRING_UNICODE:
+            json_unicode_escape(f, c);
+            break;
 
-            case ':':
-                printf("%s:%s ", color(BOLD_WHITE), color(RESET));
+        case STATE_NUMBER:
+            if (is_number_char(c)) {
+                out_putc(c);
                 break;
+            }
+            out_color(RESET);
+            f->state = STATE_NORMAL;
+            json_normal(f, c);
+            break;
 
-            case ',':
-                printf("%s,%s\n", color(BOLD_WHITE), color(RESET));
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
-                break;
+        case STATE_KEYWORD:
+            json_keyword(f, c);
+            break;
 
-            case ' ':
-            case '\t':
-            case '\n':
-            case '\r':
-                // Ignora whitespace extra
-                break;
+        default:
+            json_normal(f, c);
+            break;
+    }
+}
 
-            default:
-                // Numeros, true, false, null
-                if (isdigit(*p) || *p == '-' || *p == '.') {
-                    printf("%s", color(YELLOW));
-                    while (*p && (isdigit(*p) || *p == '.' || *p == '-' || *p == '+' || *p == 'e' || *p == 'E')) {
-                        putchar(*p);
-                        p++;
-                    }
-                    printf("%s", color(RESET));
-                    continue;
-                } else if (strncmp(p, "true", 4) == 0) {
-                    printf("%strue%s", color(MAGENTA), color(RESET));
-                    p += 4;
-                    continue;
-                } else if (strncmp(p, "false", 5) == 0) {
-                    printf("%sfalse%s", color(MAGENTA), color(RESET));
-                    p += 5;
-                    continue;
-                } else if (strncmp(p, "null", 4) == 0) {
-                    printf("%snull%s", color(DIM), color(RESET));
-                    p += 4;
-                    continue;
-                } else {
-                    putchar(*p);
-                }
-                break;
+static int json_feed(Formatter *base, const char *data, size_t len) {
+    JsonFormatter *f = (JsonFormatter *)base;
+    const char *p = data;
+    const char *end = data + len;
+
+    while (p < end && !f->base.stopped) {
+        if (f->state == STATE_STRING) {
+            if (f->utf8_len > 0) {
+                p = json_utf8(f, p, end);
+                continue;
+            }
+            // Copia o trecho da string ate a proxima aspa ou escape de uma vez
+            // (com --unicode, tambem ate o proximo UTF-8 invalido)
+            const char *run = p;
+            p += utf8_json_span(p, (size_t)(end - p), json_unicode);
+            out_write(run, (size_t)(p - run));
+            if (p == end) break;
+            if ((unsigned char)*p >= 0x80) {
+                p = json_utf8(f, p, end);
+                continue;
+            }
         }
-        p++;
+        json_step(f, *p++);
+    }
+
+    // Strings enormes: nao espera o fim do token para respeitar o limite
+    if (!f->base.stopped && out_limit_reached() &&
+        (f->state == STATE_STRING || f->state == STATE_STRING_ESCAPE || f->state == STATE_STRING_UNICODE)) {
+        json_truncate(f);
+    }
+
+    return f->base.stopped;
+}
+
+static void json_finish(Formatter *base) {
+    JsonFormatter *f = (JsonFormatter *)base;
+
+    while (f->state == STATE_KEYWORD && !f->base.stopped) {
+        json_keyword_fail(f);
     }
+    if (f->state == STATE_NUMBER) {
+        out_color(RESET);
+    }
+    if (f->utf8_len > 0 && !f->base.stopped) {
+        json_invalid(f, f->utf8, (size_t)f->utf8_len);
+    }
+
+    out_color(RESET);
+    out_putc('\n');
+    if (f->invalid > 0) {
+        out_flush();
+        fprintf(stderr, "Warning: %ld invalid UTF-8 byte(s) or unpaired surrogate(s) in strings\n", f->invalid);
+    }
+    free(f);
+}
+
+Formatter* json_formatter_new(void) {
+    JsonFormatter *f = calloc(1, sizeof(JsonFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = json_feed;
+    f->base.finish = json_finish;
+    f->state = STATE_NORMAL;
+    return &f->base;
+}
+
+void format_json(const char *data) {
+    if (!data) return;
+
+    Formatter *f = json_formatter_new();
+    if (!f) return;
 
-    printf("%s\n", color(RESET));
+    formatter_feed(f, data, strlen(data));
+    formatter_finish(f);
 }
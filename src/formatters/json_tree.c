@@ -0,0 +1,342 @@
+#include "formatters.h"
+#include "../output.h"
+#include "../body.h"
+#include "../json_dom.h"
+#include "../stats.h"
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// JSON pela arvore (--sort-keys, --compact, --canonical). Ordenar chaves
+// exige o documento inteiro: o body e guardado (memoria, depois arquivo
+// temporario) e, no fim, vira uma arvore numa arena em uma passada. Strings
+// sem escapes e numeros apontam para o body, entao a arvore custa os nos e
+// quase nada de texto; tudo e liberado de uma vez.
+
+typedef struct {
+    Formatter base;
+    int flags;
+    BodyStore body;
+    int failed;         // sem memoria/disco para guardar o body
+} TreeFormatter;
+
+typedef struct {
+    int compact;
+    int canonical;
+    int stopped;
+} TreePrinter;
+
+static void tree_color(const TreePrinter *pr, const char *color) {
+    if (!pr->canonical) out_color(color);
+}
+
+static void tree_punct(const TreePrinter *pr, char c) {
+    tree_color(pr, BOLD_WHITE);
+    out_putc(c);
+    tree_color(pr, RESET);
+}
+
+static void tree_newline(const TreePrinter *pr, int depth) {
+    if (pr->compact) return;
+    out_putc('\n');
+    out_indent(depth);
+}
+
+// String com os escapes minimos (RFC 8785): aspas, barra invertida e
+// caracteres de controle
+static void tree_string(const TreePrinter *pr, const char *s, size_t n, const char *color) {
+    const char *run = s;
+    const char *end = s + n;
+
+    tree_color(pr, color);
+    out_putc('"');
+    for (const char *p = s; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        out_write(run, (size_t)(p - run));
+        switch (c) {
+            case '"':  out_puts("\\\""); break;
+            case '\\': out_puts("\\\\"); break;
+            case '\b': out_puts("\\b"); break;
+            case '\f': out_puts("\\f"); break;
+            case '\n': out_puts("\\n"); break;
+            case '\r': out_puts("\\r"); break;
+            case '\t': out_puts("\\t"); break;
+            default:   out_printf("\\u%04x", c); break;
+        }
+        run = p + 1;
+    }
+    out_write(run, (size_t)(end - run));
+    out_putc('"');
+    tree_color(pr, RESET);
+}
+
+// Valor do numero JSON (o texto nao termina em '\0'). Retorna -1 se nao
+// couber num double finito.
+static int number_value(const char *text, size_t len, double *v) {
+    char num[64];
+    char *copy = len < sizeof(num) ? num : malloc(len + 1);
+    if (!copy) return -1;
+
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+
+    char *end;
+    *v = strtod(copy, &end);
+    int ok = *end == '\0' && *v == *v && *v - *v == 0;
+    if (copy != num) free(copy);
+    return ok ? 0 : -1;
+}
+
+// Primeiro numero que vira infinito no double: a RFC 8785 nao tem como
+// escreve-lo
+static const JsonNode *tree_find_infinite(const JsonNode *node) {
+    double v;
+    if (node->type == JSON_NUMBER) {
+        return number_value(node->as.text, node->len, &v) != 0 ? node : NULL;
+    }
+    if (node->type != JSON_OBJECT && node->type != JSON_ARRAY) return NULL;
+    for (uint32_t i = 0; i < node->len; i++) {
+        const JsonNode *bad = tree_find_infinite(&node->as.children[i]);
+        if (bad) return bad;
+    }
+    return NULL;
+}
+
+// Numero como o JavaScript o escreveria (Number.prototype.toString, exigido
+// pela RFC 8785). Retorna 0 para manter o texto original (fora do double).
+static size_t canonical_number(const char *text, size_t len, char *out) {
+    char buf[40];
+    if (len == 0) return 0;
+
+    // Inteiro de ate 15 digitos ja esta na forma canonica (menos "-0")
+    size_t start = text[0] == '-';
+    size_t i = start;
+    while (i < len && text[i] >= '0' && text[i] <= '9') i++;
+    if (i == len && len - start <= 15 && (text[start] != '0' || len == 1)) {
+        memcpy(out, text, len);
+        return len;
+    }
+
+    // Com ate 15 digitos significativos (e double normal) o texto ja e o
+    // menor que volta ao mesmo double; fora disso a busca comeca em 1 digito
+    int sig = 0, zeros = 0, leading = 1;
+    for (i = start; i < len && text[i] != 'e' && text[i] != 'E'; i++) {
+        if (text[i] == '.') continue;
+        if (text[i] == '0') {
+            if (!leading) zeros++;
+            continue;
+        }
+        sig += zeros + 1;
+        zeros = 0;
+        leading = 0;
+    }
+
+    double v;
+    if (number_value(text, len, &v) != 0) return 0;
+    if (v == 0) {
+        out[0] = '0';
+        return 1;
+    }
+
+    // Menor quantidade de digitos que volta ao mesmo double (17 sempre volta)
+    int exact = sig <= 15 && fabs(v) >= DBL_MIN;
+    for (int prec = exact ? sig : 1; prec <= 17; prec++) {
+        snprintf(buf, sizeof(buf), "%.*e", prec - 1, v);
+        if (exact || strtod(buf, NULL) == v) break;
+    }
+
+    // buf = [-]d[.ddd]e(+|-)XX
+    char digits[20];
+    int k = 0;
+    const char *p = buf;
+    size_t o = 0;
+    if (*p == '-') out[o++] = *p++;
+    for (; *p != 'e'; p++) {
+        if (*p != '.') digits[k++] = *p;
+    }
+    while (k > 1 && digits[k - 1] == '0') k--;
+    int n = atoi(p + 1) + 1;    // v = 0.digits * 10^n
+
+    if (k <= n && n <= 21) {
+        memcpy(out + o, digits, (size_t)k);
+        o += (size_t)k;
+        for (int i = k; i < n; i++) out[o++] = '0';
+    } else if (0 < n && n <= 21) {
+        memcpy(out + o, digits, (size_t)n);
+        o += (size_t)n;
+        out[o++] = '.';
+        memcpy(out + o, digits + n, (size_t)(k - n));
+        o += (size_t)(k - n);
+    } else if (-6 < n && n <= 0) {
+        out[o++] = '0';
+        out[o++] = '.';
+        for (int i = 0; i < -n; i++) out[o++] = '0';
+        memcpy(out + o, digits, (size_t)k);
+        o += (size_t)k;
+    } else {
+        out[o++] = digits[0];
+        if (k > 1) {
+            out[o++] = '.';
+            memcpy(out + o, digits + 1, (size_t)(k - 1));
+            o += (size_t)(k - 1);
+        }
+        o += (size_t)sprintf(out + o, "e%c%d", n - 1 >= 0 ? '+' : '-', n - 1 >= 0 ? n - 1 : 1 - n);
+    }
+    return o;
+}
+
+static void tree_node(TreePrinter *pr, const JsonNode *node, int depth);
+
+static void tree_container(TreePrinter *pr, const JsonNode *node, int depth) {
+    int object = node->type == JSON_OBJECT;
+
+    tree_punct(pr, object ? '{' : '[');
+    if (node->len == 0) {
+        tree_punct(pr, object ? '}' : ']');
+        return;
+    }
+
+    for (uint32_t i = 0; i < node->len; i++) {
+        const JsonNode *child = &node->as.children[i];
+
+        if (i > 0) tree_punct(pr, ',');
+        tree_newline(pr, depth + 1);
+
+        if (out_limit_reached() || (depth == 0 && out_max_items() > 0 && i >= (uint32_t)out_max_items())) {
+            out_elision();
+            pr->stopped = 1;
+            break;
+        }
+
+        if (object) {
+            tree_string(pr, child->key, child->key_len, GREEN);
+            tree_punct(pr, ':');
+            if (!pr->compact) out_putc(' ');
+        }
+        tree_node(pr, child, depth + 1);
+        if (pr->stopped) break;
+    }
+
+    tree_newline(pr, depth);
+    tree_punct(pr, object ? '}' : ']');
+}
+
+static void tree_node(TreePrinter *pr, const JsonNode *node, int depth) {
+    switch (node->type) {
+        case JSON_NULL:
+            tree_color(pr, DIM);
+            out_puts("null");
+            tree_color(pr, RESET);
+            break;
+        case JSON_TRUE:
+        case JSON_FALSE:
+            tree_color(pr, MAGENTA);
+            out_puts(node->type == JSON_TRUE ? "true" : "false");
+            tree_color(pr, RESET);
+            break;
+        case JSON_NUMBER: {
+            char num[40];
+            size_t n = pr->canonical ? canonical_number(node->as.text, node->len, num) : 0;
+            tree_color(pr, YELLOW);
+            if (n > 0) out_write(num, n);
+            else out_write(node->as.text, node->len);
+            tree_color(pr, RESET);
+            break;
+        }
+        case JSON_STRING:
+            tree_string(pr, node->as.text, node->len, GREEN);
+            break;
+        default:
+            tree_container(pr, node, depth);
+            break;
+    }
+}
+
+static int tree_feed(Formatter *base, const char *data, size_t len) {
+    TreeFormatter *f = (TreeFormatter *)base;
+
+    if (body_store_append(&f->body, data, len) != 0) {
+        f->failed = 1;
+        f->base.stopped = 1;
+    }
+    return f->base.stopped;
+}
+
+// Documento invalido: sai como o formatador lexico o imprimiria
+static void tree_fallback(const char *data, size_t len) {
+    Formatter *json = json_formatter_new();
+    if (!json) return;
+    for (size_t off = 0; off < len && !json->stopped; off += BODY_WINDOW) {
+        json->feed(json, data + off, len - off < BODY_WINDOW ? len - off : BODY_WINDOW);
+    }
+    json->finish(json);
+}
+
+static void tree_finish(Formatter *base) {
+    TreeFormatter *f = (TreeFormatter *)base;
+    const char *data = f->failed ? NULL : body_store_view(&f->body);
+    JsonDom *dom = data ? json_dom_new(NULL) : NULL;
+
+    if (!dom) {
+        fprintf(stderr, "Error: cannot keep the body for --sort-keys/--compact/--canonical\n");
+    } else {
+        size_t size = f->body.size;
+        STATS_CPU_BEGIN(t0);
+        int rc = json_dom_parse(dom, data, size, JSON_DOM_NO_HASH);
+        if (rc == 0 && (f->flags & (JSON_TREE_SORT_KEYS | JSON_TREE_CANONICAL))) {
+            rc = json_dom_sort_keys(dom, (f->flags & JSON_TREE_CANONICAL) ? JSON_SORT_DEDUPE | JSON_SORT_UTF16 : 0);
+        }
+        STATS_CPU_END(t0, tree_parse_ns);
+
+#if CURLSER_STATS
+        JsonDomUsage usage;
+        json_dom_usage(dom, &usage);
+        STATS_ADD(tree_bytes, size);
+        STATS_ADD(tree_nodes, usage.nodes);
+        STATS_ADD(tree_arena_bytes, usage.arena_bytes);
+        STATS_ADD(tree_allocs, usage.allocs);
+#endif
+
+        const JsonNode *bad = rc == 0 && json_dom_root(dom) && (f->flags & JSON_TREE_CANONICAL)
+            ? tree_find_infinite(json_dom_root(dom)) : NULL;
+
+        if (bad) {
+            out_flush();
+            fprintf(stderr, "Error: number out of range for --canonical at byte %zu: %.*s\n",
+                    (size_t)(bad->as.text - data), (int)(bad->len > 40 ? 40 : bad->len), bad->as.text);
+        } else if (rc == 0 && json_dom_root(dom)) {
+            TreePrinter pr = {
+                .compact = (f->flags & (JSON_TREE_COMPACT | JSON_TREE_CANONICAL)) != 0,
+                .canonical = (f->flags & JSON_TREE_CANONICAL) != 0
+            };
+            tree_node(&pr, json_dom_root(dom), 0);
+            out_putc('\n');
+        } else if (rc != 0) {
+            size_t offset;
+            const char *error = json_dom_error(dom, &offset);
+            out_flush();
+            fprintf(stderr, "Warning: invalid JSON at byte %zu: %s; printed as is\n", offset, error);
+            tree_fallback(data, size);
+        }
+    }
+
+    out_color(RESET);
+    json_dom_free(dom);
+    body_store_free(&f->body);
+    free(f);
+}
+
+Formatter* json_tree_formatter_new(int flags) {
+    TreeFormatter *f = calloc(1, sizeof(TreeFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = tree_feed;
+    f->base.finish = tree_finish;
+    f->flags = flags;
+    body_store_init(&f->body, 0);
+    return &f->base;
+}
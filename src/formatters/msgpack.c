@@ -0,0 +1,155 @@
+#include "binary.h"
+#include <string.h>
+
+// Inteiro big-endian de n bytes
+static unsigned long long read_be(const unsigned char *p, int n) {
+    unsigned long long v = 0;
+    for (int i = 0; i < n; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+static double read_float(const unsigned char *p, int n) {
+    if (n == 4) {
+        unsigned int bits = (unsigned int)read_be(p, 4);
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    unsigned long long bits = read_be(p, 8);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static long long read_signed(const unsigned char *p, int n) {
+    unsigned long long v = read_be(p, n);
+    if (n < 8 && (v >> (n * 8 - 1))) v |= ~0ULL << (n * 8);
+    return (long long)v;
+}
+
+// Cabecalho com tamanho em n bytes apos o byte de tipo
+static int sized(const unsigned char *p, size_t avail, int n, BinKind kind, BinToken *t) {
+    if (avail < (size_t)1 + n) return 0;
+    t->kind = kind;
+    t->len = read_be(p + 1, n);
+    return 1 + n;
+}
+
+static int ext(const unsigned char *p, size_t avail, int n, BinToken *t) {
+    if (avail < (size_t)2 + n) return 0;
+    t->kind = BIN_EXT;
+    t->len = read_be(p + 1, n);
+    t->ext_type = (signed char)p[1 + n];
+    return 2 + n;
+}
+
+static int fixext(const unsigned char *p, size_t avail, unsigned long long len, BinToken *t) {
+    if (avail < 2) return 0;
+    t->kind = BIN_EXT;
+    t->len = len;
+    t->ext_type = (signed char)p[1];
+    return 2;
+}
+
+static int msgpack_decode(const unsigned char *p, size_t avail, BinToken *t) {
+    if (avail == 0) return 0;
+
+    unsigned char b = p[0];
+    memset(t, 0, sizeof(*t));
+
+    // Formatos "fix": valor ou tamanho no proprio byte
+    if (b <= 0x7f) {
+        t->kind = BIN_UINT;
+        t->u = b;
+        return 1;
+    }
+    if (b >= 0xe0) {
+        t->kind = BIN_INT;
+        t->i = (signed char)b;
+        return 1;
+    }
+    if (b <= 0x8f) {
+        t->kind = BIN_MAP;
+        t->len = b & 0x0f;
+        return 1;
+    }
+    if (b <= 0x9f) {
+        t->kind = BIN_ARRAY;
+        t->len = b & 0x0f;
+        return 1;
+    }
+    if (b <= 0xbf) {
+        t->kind = BIN_STRING;
+        t->len = b & 0x1f;
+        return 1;
+    }
+
+    switch (b) {
+        case 0xc0: t->kind = BIN_NULL; return 1;
+        case 0xc2: t->kind = BIN_BOOL; t->u = 0; return 1;
+        case 0xc3: t->kind = BIN_BOOL; t->u = 1; return 1;
+
+        case 0xc4: return sized(p, avail, 1, BIN_BINARY, t);
+        case 0xc5: return sized(p, avail, 2, BIN_BINARY, t);
+        case 0xc6: return sized(p, avail, 4, BIN_BINARY, t);
+
+        case 0xc7: return ext(p, avail, 1, t);
+        case 0xc8: return ext(p, avail, 2, t);
+        case 0xc9: return ext(p, avail, 4, t);
+
+        case 0xca:
+        case 0xcb: {
+            int n = b == 0xca ? 4 : 8;
+            if (avail < (size_t)1 + n) return 0;
+            t->kind = BIN_FLOAT;
+            t->d = read_float(p + 1, n);
+            return 1 + n;
+        }
+
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf: {
+            int n = 1 << (b - 0xcc);
+            if (avail < (size_t)1 + n) return 0;
+            t->kind = BIN_UINT;
+            t->u = read_be(p + 1, n);
+            return 1 + n;
+        }
+
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3: {
+            int n = 1 << (b - 0xd0);
+            if (avail < (size_t)1 + n) return 0;
+            t->kind = BIN_INT;
+            t->i = read_signed(p + 1, n);
+            return 1 + n;
+        }
+
+        case 0xd4: return fixext(p, avail, 1, t);
+        case 0xd5: return fixext(p, avail, 2, t);
+        case 0xd6: return fixext(p, avail, 4, t);
+        case 0xd7: return fixext(p, avail, 8, t);
+        case 0xd8: return fixext(p, avail, 16, t);
+
+        case 0xd9: return sized(p, avail, 1, BIN_STRING, t);
+        case 0xda: return sized(p, avail, 2, BIN_STRING, t);
+        case 0xdb: return sized(p, avail, 4, BIN_STRING, t);
+
+        case 0xdc: return sized(p, avail, 2, BIN_ARRAY, t);
+        case 0xdd: return sized(p, avail, 4, BIN_ARRAY, t);
+        case 0xde: return sized(p, avail, 2, BIN_MAP, t);
+        case 0xdf: return sized(p, avail, 4, BIN_MAP, t);
+
+        default:
+            // 0xc1 nunca e usado
+            return -1;
+    }
+}
+
+Formatter* msgpack_formatter_new(void) {
+    return binary_formatter_new(msgpack_decode, "MessagePack");
+}
@@ -0,0 +1,607 @@
+#include "formatters.h"
+#include "../output.h"
+#include "../json_parser.h"
+#include "../strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Limites que mantem a memoria constante independente do tamanho do body
+#define SCHEMA_MAX_FIELDS   256     // campos distintos por objeto
+#define SCHEMA_MAX_DEPTH    64      // niveis inferidos
+#define SCHEMA_MAX_NODES    65536   // nos no total
+#define SCHEMA_MAX_TOKEN    4096    // bytes guardados por string
+
+// HyperLogLog com 2^8 registradores (~6.5% de erro, 256 bytes por no)
+#define HLL_BITS        8
+#define HLL_REGISTERS   (1 << HLL_BITS)
+
+// Ate essa quantidade os distintos sao contados exatamente (pelos hashes)
+#define DISTINCT_EXACT  16
+
+// Tipos observados em um no
+enum {
+    T_NULL    = 1 << 0,
+    T_BOOLEAN = 1 << 1,
+    T_INTEGER = 1 << 2,
+    T_NUMBER  = 1 << 3,
+    T_STRING  = 1 << 4,
+    T_ARRAY   = 1 << 5,
+    T_OBJECT  = 1 << 6
+};
+
+typedef struct SchemaNode SchemaNode;
+
+typedef struct {
+    char *name;
+    unsigned long long present;     // objetos em que o campo apareceu
+    SchemaNode *node;
+} SchemaField;
+
+// Formato agregado de todos os valores vistos em um mesmo caminho
+struct SchemaNode {
+    unsigned types;
+    unsigned long long count;
+    unsigned long long nulls;
+    unsigned long long numbers;
+    double min, max;                // numeros
+    unsigned long long strings;
+    size_t min_len, max_len;        // strings
+    unsigned long long booleans, trues;
+    unsigned long long arrays;
+    unsigned long long min_items, max_items, total_items;
+    SchemaNode *items;              // elementos de todos os arrays, mesclados
+    unsigned long long objects;
+    SchemaField *fields;
+    int field_count;
+    int field_cap;
+    unsigned long long extra_fields; // campos alem de SCHEMA_MAX_FIELDS
+    unsigned long long exact[DISTINCT_EXACT]; // hashes distintos enquanto couberem
+    int exact_count;                // -1 quando passou para o HyperLogLog
+    unsigned char *hll;             // valores distintos (escalares)
+};
+
+typedef struct {
+    SchemaNode *node;       // NULL quando o nivel nao e inferido
+    int is_object;
+    SchemaField *field;     // campo atual (objetos)
+    int next_field;         // palpite: campos costumam vir na mesma ordem
+    unsigned long long items;
+} SchemaFrame;
+
+typedef struct {
+    Formatter base;
+    int json_schema;
+    JsonParser parser;
+    SchemaNode *root;
+    SchemaFrame stack[SCHEMA_MAX_DEPTH];
+    int depth;              // niveis abertos no documento
+    int node_count;
+} SchemaFormatter;
+
+static SchemaNode* node_new(SchemaFormatter *f) {
+    if (f->node_count >= SCHEMA_MAX_NODES) return NULL;
+
+    SchemaNode *n = calloc(1, sizeof(SchemaNode));
+    if (n) f->node_count++;
+    return n;
+}
+
+static void node_free(SchemaNode *n) {
+    if (!n) return;
+    for (int i = 0; i < n->field_count; i++) {
+        free(n->fields[i].name);
+        node_free(n->fields[i].node);
+    }
+    free(n->fields);
+    node_free(n->items);
+    free(n->hll);
+    free(n);
+}
+
+// FNV-1a seguido do finalizador do splitmix64 para espalhar os bits
+static unsigned long long hash_value(unsigned tag, const char *s, size_t n) {
+    unsigned long long h = 14695981039346656037ULL ^ tag;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+static void hll_insert(SchemaNode *n, unsigned long long h) {
+    if (!n->hll) {
+        n->hll = calloc(HLL_REGISTERS, 1);
+        if (!n->hll) return;
+    }
+
+    unsigned idx = (unsigned)(h >> (64 - HLL_BITS));
+    unsigned long long rest = h << HLL_BITS;
+    unsigned char rank = 1;
+    while (rank <= 64 - HLL_BITS && !(rest & (1ULL << 63))) {
+        rank++;
+        rest <<= 1;
+    }
+    if (rank > n->hll[idx]) n->hll[idx] = rank;
+}
+
+static void hll_add(SchemaNode *n, unsigned long long h) {
+    if (n->exact_count >= 0) {
+        for (int i = 0; i < n->exact_count; i++) {
+            if (n->exact[i] == h) return;
+        }
+        if (n->exact_count < DISTINCT_EXACT) {
+            n->exact[n->exact_count++] = h;
+            return;
+        }
+
+        // Muitos valores: migra para o HyperLogLog
+        for (int i = 0; i < DISTINCT_EXACT; i++) {
+            hll_insert(n, n->exact[i]);
+        }
+        n->exact_count = -1;
+    }
+
+    hll_insert(n, h);
+}
+
+static double hll_estimate(const SchemaNode *n) {
+    if (n->exact_count >= 0) return n->exact_count;
+    if (!n->hll) return 0;
+
+    double m = HLL_REGISTERS;
+    double sum = 0;
+    int zeros = 0;
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexp(1.0, -n->hll[i]);
+        if (n->hll[i] == 0) zeros++;
+    }
+
+    double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) {
+        // Correcao para cardinalidades pequenas
+        estimate = m * log(m / zeros);
+    }
+    return estimate;
+}
+
+static SchemaField* object_field(SchemaFormatter *f, SchemaFrame *frame, const char *name, size_t len) {
+    SchemaNode *obj = frame->node;
+
+    // Tenta primeiro a posicao seguinte a do ultimo campo
+    for (int k = 0; k < obj->field_count; k++) {
+        int i = (frame->next_field + k) % obj->field_count;
+        SchemaField *field = &obj->fields[i];
+        if (strlen(field->name) == len && memcmp(field->name, name, len) == 0) {
+            frame->next_field = i + 1;
+            return field;
+        }
+    }
+
+    if (obj->field_count >= SCHEMA_MAX_FIELDS) {
+        obj->extra_fields++;
+        return NULL;
+    }
+
+    if (obj->field_count == obj->field_cap) {
+        int cap = obj->field_cap ? obj->field_cap * 2 : 8;
+        SchemaField *ptr = realloc(obj->fields, cap * sizeof(SchemaField));
+        if (!ptr) return NULL;
+        obj->fields = ptr;
+        obj->field_cap = cap;
+    }
+
+    SchemaNode *node = node_new(f);
+    char *copy = malloc(len + 1);
+    if (!node || !copy) {
+        free(node);
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+
+    SchemaField *field = &obj->fields[obj->field_count++];
+    field->name = copy;
+    field->present = 0;
+    field->node = node;
+    frame->next_field = obj->field_count;
+    return field;
+}
+
+// No que recebe o proximo valor, de acordo com o container atual
+static SchemaNode* value_target(SchemaFormatter *f) {
+    if (f->depth == 0) {
+        if (!f->root) f->root = node_new(f);
+        return f->root;
+    }
+    if (f->depth > SCHEMA_MAX_DEPTH) return NULL;
+
+    SchemaFrame *frame = &f->stack[f->depth - 1];
+    if (!frame->node) return NULL;
+
+    if (frame->is_object) {
+        return frame->field ? frame->field->node : NULL;
+    }
+
+    frame->items++;
+    if (!frame->node->items) frame->node->items = node_new(f);
+    return frame->node->items;
+}
+
+static void push_frame(SchemaFormatter *f, SchemaNode *node, int is_object) {
+    if (f->depth < SCHEMA_MAX_DEPTH) {
+        SchemaFrame *frame = &f->stack[f->depth];
+        memset(frame, 0, sizeof(*frame));
+        frame->node = node;
+        frame->is_object = is_object;
+    }
+    f->depth++;
+}
+
+static void record_scalar(SchemaNode *n, unsigned type, const char *text, size_t len, size_t full_len) {
+    n->types |= type;
+    n->count++;
+
+    switch (type) {
+        case T_NULL:
+            n->nulls++;
+            break;
+
+        case T_BOOLEAN:
+            n->booleans++;
+            if (text[0] == 't') n->trues++;
+            break;
+
+        case T_INTEGER:
+        case T_NUMBER: {
+            double v = strtod(text, NULL);
+            if (n->numbers++ == 0 || v < n->min) n->min = v;
+            if (n->numbers == 1 || v > n->max) n->max = v;
+            hll_add(n, hash_value(T_NUMBER, text, len));
+            break;
+        }
+
+        case T_STRING:
+            if (n->strings++ == 0 || full_len < n->min_len) n->min_len = full_len;
+            if (full_len > n->max_len) n->max_len = full_len;
+            hll_add(n, hash_value(T_STRING, text, len));
+            break;
+    }
+}
+
+static int is_integer(const char *text, size_t len) {
+    return memchr(text, '.', len) == NULL && memchr(text, 'e', len) == NULL && memchr(text, 'E', len) == NULL;
+}
+
+static int schema_event(void *ctx, JsonEvent event, const char *text, size_t len) {
+    SchemaFormatter *f = (SchemaFormatter *)ctx;
+    SchemaNode *n;
+
+    switch (event) {
+        case JSON_EVENT_OBJECT_START:
+        case JSON_EVENT_ARRAY_START:
+            n = value_target(f);
+            if (n) {
+                n->count++;
+                if (event == JSON_EVENT_OBJECT_START) {
+                    n->types |= T_OBJECT;
+                    n->objects++;
+                } else {
+                    n->types |= T_ARRAY;
+                }
+            }
+            push_frame(f, n, event == JSON_EVENT_OBJECT_START);
+            break;
+
+        case JSON_EVENT_OBJECT_END:
+            f->depth--;
+            break;
+
+        case JSON_EVENT_ARRAY_END:
+            f->depth--;
+            if (f->depth < SCHEMA_MAX_DEPTH && f->stack[f->depth].node) {
+                SchemaFrame *frame = &f->stack[f->depth];
+                SchemaNode *arr = frame->node;
+                if (arr->arrays == 0 || frame->items < arr->min_items) arr->min_items = frame->items;
+                if (frame->items > arr->max_items) arr->max_items = frame->items;
+                arr->total_items += frame->items;
+                arr->arrays++;
+            }
+            break;
+
+        case JSON_EVENT_KEY:
+            if (f->depth <= SCHEMA_MAX_DEPTH) {
+                SchemaFrame *frame = &f->stack[f->depth - 1];
+                if (frame->node) {
+                    frame->field = object_field(f, frame, text, len);
+                    if (frame->field) frame->field->present++;
+                }
+            }
+            break;
+
+        case JSON_EVENT_STRING:
+            n = value_target(f);
+            if (n) record_scalar(n, T_STRING, text, len, f->parser.value_len);
+            break;
+
+        case JSON_EVENT_NUMBER:
+            n = value_target(f);
+            if (n) record_scalar(n, is_integer(text, len) ? T_INTEGER : T_NUMBER, text, len, len);
+            break;
+
+        case JSON_EVENT_TRUE:
+        case JSON_EVENT_FALSE:
+            n = value_target(f);
+            if (n) record_scalar(n, T_BOOLEAN, text, len, len);
+            break;
+
+        case JSON_EVENT_NULL:
+            n = value_target(f);
+            if (n) record_scalar(n, T_NULL, text, len, len);
+            break;
+    }
+
+    return 0;
+}
+
+// Numero aproximado em forma curta: 950, 12.3k, 1.5M
+static void format_count(char *buf, size_t size, double v) {
+    if (v < 1000) snprintf(buf, size, "%.0f", v);
+    else if (v < 1e6) snprintf(buf, size, "%.1fk", v / 1e3);
+    else if (v < 1e9) snprintf(buf, size, "%.1fM", v / 1e6);
+    else snprintf(buf, size, "%.1fG", v / 1e9);
+}
+
+// Quantidade de valores distintos: exata para poucos valores, estimada acima
+static double distinct_count(const SchemaNode *n) {
+    double d = hll_estimate(n);
+    unsigned long long scalars = n->numbers + n->strings;
+    if (d > scalars) d = scalars;
+    return d;
+}
+
+static const char *type_names[] = {
+    "null", "boolean", "integer", "number", "string", "array", "object"
+};
+
+// Resumo compacto ---------------------------------------------------------
+
+static void summary_types(const SchemaNode *n) {
+    int first = 1;
+
+    // null por ultimo: "string | null"
+    for (int bit = 1; bit <= 7; bit++) {
+        int t = bit % 7;
+        if (!(n->types & (1u << t))) continue;
+        if (!first) {
+            out_color(DIM);
+            out_puts(" | ");
+            out_color(RESET);
+        }
+        out_color(t == 0 ? DIM : MAGENTA);
+        out_puts(type_names[t]);
+        out_color(RESET);
+        first = 0;
+    }
+    if (first) {
+        out_color(DIM);
+        out_puts("unknown");
+        out_color(RESET);
+    }
+}
+
+static void summary_node(const SchemaNode *n, const char *name, int optional,
+                         unsigned long long parent_objects, unsigned long long present, int level) {
+    char a[32], b[32];
+
+    out_indent(level);
+    out_color(CYAN);
+    out_puts(name);
+    out_color(RESET);
+    if (optional) {
+        out_color(YELLOW);
+        out_putc('?');
+        out_color(RESET);
+    }
+    out_color(BOLD_WHITE);
+    out_puts(": ");
+    out_color(RESET);
+    summary_types(n);
+
+    out_color(DIM);
+    format_count(a, sizeof(a), (double)n->count);
+    out_printf("  x%s", a);
+    if (optional && parent_objects > 0) {
+        out_printf("  present %.1f%%", 100.0 * present / parent_objects);
+    }
+    if (n->nulls > 0 && n->nulls < n->count) {
+        format_count(a, sizeof(a), (double)n->nulls);
+        out_printf("  nulls %s", a);
+    }
+    if (n->numbers + n->strings > 0) {
+        format_count(a, sizeof(a), distinct_count(n));
+        out_printf("  distinct~%s", a);
+    }
+    if (n->numbers > 0) {
+        out_printf("  range %.15g..%.15g", n->min, n->max);
+    }
+    if (n->strings > 0) {
+        out_printf("  len %zu..%zu", n->min_len, n->max_len);
+    }
+    if (n->types & T_BOOLEAN) {
+        format_count(a, sizeof(a), (double)n->trues);
+        format_count(b, sizeof(b), (double)(n->booleans - n->trues));
+        out_printf("  true %s / false %s", a, b);
+    }
+    if (n->arrays > 0) {
+        format_count(a, sizeof(a), (double)n->total_items);
+        out_printf("  items %llu..%llu (total %s)", n->min_items, n->max_items, a);
+    }
+    if (n->extra_fields > 0) {
+        out_printf("  +%llu fields not tracked", n->extra_fields);
+    }
+    out_color(RESET);
+    out_putc('\n');
+
+    for (int i = 0; i < n->field_count; i++) {
+        const SchemaField *field = &n->fields[i];
+        summary_node(field->node, field->name, field->present < n->objects,
+                     n->objects, field->present, level + 1);
+    }
+    if (n->items) {
+        summary_node(n->items, "[]", 0, 0, 0, level + 1);
+    }
+}
+
+// JSON Schema -------------------------------------------------------------
+
+static void schema_json_node(StrBuf *sb, const SchemaNode *n) {
+    int count = 0;
+    unsigned types = n->types;
+
+    // integer + number vira so number
+    if ((types & T_INTEGER) && (types & T_NUMBER)) types &= ~T_INTEGER;
+
+    strbuf_putc(sb, '{');
+    for (int t = 0; t < 7; t++) {
+        if (types & (1u << t)) count++;
+    }
+
+    if (count == 1) {
+        for (int t = 0; t < 7; t++) {
+            if (types & (1u << t)) strbuf_printf(sb, "\"type\":\"%s\"", type_names[t]);
+        }
+    } else if (count > 1) {
+        strbuf_puts(sb, "\"type\":[");
+        int first = 1;
+        for (int t = 0; t < 7; t++) {
+            if (!(types & (1u << t))) continue;
+            strbuf_printf(sb, "%s\"%s\"", first ? "" : ",", type_names[t]);
+            first = 0;
+        }
+        strbuf_putc(sb, ']');
+    }
+
+    #define SEP() do { if (sb->data[sb->len - 1] != '{') strbuf_putc(sb, ','); } while (0)
+
+    if (n->numbers > 0) {
+        SEP();
+        strbuf_printf(sb, "\"minimum\":%.17g,\"maximum\":%.17g", n->min, n->max);
+    }
+    if (n->strings > 0) {
+        SEP();
+        strbuf_printf(sb, "\"minLength\":%zu,\"maxLength\":%zu", n->min_len, n->max_len);
+    }
+    if (n->arrays > 0) {
+        SEP();
+        strbuf_printf(sb, "\"minItems\":%llu,\"maxItems\":%llu", n->min_items, n->max_items);
+    }
+    if (n->items) {
+        SEP();
+        strbuf_puts(sb, "\"items\":");
+        schema_json_node(sb, n->items);
+    }
+    if (n->field_count > 0) {
+        SEP();
+        strbuf_puts(sb, "\"properties\":{");
+        for (int i = 0; i < n->field_count; i++) {
+            if (i > 0) strbuf_putc(sb, ',');
+            strbuf_json_string(sb, n->fields[i].name, strlen(n->fields[i].name));
+            strbuf_putc(sb, ':');
+            schema_json_node(sb, n->fields[i].node);
+        }
+        strbuf_puts(sb, "},\"required\":[");
+        int first = 1;
+        for (int i = 0; i < n->field_count; i++) {
+            if (n->fields[i].present < n->objects) continue;
+            if (!first) strbuf_putc(sb, ',');
+            strbuf_json_string(sb, n->fields[i].name, strlen(n->fields[i].name));
+            first = 0;
+        }
+        strbuf_putc(sb, ']');
+    }
+
+    // Estatisticas observadas, como extensoes
+    SEP();
+    strbuf_printf(sb, "\"x-count\":%llu", n->count);
+    if (n->numbers + n->strings > 0) {
+        strbuf_printf(sb, ",\"x-distinct\":%.0f", distinct_count(n));
+    }
+    if (n->nulls > 0) {
+        strbuf_printf(sb, ",\"x-nulls\":%llu", n->nulls);
+    }
+
+    #undef SEP
+    strbuf_putc(sb, '}');
+}
+
+// Formatador ----------------------------------------------------------------
+
+static int schema_feed(Formatter *base, const char *data, size_t len) {
+    SchemaFormatter *f = (SchemaFormatter *)base;
+
+    if (json_parser_feed(&f->parser, data, len) < 0) {
+        // O esquema parcial ainda e impresso em schema_finish
+        f->base.stopped = 1;
+    }
+
+    return f->base.stopped;
+}
+
+static void schema_finish(Formatter *base) {
+    SchemaFormatter *f = (SchemaFormatter *)base;
+
+    if (!f->base.stopped) {
+        json_parser_finish(&f->parser);
+    }
+    if (f->parser.error) {
+        fprintf(stderr, "%sError: invalid JSON at byte %zu: %s (schema is partial)%s\n",
+                color(RED), f->parser.offset, f->parser.error, color(RESET));
+    }
+
+    if (!f->root) {
+        out_color(DIM);
+        out_puts("(empty document)\n");
+        out_color(RESET);
+    } else if (f->json_schema) {
+        StrBuf sb = {0};
+        strbuf_puts(&sb, "{\"$schema\":\"https://json-schema.org/draft/2020-12/schema\",");
+        size_t mark = sb.len;
+        schema_json_node(&sb, f->root);
+        // Junta as chaves do no raiz ao objeto com $schema
+        if (sb.data) {
+            memmove(sb.data + mark, sb.data + mark + 1, sb.len - mark);
+            sb.len--;
+            Formatter *json = json_formatter_new();
+            if (json) {
+                formatter_feed(json, sb.data, sb.len);
+                formatter_finish(json);
+            }
+        }
+        strbuf_free(&sb);
+    } else {
+        summary_node(f->root, "$", 0, 0, 0, 0);
+    }
+
+    json_parser_free(&f->parser);
+    node_free(f->root);
+    free(f);
+}
+
+Formatter* schema_formatter_new(int json_schema) {
+    SchemaFormatter *f = calloc(1, sizeof(SchemaFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = schema_feed;
+    f->base.finish = schema_finish;
+    f->json_schema = json_schema;
+    json_parser_init(&f->parser, schema_event, f, SCHEMA_MAX_TOKEN);
+    return &f->base;
+}
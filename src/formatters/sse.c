@@ -0,0 +1,355 @@
+#include "formatters.h"
+#include "../output.h"
+#include "../json_parser.h"
+#include "../strbuf.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Server-Sent Events (text/event-stream): os campos sao lidos conforme os
+// bytes chegam e cada evento e impresso assim que a linha em branco que o
+// fecha e recebida. Nada do stream e guardado alem do evento atual, e o
+// "data" de um evento e cortado em SSE_MAX_DATA: a memoria nao cresce com
+// a duracao do stream.
+
+#define SSE_MAX_DATA    (1024 * 1024)
+#define SSE_MAX_FIELD   8       // maior nome de campo conhecido ("retry")
+#define SSE_MAX_VALUE   SSE_MAX_ID
+
+typedef enum {
+    LINE_FIELD,     // nome do campo
+    LINE_SPACE,     // logo depois do ':' (um espaco e ignorado)
+    LINE_VALUE,     // valor
+    LINE_SKIP       // comentario ou campo desconhecido
+} LineState;
+
+enum { FIELD_DATA, FIELD_ID, FIELD_EVENT, FIELD_RETRY, FIELD_OTHER };
+
+typedef struct {
+    Formatter base;
+    SseState *state;
+    SseState own_state;         // quando o chamador nao guarda o estado
+
+    LineState line;
+    int after_cr;               // um '\n' logo depois de '\r' nao e outra linha
+    int bom_matched;            // bytes do BOM ja vistos; -1 = resolvido
+    char name[SSE_MAX_FIELD + 1];
+    size_t name_len;
+    int field;
+    int has_colon;
+
+    // Evento atual
+    StrBuf data;
+    int data_truncated;
+    char id[SSE_MAX_ID];        // ultimo id, vale para os eventos seguintes
+    int id_seen;                // o evento atual trouxe "id:"
+    char value[SSE_MAX_VALUE];  // id/event/retry da linha atual
+    size_t value_len;
+    char event[SSE_MAX_VALUE];
+    char retry[SSE_MAX_VALUE];  // "retry:" valido desde o ultimo evento impresso
+
+    long events;                // eventos impressos nesta resposta
+} SseFormatter;
+
+static int json_count(void *ctx, JsonEvent event, const char *text, size_t len) {
+    (void)event;
+    (void)text;
+    (void)len;
+    (*(int *)ctx)++;
+    return 0;
+}
+
+// O payload e um documento JSON completo?
+static int sse_is_json(const char *data, size_t len) {
+    const char *p = data;
+    while (p < data + len && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    if (p == data + len || (*p != '{' && *p != '[')) return 0;
+
+    JsonParser parser;
+    int tokens = 0;
+    json_parser_init(&parser, json_count, &tokens, 1);
+    int ok = json_parser_feed(&parser, data, len) == 0 && json_parser_finish(&parser) == 0 && tokens > 0;
+    json_parser_free(&parser);
+    return ok;
+}
+
+static void sse_field_label(const char *name, const char *color, const char *value) {
+    out_color(DIM);
+    out_puts(name);
+    out_color(RESET);
+    out_color(color);
+    out_puts(value);
+    out_color(RESET);
+}
+
+// Payload que nao e JSON: texto puro, respeitando o limite de linhas/bytes
+static void sse_print_text(SseFormatter *f, const char *data, size_t len) {
+    size_t fit = out_fit(data, len);
+
+    out_color(WHITE);
+    out_write(data, fit);
+    out_color(RESET);
+    out_putc('\n');
+
+    if (fit < len) {
+        out_elision();
+        out_putc('\n');
+        f->base.stopped = 1;
+    }
+}
+
+static void sse_print_json(SseFormatter *f, const char *data, size_t len) {
+    // --max-items conta eventos, nao itens do payload
+    long max_items = out_state.max_items;
+    out_state.max_items = 0;
+
+    Formatter *json = json_formatter_new();
+    if (json) {
+        json->feed(json, data, len);
+        if (json->stopped) f->base.stopped = 1;
+        json->finish(json);
+    }
+
+    out_state.max_items = max_items;
+}
+
+// Linha em branco: entrega o evento montado (sem "data" nao ha evento)
+static void sse_dispatch(SseFormatter *f) {
+    SseState *s = f->state;
+
+    memcpy(s->last_id, f->id, sizeof(s->last_id));
+
+    int has_data = f->data.len > 0;
+    if (has_data && !f->base.stopped) {
+        if (out_limit_reached()) {
+            out_elision();
+            out_putc('\n');
+            f->base.stopped = 1;
+        } else {
+            if (f->events > 0) out_putc('\n');
+
+            // "data" termina com o '\n' de sua ultima linha, a menos que
+            // tenha sido cortado
+            size_t len = f->data_truncated ? f->data.len : f->data.len - 1;
+            const char *sep = "";
+
+            if (f->event[0]) {
+                sse_field_label("event: ", BOLD_MAGENTA, f->event);
+                sep = "  ";
+            }
+            if (f->id_seen) {
+                out_puts(sep);
+                sse_field_label("id: ", YELLOW, s->last_id);
+                sep = "  ";
+            }
+            if (f->retry[0]) {
+                out_puts(sep);
+                sse_field_label("retry: ", CYAN, f->retry);
+                f->retry[0] = '\0';
+                sep = "  ";
+            }
+            if (*sep) out_putc('\n');
+
+            if (!f->data_truncated && sse_is_json(f->data.data, len)) {
+                sse_print_json(f, f->data.data, len);
+            } else {
+                sse_print_text(f, f->data.data, len);
+                if (f->data_truncated && !f->base.stopped) {
+                    out_elision();
+                    out_putc('\n');
+                }
+            }
+
+            f->events++;
+            s->events++;
+
+            // Um stream pode nao ter fim: para assim que o ultimo evento
+            // pedido e impresso, sem esperar o proximo
+            if (!f->base.stopped && out_max_items() > 0 && f->events >= out_max_items()) {
+                out_elision();
+                out_putc('\n');
+                f->base.stopped = 1;
+            }
+        }
+    }
+
+    strbuf_reset(&f->data);
+    f->data_truncated = 0;
+    f->event[0] = '\0';
+    f->id_seen = 0;
+}
+
+static int sse_field(const char *name, size_t len) {
+    if (len == 4 && memcmp(name, "data", 4) == 0) return FIELD_DATA;
+    if (len == 2 && memcmp(name, "id", 2) == 0) return FIELD_ID;
+    if (len == 5 && memcmp(name, "event", 5) == 0) return FIELD_EVENT;
+    if (len == 5 && memcmp(name, "retry", 5) == 0) return FIELD_RETRY;
+    return FIELD_OTHER;
+}
+
+// Acrescenta um trecho do valor ao destino do campo atual
+static void sse_value(SseFormatter *f, const char *s, size_t n) {
+    if (f->field == FIELD_DATA) {
+        size_t room = f->data.len < SSE_MAX_DATA ? SSE_MAX_DATA - f->data.len : 0;
+        if (n > room) {
+            n = room;
+            f->data_truncated = 1;
+        }
+        strbuf_append(&f->data, s, n);
+    } else {
+        size_t room = SSE_MAX_VALUE - 1 - f->value_len;
+        if (n > room) n = room;
+        memcpy(f->value + f->value_len, s, n);
+        f->value_len += n;
+    }
+}
+
+// Fim de linha: aplica o campo lido ou entrega o evento
+static void sse_end_line(SseFormatter *f) {
+    if (f->line == LINE_FIELD) {
+        if (f->name_len == 0 && !f->has_colon) {
+            sse_dispatch(f);
+            goto reset;
+        }
+        // Campo sem ':' vale como valor vazio
+        f->field = f->name_len <= SSE_MAX_FIELD ? sse_field(f->name, f->name_len) : FIELD_OTHER;
+    }
+
+    switch (f->field) {
+        case FIELD_DATA:
+            if (f->line != LINE_SKIP) sse_value(f, "\n", 1);
+            break;
+        case FIELD_ID:
+            // Um id com NUL e ignorado
+            if (!memchr(f->value, '\0', f->value_len)) {
+                memcpy(f->id, f->value, f->value_len);
+                f->id[f->value_len] = '\0';
+                f->id_seen = 1;
+            }
+            break;
+        case FIELD_EVENT:
+            memcpy(f->event, f->value, f->value_len);
+            f->event[f->value_len] = '\0';
+            break;
+        case FIELD_RETRY: {
+            size_t i = 0;
+            while (i < f->value_len && f->value[i] >= '0' && f->value[i] <= '9') i++;
+            if (i > 0 && i == f->value_len) {
+                memcpy(f->retry, f->value, i);
+                f->retry[i] = '\0';
+                f->state->retry_ms = strtol(f->retry, NULL, 10);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+reset:
+    f->line = LINE_FIELD;
+    f->name_len = 0;
+    f->has_colon = 0;
+    f->field = FIELD_OTHER;
+    f->value_len = 0;
+}
+
+#define SSE_BOM "\xEF\xBB\xBF"
+
+static void sse_scan(SseFormatter *f, const char *p, const char *end) {
+    while (p < end && !f->base.stopped) {
+        char c = *p;
+
+        if (f->after_cr) {
+            f->after_cr = 0;
+            if (c == '\n') {
+                p++;
+                continue;
+            }
+        }
+
+        if (c == '\r' || c == '\n') {
+            sse_end_line(f);
+            f->after_cr = c == '\r';
+            p++;
+            continue;
+        }
+
+        switch (f->line) {
+            case LINE_FIELD:
+                if (c == ':') {
+                    f->has_colon = 1;
+                    if (f->name_len == 0) {
+                        f->line = LINE_SKIP;    // comentario
+                        break;
+                    }
+                    f->field = f->name_len <= SSE_MAX_FIELD ? sse_field(f->name, f->name_len) : FIELD_OTHER;
+                    f->line = f->field == FIELD_OTHER ? LINE_SKIP : LINE_SPACE;
+                } else {
+                    if (f->name_len < SSE_MAX_FIELD) f->name[f->name_len] = c;
+                    f->name_len++;
+                }
+                p++;
+                break;
+
+            case LINE_SPACE:
+                f->line = LINE_VALUE;
+                if (c == ' ') p++;
+                break;
+
+            case LINE_VALUE: {
+                // Copia o valor ate o fim da linha de uma vez
+                const char *run = p;
+                while (p < end && *p != '\r' && *p != '\n') p++;
+                sse_value(f, run, (size_t)(p - run));
+                break;
+            }
+
+            case LINE_SKIP:
+                while (p < end && *p != '\r' && *p != '\n') p++;
+                break;
+        }
+    }
+}
+
+static int sse_feed(Formatter *base, const char *data, size_t len) {
+    SseFormatter *f = (SseFormatter *)base;
+    const char *p = data;
+    const char *end = data + len;
+
+    // BOM UTF-8 no inicio do stream, que pode vir cortado entre blocos
+    while (f->bom_matched >= 0 && p < end) {
+        if (*p != SSE_BOM[f->bom_matched]) {
+            // Nao era BOM: os bytes ja consumidos sao conteudo
+            int matched = f->bom_matched;
+            f->bom_matched = -1;
+            sse_scan(f, SSE_BOM, SSE_BOM + matched);
+            break;
+        }
+        p++;
+        if (++f->bom_matched == 3) f->bom_matched = -1;
+    }
+
+    sse_scan(f, p, end);
+    return f->base.stopped;
+}
+
+// Um evento sem a linha em branco final e descartado, como no navegador
+static void sse_finish(Formatter *base) {
+    SseFormatter *f = (SseFormatter *)base;
+
+    out_color(RESET);
+    strbuf_free(&f->data);
+    free(f);
+}
+
+Formatter* sse_formatter_new(SseState *state) {
+    SseFormatter *f = calloc(1, sizeof(SseFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = sse_feed;
+    f->base.finish = sse_finish;
+    f->state = state ? state : &f->own_state;
+    memcpy(f->id, f->state->last_id, sizeof(f->id));
+    f->line = LINE_FIELD;
+    f->field = FIELD_OTHER;
+    return &f->base;
+}
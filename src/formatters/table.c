@@ -0,0 +1,591 @@
+#include "formatters.h"
+#include "../output.h"
+#include "../json_parser.h"
+#include "../strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Registros usados para escolher colunas e larguras antes de imprimir
+#define TABLE_SAMPLE_ROWS   100
+#define TABLE_MAX_WIDTH     40      // largura maxima de uma coluna (--table)
+#define TABLE_MAX_CELL      1024    // bytes guardados por celula (--table)
+
+// Tipo do valor de uma celula
+enum {
+    CELL_MISSING,
+    CELL_STRING,
+    CELL_NUMBER,
+    CELL_BOOLEAN,
+    CELL_NULL,
+    CELL_NESTED     // objeto/array, guardado como JSON compacto
+};
+
+typedef struct {
+    char *name;
+    int width;
+    int numeric;            // todos os valores da amostra sao numeros
+} TableColumn;
+
+typedef struct {
+    unsigned char type;
+    StrBuf text;
+} TableCell;
+
+// Registro guardado durante a amostragem
+typedef struct {
+    int count;
+    unsigned char *types;
+    char **texts;
+} SampleRow;
+
+typedef struct {
+    Formatter base;
+    int csv;
+    CsvColumns *shared;             // colunas da lista de URLs (--csv)
+    int inherited;                  // colunas (e nomes) de uma resposta anterior
+    size_t cell_max;                // 0 = sem limite (CSV nao corta valores)
+    JsonParser parser;
+
+    TableColumn columns[TABLE_MAX_COLUMNS];
+    int column_count;
+    int next_column;                // palpite: campos costumam vir na mesma ordem
+    int columns_fixed;              // amostra impressa, colunas nao mudam mais
+    unsigned long long dropped;     // campos fora das colunas escolhidas
+
+    TableCell cells[TABLE_MAX_COLUMNS];  // registro atual
+    SampleRow sample[TABLE_SAMPLE_ROWS];
+    int sample_count;
+    int sample_size;
+    long printed;                   // linhas de dados ja impressas
+
+    // Posicao no documento
+    int depth;                      // apenas array externo e objeto do registro
+    int in_array;
+    int record_open;
+    int record_depth;
+    int loose_value;                // registro formado por um unico valor
+    int cell;                       // coluna do valor atual (-1 = ignorado)
+
+    // Valor aninhado sendo serializado para a celula
+    int nest;
+    int after_key;
+    char first[JSON_PARSER_MAX_DEPTH + 1];
+    StrBuf nested;
+} TableFormatter;
+
+// Colunas ------------------------------------------------------------------
+
+static int column_index(TableFormatter *f, const char *name, size_t len) {
+    for (int k = 0; k < f->column_count; k++) {
+        int i = (f->next_column + k) % f->column_count;
+        if (strlen(f->columns[i].name) == len && memcmp(f->columns[i].name, name, len) == 0) {
+            f->next_column = i + 1;
+            return i;
+        }
+    }
+
+    if (f->columns_fixed || f->column_count == TABLE_MAX_COLUMNS) {
+        f->dropped++;
+        return -1;
+    }
+
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+
+    int i = f->column_count++;
+    f->columns[i].name = copy;
+    f->columns[i].width = 0;
+    f->columns[i].numeric = 1;
+    f->cells[i].type = CELL_MISSING;
+    f->next_column = f->column_count;
+    return i;
+}
+
+// Celulas ------------------------------------------------------------------
+
+// Largura em colunas do terminal (um caractere por code point UTF-8)
+static int display_width(const char *s, size_t len) {
+    int w = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (((unsigned char)s[i] & 0xC0) != 0x80) w++;
+    }
+    return w;
+}
+
+static const char* cell_color(unsigned char type) {
+    switch (type) {
+        case CELL_STRING:  return GREEN;
+        case CELL_NUMBER:  return YELLOW;
+        case CELL_BOOLEAN: return MAGENTA;
+        case CELL_NULL:    return DIM;
+        default:           return RESET;
+    }
+}
+
+static void put_spaces(int n) {
+    for (int i = 0; i < n; i++) out_putc(' ');
+}
+
+// Imprime a celula alinhada em width colunas, cortando com "…"
+static void put_cell(const char *s, size_t len, const char *c_color, int width, int right, int last) {
+    int w = display_width(s, len);
+    int cut = w > width;
+    int shown = cut ? width : w;
+
+    if (right) put_spaces(width - shown);
+
+    out_color(c_color);
+    size_t end = len;
+    if (cut) {
+        // Posicao do code point width-1, onde entra o "…"
+        int chars = 0;
+        for (end = 0; end < len; end++) {
+            if (((unsigned char)s[end] & 0xC0) != 0x80 && chars++ == width - 1) break;
+        }
+    }
+    size_t run = 0;
+    for (size_t i = 0; i < end; i++) {
+        // Quebras de linha e tabs nao podem desalinhar a tabela
+        if ((unsigned char)s[i] < 0x20) {
+            out_write(s + run, i - run);
+            out_putc(' ');
+            run = i + 1;
+        }
+    }
+    out_write(s + run, end - run);
+    if (cut) out_puts("\xE2\x80\xA6");
+    out_color(RESET);
+
+    if (!right && !last) put_spaces(width - shown);
+}
+
+static void put_csv_field(const char *s, size_t len) {
+    int quote = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == ',' || s[i] == '"' || s[i] == '\r' || s[i] == '\n') {
+            quote = 1;
+            break;
+        }
+    }
+
+    if (!quote) {
+        out_write(s, len);
+        return;
+    }
+
+    out_putc('"');
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '"') out_putc('"');
+        out_putc(s[i]);
+    }
+    out_putc('"');
+}
+
+// Impressao ----------------------------------------------------------------
+
+static void print_header(TableFormatter *f) {
+    if (f->csv) {
+        for (int i = 0; i < f->column_count; i++) {
+            if (i > 0) out_putc(',');
+            put_csv_field(f->columns[i].name, strlen(f->columns[i].name));
+        }
+        out_puts("\r\n");
+        return;
+    }
+
+    for (int i = 0; i < f->column_count; i++) {
+        TableColumn *col = &f->columns[i];
+        if (i > 0) out_puts("  ");
+        put_cell(col->name, strlen(col->name), BOLD_WHITE, col->width, col->numeric,
+                 i == f->column_count - 1);
+    }
+    out_putc('\n');
+
+    out_color(DIM);
+    for (int i = 0; i < f->column_count; i++) {
+        if (i > 0) out_puts("  ");
+        for (int k = 0; k < f->columns[i].width; k++) out_putc('-');
+    }
+    out_color(RESET);
+    out_putc('\n');
+}
+
+static void print_row(TableFormatter *f, const unsigned char *types, char *const *texts, const size_t *lens) {
+    for (int i = 0; i < f->column_count; i++) {
+        unsigned char type = types[i];
+        const char *text = type == CELL_MISSING ? "" : texts[i];
+        size_t len = type == CELL_MISSING ? 0 : lens[i];
+
+        if (f->csv) {
+            if (i > 0) out_putc(',');
+            if (type != CELL_NULL) put_csv_field(text, len);
+        } else {
+            if (i > 0) out_puts("  ");
+            put_cell(text, len, cell_color(type), f->columns[i].width, f->columns[i].numeric,
+                     i == f->column_count - 1);
+        }
+    }
+    out_puts(f->csv ? "\r\n" : "\n");
+}
+
+// Limites de --max-items/--max-lines/--max-bytes antes de cada linha
+static int row_allowed(TableFormatter *f) {
+    if ((out_max_items() > 0 && f->printed >= out_max_items()) || out_stopped()) {
+        if (!f->csv && !out_state.broken) {
+            out_elision();
+            out_putc('\n');
+        }
+        f->base.stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static void flush_sample(TableFormatter *f) {
+    unsigned char types[TABLE_MAX_COLUMNS];
+    size_t lens[TABLE_MAX_COLUMNS];
+    char *texts[TABLE_MAX_COLUMNS];
+
+    if (f->columns_fixed) return;
+    f->columns_fixed = 1;
+
+    // Larguras a partir da amostra
+    for (int i = 0; i < f->column_count; i++) {
+        TableColumn *col = &f->columns[i];
+        int seen = 0;
+        col->width = display_width(col->name, strlen(col->name));
+        for (int r = 0; r < f->sample_count; r++) {
+            SampleRow *row = &f->sample[r];
+            if (i >= row->count || row->types[i] == CELL_MISSING) continue;
+            int w = display_width(row->texts[i], strlen(row->texts[i]));
+            if (w > col->width) col->width = w;
+            if (row->types[i] != CELL_NULL) {
+                if (row->types[i] != CELL_NUMBER) col->numeric = 0;
+                seen = 1;
+            }
+        }
+        if (!seen) col->numeric = 0;
+        if (col->width > TABLE_MAX_WIDTH) col->width = TABLE_MAX_WIDTH;
+        if (col->width < 1) col->width = 1;
+    }
+
+    if (f->column_count > 0) {
+        print_header(f);
+
+        // As proximas respostas da lista seguem estas colunas
+        if (f->shared) {
+            for (int i = 0; i < f->column_count; i++) {
+                f->shared->names[i] = strdup(f->columns[i].name);
+                if (!f->shared->names[i]) break;
+                f->shared->count = i + 1;
+            }
+        }
+    }
+
+    for (int r = 0; r < f->sample_count; r++) {
+        SampleRow *row = &f->sample[r];
+        if (!f->base.stopped && row_allowed(f)) {
+            for (int i = 0; i < f->column_count; i++) {
+                types[i] = i < row->count ? row->types[i] : CELL_MISSING;
+                texts[i] = i < row->count ? row->texts[i] : NULL;
+                lens[i] = texts[i] ? strlen(texts[i]) : 0;
+            }
+            print_row(f, types, texts, lens);
+            f->printed++;
+        }
+
+        for (int i = 0; i < row->count; i++) free(row->texts[i]);
+        free(row->texts);
+        free(row->types);
+    }
+    f->sample_count = 0;
+}
+
+// Registros ----------------------------------------------------------------
+
+static void record_begin(TableFormatter *f) {
+    for (int i = 0; i < f->column_count; i++) {
+        f->cells[i].type = CELL_MISSING;
+    }
+    f->record_open = 1;
+    f->cell = -1;
+}
+
+static void save_sample(TableFormatter *f) {
+    SampleRow *row = &f->sample[f->sample_count++];
+
+    row->count = f->column_count;
+    row->types = malloc(f->column_count + 1);
+    row->texts = calloc(f->column_count + 1, sizeof(char *));
+    if (!row->types || !row->texts) {
+        row->count = 0;
+        return;
+    }
+
+    for (int i = 0; i < f->column_count; i++) {
+        TableCell *cell = &f->cells[i];
+        row->types[i] = cell->type;
+        if (cell->type != CELL_MISSING) {
+            row->texts[i] = malloc(cell->text.len + 1);
+            if (!row->texts[i]) {
+                row->types[i] = CELL_MISSING;
+                continue;
+            }
+            memcpy(row->texts[i], cell->text.data ? cell->text.data : "", cell->text.len);
+            row->texts[i][cell->text.len] = '\0';
+        }
+    }
+}
+
+static void record_end(TableFormatter *f) {
+    f->record_open = 0;
+    f->loose_value = 0;
+
+    if (!f->columns_fixed) {
+        save_sample(f);
+        if (f->sample_count == f->sample_size) flush_sample(f);
+        return;
+    }
+
+    if (!row_allowed(f)) return;
+
+    unsigned char types[TABLE_MAX_COLUMNS];
+    size_t lens[TABLE_MAX_COLUMNS];
+    char *texts[TABLE_MAX_COLUMNS];
+    for (int i = 0; i < f->column_count; i++) {
+        types[i] = f->cells[i].type;
+        texts[i] = f->cells[i].text.data;
+        lens[i] = f->cells[i].text.len;
+    }
+    print_row(f, types, texts, lens);
+    f->printed++;
+}
+
+static void set_cell(TableFormatter *f, unsigned char type, const char *text, size_t len) {
+    if (f->cell >= 0) {
+        TableCell *cell = &f->cells[f->cell];
+        if (f->cell_max && len > f->cell_max) len = f->cell_max;
+        cell->type = type;
+        strbuf_reset(&cell->text);
+        strbuf_append(&cell->text, text, len);
+    }
+
+    if (f->loose_value) record_end(f);
+}
+
+// Objetos e arrays dentro de uma celula viram JSON compacto
+static void nested_append(TableFormatter *f, const char *s, size_t len) {
+    if (f->cell < 0) return;
+    if (f->cell_max && f->nested.len + len > f->cell_max) return;
+    strbuf_append(&f->nested, s, len);
+}
+
+static void nested_event(TableFormatter *f, JsonEvent event, const char *text, size_t len) {
+    int closing = event == JSON_EVENT_OBJECT_END || event == JSON_EVENT_ARRAY_END;
+
+    if (!closing) {
+        if (!f->first[f->nest] && !f->after_key) nested_append(f, ",", 1);
+        f->first[f->nest] = 0;
+        f->after_key = 0;
+    }
+
+    switch (event) {
+        case JSON_EVENT_OBJECT_START:
+        case JSON_EVENT_ARRAY_START:
+            nested_append(f, event == JSON_EVENT_OBJECT_START ? "{" : "[", 1);
+            f->first[++f->nest] = 1;
+            break;
+
+        case JSON_EVENT_OBJECT_END:
+        case JSON_EVENT_ARRAY_END:
+            nested_append(f, event == JSON_EVENT_OBJECT_END ? "}" : "]", 1);
+            if (--f->nest == 0) {
+                set_cell(f, CELL_NESTED, f->nested.data ? f->nested.data : "", f->nested.len);
+            }
+            break;
+
+        case JSON_EVENT_KEY:
+        case JSON_EVENT_STRING: {
+            StrBuf s = {0};
+            strbuf_json_string(&s, text, len);
+            nested_append(f, s.data, s.len);
+            strbuf_free(&s);
+            if (event == JSON_EVENT_KEY) {
+                nested_append(f, ":", 1);
+                f->after_key = 1;
+            }
+            break;
+        }
+
+        default:
+            nested_append(f, text, len);
+            break;
+    }
+}
+
+static int table_event(void *ctx, JsonEvent event, const char *text, size_t len) {
+    TableFormatter *f = (TableFormatter *)ctx;
+    int opening = event == JSON_EVENT_OBJECT_START || event == JSON_EVENT_ARRAY_START;
+
+    if (f->nest > 0) {
+        nested_event(f, event, text, len);
+        return f->base.stopped;
+    }
+
+    if (event == JSON_EVENT_OBJECT_END || event == JSON_EVENT_ARRAY_END) {
+        f->depth--;
+        if (f->record_open && f->depth == f->record_depth - 1) {
+            record_end(f);
+        } else if (f->depth == 0) {
+            f->in_array = 0;
+        }
+        return f->base.stopped;
+    }
+
+    if (!f->record_open) {
+        if (event == JSON_EVENT_ARRAY_START && f->depth == 0) {
+            f->in_array = 1;
+            f->depth++;
+            return 0;
+        }
+
+        record_begin(f);
+        if (event == JSON_EVENT_OBJECT_START) {
+            f->record_depth = ++f->depth;
+            return 0;
+        }
+
+        // Array de escalares (ou de arrays): uma unica coluna "value"
+        f->loose_value = 1;
+        f->cell = column_index(f, "value", 5);
+    } else if (event == JSON_EVENT_KEY) {
+        f->cell = column_index(f, text, len);
+        return 0;
+    }
+
+    if (opening) {
+        strbuf_reset(&f->nested);
+        f->first[0] = 1;
+        nested_event(f, event, text, len);
+        return f->base.stopped;
+    }
+
+    switch (event) {
+        case JSON_EVENT_STRING:
+            set_cell(f, CELL_STRING, text, len);
+            break;
+        case JSON_EVENT_NUMBER:
+            set_cell(f, CELL_NUMBER, text, len);
+            break;
+        case JSON_EVENT_TRUE:
+        case JSON_EVENT_FALSE:
+            set_cell(f, CELL_BOOLEAN, text, len);
+            break;
+        default:
+            set_cell(f, CELL_NULL, "null", 4);
+            break;
+    }
+
+    return f->base.stopped;
+}
+
+// Formatador ----------------------------------------------------------------
+
+static int table_feed(Formatter *base, const char *data, size_t len) {
+    TableFormatter *f = (TableFormatter *)base;
+
+    if (json_parser_feed(&f->parser, data, len) < 0) {
+        f->base.stopped = 1;
+    }
+
+    return f->base.stopped;
+}
+
+static void table_finish(Formatter *base) {
+    TableFormatter *f = (TableFormatter *)base;
+    int failed = f->parser.error != NULL;
+
+    // Se a saida foi fechada o documento ficou pela metade de proposito
+    if (!f->base.stopped && !out_state.broken && json_parser_finish(&f->parser) < 0) {
+        failed = 1;
+    }
+
+    // Documento com menos registros que a amostra
+    flush_sample(f);
+
+    if (failed) {
+        out_flush();
+        fprintf(stderr, "%sError: invalid JSON at byte %zu: %s%s\n",
+                color(RED), f->parser.offset, f->parser.error, color(RESET));
+    }
+
+    if (f->dropped > 0) {
+        if (f->inherited) {
+            out_flush();
+            fprintf(stderr, "Warning: %llu fields outside the columns of the first response were dropped\n",
+                    f->dropped);
+        } else if (f->csv) {
+            out_flush();
+            fprintf(stderr, "Warning: %llu fields outside the columns of the first %d records were dropped\n",
+                    f->dropped, f->sample_size);
+        } else if (!f->base.stopped) {
+            out_color(DIM);
+            out_printf("(%llu fields outside the columns of the first %d records not shown)\n",
+                       f->dropped, f->sample_size);
+            out_color(RESET);
+        }
+    }
+
+    // Nomes herdados pertencem ao CsvColumns
+    for (int i = 0; i < f->column_count && !f->inherited; i++) {
+        free(f->columns[i].name);
+    }
+    for (int i = 0; i < TABLE_MAX_COLUMNS; i++) {
+        strbuf_free(&f->cells[i].text);
+    }
+    strbuf_free(&f->nested);
+    json_parser_free(&f->parser);
+    free(f);
+}
+
+void csv_columns_free(CsvColumns *columns) {
+    for (int i = 0; i < columns->count; i++) {
+        free(columns->names[i]);
+    }
+    columns->count = 0;
+}
+
+Formatter* table_formatter_new(int csv, CsvColumns *shared) {
+    TableFormatter *f = calloc(1, sizeof(TableFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = table_feed;
+    f->base.finish = table_finish;
+    f->csv = csv;
+    f->shared = csv ? shared : NULL;
+    f->cell_max = csv ? 0 : TABLE_MAX_CELL;
+
+    // Cabecalho ja impresso por uma resposta anterior: sem amostra, as
+    // linhas saem direto nas mesmas colunas
+    if (f->shared && f->shared->count > 0) {
+        for (int i = 0; i < f->shared->count; i++) {
+            f->columns[i].name = f->shared->names[i];
+        }
+        f->column_count = f->shared->count;
+        f->columns_fixed = 1;
+        f->inherited = 1;
+        f->shared = NULL;
+    }
+
+    // Com --max-items pequeno nao faz sentido esperar a amostra inteira
+    f->sample_size = TABLE_SAMPLE_ROWS;
+    if (out_max_items() > 0 && out_max_items() < f->sample_size) {
+        f->sample_size = (int)out_max_items();
+    }
+
+    json_parser_init(&f->parser, table_event, f, f->cell_max);
+    return &f->base;
+}
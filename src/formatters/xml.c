@@ -1,211 +1,503 @@
 #include "formatters.h"
-#include "../colors.h"
-#include <stdio.h>
+#include "../output.h"
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
-void format_xml(const char *data) {
-    if (!data) return;
+#define XML_MAX_NAME 128
 
-    int indent = 0;
-    int in_tag = 0;
-    int in_string = 0;
-    int in_comment = 0;
-    int in_cdata = 0;
-    int is_closing_tag = 0;
-    int is_self_closing = 0;
-    int tag_has_content = 0;
-    const char *p = data;
+// Estados do formatador XML
+typedef enum {
+    XML_OUTSIDE,    // entre tags
+    XML_SPACE,      // whitespace entre tags: so e impresso se vier texto depois
+    XML_TEXT,       // conteudo de texto ate o proximo '<'
+    XML_MARKUP,     // '<' pendente: tag, comentario ou CDATA
+    XML_TAG_NAME,   // nome da tag de abertura
+    XML_CLOSE_NAME, // nome da tag de fechamento
+    XML_TAG,        // dentro da tag, entre atributos
+    XML_ATTR_NAME,
+    XML_STRING,     // valor de atributo
+    XML_COMMENT,
+    XML_CDATA
+} XmlState;
 
-    while (*p) {
-        // Detect XML comments
-        if (!in_string && strncmp(p, "<!--", 4) == 0) {
-            printf("%s<!--", color(DIM));
-            p += 4;
-            in_comment = 1;
-            continue;
-        }
+typedef struct {
+    Formatter base;
+    XmlState state;
+    XmlState resume;        // estado ao sair de comentario/CDATA
+    int indent;
+    int is_closing_tag;
+    int is_self_closing;
+    int is_pi;              // <?...?> nao e elemento
+    int tag_has_content;
+    int consumed;           // ja processamos algum byte
+    int markup_first;       // o '<' pendente e o primeiro byte do documento
+    char prev;              // ultimo byte processado
+    char pend[16];          // inicio de markup ainda indefinido
+    int pend_len;
+    int marker;             // '-' ou ']' consecutivos no fim de comentario/CDATA
+    char *space;            // whitespace pendente em XML_SPACE
+    size_t space_len;
+    size_t space_cap;
+    char name[XML_MAX_NAME];
+    int name_len;
+    char *stack;            // nomes das tags abertas, separados por '\0'
+    size_t stack_len;
+    size_t stack_cap;
+    int depth;
+    long items;             // elementos completos dentro da raiz
+} XmlFormatter;
 
-        if (in_comment) {
-            if (strncmp(p, "-->", 3) == 0) {
-                printf("-->%s", color(RESET));
-                p += 3;
-                in_comment = 0;
-                continue;
-            }
-            putchar(*p);
-            p++;
-            continue;
-        }
+static void xml_step(XmlFormatter *f, char c);
 
-        // Detect CDATA
-        if (!in_string && strncmp(p, "<![CDATA[", 9) == 0) {
-            printf("%s<![CDATA[", color(YELLOW));
-            p += 9;
-            in_cdata = 1;
-            continue;
-        }
+// Pilha de tags abertas, usada para fechar o documento ao truncar
+static void xml_push(XmlFormatter *f) {
+    size_t need = f->stack_len + f->name_len + 1;
+    if (need > f->stack_cap) {
+        size_t cap = f->stack_cap ? f->stack_cap * 2 : 256;
+        while (cap < need) cap *= 2;
+        char *ptr = realloc(f->stack, cap);
+        if (!ptr) return;
+        f->stack = ptr;
+        f->stack_cap = cap;
+    }
+    memcpy(f->stack + f->stack_len, f->name, f->name_len);
+    f->stack_len += f->name_len;
+    f->stack[f->stack_len++] = '\0';
+    f->depth++;
+}
 
-        if (in_cdata) {
-            if (strncmp(p, "]]>", 3) == 0) {
-                printf("]]>%s", color(RESET));
-                p += 3;
-                in_cdata = 0;
-                continue;
-            }
-            putchar(*p);
-            p++;
-            continue;
-        }
+static const char* xml_top(XmlFormatter *f) {
+    if (f->stack_len == 0) return NULL;
+    size_t i = f->stack_len - 1;
+    while (i > 0 && f->stack[i - 1] != '\0') i--;
+    return f->stack + i;
+}
 
-        // Inside string (attribute)
-        if (in_tag && (*p == '"' || *p == '\'')) {
-            char quote = *p;
-            if (!in_string) {
-                printf("%s%c", color(GREEN), quote);
-                in_string = 1;
-            } else if (in_string) {
-                printf("%c%s", quote, color(RESET));
-                in_string = 0;
-            }
-            p++;
-            continue;
+static void xml_pop(XmlFormatter *f) {
+    const char *top = xml_top(f);
+    if (!top) return;
+    f->stack_len = top - f->stack;
+    f->depth--;
+}
+
+static void xml_truncate(XmlFormatter *f) {
+    switch (f->state) {
+        case XML_STRING:
+            out_putc('"');
+            out_color(RESET);
+            break;
+        case XML_SPACE:
+            break;
+        default:
+            out_color(RESET);
+            break;
+    }
+    f->state = XML_OUTSIDE;
+
+    out_putc('\n');
+    out_indent(f->indent);
+    out_elision();
+
+    const char *top;
+    while ((top = xml_top(f)) != NULL) {
+        f->indent--;
+        out_putc('\n');
+        out_indent(f->indent);
+        out_color(BLUE);
+        out_puts("</");
+        out_color(CYAN);
+        out_puts(top);
+        out_color(BLUE);
+        out_putc('>');
+        out_color(RESET);
+        xml_pop(f);
+    }
+
+    f->base.stopped = 1;
+}
+
+static void xml_space_append(XmlFormatter *f, char c) {
+    if (f->space_len == f->space_cap) {
+        size_t cap = f->space_cap ? f->space_cap * 2 : 64;
+        char *ptr = realloc(f->space, cap);
+        if (!ptr) return;
+        f->space = ptr;
+        f->space_cap = cap;
+    }
+    f->space[f->space_len++] = c;
+}
+
+// Inicio de conteudo de texto
+static void xml_text_start(XmlFormatter *f) {
+    out_color(WHITE);
+    f->tag_has_content = 1;
+    f->state = XML_TEXT;
+}
+
+// Decide o que e o '<' pendente; next e o caractere seguinte (0 no fim)
+static void xml_tag_start(XmlFormatter *f, char next) {
+    f->is_closing_tag = (next == '/');
+    f->is_self_closing = 0;
+    f->is_pi = (next == '?');
+    f->name_len = 0;
+
+    // Elementos completos dentro da raiz contam como itens
+    if (out_limit_reached() ||
+        (!f->is_closing_tag && f->depth == 1 && out_max_items() > 0 && f->items >= out_max_items())) {
+        xml_truncate(f);
+        return;
+    }
+
+    if (f->is_closing_tag) {
+        f->indent--;
+    }
+
+    // Newline and indentation for tags (except first)
+    if (!f->markup_first && !f->tag_has_content) {
+        out_putc('\n');
+        out_indent(f->indent);
+    }
+
+    out_color(BLUE);
+    out_putc('<');
+    out_color(RESET);
+
+    if (f->is_closing_tag) {
+        out_color(BLUE);
+        out_putc('/');
+        out_color(CYAN);
+        f->state = XML_CLOSE_NAME;
+        return;
+    }
+
+    // Detect XML declaration or processing instruction
+    if (next == '?') {
+        out_color(MAGENTA);
+        out_putc('?');
+    }
+    out_color(CYAN);
+    f->state = XML_TAG_NAME;
+    f->tag_has_content = 0;
+}
+
+// Resolve o markup pendente quando ja nao pode ser comentario nem CDATA
+static void xml_markup_resolve(XmlFormatter *f) {
+    char pending[16];
+    int n = f->pend_len;
+
+    memcpy(pending, f->pend, n);
+    f->pend_len = 0;
+
+    xml_tag_start(f, n > 1 ? pending[1] : '\0');
+    if (f->base.stopped) return;
+
+    // O '/' de fechamento e o '?' ja foram impressos
+    int skip = (n > 1 && (pending[1] == '/' || pending[1] == '?')) ? 2 : 1;
+    for (int i = skip; i < n && !f->base.stopped; i++) {
+        xml_step(f, pending[i]);
+    }
+}
+
+static void xml_markup(XmlFormatter *f, char c) {
+    static const char comment[] = "<!--";
+    static const char cdata[] = "<![CDATA[";
+
+    f->pend[f->pend_len++] = c;
+
+    if ((size_t)f->pend_len <= strlen(comment) && strncmp(f->pend, comment, f->pend_len) == 0) {
+        if ((size_t)f->pend_len == strlen(comment)) {
+            f->pend_len = 0;
+            out_color(DIM);
+            out_puts(comment);
+            f->marker = 0;
+            f->state = XML_COMMENT;
         }
+        return;
+    }
 
-        if (in_string) {
-            putchar(*p);
-            p++;
-            continue;
+    if ((size_t)f->pend_len <= strlen(cdata) && strncmp(f->pend, cdata, f->pend_len) == 0) {
+        if ((size_t)f->pend_len == strlen(cdata)) {
+            f->pend_len = 0;
+            out_color(YELLOW);
+            out_puts(cdata);
+            f->marker = 0;
+            f->state = XML_CDATA;
         }
+        return;
+    }
 
-        // Tag start
-        if (*p == '<') {
-            in_tag = 1;
-            is_closing_tag = (*(p + 1) == '/');
-            is_self_closing = 0;
+    xml_markup_resolve(f);
+}
 
-            if (is_closing_tag) {
-                indent--;
-            }
+// Fim de comentario ("-->") ou CDATA ("]]>")
+static void xml_section(XmlFormatter *f, char c, char mark, const char *end) {
+    if (c == mark) {
+        f->marker++;
+        return;
+    }
+
+    if (c == '>' && f->marker >= 2) {
+        for (int i = 2; i < f->marker; i++) out_putc(mark);
+        out_puts(end);
+        out_color(RESET);
+        f->marker = 0;
+        f->state = f->resume;
+        return;
+    }
+
+    for (int i = 0; i < f->marker; i++) out_putc(mark);
+    f->marker = 0;
+    out_putc(c);
+}
 
-            // Newline and indentation for tags (except first)
-            if (p != data && !tag_has_content) {
-                putchar('\n');
-                for (int i = 0; i < indent * 2; i++) putchar(' ');
+static void xml_tag_end(XmlFormatter *f) {
+    // Check if self-closing
+    if (f->prev == '/' || f->prev == '?') {
+        f->is_self_closing = 1;
+    }
+
+    out_color(BLUE);
+    out_putc('>');
+    out_color(RESET);
+    f->state = XML_OUTSIDE;
+
+    if (!f->is_closing_tag && !f->is_self_closing) {
+        f->indent++;
+        if (f->name_len > 0 && f->name[0] != '!') xml_push(f);
+    } else if (f->is_closing_tag) {
+        xml_pop(f);
+        if (f->depth == 1) f->items++;
+    } else if (f->depth == 1 && !f->is_pi && f->name_len > 0 && f->name[0] != '!') {
+        f->items++;
+    }
+
+    f->tag_has_content = 0;
+}
+
+static void xml_step(XmlFormatter *f, char c) {
+    int first = !f->consumed;
+    f->consumed = 1;
+
+    switch (f->state) {
+        case XML_OUTSIDE:
+            if (c == '<') {
+                f->markup_first = first;
+                f->resume = XML_OUTSIDE;
+                f->pend[0] = c;
+                f->pend_len = 1;
+                f->state = XML_MARKUP;
+            } else if (isspace((unsigned char)c)) {
+                f->space_len = 0;
+                xml_space_append(f, c);
+                f->state = XML_SPACE;
+            } else {
+                xml_text_start(f);
+                out_putc(c);
             }
+            break;
 
-            printf("%s<%s", color(BLUE), color(RESET));
+        case XML_SPACE:
+            if (isspace((unsigned char)c)) {
+                xml_space_append(f, c);
+            } else if (c == '<') {
+                // Whitespace entre tags e descartado
+                f->state = XML_OUTSIDE;
+                xml_step(f, c);
+                return;
+            } else {
+                xml_text_start(f);
+                out_write(f->space, f->space_len);
+                out_putc(c);
+            }
+            break;
 
-            if (is_closing_tag) {
-                printf("%s/", color(BLUE));
-                p += 2;
-                // Print tag name
-                printf("%s", color(CYAN));
-                while (*p && *p != '>' && !isspace(*p)) {
-                    putchar(*p);
-                    p++;
-                }
-                printf("%s", color(RESET));
-                continue;
+        case XML_TEXT:
+            if (c == '<') {
+                out_color(RESET);
+                f->state = XML_OUTSIDE;
+                xml_step(f, c);
+                return;
             }
+            out_putc(c);
+            break;
+
+        case XML_MARKUP:
+            xml_markup(f, c);
+            break;
 
-            p++;
-            // Detect XML declaration or processing instruction
-            if (*p == '?') {
-                printf("%s?", color(MAGENTA));
-                p++;
+        case XML_TAG_NAME:
+            if (c == '>' || c == '/' || isspace((unsigned char)c)) {
+                out_color(RESET);
+                f->state = XML_TAG;
+                xml_step(f, c);
+                return;
             }
-            // Print tag name
-            printf("%s", color(CYAN));
-            while (*p && *p != '>' && *p != '/' && !isspace(*p)) {
-                putchar(*p);
-                p++;
+            if (f->name_len < XML_MAX_NAME - 1) f->name[f->name_len++] = c;
+            out_putc(c);
+            break;
+
+        case XML_CLOSE_NAME:
+            if (c == '>' || isspace((unsigned char)c)) {
+                out_color(RESET);
+                f->state = XML_TAG;
+                xml_step(f, c);
+                return;
             }
-            printf("%s", color(RESET));
-            tag_has_content = 0;
-            continue;
-        }
+            out_putc(c);
+            break;
 
-        // Tag end
-        if (*p == '>') {
-            // Check if self-closing
-            if (p > data && *(p - 1) == '/') {
-                is_self_closing = 1;
-            } else if (p > data && *(p - 1) == '?') {
-                is_self_closing = 1;
+        case XML_TAG:
+            if (c == '"' || c == '\'') {
+                out_color(GREEN);
+                out_putc(c);
+                f->state = XML_STRING;
+            } else if (c == '<') {
+                f->markup_first = first;
+                f->resume = XML_TAG;
+                f->pend[0] = c;
+                f->pend_len = 1;
+                f->state = XML_MARKUP;
+            } else if (c == '>') {
+                xml_tag_end(f);
+            } else if (c == '/') {
+                // Self-closing tag slash
+                out_color(BLUE);
+                out_putc('/');
+                f->is_self_closing = 1;
+            } else if (isalpha((unsigned char)c)) {
+                out_putc(' ');
+                out_color(YELLOW);
+                out_putc(c);
+                f->state = XML_ATTR_NAME;
+            } else if (c == '=') {
+                out_color(BOLD_WHITE);
+                out_putc('=');
+                out_color(RESET);
+            } else if (!isspace((unsigned char)c)) {
+                out_putc(c);
             }
+            break;
 
-            printf("%s>%s", color(BLUE), color(RESET));
-            in_tag = 0;
+        case XML_ATTR_NAME:
+            if (c == '=' || c == '>' || isspace((unsigned char)c)) {
+                out_color(RESET);
+                f->state = XML_TAG;
+                xml_step(f, c);
+                return;
+            }
+            out_putc(c);
+            break;
 
-            if (!is_closing_tag && !is_self_closing) {
-                indent++;
+        case XML_STRING:
+            out_putc(c);
+            if (c == '"' || c == '\'') {
+                out_color(RESET);
+                f->state = XML_TAG;
             }
+            break;
 
-            tag_has_content = 0;
-            p++;
-            continue;
-        }
+        case XML_COMMENT:
+            xml_section(f, c, '-', "-->");
+            break;
 
-        // Self-closing tag slash
-        if (in_tag && *p == '/') {
-            printf("%s/", color(BLUE));
-            is_self_closing = 1;
-            p++;
-            continue;
-        }
+        case XML_CDATA:
+            xml_section(f, c, ']', "]]>");
+            break;
+    }
 
-        // Attribute name
-        if (in_tag && isalpha(*p)) {
-            printf(" %s", color(YELLOW));
-            while (*p && *p != '=' && *p != '>' && !isspace(*p)) {
-                putchar(*p);
-                p++;
-            }
-            printf("%s", color(RESET));
-            continue;
-        }
+    f->prev = c;
+}
 
-        // Equals sign in attribute
-        if (in_tag && *p == '=') {
-            printf("%s=%s", color(BOLD_WHITE), color(RESET));
-            p++;
-            continue;
-        }
+static int xml_feed(Formatter *base, const char *data, size_t len) {
+    XmlFormatter *f = (XmlFormatter *)base;
+    const char *p = data;
+    const char *end = data + len;
 
-        // Text content
-        if (!in_tag) {
-            // Skip whitespace between tags
-            if (isspace(*p)) {
-                // Check if there's real content after whitespace
-                const char *look = p;
-                while (*look && isspace(*look)) look++;
-                if (*look == '<') {
-                    p = look;
-                    continue;
-                }
+    while (p < end && !f->base.stopped) {
+        if (f->state == XML_TEXT || f->state == XML_STRING) {
+            // Copia trechos de texto/valores de uma vez
+            const char *run = p;
+            if (f->state == XML_TEXT) {
+                while (p < end && *p != '<') p++;
+            } else {
+                while (p < end && *p != '"' && *p != '\'') p++;
             }
-
-            // Actual text content
-            printf("%s", color(WHITE));
-            tag_has_content = 1;
-            while (*p && *p != '<') {
-                putchar(*p);
-                p++;
+            if (p > run) {
+                out_write(run, p - run);
+                f->prev = p[-1];
             }
-            printf("%s", color(RESET));
-            continue;
+            if (p == end) break;
         }
+        xml_step(f, *p++);
+    }
+
+    // Textos e comentarios enormes nao esperam a proxima tag para parar
+    if (!f->base.stopped && out_limit_reached() &&
+        (f->state == XML_TEXT || f->state == XML_STRING ||
+         f->state == XML_COMMENT || f->state == XML_CDATA)) {
+        xml_truncate(f);
+    }
+
+    return f->base.stopped;
+}
+
+static void xml_finish(Formatter *base) {
+    XmlFormatter *f = (XmlFormatter *)base;
 
-        // Spaces inside tag
-        if (in_tag && isspace(*p)) {
-            p++;
-            continue;
+    if (!f->base.stopped) {
+        if (f->state == XML_MARKUP) {
+            xml_markup_resolve(f);
         }
 
-        putchar(*p);
-        p++;
+        switch (f->state) {
+            case XML_SPACE:
+                // Whitespace no fim do documento e impresso como texto
+                out_color(WHITE);
+                out_write(f->space, f->space_len);
+                out_color(RESET);
+                break;
+            case XML_COMMENT:
+            case XML_CDATA:
+                for (int i = 0; i < f->marker; i++) {
+                    out_putc(f->state == XML_COMMENT ? '-' : ']');
+                }
+                break;
+            case XML_TEXT:
+            case XML_TAG_NAME:
+            case XML_CLOSE_NAME:
+            case XML_ATTR_NAME:
+                out_color(RESET);
+                break;
+            default:
+                break;
+        }
     }
 
-    printf("%s\n", color(RESET));
+    out_color(RESET);
+    out_putc('\n');
+
+    free(f->space);
+    free(f->stack);
+    free(f);
+}
+
+Formatter* xml_formatter_new(void) {
+    XmlFormatter *f = calloc(1, sizeof(XmlFormatter));
+    if (!f) return NULL;
+
+    f->base.feed = xml_feed;
+    f->base.finish = xml_finish;
+    f->state = XML_OUTSIDE;
+    return &f->base;
+}
+
+void format_xml(const char *data) {
+    if (!data) return;
+
+    Formatter *f = xml_formatter_new();
+    if (!f) return;
+
+    formatter_feed(f, data, strlen(data));
+    formatter_finish(f);
 }
@@ -1,24 +1,101 @@
 #include "http.h"
+#include "resolve.h"
+#include "strbuf.h"
+#include "stats.h"
 #include <curl/curl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+
+// Tempo maximo de uma requisicao, em segundos
+#define REQUEST_TIMEOUT 30L
+
+// Estado de uma transferencia em andamento
+typedef struct {
+    CURL *curl;
+    const HttpRequest *req;
+    HttpResponse *resp;
+    struct curl_slist *header_list;
+    int streaming;      // on_body ja recebeu o primeiro bloco
+    int consumer_done;  // on_body pediu para parar, mas a gravacao continua
+    int event_stream;   // text/event-stream: sem tempo maximo
+    int timed_out;
+    time_t started;
+} HttpTransfer;
+
+static void fill_response_info(CURL *curl, HttpResponse *resp);
+
+// Mensagem de erro da requisicao: no buffer do chamador ou em stderr
+static void request_error(const HttpRequest *req, const char *prefix, const char *detail) {
+    if (req->error) {
+        snprintf(req->error, HTTP_ERROR_MAX, "%s%s", prefix, detail);
+    } else {
+        fprintf(stderr, "Request error: %s%s\n", prefix, detail);
+    }
+}
+
+// --record / --replay (http_set_fixtures)
+static HttpFixtures fixtures;
+
+static int recording(void) {
+    return fixtures.store && !fixtures.replay;
+}
+
+static int replaying(void) {
+    return fixtures.store && fixtures.replay;
+}
+
+static int is_event_stream(const char *content_type) {
+    static const char name[] = "text/event-stream";
+    for (const char *p = content_type; p && *p; p++) {
+        size_t i = 0;
+        while (name[i] && tolower((unsigned char)p[i]) == name[i]) i++;
+        if (!name[i]) return 1;
+    }
+    return 0;
+}
 
 // Callback to receive the response body
 static size_t write_body_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
-    HttpResponse *resp = (HttpResponse *)userp;
+    HttpTransfer *t = (HttpTransfer *)userp;
+    HttpResponse *resp = t->resp;
+
+    if (t->req->on_body) {
+        // Headers da resposta final ja chegaram: status e tipo estao disponiveis
+        if (!t->streaming) {
+            fill_response_info(t->curl, resp);
+            t->streaming = 1;
+            t->event_stream = is_event_stream(resp->content_type);
+        }
 
-    char *ptr = realloc(resp->body, resp->body_size + realsize + 1);
-    if (!ptr) {
-        fprintf(stderr, "Error: out of memory\n");
-        return 0;
+        // Gravando, o body tambem vai para o store
+        if (recording() && body_store_append(&resp->body, contents, realsize) != 0) {
+            return 0;
+        }
+
+        if (!t->consumer_done) {
+            STATS_ADD(body_streamed, realsize);
+            if (t->req->on_body(resp, contents, realsize, t->req->userdata) != 0) {
+                resp->aborted = 1;
+                // A gravacao precisa da resposta inteira; um stream de
+                // eventos pode nao terminar, entao fica com o que chegou
+                if (!recording() || t->event_stream) return 0;
+                t->consumer_done = 1;
+            }
+        }
+
+        resp->body_size += realsize;
+        return realsize;
     }
 
-    resp->body = ptr;
-    memcpy(&(resp->body[resp->body_size]), contents, realsize);
+    if (body_store_append(&resp->body, contents, realsize) != 0) {
+        return 0;
+    }
     resp->body_size += realsize;
-    resp->body[resp->body_size] = 0;
 
     return realsize;
 }
@@ -39,15 +116,28 @@ static size_t write_header_callback(void *contents, size_t size, size_t nmemb, v
     resp->headers_size += realsize;
     resp->headers[resp->headers_size] = 0;
 
+    STATS_ADD(header_reallocs, 1);
+    STATS_ADD(header_bytes_copied, realsize);
+    STATS_PEAK(header_peak, resp->headers_size);
+
     return realsize;
 }
 
-int http_init(void) {
-    return curl_global_init(CURL_GLOBAL_ALL) == CURLE_OK ? 0 : -1;
+// Inicializacao global feita so na primeira requisicao: --help, --version,
+// erros de argumento e --diff entre arquivos nao carregam o libcurl nem o TLS
+static int initialized;
+
+static int http_global_init(void) {
+    if (initialized) return 0;
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) return -1;
+    initialized = 1;
+    return 0;
 }
 
 void http_cleanup(void) {
+    if (!initialized) return;
     curl_global_cleanup();
+    initialized = 0;
 }
 
 // Extrai o Content-Type dos headers
@@ -80,18 +170,410 @@ static char* extract_content_type(const char *headers) {
     return content_type;
 }
 
-HttpResponse* http_request(const HttpRequest *req) {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Error: failed to initialize curl\n");
+// Content-Type sem parametros ("text/html; charset=utf-8" -> "text/html")
+static char* media_type(const char *ct, size_t len) {
+    size_t n = 0;
+    while (n < len && ct[n] != ';') n++;
+    while (n > 0 && (ct[n - 1] == ' ' || ct[n - 1] == '\t')) n--;
+
+    char *type = malloc(n + 1);
+    if (type) {
+        memcpy(type, ct, n);
+        type[n] = '\0';
+    }
+    return type;
+}
+
+// Preenche status e Content-Type da resposta final
+static void fill_response_info(CURL *curl, HttpResponse *resp) {
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
+
+    if (!resp->content_type) {
+        // Com redirects, os headers acumulados tem varios Content-Type;
+        // o libcurl informa o da resposta final
+        char *ct = NULL;
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &ct);
+        if (ct) {
+            resp->content_type = media_type(ct, strlen(ct));
+        } else {
+            resp->content_type = extract_content_type(resp->headers);
+        }
+    }
+}
+
+// Gravacao e reproducao -----------------------------------------------------
+
+void http_set_fixtures(const HttpFixtures *f) {
+    if (f) {
+        fixtures = *f;
+    } else {
+        memset(&fixtures, 0, sizeof(fixtures));
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void replay_wait(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static void request_key(StrBuf *key, const HttpRequest *req) {
+    fixture_key(key, req->method, req->url, (const char *const *)req->headers, req->header_count,
+                fixtures.key_headers, fixtures.key_header_count);
+}
+
+// Acrescenta a resposta concluida ao store
+static void record_response(const HttpTransfer *t, HttpResponse *resp) {
+    const char *body = body_store_view(&resp->body);
+    if (!body) return;
+
+    // Content-Type com parametros (charset), como veio
+    char *ct = NULL;
+    curl_easy_getinfo(t->curl, CURLINFO_CONTENT_TYPE, &ct);
+    if (!ct) ct = resp->content_type;
+
+    StrBuf key = {0};
+    request_key(&key, t->req);
+
+    Fixture f;
+    memset(&f, 0, sizeof(f));
+    f.key = key.data;
+    f.key_len = key.len;
+    f.status = resp->status_code;
+    f.content_type = ct ? ct : "";
+    f.content_type_len = ct ? strlen(ct) : 0;
+    f.headers = resp->headers ? resp->headers : "";
+    f.headers_len = resp->headers_size;
+    f.body = body;
+    f.body_len = resp->body.size;
+    curl_easy_getinfo(t->curl, CURLINFO_STARTTRANSFER_TIME, &f.first_byte_time);
+    curl_easy_getinfo(t->curl, CURLINFO_TOTAL_TIME, &f.total_time);
+
+    fixture_store_append(fixtures.store, &f);
+    strbuf_free(&key);
+}
+
+// Monta a resposta gravada para req. Com delay, devolve em *delay quanto a
+// resposta levaria (escalado) em vez de esperar; senao espera aqui, e com
+// on_body entrega o body em blocos, como numa transferencia.
+static HttpResponse* replay_request(const HttpRequest *req, double *delay) {
+    StrBuf key = {0};
+    request_key(&key, req);
+
+    Fixture f;
+    if (!fixture_store_find(fixtures.store, key.data, key.len, &f)) {
+        key.data[strcspn(key.data, "\n")] = '\0';
+        request_error(req, "no recorded response for ", key.data);
+        strbuf_free(&key);
         return NULL;
     }
+    strbuf_free(&key);
 
     HttpResponse *resp = calloc(1, sizeof(HttpResponse));
     if (!resp) {
-        curl_easy_cleanup(curl);
+        fprintf(stderr, "Error: out of memory\n");
         return NULL;
     }
+    body_store_init(&resp->body, req->body_mem_limit);
+    resp->status_code = f.status;
+    resp->headers = malloc(f.headers_len + 1);
+    if (f.content_type_len > 0) resp->content_type = media_type(f.content_type, f.content_type_len);
+    if (!resp->headers || (f.content_type_len > 0 && !resp->content_type)) {
+        fprintf(stderr, "Error: out of memory\n");
+        http_response_free(resp);
+        return NULL;
+    }
+    memcpy(resp->headers, f.headers, f.headers_len);
+    resp->headers[f.headers_len] = '\0';
+    resp->headers_size = f.headers_len;
+
+    double first_byte = f.first_byte_time * fixtures.latency;
+    double total = f.total_time * fixtures.latency;
+    resp->timings.first_byte = f.first_byte_time;
+    resp->timings.total = f.total_time;
+    if (delay) {
+        *delay = total;
+        req = NULL;     // sem espera e sem on_body
+    } else {
+        replay_wait(first_byte);
+    }
+
+    if (req && req->on_body) {
+        for (size_t off = 0; off < f.body_len; off += BODY_WINDOW) {
+            size_t n = f.body_len - off < BODY_WINDOW ? f.body_len - off : BODY_WINDOW;
+            STATS_ADD(body_streamed, n);
+            if (req->on_body(resp, f.body + off, n, req->userdata) != 0) {
+                resp->aborted = 1;
+                break;
+            }
+            resp->body_size += n;
+        }
+    } else {
+        // Direto do mmap, sem copia
+        body_store_borrow(&resp->body, f.body, f.body_len);
+        resp->body_size = f.body_len;
+    }
+
+    if (!delay) replay_wait(total - first_byte);
+
+#if CURLSER_STATS
+    stats.requests++;
+    stats.first_byte_time = first_byte;
+    stats.transfer_time = total;
+#endif
+
+    return resp;
+}
+
+// Conexao reaproveitada entre requisicoes (--watch, listas de URLs)
+struct HttpSession {
+    CURL *curl;                 // criado na primeira requisicao
+    CURLSH *share;              // cache de DNS, sessoes TLS e conexoes do prewarm
+    struct curl_slist *resolve; // enderecos resolvidos antes (CURLOPT_RESOLVE)
+    int resolved;
+};
+
+HttpSession* http_session_new(void) {
+    return calloc(1, sizeof(HttpSession));
+}
+
+void http_session_free(HttpSession *s) {
+    if (!s) return;
+    if (s->curl) curl_easy_cleanup(s->curl);
+    if (s->share) curl_share_cleanup(s->share);
+    curl_slist_free_all(s->resolve);
+    free(s);
+}
+
+// Hosts distintos das URLs, com a porta efetiva e o esquema da primeira URL
+typedef struct {
+    ResolveEntry entry;
+    char *scheme;
+} PrewarmHost;
+
+static size_t collect_hosts(const char *const *urls, size_t count, PrewarmHost **out) {
+    PrewarmHost *hosts = NULL;
+    size_t n = 0, cap = 0;
+    CURLU *u = curl_url();
+
+    for (size_t i = 0; u && i < count; i++) {
+        char *scheme = NULL, *host = NULL, *port = NULL;
+
+        if (curl_url_set(u, CURLUPART_URL, urls[i], 0) == CURLUE_OK &&
+            curl_url_get(u, CURLUPART_SCHEME, &scheme, 0) == CURLUE_OK &&
+            curl_url_get(u, CURLUPART_HOST, &host, 0) == CURLUE_OK &&
+            curl_url_get(u, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) == CURLUE_OK) {
+
+            // IPv6 vem entre colchetes
+            size_t len = strlen(host);
+            if (host[0] == '[' && len > 2) {
+                memmove(host, host + 1, len - 2);
+                host[len - 2] = '\0';
+            }
+
+            int p = atoi(port);
+            size_t j;
+            for (j = 0; j < n; j++) {
+                if (hosts[j].entry.port == p && strcasecmp(hosts[j].entry.host, host) == 0 &&
+                    strcasecmp(hosts[j].scheme, scheme) == 0) break;
+            }
+
+            if (j == n && n == cap) {
+                size_t new_cap = cap ? cap * 2 : 16;
+                PrewarmHost *tmp = realloc(hosts, new_cap * sizeof(PrewarmHost));
+                if (tmp) {
+                    hosts = tmp;
+                    cap = new_cap;
+                }
+            }
+            if (j == n && n < cap) {
+                memset(&hosts[n], 0, sizeof(PrewarmHost));
+                hosts[n].entry.host = strdup(host);
+                hosts[n].entry.port = p;
+                hosts[n].scheme = strdup(scheme);
+                if (hosts[n].entry.host && hosts[n].scheme) {
+                    n++;
+                } else {
+                    free(hosts[n].entry.host);
+                    free(hosts[n].scheme);
+                }
+            }
+        }
+        curl_free(scheme);
+        curl_free(host);
+        curl_free(port);
+    }
+
+    curl_url_cleanup(u);
+    *out = hosts;
+    return n;
+}
+
+// O host foi resolvido (ha uma entrada "host:porta:" no CURLOPT_RESOLVE)
+static int session_has_address(const HttpSession *s, const char *host, int port) {
+    char prefix[300];
+    int n = snprintf(prefix, sizeof(prefix), "%s:%d:", host, port);
+    if (n < 0 || (size_t)n >= sizeof(prefix)) return 0;
+
+    for (const struct curl_slist *e = s->resolve; e; e = e->next) {
+        if (strncasecmp(e->data, prefix, (size_t)n) == 0) return 1;
+    }
+    return 0;
+}
+
+static size_t discard_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    (void)contents;
+    (void)userp;
+    return size * nmemb;
+}
+
+// Abre `connections` conexoes por host em paralelo com um HEAD na raiz. Elas
+// ficam no cache de conexoes compartilhado e as primeiras requisicoes de
+// verdade ja encontram o TCP (e o TLS) estabelecido.
+static void open_connections(HttpSession *s, const PrewarmHost *hosts, size_t count, int connections) {
+    CURLM *multi = curl_multi_init();
+    if (!multi) return;
+
+    size_t total = count * (size_t)connections;
+    CURL **handles = calloc(total, sizeof(CURL *));
+    StrBuf url = {0};
+
+    for (size_t i = 0; handles && i < total; i++) {
+        const PrewarmHost *h = &hosts[i / (size_t)connections];
+        if (!resolve_is_literal(h->entry.host) && !session_has_address(s, h->entry.host, h->entry.port)) continue;
+
+        url.len = 0;
+        strbuf_printf(&url, strchr(h->entry.host, ':') ? "%s://[%s]:%d/" : "%s://%s:%d/",
+                      h->scheme, h->entry.host, h->entry.port);
+
+        CURL *c = curl_easy_init();
+        if (!c) break;
+        curl_easy_setopt(c, CURLOPT_URL, url.data);
+        curl_easy_setopt(c, CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(c, CURLOPT_SHARE, s->share);
+        curl_easy_setopt(c, CURLOPT_RESOLVE, s->resolve);
+        curl_easy_setopt(c, CURLOPT_TIMEOUT, 10L);
+        curl_easy_setopt(c, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(c, CURLOPT_USERAGENT, "curlser/1.0");
+        curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, discard_callback);
+        curl_multi_add_handle(multi, c);
+        handles[i] = c;
+    }
+
+    int running = 1;
+    while (running) {
+        if (curl_multi_perform(multi, &running) != CURLM_OK) break;
+        if (running) curl_multi_poll(multi, NULL, 0, 1000, NULL);
+    }
+
+    for (size_t i = 0; handles && i < total; i++) {
+        if (!handles[i]) continue;
+        curl_multi_remove_handle(multi, handles[i]);
+        curl_easy_cleanup(handles[i]);
+    }
+    free(handles);
+    strbuf_free(&url);
+    curl_multi_cleanup(multi);
+}
+
+int http_session_prewarm(HttpSession *s, const char *const *urls, size_t count, int connections) {
+    // Reproduzindo nada vai para a rede
+    if (count == 0 || replaying()) return 0;
+    if (http_global_init() != 0) return -1;
+
+    if (!s->share) {
+        s->share = curl_share_init();
+        if (!s->share) return -1;
+        curl_share_setopt(s->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(s->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(s->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    }
+
+    PrewarmHost *hosts;
+    size_t n = collect_hosts(urls, count, &hosts);
+
+    // Os IPs literais nao passam pelo DNS. Numa segunda chamada (os workers
+    // do --workers herdam a sessao ja resolvida) so as conexoes sao abertas.
+    ResolveEntry *pending = s->resolved ? NULL : calloc(n ? n : 1, sizeof(ResolveEntry));
+    size_t pending_count = 0;
+    for (size_t i = 0; pending && i < n; i++) {
+        if (!resolve_is_literal(hosts[i].entry.host)) pending[pending_count++] = hosts[i].entry;
+    }
+    resolve_all(pending, pending_count, 0);
+
+    StrBuf entry = {0};
+    for (size_t i = 0, k = 0; pending && i < n; i++) {
+        if (resolve_is_literal(hosts[i].entry.host)) continue;
+        hosts[i].entry.addresses = pending[k++].addresses;
+        if (!hosts[i].entry.addresses) continue;
+
+        entry.len = 0;
+        strbuf_printf(&entry, "%s:%d:%s", hosts[i].entry.host, hosts[i].entry.port, hosts[i].entry.addresses);
+        struct curl_slist *list = curl_slist_append(s->resolve, entry.data);
+        if (list) s->resolve = list;
+    }
+    strbuf_free(&entry);
+    free(pending);
+    s->resolved = 1;
+
+    if (connections > 0) {
+        open_connections(s, hosts, n, connections);
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        free(hosts[i].entry.host);
+        free(hosts[i].entry.addresses);
+        free(hosts[i].scheme);
+    }
+    free(hosts);
+    return 0;
+}
+
+// Tempo maximo das transferencias em streaming. Um stream de eventos so
+// termina quando o servidor fecha, entao o limite nao vale para ele; como
+// CURLOPT_TIMEOUT nao pode mudar no meio da transferencia, o limite e
+// conferido aqui (pelo menos uma vez por segundo).
+static int progress_callback(void *userp, curl_off_t dltotal, curl_off_t dlnow,
+                             curl_off_t ultotal, curl_off_t ulnow) {
+    HttpTransfer *t = (HttpTransfer *)userp;
+    (void)dltotal;
+    (void)dlnow;
+    (void)ultotal;
+    (void)ulnow;
+
+    if (!t->event_stream && time(NULL) - t->started >= REQUEST_TIMEOUT) {
+        t->timed_out = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// Configura o handle para a requisicao e aloca a resposta
+static int transfer_begin(HttpTransfer *t, CURL *curl, const HttpRequest *req, const HttpSession *session) {
+    memset(t, 0, sizeof(*t));
+    t->curl = curl;
+    t->req = req;
+
+    HttpResponse *resp = calloc(1, sizeof(HttpResponse));
+    if (!resp) {
+        return -1;
+    }
+    body_store_init(&resp->body, req->body_mem_limit);
+    t->resp = resp;
+
+    if (session && session->share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, session->share);
+        curl_easy_setopt(curl, CURLOPT_RESOLVE, session->resolve);
+    }
 
     // Set URL
     curl_easy_setopt(curl, CURLOPT_URL, req->url);
@@ -117,17 +599,16 @@ HttpResponse* http_request(const HttpRequest *req) {
     }
 
     // Set custom headers
-    struct curl_slist *header_list = NULL;
     for (int i = 0; i < req->header_count; i++) {
-        header_list = curl_slist_append(header_list, req->headers[i]);
+        t->header_list = curl_slist_append(t->header_list, req->headers[i]);
     }
-    if (header_list) {
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
+    if (t->header_list) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, t->header_list);
     }
 
     // Set callbacks
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_body_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, resp);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, t);
     curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, write_header_callback);
     curl_easy_setopt(curl, CURLOPT_HEADERDATA, resp);
 
@@ -135,7 +616,25 @@ HttpResponse* http_request(const HttpRequest *req) {
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
     // Timeout
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    if (req->on_body) {
+        t->started = time(NULL);
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, REQUEST_TIMEOUT);
+        curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress_callback);
+        curl_easy_setopt(curl, CURLOPT_XFERINFODATA, t);
+        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    } else if (req->timeout > 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)(req->timeout * 1000));
+    } else {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, REQUEST_TIMEOUT);
+    }
+
+    // Mantem a conexao viva entre requisicoes
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    // Accept-Encoding com tudo que o libcurl sabe descompactar
+    if (req->compressed) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    }
 
     // User-Agent
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "curlser/1.0");
@@ -145,33 +644,303 @@ HttpResponse* http_request(const HttpRequest *req) {
         curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
     }
 
-    // Execute request
-    CURLcode res = curl_easy_perform(curl);
+    return 0;
+}
+
+// Fecha a transferencia: a resposta, ou NULL se ela falhou
+static HttpResponse* transfer_end(HttpTransfer *t, CURLcode res) {
+    HttpResponse *resp = t->resp;
+
+    if (t->header_list) curl_slist_free_all(t->header_list);
+    t->header_list = NULL;
+
+    // Abortar a pedido do consumidor do body nao e erro
+    if (res == CURLE_WRITE_ERROR && resp->aborted) {
+        res = CURLE_OK;
+    }
+    if (res == CURLE_ABORTED_BY_CALLBACK && t->timed_out) {
+        res = CURLE_OPERATION_TIMEDOUT;
+    }
 
     if (res != CURLE_OK) {
-        fprintf(stderr, "Request error: %s\n", curl_easy_strerror(res));
+        request_error(t->req, "", curl_easy_strerror(res));
         http_response_free(resp);
-        if (header_list) curl_slist_free_all(header_list);
-        curl_easy_cleanup(curl);
         return NULL;
     }
 
-    // Get status code
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &resp->status_code);
+    // Get status code and content-type
+    fill_response_info(t->curl, resp);
 
-    // Extract content-type
-    resp->content_type = extract_content_type(resp->headers);
+    HttpTimings *tm = &resp->timings;
+    curl_easy_getinfo(t->curl, CURLINFO_NAMELOOKUP_TIME, &tm->dns);
+    curl_easy_getinfo(t->curl, CURLINFO_CONNECT_TIME, &tm->connect);
+    curl_easy_getinfo(t->curl, CURLINFO_APPCONNECT_TIME, &tm->tls);
+    curl_easy_getinfo(t->curl, CURLINFO_STARTTRANSFER_TIME, &tm->first_byte);
+    curl_easy_getinfo(t->curl, CURLINFO_TOTAL_TIME, &tm->total);
+    curl_easy_getinfo(t->curl, CURLINFO_NUM_CONNECTS, &tm->new_connections);
 
-    // Cleanup
-    if (header_list) curl_slist_free_all(header_list);
-    curl_easy_cleanup(curl);
+    if (recording()) {
+        record_response(t, resp);
+    }
+
+#if CURLSER_STATS
+    stats.requests++;
+    stats.first_byte_time = tm->first_byte;
+    stats.transfer_time = tm->total;
+#endif
 
     return resp;
 }
 
+HttpResponse* http_session_request(HttpSession *session, const HttpRequest *req) {
+    if (replaying()) {
+        return replay_request(req, NULL);
+    }
+
+    if (!session->curl) {
+        if (http_global_init() != 0 || !(session->curl = curl_easy_init())) {
+            fprintf(stderr, "Error: failed to initialize HTTP library\n");
+            return NULL;
+        }
+    }
+
+    // Volta as opcoes ao padrao mas mantem conexoes, cache de DNS e sessoes TLS
+    curl_easy_reset(session->curl);
+
+    HttpTransfer transfer;
+    if (transfer_begin(&transfer, session->curl, req, session) != 0) {
+        return NULL;
+    }
+
+    // Execute request
+    CURLcode res = curl_easy_perform(session->curl);
+    return transfer_end(&transfer, res);
+}
+
+// Transferencias simultaneas -------------------------------------------------
+
+typedef struct MultiTransfer {
+    HttpTransfer transfer;
+    HttpRequest req;            // copia: a do chamador pode nao durar ate o fim
+    void *tag;
+    double ready_at;            // reproducao: quando a resposta gravada fica pronta
+    struct MultiTransfer *next;
+} MultiTransfer;
+
+struct HttpMulti {
+    CURLM *multi;
+    const HttpSession *session;
+    MultiTransfer *transfers;   // adicionadas e ainda nao devolvidas
+    int pending;
+};
+
+static void multi_transfer_free(HttpMulti *m, MultiTransfer *mt) {
+    for (MultiTransfer **p = &m->transfers; *p; p = &(*p)->next) {
+        if (*p == mt) {
+            *p = mt->next;
+            break;
+        }
+    }
+    if (mt->transfer.curl) {
+        curl_multi_remove_handle(m->multi, mt->transfer.curl);
+        curl_easy_cleanup(mt->transfer.curl);
+    }
+    free(mt);
+    m->pending--;
+}
+
+HttpMulti* http_multi_new(const HttpSession *session) {
+    HttpMulti *m = calloc(1, sizeof(HttpMulti));
+    if (!m) return NULL;
+
+    m->multi = curl_multi_init();
+    if (!m->multi) {
+        free(m);
+        return NULL;
+    }
+    m->session = session;
+    return m;
+}
+
+// Reproducao: a resposta e montada ja, e entregue quando a gravada
+// terminaria, como se as transferencias corressem em paralelo
+static int multi_add_replay(HttpMulti *m, const HttpRequest *req, void *tag) {
+    MultiTransfer *mt = calloc(1, sizeof(MultiTransfer));
+    if (!mt) return -1;
+
+    mt->req = *req;
+    mt->req.on_body = NULL;
+    mt->tag = tag;
+
+    double delay = 0;
+    mt->transfer.req = &mt->req;
+    mt->transfer.resp = replay_request(&mt->req, &delay);
+    mt->ready_at = now_seconds() + delay;
+
+    mt->next = m->transfers;
+    m->transfers = mt;
+    m->pending++;
+    return 0;
+}
+
+static int multi_next_replay(HttpMulti *m, HttpResponse **resp, void **tag, int timeout_ms) {
+    MultiTransfer *first = NULL;
+    for (MultiTransfer *mt = m->transfers; mt; mt = mt->next) {
+        if (!first || mt->ready_at <= first->ready_at) first = mt;
+    }
+
+    double wait = first ? first->ready_at - now_seconds() : 0;
+    if (timeout_ms >= 0 && (!first || wait > timeout_ms / 1000.0)) {
+        replay_wait(timeout_ms / 1000.0);
+        return 0;
+    }
+    if (!first) return 0;
+
+    replay_wait(wait);
+    *resp = first->transfer.resp;
+    *tag = first->tag;
+    multi_transfer_free(m, first);
+    return 1;
+}
+
+int http_multi_add(HttpMulti *m, const HttpRequest *req, void *tag) {
+    if (replaying()) return multi_add_replay(m, req, tag);
+    if (http_global_init() != 0) return -1;
+
+    MultiTransfer *mt = calloc(1, sizeof(MultiTransfer));
+    CURL *curl = mt ? curl_easy_init() : NULL;
+    if (!curl) {
+        free(mt);
+        return -1;
+    }
+
+    mt->req = *req;
+    mt->req.on_body = NULL;
+    mt->tag = tag;
+
+    if (transfer_begin(&mt->transfer, curl, &mt->req, m->session) != 0) {
+        curl_easy_cleanup(curl);
+        free(mt);
+        return -1;
+    }
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, mt);
+
+    if (curl_multi_add_handle(m->multi, curl) != CURLM_OK) {
+        http_response_free(transfer_end(&mt->transfer, CURLE_FAILED_INIT));
+        curl_easy_cleanup(curl);
+        free(mt);
+        return -1;
+    }
+    mt->next = m->transfers;
+    m->transfers = mt;
+    m->pending++;
+    return 0;
+}
+
+int http_multi_pending(const HttpMulti *m) {
+    return m->pending;
+}
+
+// timeout_ms < 0: espera ate uma transferencia terminar
+static int multi_next(HttpMulti *m, HttpResponse **resp, void **tag, int timeout_ms) {
+    if (replaying()) return multi_next_replay(m, resp, tag, timeout_ms);
+
+    for (int waited = 0;; waited = 1) {
+        int running;
+        if (curl_multi_perform(m->multi, &running) != CURLM_OK) return -1;
+
+        CURLMsg *msg;
+        int left;
+        while ((msg = curl_multi_info_read(m->multi, &left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            CURLcode res = msg->data.result;
+            MultiTransfer *mt = NULL;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&mt);
+
+            *resp = transfer_end(&mt->transfer, res);
+            *tag = mt->tag;
+            multi_transfer_free(m, mt);
+            return 1;
+        }
+
+        if ((m->pending == 0 && timeout_ms < 0) || (waited && timeout_ms >= 0)) return 0;
+        curl_multi_poll(m->multi, NULL, 0, timeout_ms < 0 ? 1000 : timeout_ms, NULL);
+    }
+}
+
+int http_multi_next(HttpMulti *m, HttpResponse **resp, void **tag) {
+    return multi_next(m, resp, tag, -1);
+}
+
+int http_multi_poll(HttpMulti *m, HttpResponse **resp, void **tag, int timeout_ms) {
+    return multi_next(m, resp, tag, timeout_ms < 0 ? 0 : timeout_ms);
+}
+
+void http_multi_keep_connections(HttpMulti *m, long count) {
+    curl_multi_setopt(m->multi, CURLMOPT_MAXCONNECTS, count);
+}
+
+void http_multi_free(HttpMulti *m) {
+    if (!m) return;
+
+    // Transferencias nao concluidas sao descartadas
+    while (m->transfers) {
+        MultiTransfer *mt = m->transfers;
+        if (mt->transfer.header_list) curl_slist_free_all(mt->transfer.header_list);
+        http_response_free(mt->transfer.resp);
+        multi_transfer_free(m, mt);
+    }
+
+    curl_multi_cleanup(m->multi);
+    free(m);
+}
+
+HttpResponse* http_request(const HttpRequest *req) {
+    HttpSession *session = http_session_new();
+    if (!session) {
+        fprintf(stderr, "Error: out of memory\n");
+        return NULL;
+    }
+
+    HttpResponse *resp = http_session_request(session, req);
+    http_session_free(session);
+    return resp;
+}
+
+char* http_response_header(const HttpResponse *resp, const char *name) {
+    if (!resp->headers) return NULL;
+
+    // Com redirects os headers de todas as respostas estao acumulados:
+    // vale a ultima ocorrencia
+    size_t name_len = strlen(name);
+    const char *found = NULL;
+    const char *line = resp->headers;
+    while (*line) {
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            found = line + name_len + 1;
+        }
+        const char *next = strchr(line, '\n');
+        if (!next) break;
+        line = next + 1;
+    }
+    if (!found) return NULL;
+
+    while (*found == ' ' || *found == '\t') found++;
+    size_t len = strcspn(found, "\r\n");
+    while (len > 0 && (found[len - 1] == ' ' || found[len - 1] == '\t')) len--;
+
+    char *value = malloc(len + 1);
+    if (value) {
+        memcpy(value, found, len);
+        value[len] = '\0';
+    }
+    return value;
+}
+
 void http_response_free(HttpResponse *resp) {
     if (resp) {
-        free(resp->body);
+        body_store_free(&resp->body);
         free(resp->headers);
         free(resp->content_type);
         free(resp);
@@ -2,17 +2,36 @@
 #define HTTP_H
 
 #include <stddef.h>
+#include "body.h"
+#include "fixtures.h"
+
+// Fases da transferencia, em segundos desde o inicio (CURLINFO_*_TIME)
+typedef struct {
+    double dns;
+    double connect;
+    double tls;                 // fim do handshake; 0 sem TLS
+    double first_byte;
+    double total;
+    long new_connections;       // conexoes abertas (0 = reaproveitou uma)
+} HttpTimings;
 
 // Estrutura para armazenar resposta HTTP
 typedef struct {
-    char *body;
-    size_t body_size;
+    BodyStore body;     // body acumulado (sem on_body, ou gravando com --record)
+    size_t body_size;   // bytes de body recebidos
     char *headers;
     size_t headers_size;
     long status_code;
     char *content_type;
+    int aborted;        // transferencia interrompida pelo consumidor do body
+    HttpTimings timings;
 } HttpResponse;
 
+// Consumidor do body em streaming: chamado a cada bloco recebido, com status
+// e Content-Type ja preenchidos. Retorna 0 para continuar ou != 0 para
+// abortar a transferencia (ex: limite de saida atingido).
+typedef int (*HttpBodyCallback)(HttpResponse *resp, const char *data, size_t len, void *userdata);
+
 // Estrutura para configuracao da requisicao
 typedef struct {
     const char *url;
@@ -22,17 +41,82 @@ typedef struct {
     const char *body;
     int show_headers;
     int verbose;
+    int compressed;             // pede gzip/deflate/zstd e descompacta ao receber
+    HttpBodyCallback on_body;   // se definido, o body nao e acumulado em memoria
+    void *userdata;
+    size_t body_mem_limit;      // bytes do body mantidos em memoria antes de ir para o disco
+    double timeout;             // segundos; 0 = padrao (30)
+    char *error;                // se definido, recebe a mensagem de erro (HTTP_ERROR_MAX) em vez de stderr
 } HttpRequest;
 
-// Inicializa a biblioteca HTTP
-int http_init(void);
+#define HTTP_ERROR_MAX 256
 
-// Limpa recursos da biblioteca HTTP
+// Limpa recursos da biblioteca HTTP. A inicializacao e feita sob demanda na
+// primeira requisicao, de acordo com o esquema da URL.
 void http_cleanup(void);
 
 // Executa uma requisicao HTTP
 HttpResponse* http_request(const HttpRequest *req);
 
+// Handle reaproveitado entre requisicoes: a conexao fica aberta (keep-alive)
+typedef struct HttpSession HttpSession;
+
+HttpSession* http_session_new(void);
+
+HttpResponse* http_session_request(HttpSession *session, const HttpRequest *req);
+
+void http_session_free(HttpSession *session);
+
+// Prepara a sessao para uma lista de URLs: resolve em paralelo os hosts
+// distintos e injeta os enderecos no cache de DNS (CURLOPT_RESOLVE). Com
+// connections > 0 abre, e em https faz o handshake TLS de, esse numero de
+// conexoes por host antes da primeira requisicao.
+int http_session_prewarm(HttpSession *session, const char *const *urls, size_t count, int connections);
+
+// Varias transferencias simultaneas num multi handle (--workers). O body e
+// sempre acumulado (on_body e ignorado); a sessao, se dada, fornece o cache
+// de DNS e os enderecos resolvidos pelo http_session_prewarm.
+typedef struct HttpMulti HttpMulti;
+
+HttpMulti* http_multi_new(const HttpSession *session);
+
+// Inicia uma requisicao; tag volta junto com a resposta
+int http_multi_add(HttpMulti *multi, const HttpRequest *req, void *tag);
+
+// Transferencias em andamento
+int http_multi_pending(const HttpMulti *multi);
+
+// Espera a proxima transferencia terminar. Retorna 1 com *resp (NULL se a
+// requisicao falhou) e *tag, 0 se nao ha nada em andamento, -1 em erro.
+int http_multi_next(HttpMulti *multi, HttpResponse **resp, void **tag);
+
+// Como http_multi_next, mas espera no maximo timeout_ms (mesmo sem nada em
+// andamento); retorna 0 se nenhuma transferencia terminou nesse tempo
+int http_multi_poll(HttpMulti *multi, HttpResponse **resp, void **tag, int timeout_ms);
+
+// Conexoes mantidas abertas entre transferencias (padrao do libcurl: 4 por
+// transferencia simultanea)
+void http_multi_keep_connections(HttpMulti *multi, long count);
+
+void http_multi_free(HttpMulti *multi);
+
+// Gravacao e reproducao de respostas (--record, --replay)
+typedef struct {
+    FixtureStore *store;
+    int replay;                         // 0 = grava cada resposta no store
+    const char *const *key_headers;     // headers da requisicao que entram na chave
+    int key_header_count;
+    double latency;                     // reproducao: escala dos tempos gravados (0 = sem espera)
+} HttpFixtures;
+
+// Vale para todas as requisicoes do processo (sessoes, multi e workers).
+// Em reproducao nada vai para a rede e uma requisicao sem fixture falha.
+// NULL desliga.
+void http_set_fixtures(const HttpFixtures *fixtures);
+
+// Valor de um header da resposta final (alocado), ou NULL
+char* http_response_header(const HttpResponse *resp, const char *name);
+
 // Libera memoria da resposta
 void http_response_free(HttpResponse *resp);
 
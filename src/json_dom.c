@@ -0,0 +1,646 @@
+#include "json_dom.h"
+#include "utf8.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define KEY_TABLE_SLOTS 65536   // potencia de 2
+#define KEY_INTERN_MAX  64      // chaves maiores nao sao compartilhadas
+
+struct JsonKeyTable {
+    Arena arena;
+    const char **keys;
+    uint32_t *lens;
+    size_t count;
+};
+
+// Itens do container aberto em cada nivel; o vetor e reaproveitado
+typedef struct {
+    JsonNode *items;
+    size_t count;
+    size_t cap;
+    const char *key;        // chave do proprio container no pai
+    uint32_t key_len;
+    int type;               // JSON_ARRAY ou JSON_OBJECT
+} DomFrame;
+
+struct JsonDom {
+    JsonParser parser;
+    Arena arena;
+    JsonKeyTable *keys;
+    DomFrame frames[JSON_PARSER_MAX_DEPTH + 1];  // frames[0] = nivel externo
+    int depth;
+    const char *key;        // chave do proximo valor
+    uint32_t key_len;
+    JsonNode root;
+    int has_root;
+    const char *error;
+    int no_hash;            // JSON_DOM_NO_HASH
+    size_t nodes;
+    size_t frame_allocs;    // realloc dos vetores de montagem
+    JsonNode *scratch;      // ordenacao das chaves
+    size_t scratch_cap;
+};
+
+// Hashes -------------------------------------------------------------------
+
+static uint64_t mix64(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64_t json_hash_bytes(uint64_t seed, const char *s, size_t n) {
+    uint64_t h = 14695981039346656037ULL ^ seed;
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    return mix64(h);
+}
+
+static uint64_t hash_container(int type, const JsonNode *children, size_t count) {
+    uint64_t h;
+
+    if (type == JSON_ARRAY) {
+        // Depende da ordem
+        h = 0x9e3779b97f4a7c15ULL;
+        for (size_t i = 0; i < count; i++) {
+            h = mix64(h + children[i].hash);
+        }
+    } else {
+        // Soma: a ordem das chaves nao importa
+        h = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint64_t k = json_hash_bytes(JSON_OBJECT, children[i].key, children[i].key_len);
+            h += mix64(k ^ (children[i].hash * 0x9e3779b97f4a7c15ULL));
+        }
+    }
+
+    return mix64(h ^ ((uint64_t)type << 56) ^ count);
+}
+
+// Chaves -------------------------------------------------------------------
+
+JsonKeyTable* json_key_table_new(void) {
+    JsonKeyTable *t = calloc(1, sizeof(JsonKeyTable));
+    if (!t) return NULL;
+
+    t->keys = calloc(KEY_TABLE_SLOTS, sizeof(const char *));
+    t->lens = calloc(KEY_TABLE_SLOTS, sizeof(uint32_t));
+    if (!t->keys || !t->lens) {
+        json_key_table_free(t);
+        return NULL;
+    }
+    arena_init(&t->arena);
+    return t;
+}
+
+void json_key_table_free(JsonKeyTable *t) {
+    if (!t) return;
+    arena_free(&t->arena);
+    free(t->keys);
+    free(t->lens);
+    free(t);
+}
+
+static const char* intern_key(JsonDom *dom, const char *s, size_t n) {
+    JsonKeyTable *t = dom->keys;
+
+    // Tabela cheia pela metade ou chave longa: copia sem compartilhar
+    if (!t || n > KEY_INTERN_MAX || t->count >= KEY_TABLE_SLOTS / 2) {
+        return arena_strndup(&dom->arena, s, n);
+    }
+
+    size_t i = json_hash_bytes(0, s, n) & (KEY_TABLE_SLOTS - 1);
+    while (t->keys[i]) {
+        if (t->lens[i] == n && memcmp(t->keys[i], s, n) == 0) return t->keys[i];
+        i = (i + 1) & (KEY_TABLE_SLOTS - 1);
+    }
+
+    const char *copy = arena_strndup(&t->arena, s, n);
+    if (!copy) return NULL;
+    t->keys[i] = copy;
+    t->lens[i] = (uint32_t)n;
+    t->count++;
+    return copy;
+}
+
+// Montagem -----------------------------------------------------------------
+
+static int push_node(JsonDom *dom, JsonNode *node) {
+    DomFrame *fr = &dom->frames[dom->depth];
+
+    if (fr->count == fr->cap) {
+        size_t cap = fr->cap ? fr->cap * 2 : 16;
+        JsonNode *items = realloc(fr->items, cap * sizeof(JsonNode));
+        if (!items) {
+            dom->error = "out of memory";
+            return 1;
+        }
+        fr->items = items;
+        fr->cap = cap;
+        dom->frame_allocs++;
+    }
+
+    fr->items[fr->count++] = *node;
+    dom->nodes++;
+    return 0;
+}
+
+// Valor simples no container aberto, com a chave pendente
+static int add_scalar(JsonDom *dom, int type, const char *text, size_t len) {
+    JsonNode node;
+    memset(&node, 0, sizeof(node));
+
+    node.type = type;
+    node.as.text = text;
+    node.len = (uint32_t)len;
+    if (!dom->no_hash) node.hash = json_hash_bytes(type, text, len);
+    node.key = dom->key;
+    node.key_len = dom->key_len;
+    dom->key = NULL;
+    dom->key_len = 0;
+    return push_node(dom, &node);
+}
+
+static void open_container(JsonDom *dom, int type) {
+    DomFrame *fr = &dom->frames[++dom->depth];
+    fr->count = 0;
+    fr->type = type;
+    fr->key = dom->key;
+    fr->key_len = dom->key_len;
+    dom->key = NULL;
+    dom->key_len = 0;
+}
+
+// Fecha o container do nivel atual: os filhos vao para a arena, de uma vez
+static int close_container(JsonDom *dom) {
+    DomFrame *fr = &dom->frames[dom->depth];
+    JsonNode node;
+    memset(&node, 0, sizeof(node));
+
+    node.type = fr->type;
+    if (fr->count > UINT32_MAX) {
+        dom->error = "container too large";
+        return 1;
+    }
+    node.len = (uint32_t)fr->count;
+    if (fr->count > 0) {
+        node.as.children = arena_alloc(&dom->arena, fr->count * sizeof(JsonNode));
+        if (!node.as.children) {
+            dom->error = "out of memory";
+            return 1;
+        }
+        memcpy(node.as.children, fr->items, fr->count * sizeof(JsonNode));
+    }
+    if (!dom->no_hash) node.hash = hash_container(node.type, node.as.children, fr->count);
+    node.key = fr->key;
+    node.key_len = fr->key_len;
+    dom->depth--;
+    return push_node(dom, &node);
+}
+
+static int dom_event(void *ctx, JsonEvent event, const char *text, size_t len) {
+    JsonDom *dom = (JsonDom *)ctx;
+
+    switch (event) {
+        case JSON_EVENT_KEY:
+            if (len > JSON_DOM_MAX_KEY) len = JSON_DOM_MAX_KEY;
+            dom->key = intern_key(dom, text, len);
+            dom->key_len = (uint32_t)len;
+            if (!dom->key) {
+                dom->error = "out of memory";
+                return 1;
+            }
+            return 0;
+
+        case JSON_EVENT_OBJECT_START:
+        case JSON_EVENT_ARRAY_START:
+            open_container(dom, event == JSON_EVENT_OBJECT_START ? JSON_OBJECT : JSON_ARRAY);
+            return 0;
+
+        case JSON_EVENT_OBJECT_END:
+        case JSON_EVENT_ARRAY_END:
+            return close_container(dom);
+
+        case JSON_EVENT_STRING:
+        case JSON_EVENT_NUMBER: {
+            if (len > UINT32_MAX) {
+                dom->error = "string too large";
+                return 1;
+            }
+            const char *copy = arena_strndup(&dom->arena, text, len);
+            if (!copy) {
+                dom->error = "out of memory";
+                return 1;
+            }
+            return add_scalar(dom, event == JSON_EVENT_STRING ? JSON_STRING : JSON_NUMBER, copy, len);
+        }
+
+        case JSON_EVENT_TRUE:
+            return add_scalar(dom, JSON_TRUE, NULL, 0);
+        case JSON_EVENT_FALSE:
+            return add_scalar(dom, JSON_FALSE, NULL, 0);
+        case JSON_EVENT_NULL:
+            return add_scalar(dom, JSON_NULL, NULL, 0);
+    }
+
+    return 0;
+}
+
+JsonDom* json_dom_new(JsonKeyTable *keys) {
+    JsonDom *dom = calloc(1, sizeof(JsonDom));
+    if (!dom) return NULL;
+
+    arena_init(&dom->arena);
+    dom->keys = keys;
+    json_parser_init(&dom->parser, dom_event, dom, 0);
+    return dom;
+}
+
+int json_dom_feed(JsonDom *dom, const char *data, size_t len) {
+    if (dom->error) return -1;
+    if (json_parser_feed(&dom->parser, data, len) != 0 && !dom->error) {
+        dom->error = dom->parser.error ? dom->parser.error : "parse stopped";
+    }
+    return dom->error ? -1 : 0;
+}
+
+// Raiz a partir dos valores do nivel externo
+static int build_root(JsonDom *dom) {
+    DomFrame *top = &dom->frames[0];
+    if (top->count == 1) {
+        dom->root = top->items[0];
+        dom->has_root = 1;
+    } else if (top->count > 1) {
+        // NDJSON: os documentos viram itens de um array
+        JsonNode *items = arena_alloc(&dom->arena, top->count * sizeof(JsonNode));
+        if (!items) {
+            dom->error = "out of memory";
+            return -1;
+        }
+        memcpy(items, top->items, top->count * sizeof(JsonNode));
+        memset(&dom->root, 0, sizeof(dom->root));
+        dom->root.type = JSON_ARRAY;
+        dom->root.as.children = items;
+        dom->root.len = (uint32_t)top->count;
+        if (!dom->no_hash) dom->root.hash = hash_container(JSON_ARRAY, items, top->count);
+        dom->has_root = 1;
+    }
+
+    return 0;
+}
+
+int json_dom_finish(JsonDom *dom) {
+    if (dom->error) return -1;
+    if (json_parser_finish(&dom->parser) != 0) {
+        if (!dom->error) dom->error = dom->parser.error;
+        return -1;
+    }
+
+    return build_root(dom);
+}
+
+// Documento inteiro em memoria --------------------------------------------
+
+static int is_ws(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// Conteudo de uma string com escapes, decodificado na arena como no parser
+// incremental (surrogate sem par vira U+FFFD). Escapes so encolhem o texto.
+static const char* decode_string(JsonDom *dom, const char *s, size_t n, size_t *out_len) {
+    char *out = arena_alloc(&dom->arena, n + 1);
+    if (!out) {
+        dom->error = "out of memory";
+        return NULL;
+    }
+
+    const char *end = s + n;
+    char *o = out;
+    unsigned high = 0;
+
+    while (s < end) {
+        char c = *s++;
+        if (c == '\\' && *s == 'u') {
+            unsigned cp = 0;
+            for (int i = 1; i <= 4; i++) {
+                int v = s + i < end ? utf8_hex_digit(s[i]) : -1;
+                if (v < 0) {
+                    dom->error = "invalid \\u escape";
+                    return NULL;
+                }
+                cp = (cp << 4) | (unsigned)v;
+            }
+            s += 5;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (high) o += utf8_encode(0xFFFD, o);
+                high = cp;
+                continue;
+            }
+            if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                if (high) {
+                    cp = 0x10000 + ((high - 0xD800) << 10) + (cp - 0xDC00);
+                    high = 0;
+                } else {
+                    cp = 0xFFFD;
+                }
+            }
+            if (high) {
+                o += utf8_encode(0xFFFD, o);
+                high = 0;
+            }
+            o += utf8_encode(cp, o);
+            continue;
+        }
+
+        if (high) {
+            o += utf8_encode(0xFFFD, o);
+            high = 0;
+        }
+        if (c != '\\') {
+            *o++ = c;
+            continue;
+        }
+
+        switch (*s++) {
+            case 'n': *o++ = '\n'; break;
+            case 't': *o++ = '\t'; break;
+            case 'r': *o++ = '\r'; break;
+            case 'b': *o++ = '\b'; break;
+            case 'f': *o++ = '\f'; break;
+            case '"': *o++ = '"'; break;
+            case '\\': *o++ = '\\'; break;
+            case '/': *o++ = '/'; break;
+            default:
+                dom->error = "invalid escape";
+                return NULL;
+        }
+    }
+    if (high) o += utf8_encode(0xFFFD, o);
+
+    *o = '\0';
+    *out_len = (size_t)(o - out);
+    return out;
+}
+
+// String a partir da aspa de abertura em *pp: sem escapes, o texto aponta
+// para o documento; com escapes, para a copia decodificada
+static const char* parse_string(JsonDom *dom, const char **pp, const char *end, size_t *len) {
+    const char *start = *pp + 1;
+    const char *q = start;
+    int escaped = 0;
+
+    for (;;) {
+        while (q < end && *q != '"' && *q != '\\') q++;
+        if (q >= end) {
+            dom->error = "unexpected end of document";
+            return NULL;
+        }
+        if (*q == '"') break;
+        escaped = 1;
+        q += 2;
+    }
+    *pp = q + 1;
+
+    if ((size_t)(q - start) > UINT32_MAX) {
+        dom->error = "string too large";
+        return NULL;
+    }
+    if (!escaped) {
+        *len = (size_t)(q - start);
+        return start;
+    }
+    return decode_string(dom, start, (size_t)(q - start), len);
+}
+
+enum { PARSE_VALUE, PARSE_KEY, PARSE_AFTER_VALUE };
+
+int json_dom_parse(JsonDom *dom, const char *data, size_t len, int flags) {
+    const char *p = data;
+    const char *end = data + len;
+    int state = PARSE_VALUE;
+
+    dom->no_hash = (flags & JSON_DOM_NO_HASH) != 0;
+
+    while (!dom->error) {
+        while (p < end && is_ws(*p)) p++;
+
+        if (p == end) {
+            if (dom->depth > 0 || state == PARSE_KEY) dom->error = "unexpected end of document";
+            break;
+        }
+
+        if (state == PARSE_AFTER_VALUE && dom->depth > 0) {
+            DomFrame *fr = &dom->frames[dom->depth];
+            char c = *p++;
+            if (c == ',') {
+                state = fr->type == JSON_OBJECT ? PARSE_KEY : PARSE_VALUE;
+            } else if ((c == '}' && fr->type == JSON_OBJECT) || (c == ']' && fr->type == JSON_ARRAY)) {
+                close_container(dom);
+            } else if (c == '}' || c == ']') {
+                dom->error = "mismatched bracket";
+            } else {
+                dom->error = "expected ',' or closing bracket";
+            }
+            continue;
+        }
+
+        if (state == PARSE_KEY) {
+            size_t n;
+            const char *key;
+            if (*p != '"') {
+                dom->error = "expected object key";
+                break;
+            }
+            if (!(key = parse_string(dom, &p, end, &n))) break;
+            if (n > JSON_DOM_MAX_KEY) n = JSON_DOM_MAX_KEY;
+
+            // Sem tabela, a chave fica no documento (ou na copia decodificada)
+            if (dom->keys) key = intern_key(dom, key, n);
+            if (!key) {
+                dom->error = "out of memory";
+                break;
+            }
+            dom->key = key;
+            dom->key_len = (uint32_t)n;
+
+            while (p < end && is_ws(*p)) p++;
+            if (p == end || *p != ':') {
+                dom->error = "expected ':'";
+                break;
+            }
+            p++;
+            state = PARSE_VALUE;
+            continue;
+        }
+
+        // Valor (ou outro valor no nivel externo, como no NDJSON)
+        char c = *p;
+        state = PARSE_AFTER_VALUE;
+
+        if (c == '{' || c == '[') {
+            if (dom->depth >= JSON_PARSER_MAX_DEPTH) {
+                dom->error = "nesting too deep";
+                break;
+            }
+            open_container(dom, c == '{' ? JSON_OBJECT : JSON_ARRAY);
+            p++;
+            while (p < end && is_ws(*p)) p++;
+            if (p < end && (*p == '}' || *p == ']')) continue;     // vazio: fechado acima
+            state = c == '{' ? PARSE_KEY : PARSE_VALUE;
+        } else if (c == '"') {
+            size_t n;
+            const char *text = parse_string(dom, &p, end, &n);
+            if (text) add_scalar(dom, JSON_STRING, text, n);
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            const char *start = p;
+            while (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' ||
+                               *p == '+' || *p == '-')) p++;
+            add_scalar(dom, JSON_NUMBER, start, (size_t)(p - start));
+        } else if (c == 't' && (size_t)(end - p) >= 4 && memcmp(p, "true", 4) == 0) {
+            add_scalar(dom, JSON_TRUE, NULL, 0);
+            p += 4;
+        } else if (c == 'f' && (size_t)(end - p) >= 5 && memcmp(p, "false", 5) == 0) {
+            add_scalar(dom, JSON_FALSE, NULL, 0);
+            p += 5;
+        } else if (c == 'n' && (size_t)(end - p) >= 4 && memcmp(p, "null", 4) == 0) {
+            add_scalar(dom, JSON_NULL, NULL, 0);
+            p += 4;
+        } else {
+            dom->error = c == 't' || c == 'f' || c == 'n' ? "invalid literal" : "unexpected character";
+        }
+    }
+
+    dom->parser.offset = (size_t)(p - data);
+    if (dom->error) return -1;
+    return build_root(dom);
+}
+
+// Ordenacao das chaves ------------------------------------------------------
+
+static int compare_keys(const JsonNode *a, const JsonNode *b) {
+    size_t n = a->key_len < b->key_len ? a->key_len : b->key_len;
+    int c = memcmp(a->key, b->key, n);
+    if (c != 0) return c;
+    return (a->key_len > b->key_len) - (a->key_len < b->key_len);
+}
+
+// Ordem das unidades UTF-16 (RFC 8785). So muda em relacao aos bytes UTF-8
+// quando um caractere fora do BMP (surrogates 0xD800-0xDBFF) encontra um de
+// U+E000-U+FFFF: em UTF-8 o primeiro vem depois.
+static int compare_keys_utf16(const JsonNode *a, const JsonNode *b) {
+    size_t n = a->key_len < b->key_len ? a->key_len : b->key_len;
+    size_t i = 0;
+    while (i < n && a->key[i] == b->key[i]) i++;
+    if (i == n) return (a->key_len > b->key_len) - (a->key_len < b->key_len);
+
+    while (i > 0 && ((unsigned char)a->key[i] & 0xC0) == 0x80) i--;
+    unsigned char ca = (unsigned char)a->key[i];
+    unsigned char cb = (unsigned char)b->key[i];
+    if (ca >= 0xF0 && cb >= 0xEE && cb < 0xF0) return -1;
+    if (cb >= 0xF0 && ca >= 0xEE && ca < 0xF0) return 1;
+    return compare_keys(a, b);
+}
+
+typedef int (*KeyCompare)(const JsonNode *a, const JsonNode *b);
+
+// Merge sort estavel: chaves repetidas ficam na ordem do documento
+static void merge_sort(JsonNode *items, JsonNode *tmp, size_t count, KeyCompare compare) {
+    if (count < 2) return;
+    if (count <= 8) {
+        for (size_t i = 1; i < count; i++) {
+            JsonNode x = items[i];
+            size_t j = i;
+            while (j > 0 && compare(&items[j - 1], &x) > 0) {
+                items[j] = items[j - 1];
+                j--;
+            }
+            items[j] = x;
+        }
+        return;
+    }
+
+    size_t half = count / 2;
+    merge_sort(items, tmp, half, compare);
+    merge_sort(items + half, tmp, count - half, compare);
+    if (compare(&items[half - 1], &items[half]) <= 0) return;
+
+    size_t i = 0, j = half, k = 0;
+    while (i < half && j < count) {
+        tmp[k++] = compare(&items[j], &items[i]) < 0 ? items[j++] : items[i++];
+    }
+    while (i < half) tmp[k++] = items[i++];
+    while (j < count) tmp[k++] = items[j++];
+    memcpy(items, tmp, count * sizeof(JsonNode));
+}
+
+static int sort_node(JsonDom *dom, JsonNode *node, int flags) {
+    if (node->type != JSON_ARRAY && node->type != JSON_OBJECT) return 0;
+
+    JsonNode *children = node->as.children;
+    for (uint32_t i = 0; i < node->len; i++) {
+        if (sort_node(dom, &children[i], flags) != 0) return -1;
+    }
+    if (node->type != JSON_OBJECT || node->len < 2) return 0;
+
+    if (node->len > dom->scratch_cap) {
+        JsonNode *scratch = realloc(dom->scratch, node->len * sizeof(JsonNode));
+        if (!scratch) return -1;
+        dom->scratch = scratch;
+        dom->scratch_cap = node->len;
+        dom->frame_allocs++;
+    }
+    merge_sort(children, dom->scratch, node->len,
+               (flags & JSON_SORT_UTF16) ? compare_keys_utf16 : compare_keys);
+
+    if (flags & JSON_SORT_DEDUPE) {
+        // Vale a ultima ocorrencia, como no JSON.parse
+        uint32_t out = 0;
+        for (uint32_t i = 0; i < node->len; i++) {
+            if (i + 1 < node->len && compare_keys(&children[i], &children[i + 1]) == 0) continue;
+            children[out++] = children[i];
+        }
+        node->len = out;
+    }
+    return 0;
+}
+
+int json_dom_sort_keys(JsonDom *dom, int flags) {
+    if (!dom->has_root) return 0;
+    if (sort_node(dom, &dom->root, flags) != 0) {
+        dom->error = "out of memory";
+        return -1;
+    }
+    return 0;
+}
+
+const JsonNode* json_dom_root(const JsonDom *dom) {
+    return dom->has_root ? &dom->root : NULL;
+}
+
+const char* json_dom_error(const JsonDom *dom, size_t *offset) {
+    if (offset) *offset = dom->parser.offset;
+    return dom->error;
+}
+
+void json_dom_usage(const JsonDom *dom, JsonDomUsage *usage) {
+    usage->nodes = dom->nodes;
+    usage->arena_bytes = dom->arena.total;
+    usage->allocs = dom->arena.blocks + dom->frame_allocs;
+}
+
+void json_dom_free(JsonDom *dom) {
+    if (!dom) return;
+    free(dom->scratch);
+    for (int i = 0; i <= JSON_PARSER_MAX_DEPTH; i++) {
+        free(dom->frames[i].items);
+    }
+    json_parser_free(&dom->parser);
+    arena_free(&dom->arena);
+    free(dom);
+}
@@ -0,0 +1,92 @@
+#ifndef JSON_DOM_H
+#define JSON_DOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "json_parser.h"
+
+// Arvore de um documento JSON montada a partir do parser incremental.
+// Todos os nos e textos ficam em uma arena. Cada no guarda um hash da
+// subarvore (estilo Merkle): subarvores iguais tem o mesmo hash, e objetos
+// com as mesmas chaves em outra ordem tambem.
+
+typedef enum {
+    JSON_NULL,
+    JSON_FALSE,
+    JSON_TRUE,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+typedef struct JsonNode JsonNode;
+struct JsonNode {
+    uint64_t hash;
+    union {
+        const char *text;       // string (decodificada) ou numero como no documento
+        JsonNode *children;     // itens do array ou campos do objeto
+    } as;
+    const char *key;            // nome do campo quando o pai e um objeto
+    unsigned key_len : 24;
+    unsigned type : 8;
+    uint32_t len;               // bytes do texto ou quantidade de filhos
+};
+
+#define JSON_DOM_MAX_KEY ((1u << 24) - 1)
+
+// Tabela de chaves compartilhada entre documentos: a mesma chave vira
+// o mesmo ponteiro, o que economiza memoria em arrays de objetos
+typedef struct JsonKeyTable JsonKeyTable;
+
+JsonKeyTable* json_key_table_new(void);
+void json_key_table_free(JsonKeyTable *t);
+
+typedef struct JsonDom JsonDom;
+
+// keys pode ser NULL (sem compartilhamento entre documentos)
+JsonDom* json_dom_new(JsonKeyTable *keys);
+
+// Alimenta o parser; retorna 0, ou -1 em erro (ver json_dom_error)
+int json_dom_feed(JsonDom *dom, const char *data, size_t len);
+
+// Fim do documento; retorna 0 ou -1
+int json_dom_finish(JsonDom *dom);
+
+// Sem hash das subarvores (so para imprimir, nao para o --diff)
+#define JSON_DOM_NO_HASH 1
+
+// Monta a arvore de um documento inteiro ja em memoria, sem passar pelo
+// parser incremental. Numeros e strings sem escapes apontam para data (sem
+// '\0' no fim), que precisa viver tanto quanto o dom; so strings com escapes
+// sao decodificadas na arena. Nao se mistura com json_dom_feed. Retorna 0 ou -1.
+int json_dom_parse(JsonDom *dom, const char *data, size_t len, int flags);
+
+// Ordena as chaves de todos os objetos (estavel), pelos bytes UTF-8 ou, com
+// JSON_SORT_UTF16, pelas unidades UTF-16 como na RFC 8785. Com
+// JSON_SORT_DEDUPE, de chaves repetidas fica so a ultima. Retorna 0 ou -1.
+#define JSON_SORT_DEDUPE    1
+#define JSON_SORT_UTF16     2
+int json_dom_sort_keys(JsonDom *dom, int flags);
+
+typedef struct {
+    size_t nodes;
+    size_t arena_bytes;     // reservados em blocos
+    size_t allocs;          // malloc/realloc: blocos da arena e vetores de montagem
+} JsonDomUsage;
+
+void json_dom_usage(const JsonDom *dom, JsonDomUsage *usage);
+
+// Raiz do documento (varios valores no nivel externo viram um array)
+const JsonNode* json_dom_root(const JsonDom *dom);
+
+// Mensagem e posicao do erro, ou NULL
+const char* json_dom_error(const JsonDom *dom, size_t *offset);
+
+void json_dom_free(JsonDom *dom);
+
+// Hash de bytes usado nos nos (FNV-1a com finalizador splitmix64)
+uint64_t json_hash_bytes(uint64_t seed, const char *s, size_t n);
+
+#endif // JSON_DOM_H
@@ -0,0 +1,361 @@
+#include "json_parser.h"
+#include "utf8.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Estados do parser
+enum {
+    P_VALUE,            // espera um valor
+    P_VALUE_OR_END,     // logo apos '[': valor ou ']'
+    P_KEY_OR_END,       // logo apos '{': chave ou '}'
+    P_KEY,              // apos ',' dentro de objeto
+    P_COLON,
+    P_AFTER_VALUE,      // espera ',', fechamento ou outro valor no topo
+    P_STRING,
+    P_ESCAPE,
+    P_UNICODE,
+    P_NUMBER,
+    P_LITERAL
+};
+
+void json_parser_init(JsonParser *p, JsonEventCallback callback, void *ctx, size_t max_token) {
+    memset(p, 0, sizeof(*p));
+    p->callback = callback;
+    p->ctx = ctx;
+    p->max_token = max_token;
+    p->state = P_VALUE;
+}
+
+void json_parser_free(JsonParser *p) {
+    free(p->token);
+    p->token = NULL;
+    p->token_cap = 0;
+}
+
+static int is_ws(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static void token_append(JsonParser *p, const char *s, size_t n) {
+    p->value_len += n;
+
+    if (p->max_token && p->token_len + n > p->max_token) {
+        n = p->token_len < p->max_token ? p->max_token - p->token_len : 0;
+        p->truncated = 1;
+    }
+    if (n == 0) return;
+
+    if (p->token_len + n + 1 > p->token_cap) {
+        size_t cap = p->token_cap ? p->token_cap : 256;
+        while (cap < p->token_len + n + 1) cap *= 2;
+        char *ptr = realloc(p->token, cap);
+        if (!ptr) {
+            p->error = "out of memory";
+            return;
+        }
+        p->token = ptr;
+        p->token_cap = cap;
+    }
+
+    memcpy(p->token + p->token_len, s, n);
+    p->token_len += n;
+    p->token[p->token_len] = '\0';
+}
+
+static void token_reset(JsonParser *p) {
+    p->token_len = 0;
+    p->value_len = 0;
+    p->truncated = 0;
+    if (p->token) p->token[0] = '\0';
+}
+
+static void token_append_utf8(JsonParser *p, unsigned cp) {
+    char buf[4];
+    token_append(p, buf, utf8_encode(cp, buf));
+}
+
+static void emit(JsonParser *p, JsonEvent event, const char *text, size_t len) {
+    if (p->callback && p->callback(p->ctx, event, text, len) != 0) {
+        p->stopped = 1;
+    }
+}
+
+// Estado depois de um valor completo
+static void value_done(JsonParser *p) {
+    p->state = P_AFTER_VALUE;
+}
+
+static void begin_value(JsonParser *p, char c) {
+    switch (c) {
+        case '{':
+        case '[':
+            if (p->depth >= JSON_PARSER_MAX_DEPTH) {
+                p->error = "nesting too deep";
+                return;
+            }
+            p->stack[p->depth++] = c;
+            emit(p, c == '{' ? JSON_EVENT_OBJECT_START : JSON_EVENT_ARRAY_START, NULL, 0);
+            p->state = c == '{' ? P_KEY_OR_END : P_VALUE_OR_END;
+            break;
+
+        case '"':
+            token_reset(p);
+            p->is_key = 0;
+            p->state = P_STRING;
+            break;
+
+        case 't':
+        case 'f':
+        case 'n':
+            p->literal = c == 't' ? "true" : c == 'f' ? "false" : "null";
+            p->literal_pos = 1;
+            p->state = P_LITERAL;
+            break;
+
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                token_reset(p);
+                token_append(p, &c, 1);
+                p->state = P_NUMBER;
+            } else {
+                p->error = "unexpected character";
+            }
+            break;
+    }
+}
+
+static void end_container(JsonParser *p, char c) {
+    char open = c == '}' ? '{' : '[';
+
+    if (p->depth == 0 || p->stack[p->depth - 1] != open) {
+        p->error = "mismatched bracket";
+        return;
+    }
+
+    p->depth--;
+    emit(p, c == '}' ? JSON_EVENT_OBJECT_END : JSON_EVENT_ARRAY_END, NULL, 0);
+    value_done(p);
+}
+
+static void string_done(JsonParser *p) {
+    if (p->high_surrogate) {
+        // Surrogate alto sem par
+        token_append_utf8(p, 0xFFFD);
+        p->high_surrogate = 0;
+    }
+
+    if (p->is_key) {
+        emit(p, JSON_EVENT_KEY, p->token ? p->token : "", p->token_len);
+        p->state = P_COLON;
+    } else {
+        emit(p, JSON_EVENT_STRING, p->token ? p->token : "", p->token_len);
+        value_done(p);
+    }
+}
+
+static void unicode_done(JsonParser *p) {
+    unsigned cp = p->codepoint;
+
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        if (p->high_surrogate) token_append_utf8(p, 0xFFFD);
+        p->high_surrogate = cp;
+        return;
+    }
+
+    if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        if (p->high_surrogate) {
+            cp = 0x10000 + ((p->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+            p->high_surrogate = 0;
+        } else {
+            cp = 0xFFFD;
+        }
+    } else if (p->high_surrogate) {
+        token_append_utf8(p, 0xFFFD);
+        p->high_surrogate = 0;
+    }
+
+    token_append_utf8(p, cp);
+}
+
+static void escape_char(JsonParser *p, char c) {
+    char out;
+
+    if (c == 'u') {
+        p->codepoint = 0;
+        p->hex_digits = 0;
+        p->state = P_UNICODE;
+        return;
+    }
+
+    if (p->high_surrogate) {
+        token_append_utf8(p, 0xFFFD);
+        p->high_surrogate = 0;
+    }
+
+    switch (c) {
+        case 'n': out = '\n'; break;
+        case 't': out = '\t'; break;
+        case 'r': out = '\r'; break;
+        case 'b': out = '\b'; break;
+        case 'f': out = '\f'; break;
+        case '"':
+        case '\\':
+        case '/':
+            out = c;
+            break;
+        default:
+            p->error = "invalid escape";
+            return;
+    }
+
+    token_append(p, &out, 1);
+    p->state = P_STRING;
+}
+
+static void step(JsonParser *p, char c) {
+    switch (p->state) {
+        case P_VALUE:
+            if (!is_ws(c)) begin_value(p, c);
+            break;
+
+        case P_VALUE_OR_END:
+            if (is_ws(c)) break;
+            if (c == ']') end_container(p, c);
+            else begin_value(p, c);
+            break;
+
+        case P_KEY_OR_END:
+        case P_KEY:
+            if (is_ws(c)) break;
+            if (c == '}' && p->state == P_KEY_OR_END) {
+                end_container(p, c);
+            } else if (c == '"') {
+                token_reset(p);
+                p->is_key = 1;
+                p->state = P_STRING;
+            } else {
+                p->error = "expected object key";
+            }
+            break;
+
+        case P_COLON:
+            if (is_ws(c)) break;
+            if (c == ':') p->state = P_VALUE;
+            else p->error = "expected ':'";
+            break;
+
+        case P_AFTER_VALUE:
+            if (is_ws(c)) break;
+            if (p->depth == 0) {
+                // Outro valor no nivel mais externo (NDJSON)
+                begin_value(p, c);
+            } else if (c == ',') {
+                p->state = p->stack[p->depth - 1] == '{' ? P_KEY : P_VALUE;
+            } else if (c == '}' || c == ']') {
+                end_container(p, c);
+            } else {
+                p->error = "expected ',' or closing bracket";
+            }
+            break;
+
+        case P_STRING:
+            if (c == '"') {
+                string_done(p);
+            } else if (c == '\\') {
+                p->state = P_ESCAPE;
+            } else {
+                if (p->high_surrogate) {
+                    token_append_utf8(p, 0xFFFD);
+                    p->high_surrogate = 0;
+                }
+                token_append(p, &c, 1);
+            }
+            break;
+
+        case P_ESCAPE:
+            escape_char(p, c);
+            break;
+
+        case P_UNICODE: {
+            int v = utf8_hex_digit(c);
+            if (v < 0) {
+                p->error = "invalid \\u escape";
+                break;
+            }
+            p->codepoint = (p->codepoint << 4) | (unsigned)v;
+            if (++p->hex_digits == 4) {
+                unicode_done(p);
+                p->state = P_STRING;
+            }
+            break;
+        }
+
+        case P_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                token_append(p, &c, 1);
+                break;
+            }
+            emit(p, JSON_EVENT_NUMBER, p->token, p->token_len);
+            value_done(p);
+            if (!p->stopped) step(p, c);
+            break;
+
+        case P_LITERAL:
+            if (c != p->literal[p->literal_pos]) {
+                p->error = "invalid literal";
+                break;
+            }
+            if (p->literal[++p->literal_pos] == '\0') {
+                JsonEvent ev = p->literal[0] == 't' ? JSON_EVENT_TRUE :
+                               p->literal[0] == 'f' ? JSON_EVENT_FALSE : JSON_EVENT_NULL;
+                emit(p, ev, p->literal, p->literal_pos);
+                value_done(p);
+            }
+            break;
+    }
+}
+
+int json_parser_feed(JsonParser *p, const char *data, size_t len) {
+    const char *s = data;
+    const char *end = data + len;
+
+    while (s < end && !p->error && !p->stopped) {
+        if (p->state == P_STRING && !p->high_surrogate) {
+            // Trechos comuns de string e numero sao copiados de uma vez
+            const char *run = s;
+            while (s < end && *s != '"' && *s != '\\') s++;
+            token_append(p, run, s - run);
+            p->offset += s - run;
+            if (s == end) break;
+        } else if (p->state == P_NUMBER) {
+            const char *run = s;
+            while (s < end && ((*s >= '0' && *s <= '9') || *s == '.' || *s == 'e' || *s == 'E' ||
+                               *s == '+' || *s == '-')) s++;
+            token_append(p, run, s - run);
+            p->offset += s - run;
+            if (s == end) break;
+        }
+        step(p, *s++);
+        p->offset++;
+    }
+
+    if (p->error) return -1;
+    return p->stopped ? 1 : 0;
+}
+
+int json_parser_finish(JsonParser *p) {
+    if (p->error) return -1;
+    if (p->stopped) return 1;
+
+    if (p->state == P_NUMBER) {
+        emit(p, JSON_EVENT_NUMBER, p->token, p->token_len);
+        value_done(p);
+    }
+
+    if (p->depth > 0 || (p->state != P_AFTER_VALUE && p->state != P_VALUE)) {
+        p->error = "unexpected end of document";
+        return -1;
+    }
+
+    return p->stopped ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#ifndef JSON_PARSER_H
+#define JSON_PARSER_H
+
+#include <stddef.h>
+
+// Parser JSON incremental (estilo SAX): recebe o body em blocos de qualquer
+// tamanho e gera um evento por token, sem montar a arvore em memoria.
+// Aceita varios valores no nivel mais externo (NDJSON).
+
+#define JSON_PARSER_MAX_DEPTH 1024
+
+typedef enum {
+    JSON_EVENT_OBJECT_START,
+    JSON_EVENT_OBJECT_END,
+    JSON_EVENT_ARRAY_START,
+    JSON_EVENT_ARRAY_END,
+    JSON_EVENT_KEY,         // text = nome do campo (escapes decodificados)
+    JSON_EVENT_STRING,      // text = valor (escapes decodificados)
+    JSON_EVENT_NUMBER,      // text = numero como aparece no documento
+    JSON_EVENT_TRUE,
+    JSON_EVENT_FALSE,
+    JSON_EVENT_NULL
+} JsonEvent;
+
+// Retorna 0 para continuar ou != 0 para parar o parse
+typedef int (*JsonEventCallback)(void *ctx, JsonEvent event, const char *text, size_t len);
+
+typedef struct {
+    JsonEventCallback callback;
+    void *ctx;
+    int state;
+    int resume;                 // estado depois do token atual
+    int is_key;
+    char stack[JSON_PARSER_MAX_DEPTH];
+    int depth;                  // profundidade atual (0 = fora de tudo)
+    char *token;                // string/numero sendo acumulado
+    size_t token_len;
+    size_t token_cap;
+    size_t max_token;           // 0 = sem limite; acima disso o texto e cortado
+    size_t value_len;           // tamanho real do ultimo token (mesmo se cortado)
+    int truncated;              // o ultimo token foi cortado em max_token
+    unsigned codepoint;         // \uXXXX em andamento
+    unsigned high_surrogate;
+    int hex_digits;
+    const char *literal;        // true/false/null em andamento
+    int literal_pos;
+    size_t offset;              // bytes consumidos
+    const char *error;          // mensagem de erro (NULL se ok)
+    int stopped;                // o callback pediu para parar
+} JsonParser;
+
+// Inicializa o parser; max_token limita a memoria por token (0 = sem limite)
+void json_parser_init(JsonParser *p, JsonEventCallback callback, void *ctx, size_t max_token);
+
+// Processa um bloco. Retorna 0 (ok), 1 (parado pelo callback) ou -1 (erro).
+int json_parser_feed(JsonParser *p, const char *data, size_t len);
+
+// Fim do documento: emite o numero pendente e valida que tudo foi fechado
+int json_parser_finish(JsonParser *p);
+
+void json_parser_free(JsonParser *p);
+
+#endif // JSON_PARSER_H
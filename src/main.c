@@ -1,17 +1,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <ctype.h>
 #include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 #include "http.h"
 #include "colors.h"
+#include "output.h"
+#include "pipeline.h"
+#include "diff.h"
+#include "watch.h"
+#include "monitor.h"
+#include "workers.h"
+#include "filewriter.h"
+#include "stats.h"
 #include "formatters/formatters.h"
 
 #define VERSION "1.0.0"
 #define MAX_HEADERS 64
 
 static void print_usage(const char *prog) {
-    printf("Usage: %s [options] <URL>\n", prog);
+    printf("Usage: %s [options] <URL>...\n", prog);
+    printf("       %s --diff [options] <OLD> <NEW>\n", prog);
     printf("\n");
     printf("Options:\n");
     printf("  -X, --request <METHOD>  HTTP method (GET, POST, PUT, DELETE, etc)\n");
@@ -20,6 +39,40 @@ static void print_usage(const char *prog) {
     printf("  -i, --include           Include response headers in output\n");
     printf("  -r, --raw               Raw output, no formatting\n");
     printf("  -v, --verbose           Verbose mode\n");
+    printf("      --compressed        Request a compressed response and decompress it\n");
+    printf("      --urls <FILE>       Read URLs from FILE, one per line (- for stdin)\n");
+    printf("      --prewarm[=N]       Open N connections per host (default 1) before the first request\n");
+    printf("      --workers[=N]       Fetch and format a URL list in N processes (default: CPU count)\n");
+    printf("      --order <ORDER>     Output order with --workers: submission (default) or completion\n");
+    printf("      --output-dir <DIR>  Save each response body, unformatted, to its own file in DIR\n");
+    printf("      --output-template <T>  File name template (default {index}-{name}.{ext}; also {host}, {path})\n");
+    printf("      --file <PATH>       Format a local file (- for stdin) instead of an HTTP response\n");
+    printf("      --type <TYPE>       Format the body as json, xml, html, text, msgpack, cbor or sse\n");
+    printf("      --max-lines <N>     Stop after N lines of body output\n");
+    printf("      --max-bytes <N>     Stop after N bytes of body output\n");
+    printf("      --max-items <N>     Stop after N top-level JSON items or XML root children\n");
+    printf("      --buffer            Download the whole body before formatting it\n");
+    printf("      --pipeline          Format in a separate thread, overlapping download and output\n");
+    printf("      --schema[=json]     Infer the schema of a JSON body instead of printing it\n");
+    printf("      --table             Print a JSON array of objects as aligned columns\n");
+    printf("      --csv               Print a JSON array of objects as CSV\n");
+    printf("      --sort-keys         Print JSON objects with their keys in sorted order\n");
+    printf("      --compact           Print JSON on a single line, without spaces\n");
+    printf("      --canonical         Print canonical JSON (RFC 8785): sorted unique keys, no colors\n");
+    printf("      --select <CSS>      Print only the HTML elements matching CSS (::text, ::attr(NAME))\n");
+    printf("      --unicode           Show \\uXXXX escapes as UTF-8 and highlight invalid UTF-8 in JSON strings\n");
+    printf("      --diff              Compare two JSON documents (URLs, files or - for stdin)\n");
+    printf("      --watch <SECONDS>   Repeat the request every SECONDS, redrawing only what changed\n");
+    printf("      --reconnect[=N]     Reopen an event stream when it ends, with Last-Event-ID (N times)\n");
+    printf("      --record <FILE>     Append every request and its response to the fixture FILE\n");
+    printf("      --replay <FILE>     Answer requests from the fixture FILE, without the network\n");
+    printf("      --replay-latency[=S]  Replay the recorded timings, scaled by S (default 1)\n");
+    printf("      --match-header <NAME>  Request header that is part of the fixture key (repeatable)\n");
+    printf("      --serve <PORT>      With --replay, serve the fixtures over HTTP on 127.0.0.1:PORT\n");
+    printf("      --monitor <FILE>    Probe the targets in FILE on their schedules and check their assertions\n");
+    printf("      --metrics <PORT>    With --monitor, serve Prometheus metrics on 127.0.0.1:PORT/metrics\n");
+    printf("      --max-memory <MB>   Body kept in memory before spilling to a temp file (default 16)\n");
+    printf("      --stats[=json]      Print allocation, copy and timing counters to stderr\n");
     printf("  -h, --help              Show this help\n");
     printf("  -V, --version           Show version\n");
     printf("\n");
@@ -27,6 +80,17 @@ static void print_usage(const char *prog) {
     printf("  %s https://api.example.com/data\n", prog);
     printf("  %s -X POST -H \"Content-Type: application/json\" -d '{\"key\":\"value\"}' https://api.example.com/create\n", prog);
     printf("  %s -i https://api.example.com/data\n", prog);
+    printf("  %s --diff https://prod.example.com/data https://canary.example.com/data\n", prog);
+    printf("  %s --watch 2 https://api.example.com/status\n", prog);
+    printf("  %s --prewarm --urls urls.txt\n", prog);
+    printf("  %s --workers --order completion --urls urls.txt\n", prog);
+    printf("  %s --output-dir pages --urls urls.txt\n", prog);
+    printf("  %s --reconnect https://api.example.com/events\n", prog);
+    printf("  %s --file dump.json --max-items 10\n", prog);
+    printf("  %s --select 'a[href]::attr(href)' https://example.com/\n", prog);
+    printf("  %s --record api.fix --urls urls.txt\n", prog);
+    printf("  %s --replay api.fix --serve 8080\n", prog);
+    printf("  %s --monitor targets.txt --metrics 9100\n", prog);
 }
 
 static void print_version(void) {
@@ -34,73 +98,1104 @@ static void print_version(void) {
     printf("A CLI tool for HTTP requests with automatic formatting\n");
 }
 
-static void print_status(long status_code) {
-    const char *status_color;
+// Limites de saida do body (0 = sem limite)
+typedef struct {
+    long max_lines;
+    long long max_bytes;
+    long max_items;
+} OutputLimits;
 
-    if (status_code >= 200 && status_code < 300) {
-        status_color = GREEN;
-    } else if (status_code >= 300 && status_code < 400) {
-        status_color = YELLOW;
-    } else if (status_code >= 400 && status_code < 500) {
-        status_color = RED;
-    } else if (status_code >= 500) {
-        status_color = BOLD_RED;
-    } else {
-        status_color = WHITE;
+// Como o body e apresentado
+typedef enum {
+    BODY_FORMAT,        // formatador do Content-Type (padrao)
+    BODY_RAW,           // -r
+    BODY_SCHEMA,        // --schema
+    BODY_SCHEMA_JSON,   // --schema=json
+    BODY_TABLE,         // --table
+    BODY_CSV            // --csv
+} BodyMode;
+
+// Estado da impressao do body em streaming
+typedef struct {
+    int show_headers;
+    BodyMode mode;
+    int type_given;                 // --type: ignora o Content-Type
+    ContentType type;
+    int json_tree;                  // JSON_TREE_*: --sort-keys, --compact, --canonical
+    const HtmlSelector *select;     // --select
+    OutputLimits limits;
+    int pipelined;
+    int started;
+    Formatter *formatter;
+    const char *formatter_name;     // para o --stats
+    SseState *sse;                  // estado do stream de eventos (--reconnect)
+    CsvColumns *csv_columns;        // colunas comuns a uma lista de URLs (--csv)
+    long long output_start;         // bytes de saida antes do body
+    Pipeline *pipeline;
+} BodyPrinter;
+
+// Status e headers so sao impressos quando a resposta final chega; o CSV
+// sai sem eles para que stdout seja um arquivo CSV valido
+static void body_printer_start(BodyPrinter *bp, HttpResponse *resp) {
+    bp->started = 1;
+
+    if (bp->mode != BODY_CSV) {
+        print_status(resp->status_code);
+        if (bp->show_headers) {
+            print_headers(resp->headers);
+        }
     }
 
-    printf("%sHTTP Status: %ld%s\n\n", color(status_color), status_code, color(RESET));
+    out_set_limits(bp->limits.max_lines, bp->limits.max_bytes, bp->limits.max_items);
+}
+
+static const char* content_type_name(ContentType type) {
+    switch (type) {
+        case CONTENT_JSON:    return "json";
+        case CONTENT_XML:     return "xml";
+        case CONTENT_HTML:    return "html";
+        case CONTENT_MSGPACK: return "msgpack";
+        case CONTENT_CBOR:    return "cbor";
+        case CONTENT_SSE:     return "sse";
+        default:              return "text";
+    }
 }
 
-static void print_headers(const char *headers) {
-    if (!headers) return;
+static Formatter* body_formatter_new(BodyPrinter *bp, ContentType type) {
+    bp->output_start = out_bytes();
 
-    const char *p = headers;
-    while (*p) {
-        // Linha de status HTTP
-        if (strncmp(p, "HTTP/", 5) == 0) {
-            printf("%s", color(BOLD_CYAN));
-            while (*p && *p != '\r' && *p != '\n') {
-                putchar(*p);
-                p++;
+    switch (bp->mode) {
+        case BODY_RAW:
+            bp->formatter_name = "raw";
+            return raw_formatter_new();
+        case BODY_SCHEMA:
+        case BODY_SCHEMA_JSON:
+            bp->formatter_name = "schema";
+            return schema_formatter_new(bp->mode == BODY_SCHEMA_JSON);
+        case BODY_TABLE:
+        case BODY_CSV:
+            bp->formatter_name = bp->mode == BODY_CSV ? "csv" : "table";
+            return table_formatter_new(bp->mode == BODY_CSV, bp->csv_columns);
+        default:
+            if (type == CONTENT_JSON && bp->json_tree) {
+                bp->formatter_name = "json-tree";
+                return json_tree_formatter_new(bp->json_tree);
             }
-            printf("%s", color(RESET));
-        }
-        // Nome do header
-        else if (isalpha(*p) || *p == '-') {
-            printf("%s", color(CYAN));
-            while (*p && *p != ':') {
-                putchar(*p);
-                p++;
+            if (type == CONTENT_HTML && bp->select) {
+                bp->formatter_name = "html-select";
+                return html_select_formatter_new(bp->select);
             }
-            printf("%s", color(RESET));
+            bp->formatter_name = content_type_name(type);
+            if (type == CONTENT_SSE) return sse_formatter_new(bp->sse);
+            return formatter_new(type);
+    }
+}
+
+// Cria o formatador do body; retorna -1 sem memoria
+static int body_printer_open(BodyPrinter *bp, ContentType type) {
+    bp->formatter = body_formatter_new(bp, bp->type_given ? bp->type : type);
+    if (!bp->formatter) {
+        fprintf(stderr, "Error: out of memory\n");
+        return -1;
+    }
+
+    if (bp->pipelined) {
+        // Status e headers ja estao no buffer de saida; daqui em diante
+        // so a thread de formatacao escreve em stdout
+        bp->pipeline = pipeline_start(bp->formatter, PIPELINE_RING_SIZE);
+    }
+    return 0;
+}
+
+// Passa um bloco ao formatador; retorna != 0 quando o resto nao e necessario
+static int body_printer_feed(BodyPrinter *bp, const char *data, size_t len) {
+    if (bp->pipeline) {
+        return pipeline_push(bp->pipeline, data, len);
+    }
+
+    int stop = formatter_feed(bp->formatter, data, len);
+    out_flush();
+
+    return stop || out_check_closed();
+}
+
+// Formata cada bloco assim que chega; retornar != 0 aborta a transferencia
+static int on_body(HttpResponse *resp, const char *data, size_t len, void *userdata) {
+    BodyPrinter *bp = (BodyPrinter *)userdata;
+
+    if (!bp->started) {
+        body_printer_start(bp, resp);
+        if (body_printer_open(bp, detect_content_type(resp->content_type)) != 0) return 1;
+    }
+
+    return body_printer_feed(bp, data, len);
+}
+
+// Espera a thread de formatacao e fecha a saida do body
+static void body_printer_finish(BodyPrinter *bp) {
+    if (bp->pipeline) {
+        pipeline_finish(bp->pipeline);
+        bp->pipeline = NULL;
+    }
+    if (bp->formatter) {
+        formatter_finish(bp->formatter);
+        bp->formatter = NULL;
+        stats_formatter_bytes(bp->formatter_name, (unsigned long long)(out_bytes() - bp->output_start));
+    }
+    out_flush();
+}
+
+// Formata um body ja baixado, em blocos, direto da memoria ou do mmap
+static void print_buffered_body(BodyPrinter *bp, HttpResponse *resp) {
+    const char *view = body_store_view(&resp->body);
+    size_t size = resp->body.size;
+
+    if (!view) return;
+
+    for (size_t off = 0; off < size; off += BODY_WINDOW) {
+        size_t n = size - off < BODY_WINDOW ? size - off : BODY_WINDOW;
+        int stop = on_body(resp, view + off, n, bp);
+        body_store_consumed(&resp->body, off + n);
+        if (stop) break;
+    }
+}
+
+// --diff ------------------------------------------------------------------
+
+static int diff_on_body(HttpResponse *resp, const char *data, size_t len, void *userdata) {
+    (void)resp;
+    return json_dom_feed((JsonDom *)userdata, data, len) != 0;
+}
+
+// Monta a arvore de um documento vindo de uma URL, de um arquivo ou de stdin ("-")
+static JsonDom* load_document(const char *source, const HttpRequest *base, JsonKeyTable *keys, long *status) {
+    JsonDom *dom = json_dom_new(keys);
+    *status = 0;
+
+    if (!dom) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        return NULL;
+    }
+
+    if (strstr(source, "://")) {
+        HttpRequest req = *base;
+        req.url = source;
+        req.on_body = diff_on_body;
+        req.userdata = dom;
+
+        HttpResponse *resp = http_request(&req);
+        if (!resp) {
+            json_dom_free(dom);
+            return NULL;
+        }
+        *status = resp->status_code;
+        http_response_free(resp);
+    } else {
+        FILE *fp = strcmp(source, "-") == 0 ? stdin : fopen(source, "rb");
+        if (!fp) {
+            fprintf(stderr, "%sError: cannot open %s: %s%s\n", color(RED), source, strerror(errno), color(RESET));
+            json_dom_free(dom);
+            return NULL;
+        }
+
+        static char buf[BODY_WINDOW];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+            if (json_dom_feed(dom, buf, n) != 0) break;
+        }
+        if (fp != stdin) fclose(fp);
+    }
+
+    if (json_dom_finish(dom) != 0 || !json_dom_root(dom)) {
+        size_t offset;
+        const char *error = json_dom_error(dom, &offset);
+        if (error) {
+            fprintf(stderr, "%sError: %s: invalid JSON at byte %zu: %s%s\n",
+                    color(RED), source, offset, error, color(RESET));
+        } else {
+            fprintf(stderr, "%sError: %s: empty document%s\n", color(RED), source, color(RESET));
+        }
+        json_dom_free(dom);
+        return NULL;
+    }
+
+    return dom;
+}
+
+static void print_diff_source(const char *marker, const char *marker_color, const char *source, long status) {
+    out_color(marker_color);
+    out_printf("%s %s", marker, source);
+    if (status) out_printf(" (HTTP %ld)", status);
+    out_color(RESET);
+    out_putc('\n');
+}
+
+// Retorna 0 sem diferencas, 1 com diferencas e 2 em erro (como o diff)
+static int run_diff(const char *old_source, const char *new_source, const HttpRequest *base, OutputLimits limits) {
+    JsonKeyTable *keys = json_key_table_new();
+    long old_status = 0, new_status = 0;
+    int result = 2;
+
+    JsonDom *a = load_document(old_source, base, keys, &old_status);
+    JsonDom *b = a ? load_document(new_source, base, keys, &new_status) : NULL;
+
+    if (a && b) {
+        JsonDiffStats stats;
+
+        print_diff_source("---", RED, old_source, old_status);
+        print_diff_source("+++", GREEN, new_source, new_status);
+        out_putc('\n');
+
+        out_set_limits(limits.max_lines, limits.max_bytes, limits.max_items);
+        json_diff(json_dom_root(a), json_dom_root(b), &stats);
+
+        unsigned long long total = stats.changed + stats.added + stats.removed;
+        if (total == 0) {
+            out_color(GREEN);
+            out_puts("No differences\n");
+            out_color(RESET);
+        } else if (!stats.truncated) {
+            out_color(DIM);
+            out_printf("\n%llu changed, %llu added, %llu removed\n", stats.changed, stats.added, stats.removed);
+            out_color(RESET);
+        }
+        out_flush();
+        result = total > 0;
+    }
+
+    json_dom_free(a);
+    json_dom_free(b);
+    json_key_table_free(keys);
+    return result;
+}
+
+// --watch -----------------------------------------------------------------
+
+static volatile sig_atomic_t watch_interrupted = 0;
+
+static void on_watch_signal(int sig) {
+    (void)sig;
+    watch_interrupted = 1;
+}
+
+// Dorme ate o proximo ciclo; Ctrl+C interrompe a espera
+static void watch_sleep(double seconds) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+    while (!watch_interrupted && nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+// Guarda o valor de um header de validacao da resposta, se houver
+static void remember_validator(char **slot, const HttpResponse *resp, const char *name) {
+    char *value = http_response_header(resp, name);
+    if (value) {
+        free(*slot);
+        *slot = value;
+    }
+}
+
+// Formata a resposta num buffer em vez de stdout
+static void capture_body(BodyPrinter *bp, HttpResponse *resp, StrBuf *body) {
+    body->len = 0;
+    out_capture(body);
+
+    bp->started = 0;
+    print_buffered_body(bp, resp);
+    if (!bp->started) {
+        body_printer_start(bp, resp);
+    }
+    body_printer_finish(bp);
+
+    out_capture(NULL);
+    out_set_limits(0, 0, 0);
+}
+
+// Repete a requisicao na mesma conexao. Usa ETag/Last-Modified para pedir
+// so o que mudou; em 304 ou body com o mesmo hash nada e reformatado.
+static int run_watch(const HttpRequest *base, BodyPrinter *bp, double interval) {
+    HttpSession *session = http_session_new();
+    if (!session) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_watch_signal;     // sem SA_RESTART: o sleep e interrompido
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    WatchScreen screen;
+    watch_screen_init(&screen);
+
+    // O quadro nunca passa da altura do terminal: nao formata o que nao cabe
+    if (screen.tty && bp->limits.max_lines == 0) {
+        bp->limits.max_lines = watch_screen_rows(&screen);
+    }
+    bp->pipelined = 0;
+
+    const char *headers[MAX_HEADERS + 2];
+    StrBuf if_none_match = {0}, if_modified_since = {0};
+    StrBuf body = {0}, frame = {0};
+    char *etag = NULL, *last_modified = NULL;
+    uint64_t last_hash = 0;
+    long last_status = 0;
+    int have_body = 0;
+    unsigned long polls = 0;
+
+    HttpRequest req = *base;
+    req.on_body = NULL;
+    req.headers = headers;
+
+    while (!watch_interrupted && !out_state.broken) {
+        memcpy(headers, base->headers, base->header_count * sizeof(const char *));
+        req.header_count = base->header_count;
+        if (etag) {
+            if_none_match.len = 0;
+            strbuf_printf(&if_none_match, "If-None-Match: %s", etag);
+            headers[req.header_count++] = if_none_match.data;
+        }
+        if (last_modified) {
+            if_modified_since.len = 0;
+            strbuf_printf(&if_modified_since, "If-Modified-Since: %s", last_modified);
+            headers[req.header_count++] = if_modified_since.data;
+        }
 
-            if (*p == ':') {
-                printf("%s:%s", color(BOLD_WHITE), color(RESET));
-                p++;
+        HttpResponse *resp = http_session_request(session, &req);
+        const char *state;
+        int changed = 0;
+        polls++;
+
+        if (!resp) {
+            state = "request failed";
+            watch_screen_invalidate(&screen);
+        } else if (resp->status_code == 304 && have_body) {
+            state = "not modified";
+        } else {
+            uint64_t hash = body_store_hash(&resp->body);
+            if (have_body && hash == last_hash && resp->status_code == last_status) {
+                state = "unchanged";
+            } else {
+                capture_body(bp, resp, &body);
+                last_hash = hash;
+                last_status = resp->status_code;
+                have_body = 1;
+                changed = 1;
+                state = "changed";
             }
+            remember_validator(&etag, resp, "ETag");
+            remember_validator(&last_modified, resp, "Last-Modified");
+        }
+
+        char now[16];
+        time_t t = time(NULL);
+        strftime(now, sizeof(now), "%H:%M:%S", localtime(&t));
+
+        frame.len = 0;
+        strbuf_printf(&frame, "%sEvery %gs: %s %s  #%lu %s  %s%s\n\n",
+                      color(DIM), interval, req.method, req.url, polls, now, state, color(RESET));
+        if (body.data) strbuf_append(&frame, body.data, body.len);
+
+        // Fora de um terminal so os quadros novos sao impressos
+        if (screen.tty || changed) {
+            watch_screen_update(&screen, frame.data, frame.len);
+        }
+
+        http_response_free(resp);
+        watch_sleep(interval);
+    }
+
+    watch_screen_end(&screen);
+    http_session_free(session);
+    strbuf_free(&if_none_match);
+    strbuf_free(&if_modified_since);
+    strbuf_free(&body);
+    strbuf_free(&frame);
+    free(etag);
+    free(last_modified);
+    return 0;
+}
 
-            // Valor do header
-            printf("%s", color(WHITE));
-            while (*p && *p != '\r' && *p != '\n') {
-                putchar(*p);
-                p++;
+// Listas de URLs -----------------------------------------------------------
+
+typedef struct {
+    char **items;
+    size_t count;
+    size_t cap;
+} UrlList;
+
+static int url_list_add(UrlList *l, const char *url, size_t len) {
+    if (l->count == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 16;
+        char **items = realloc(l->items, cap * sizeof(char *));
+        if (!items) return -1;
+        l->items = items;
+        l->cap = cap;
+    }
+    char *copy = malloc(len + 1);
+    if (!copy) return -1;
+    memcpy(copy, url, len);
+    copy[len] = '\0';
+    l->items[l->count++] = copy;
+    return 0;
+}
+
+// Uma URL por linha; linhas vazias e comentarios (#) sao ignorados
+static int url_list_load(UrlList *l, const char *path) {
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "%sError: cannot open %s: %s%s\n", color(RED), path, strerror(errno), color(RESET));
+        return -1;
+    }
+
+    StrBuf line = {0};
+    char chunk[4096];
+    int result = 0;
+    int eof = 0;
+
+    while (!eof && result == 0) {
+        line.len = 0;
+        for (;;) {
+            if (!fgets(chunk, sizeof(chunk), fp)) {
+                eof = 1;
+                break;
             }
-            printf("%s", color(RESET));
+            strbuf_puts(&line, chunk);
+            if (line.len && line.data[line.len - 1] == '\n') break;
         }
 
-        // Avanca para proxima linha
-        while (*p == '\r' || *p == '\n') {
-            putchar(*p);
-            p++;
+        const char *start = line.data ? line.data : "";
+        const char *end = start + line.len;
+        while (start < end && isspace((unsigned char)*start)) start++;
+        while (end > start && isspace((unsigned char)end[-1])) end--;
+        if (start == end || *start == '#') continue;
+
+        if (url_list_add(l, start, (size_t)(end - start)) != 0) {
+            fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+            result = -1;
         }
     }
-    printf("\n");
+
+    strbuf_free(&line);
+    if (fp != stdin) fclose(fp);
+    return result;
+}
+
+static void url_list_free(UrlList *l) {
+    for (size_t i = 0; i < l->count; i++) free(l->items[i]);
+    free(l->items);
+}
+
+// Cabecalho "==> URL <==" entre as respostas de uma lista
+static void print_banner(const char *url, int first) {
+    if (!first) out_putc('\n');
+    out_color(DIM);
+    out_printf("==> %s <==", url);
+    out_color(RESET);
+    out_putc('\n');
+}
+
+// Imprime uma resposta completa (status, headers e body)
+static void print_response(BodyPrinter *bp, HttpResponse *resp, int buffered) {
+    if (buffered) {
+        print_buffered_body(bp, resp);
+    }
+
+    // Resposta sem body: exibe status e headers
+    if (!bp->started) {
+        body_printer_start(bp, resp);
+    }
+
+    body_printer_finish(bp);
+    out_set_limits(0, 0, 0);
+}
+
+typedef struct {
+    BodyPrinter *bp;
+    const UrlList *urls;
+    int banners;
+} WorkerContext;
+
+// Roda dentro de cada worker do --workers, com a saida capturada
+static void worker_format(size_t index, HttpResponse *resp, void *userdata) {
+    WorkerContext *ctx = (WorkerContext *)userdata;
+
+    // A linha em branco entre as respostas vem do separador do pool: com
+    // --order completion a primeira a sair nao e necessariamente a 0
+    if (ctx->banners) print_banner(ctx->urls->items[index], 1);
+
+    ctx->bp->started = 0;
+    if (resp) {
+        print_response(ctx->bp, resp, 1);
+    }
+}
+
+// Executa as requisicoes em ordem, na mesma sessao, ou distribuidas entre
+// processos com --workers. Com mais de uma URL os hosts sao resolvidos todos
+// de uma vez no inicio e cada resposta ganha um cabecalho "==> URL <==".
+static int run_requests(const HttpRequest *base, BodyPrinter *bp, const UrlList *urls,
+                        int prewarm, const WorkerOptions *workers) {
+    HttpSession *session = http_session_new();
+    if (!session) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        return 1;
+    }
+
+    // Em -r o banner tambem separa os bodies, que podem nao terminar em '\n';
+    // o CSV continua um unico fluxo, com um so cabecalho
+    int banners = urls->count > 1 && bp->mode != BODY_CSV;
+    int failed = 0;
+
+    if (workers && urls->count > 1) {
+        // As conexoes do prewarm sao abertas em cada worker, depois do fork
+        http_session_prewarm(session, (const char *const *)urls->items, urls->count, 0);
+
+        WorkerOptions opts = *workers;
+        opts.prewarm = prewarm;
+        opts.separator = banners ? "\n" : NULL;
+        int pipelined = bp->pipelined;
+        bp->pipelined = 0;
+        WorkerContext ctx = { .bp = bp, .urls = urls, .banners = banners };
+
+        failed = workers_run(session, base, (const char *const *)urls->items, urls->count,
+                             &opts, worker_format, &ctx);
+        if (failed >= 0) {
+            http_session_free(session);
+            return failed != 0;
+        }
+
+        // Sem fork ou memoria compartilhada: segue em ordem neste processo
+        fprintf(stderr, "Warning: cannot start the --workers processes; running the requests in order\n");
+        bp->pipelined = pipelined;
+        failed = 0;
+    }
+
+    if (urls->count > 1 || prewarm > 0) {
+        http_session_prewarm(session, (const char *const *)urls->items, urls->count, prewarm);
+    }
+
+    CsvColumns csv_columns = {0};
+    if (bp->mode == BODY_CSV) bp->csv_columns = &csv_columns;
+
+    HttpRequest req = *base;
+
+    for (size_t i = 0; i < urls->count && !out_state.broken; i++) {
+        req.url = urls->items[i];
+
+        if (banners) {
+            print_banner(req.url, i == 0);
+            out_flush();    // antes de qualquer erro da requisicao em stderr
+        }
+
+        bp->started = 0;
+        HttpResponse *resp = http_session_request(session, &req);
+
+        if (!resp) {
+            body_printer_finish(bp);
+            failed = 1;
+            continue;
+        }
+
+        print_response(bp, resp, !req.on_body);
+        http_response_free(resp);
+    }
+
+    bp->csv_columns = NULL;
+    csv_columns_free(&csv_columns);
+    http_session_free(session);
+    return failed;
+}
+
+// --output-dir -------------------------------------------------------------
+
+// Transferencias simultaneas ao gravar em arquivos: nada e formatado, o
+// limite e a rede
+#define OUTPUT_TRANSFERS 16
+
+#define OUTPUT_DEFAULT_TEMPLATE "{index}-{name}.{ext}"
+
+// Copia s para sb trocando o que nao serve em nome de arquivo por '_'
+static void append_sanitized(StrBuf *sb, const char *s, size_t n) {
+    size_t start = sb->len;
+    for (size_t i = 0; i < n && sb->len - start < 120; i++) {
+        char c = s[i];
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_') c = '_';
+        strbuf_putc(sb, c);
+    }
+}
+
+// Partes da URL usadas no modelo de nome
+typedef struct {
+    const char *host;
+    size_t host_len;
+    const char *path;       // sem a barra inicial, sem query
+    size_t path_len;
+    const char *name;       // ultimo segmento, sem extensao
+    size_t name_len;
+    const char *ext;        // extensao do ultimo segmento, sem o ponto
+    size_t ext_len;
+} UrlParts;
+
+static void split_url(const char *url, UrlParts *u) {
+    memset(u, 0, sizeof(*u));
+
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    const char *at = strpbrk(p, "@/?#");
+    if (at && *at == '@') p = at + 1;
+
+    u->host = p;
+    while (*p && *p != ':' && *p != '/' && *p != '?' && *p != '#') p++;
+    u->host_len = (size_t)(p - u->host);
+
+    while (*p && *p != '/' && *p != '?' && *p != '#') p++;
+    if (*p == '/') p++;
+    u->path = p;
+    while (*p && *p != '?' && *p != '#') p++;
+    u->path_len = (size_t)(p - u->path);
+    while (u->path_len > 0 && u->path[u->path_len - 1] == '/') u->path_len--;
+
+    const char *seg = u->path + u->path_len;
+    while (seg > u->path && seg[-1] != '/') seg--;
+    u->name = seg;
+    u->name_len = (size_t)(u->path + u->path_len - seg);
+
+    const char *dot = NULL;
+    for (const char *c = seg + 1; c < u->path + u->path_len; c++) {
+        if (*c == '.') dot = c;
+    }
+    if (dot) {
+        u->ext = dot + 1;
+        u->ext_len = (size_t)(u->path + u->path_len - u->ext);
+        u->name_len = (size_t)(dot - seg);
+    }
+}
+
+static const char* output_extension(const HttpResponse *resp, const UrlParts *u, size_t *len) {
+    switch (detect_content_type(resp->content_type)) {
+        case CONTENT_JSON:    *len = 4; return "json";
+        case CONTENT_XML:     *len = 3; return "xml";
+        case CONTENT_HTML:    *len = 4; return "html";
+        case CONTENT_MSGPACK: *len = 7; return "msgpack";
+        case CONTENT_CBOR:    *len = 4; return "cbor";
+        case CONTENT_TEXT:
+        case CONTENT_SSE:     *len = 3; return "txt";
+        default: break;
+    }
+    if (u->ext_len) {
+        *len = u->ext_len;
+        return u->ext;
+    }
+    *len = 3;
+    return "bin";
+}
+
+// Expande o modelo: {index} (1, 2, ... com zeros a esquerda), {host},
+// {path}, {name} e {ext}
+static void output_file_name(StrBuf *sb, const char *dir, const char *tpl, size_t index, size_t count,
+                             const char *url, const HttpResponse *resp) {
+    UrlParts u;
+    split_url(url, &u);
+
+    int width = 1;
+    for (size_t n = count; n >= 10; n /= 10) width++;
+
+    sb->len = 0;
+    strbuf_printf(sb, "%s/", dir);
+
+    for (const char *t = tpl; *t; t++) {
+        const char *end = *t == '{' ? strchr(t, '}') : NULL;
+        size_t n = end ? (size_t)(end - t - 1) : 0;
+
+        if (end && n == 5 && strncmp(t + 1, "index", 5) == 0) {
+            strbuf_printf(sb, "%0*zu", width, index + 1);
+        } else if (end && n == 4 && strncmp(t + 1, "host", 4) == 0) {
+            append_sanitized(sb, u.host, u.host_len);
+        } else if (end && n == 4 && strncmp(t + 1, "path", 4) == 0) {
+            if (u.path_len) append_sanitized(sb, u.path, u.path_len);
+            else strbuf_puts(sb, "index");
+        } else if (end && n == 4 && strncmp(t + 1, "name", 4) == 0) {
+            if (u.name_len) append_sanitized(sb, u.name, u.name_len);
+            else append_sanitized(sb, u.host, u.host_len);
+        } else if (end && n == 3 && strncmp(t + 1, "ext", 3) == 0) {
+            size_t len;
+            const char *ext = output_extension(resp, &u, &len);
+            append_sanitized(sb, ext, len);
+        } else {
+            strbuf_putc(sb, *t == '/' ? '_' : *t);
+            continue;
+        }
+        t = end;
+    }
+}
+
+// Arquivos gravados com sucesso
+typedef struct {
+    size_t files;
+    unsigned long long bytes;
+    int failed;
+} OutputTally;
+
+typedef struct {
+    HttpResponse *resp;     // o body e gravado direto do buffer de recepcao
+    char *path;
+    OutputTally *tally;
+} SavedFile;
+
+static void on_file_saved(void *tag, int error) {
+    SavedFile *f = (SavedFile *)tag;
+    if (error) {
+        fprintf(stderr, "%sError: cannot write %s: %s%s\n", color(RED), f->path, strerror(error), color(RESET));
+        f->tally->failed = 1;
+    } else {
+        f->tally->files++;
+        f->tally->bytes += f->resp->body.size;
+    }
+    http_response_free(f->resp);
+    free(f->path);
+    free(f);
+}
+
+static double elapsed_since(const struct timespec *t0) {
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (double)(t1.tv_sec - t0->tv_sec) + (double)(t1.tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+// Baixa as URLs em paralelo e grava cada body, sem formatar, num arquivo
+// proprio. Imprime uma linha por arquivo e, em stderr, arquivos/s e MB/s.
+static int run_output_dir(const HttpRequest *base, const UrlList *urls, const char *dir,
+                          const char *tpl, int prewarm) {
+#ifdef _WIN32
+    int made = mkdir(dir);
+#else
+    int made = mkdir(dir, 0777);
+#endif
+    if (made != 0 && errno != EEXIST) {
+        fprintf(stderr, "%sError: cannot create %s: %s%s\n", color(RED), dir, strerror(errno), color(RESET));
+        return 1;
+    }
+
+    HttpSession *session = http_session_new();
+    FileWriter *writer = file_writer_new();
+    if (!session || !writer) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        http_session_free(session);
+        file_writer_free(writer);
+        return 1;
+    }
+
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    http_session_prewarm(session, (const char *const *)urls->items, urls->count, prewarm);
+    HttpMulti *multi = http_multi_new(session);
+
+    HttpRequest req = *base;
+    req.on_body = NULL;
+    StrBuf path = {0};
+    size_t next = 0;
+    OutputTally tally = {0};
+
+    while (multi && !out_state.broken) {
+        while (next < urls->count && http_multi_pending(multi) < OUTPUT_TRANSFERS) {
+            req.url = urls->items[next];
+            if (http_multi_add(multi, &req, (void *)(uintptr_t)next) != 0) tally.failed = 1;
+            next++;
+        }
+
+        HttpResponse *resp;
+        void *tag;
+        if (http_multi_next(multi, &resp, &tag) <= 0) break;
+        size_t index = (size_t)(uintptr_t)tag;
+
+        if (!resp) {
+            tally.failed = 1;
+            continue;
+        }
+
+        output_file_name(&path, dir, tpl, index, urls->count, urls->items[index], resp);
+        size_t size = resp->body.size;
+        const char *data = size ? body_store_view(&resp->body) : "";
+
+        out_color(status_color(resp->status_code));
+        out_printf("%ld", resp->status_code);
+        out_color(RESET);
+        out_printf("  %10zu  %s\n", size, path.data);
+        out_flush();
+
+        SavedFile *f = malloc(sizeof(SavedFile));
+        char *copy = f ? strdup(path.data) : NULL;
+        if (!copy || !data) {
+            fprintf(stderr, "%sError: cannot write %s%s\n", color(RED), path.data, color(RESET));
+            http_response_free(resp);
+            free(f);
+            tally.failed = 1;
+            continue;
+        }
+        f->resp = resp;
+        f->path = copy;
+        f->tally = &tally;
+
+        if (file_writer_submit(writer, copy, data, size, on_file_saved, f) != 0) {
+            on_file_saved(f, EIO);
+        }
+    }
+
+    file_writer_drain(writer);
+    double seconds = elapsed_since(&t0);
+    double mb = tally.bytes / (1024.0 * 1024.0);
+
+    fprintf(stderr, "%s%zu files, %.1f MB in %.2fs: %.0f files/s, %.1f MB/s (%s)%s\n",
+            color(DIM), tally.files, mb, seconds,
+            seconds > 0 ? tally.files / seconds : 0, seconds > 0 ? mb / seconds : 0,
+            file_writer_backend(writer), color(RESET));
+
+    http_multi_free(multi);
+    file_writer_free(writer);
+    http_session_free(session);
+    strbuf_free(&path);
+    return tally.failed;
+}
+
+// --reconnect --------------------------------------------------------------
+
+// Espera padrao entre reconexoes, como no EventSource dos navegadores
+#define SSE_DEFAULT_RETRY_MS 3000
+
+// Mantem um text/event-stream aberto: quando o stream termina ou a conexao
+// cai, espera o "retry:" do servidor e pede de novo com Last-Event-ID, ate
+// max_reconnects vezes (< 0 = sem limite). Outra resposta que nao um stream
+// 200 encerra, assim como Ctrl+C ou um limite de saida.
+static int run_event_stream(const HttpRequest *base, BodyPrinter *bp, long max_reconnects) {
+    HttpSession *session = http_session_new();
+    if (!session) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        return 1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_watch_signal;     // sem SA_RESTART: a espera e interrompida
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    SseState sse = {0};
+    bp->sse = &sse;
+
+    const char *headers[MAX_HEADERS + 1];
+    StrBuf last_event_id = {0};
+    HttpRequest req = *base;
+    req.headers = headers;
+    memcpy(headers, base->headers, base->header_count * sizeof(const char *));
+
+    int failed = 0;
+    for (long attempt = 0; ; attempt++) {
+        bp->started = 0;
+        HttpResponse *resp = http_session_request(session, &req);
+        int streaming = 0, aborted = 0;
+
+        if (!resp) {
+            body_printer_finish(bp);
+            failed = 1;
+        } else {
+            streaming = resp->status_code == 200 && detect_content_type(resp->content_type) == CONTENT_SSE;
+            aborted = resp->aborted;
+            failed = 0;
+            print_response(bp, resp, !req.on_body);
+            http_response_free(resp);
+        }
+
+        if ((resp && !streaming) || aborted || watch_interrupted || out_state.broken) break;
+        if (max_reconnects >= 0 && attempt >= max_reconnects) break;
+
+        long wait = sse.retry_ms > 0 ? sse.retry_ms : SSE_DEFAULT_RETRY_MS;
+        fprintf(stderr, "%sReconnecting in %ld ms%s%s%s\n", color(DIM), wait,
+                sse.last_id[0] ? " (Last-Event-ID: " : "", sse.last_id, sse.last_id[0] ? ")" : "");
+        fprintf(stderr, "%s", color(RESET));
+        watch_sleep(wait / 1000.0);
+        if (watch_interrupted) break;
+
+        req.header_count = base->header_count;
+        if (sse.last_id[0]) {
+            last_event_id.len = 0;
+            strbuf_printf(&last_event_id, "Last-Event-ID: %s", sse.last_id);
+            headers[req.header_count++] = last_event_id.data;
+        }
+    }
+
+    bp->sse = NULL;
+    strbuf_free(&last_event_id);
+    http_session_free(session);
+    return failed;
+}
+
+// --file -------------------------------------------------------------------
+
+// Bytes olhados para adivinhar o tipo quando nao ha --type
+#define FILE_SNIFF_BYTES 4096
+
+// Arquivo regular mapeado: o kernel le adiante (MADV_SEQUENTIAL) e as janelas
+// ja formatadas sao devolvidas, entao a memoria nao cresce com o arquivo.
+// Retorna -1 se o mapeamento nao for possivel (o chamador le em blocos).
+static int format_mapped_file(BodyPrinter *bp, int fd, int *stopped) {
+#ifdef _WIN32
+    (void)bp;
+    (void)fd;
+    (void)stopped;
+    return -1;
+#else
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return -1;
+
+    size_t size = (size_t)st.st_size;
+    char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    size_t sniff = size < FILE_SNIFF_BYTES ? size : FILE_SNIFF_BYTES;
+    if (body_printer_open(bp, sniff_content_type(map, sniff)) == 0) {
+        for (size_t off = 0; off < size; off += BODY_WINDOW) {
+            size_t n = size - off < BODY_WINDOW ? size - off : BODY_WINDOW;
+            STATS_ADD(body_streamed, n);
+            *stopped = body_printer_feed(bp, map + off, n);
+            // O --pipeline copia para o anel, entao a janela anterior ja foi usada
+            if (off > 0) madvise(map + off - BODY_WINDOW, BODY_WINDOW, MADV_DONTNEED);
+            if (*stopped) break;
+        }
+    }
+
+    munmap(map, size);
+    return 0;
+#endif
+}
+
+// Le ate want bytes ou o fim (um pipe entrega aos poucos); retorna os bytes
+// lidos ou -1 em erro
+static ssize_t read_some(int fd, char *buf, size_t want) {
+    size_t have = 0;
+    while (have < want) {
+        ssize_t n = read(fd, buf + have, want - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        have += (size_t)n;
+    }
+    return (ssize_t)have;
 }
 
+// Formata um arquivo ou stdin ("-"), sem HTTP. O tipo vem de --type ou e
+// adivinhado pelos primeiros bytes.
+static int run_file(BodyPrinter *bp, const char *path) {
+    int fd = strcmp(path, "-") == 0 ? 0 : open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%sError: cannot open %s: %s%s\n", color(RED), path, strerror(errno), color(RESET));
+        return 1;
+    }
+
+    bp->started = 1;
+    out_set_limits(bp->limits.max_lines, bp->limits.max_bytes, bp->limits.max_items);
+
+    int result = 0;
+    int stopped = 0;
+    if (format_mapped_file(bp, fd, &stopped) != 0) {
+        // Pipe, terminal ou arquivo especial: le em blocos
+        char *buf = malloc(BODY_WINDOW);
+        ssize_t n = buf ? read_some(fd, buf, FILE_SNIFF_BYTES) : -1;
+
+        if (n >= 0 && body_printer_open(bp, sniff_content_type(buf, (size_t)n)) == 0) {
+            while (n > 0 && !stopped) {
+                STATS_ADD(body_streamed, (unsigned long long)n);
+                stopped = body_printer_feed(bp, buf, (size_t)n);
+                // O que chegar: um pipe lento e formatado conforme escreve
+                if (!stopped) {
+                    do {
+                        n = read(fd, buf, BODY_WINDOW);
+                    } while (n < 0 && errno == EINTR);
+                }
+            }
+        }
+        if (n < 0) {
+            fprintf(stderr, "%sError: cannot read %s: %s%s\n", color(RED), path,
+                    buf ? strerror(errno) : "out of memory", color(RESET));
+            result = 1;
+        }
+        free(buf);
+    }
+    if (!bp->formatter) result = 1;     // sem memoria para o formatador
+
+    body_printer_finish(bp);
+    out_set_limits(0, 0, 0);
+    if (fd != 0) close(fd);
+    return result;
+}
+
+#if CURLSER_STATS
+static int stats_json = 0;
+
+static void print_stats_at_exit(void) {
+    stats_print(stats_json);
+}
+#endif
+
+// Parse de argumento numerico positivo
+static int parse_limit(const char *arg, const char *name, long long *value) {
+    char *end;
+    long long v = strtoll(arg, &end, 10);
+
+    if (*arg == '\0' || *end != '\0' || v <= 0) {
+        fprintf(stderr, "%sError: invalid value for --%s: %s%s\n", color(RED), name, arg, color(RESET));
+        return -1;
+    }
+
+    *value = v;
+    return 0;
+}
+
+// Opcoes longas sem equivalente curto
+enum {
+    OPT_MAX_LINES = 256,
+    OPT_MAX_BYTES,
+    OPT_MAX_ITEMS,
+    OPT_BUFFER,
+    OPT_MAX_MEMORY,
+    OPT_PIPELINE,
+    OPT_SCHEMA,
+    OPT_TABLE,
+    OPT_CSV,
+    OPT_DIFF,
+    OPT_WATCH,
+    OPT_COMPRESSED,
+    OPT_STATS,
+    OPT_URLS,
+    OPT_PREWARM,
+    OPT_WORKERS,
+    OPT_ORDER,
+    OPT_OUTPUT_DIR,
+    OPT_OUTPUT_TEMPLATE,
+    OPT_RECONNECT,
+    OPT_RECORD,
+    OPT_REPLAY,
+    OPT_REPLAY_LATENCY,
+    OPT_MATCH_HEADER,
+    OPT_SERVE,
+    OPT_FILE,
+    OPT_TYPE,
+    OPT_SORT_KEYS,
+    OPT_COMPACT,
+    OPT_CANONICAL,
+    OPT_UNICODE,
+    OPT_SELECT,
+    OPT_MONITOR,
+    OPT_METRICS
+};
+
 int main(int argc, char *argv[]) {
-    // Inicializa cores
+    // Inicializa cores e saida
     init_colors();
+    out_init();
 
     // Opcoes
     const char *method = "GET";
@@ -108,8 +1203,37 @@ int main(int argc, char *argv[]) {
     int header_count = 0;
     const char *data = NULL;
     int show_headers = 0;
-    int raw_output = 0;
+    BodyMode mode = BODY_FORMAT;
     int verbose = 0;
+    int compressed = 0;
+    int buffer_body = 0;
+    int pipelined = 0;
+    int diff_mode = 0;
+    double watch_interval = 0;
+    size_t max_memory = 0;
+    UrlList urls = {0};
+    int prewarm = 0;
+    int use_workers = 0;
+    const char *output_dir = NULL;
+    const char *output_template = OUTPUT_DEFAULT_TEMPLATE;
+    long reconnects = 0;    // 0 = sem --reconnect, < 0 = sem limite
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    double replay_latency = 0;
+    const char *match_headers[FIXTURE_MAX_KEY_HEADERS];
+    int match_header_count = 0;
+    int serve_port = -1;
+    const char *monitor_path = NULL;
+    int metrics_port = -1;
+    const char *file_path = NULL;
+    int type_given = 0;
+    ContentType type = CONTENT_UNKNOWN;
+    int json_tree = 0;
+    const char *select_css = NULL;
+    HtmlSelector *select = NULL;
+    WorkerOptions worker_opts = {0};
+    OutputLimits limits = {0};
+    long long value;
 
     // Definicao das opcoes longas
     static struct option long_options[] = {
@@ -121,6 +1245,40 @@ int main(int argc, char *argv[]) {
         {"verbose", no_argument,       0, 'v'},
         {"help",    no_argument,       0, 'h'},
         {"version", no_argument,       0, 'V'},
+        {"max-lines", required_argument, 0, OPT_MAX_LINES},
+        {"max-bytes", required_argument, 0, OPT_MAX_BYTES},
+        {"max-items", required_argument, 0, OPT_MAX_ITEMS},
+        {"buffer",    no_argument,       0, OPT_BUFFER},
+        {"max-memory", required_argument, 0, OPT_MAX_MEMORY},
+        {"pipeline",  no_argument,       0, OPT_PIPELINE},
+        {"schema",    optional_argument, 0, OPT_SCHEMA},
+        {"table",     no_argument,       0, OPT_TABLE},
+        {"csv",       no_argument,       0, OPT_CSV},
+        {"diff",      no_argument,       0, OPT_DIFF},
+        {"watch",     required_argument, 0, OPT_WATCH},
+        {"compressed", no_argument,      0, OPT_COMPRESSED},
+        {"stats",     optional_argument, 0, OPT_STATS},
+        {"urls",      required_argument, 0, OPT_URLS},
+        {"prewarm",   optional_argument, 0, OPT_PREWARM},
+        {"workers",   optional_argument, 0, OPT_WORKERS},
+        {"order",     required_argument, 0, OPT_ORDER},
+        {"output-dir", required_argument, 0, OPT_OUTPUT_DIR},
+        {"output-template", required_argument, 0, OPT_OUTPUT_TEMPLATE},
+        {"reconnect", optional_argument, 0, OPT_RECONNECT},
+        {"record",    required_argument, 0, OPT_RECORD},
+        {"replay",    required_argument, 0, OPT_REPLAY},
+        {"replay-latency", optional_argument, 0, OPT_REPLAY_LATENCY},
+        {"match-header", required_argument, 0, OPT_MATCH_HEADER},
+        {"serve",     required_argument, 0, OPT_SERVE},
+        {"file",      required_argument, 0, OPT_FILE},
+        {"type",      required_argument, 0, OPT_TYPE},
+        {"sort-keys", no_argument,       0, OPT_SORT_KEYS},
+        {"compact",   no_argument,       0, OPT_COMPACT},
+        {"canonical", no_argument,       0, OPT_CANONICAL},
+        {"unicode",   no_argument,       0, OPT_UNICODE},
+        {"select",    required_argument, 0, OPT_SELECT},
+        {"monitor",   required_argument, 0, OPT_MONITOR},
+        {"metrics",   required_argument, 0, OPT_METRICS},
         {0, 0, 0, 0}
     };
 
@@ -144,7 +1302,7 @@ int main(int argc, char *argv[]) {
                 show_headers = 1;
                 break;
             case 'r':
-                raw_output = 1;
+                mode = BODY_RAW;
                 break;
             case 'v':
                 verbose = 1;
@@ -155,26 +1313,345 @@ int main(int argc, char *argv[]) {
             case 'V':
                 print_version();
                 return 0;
+            case OPT_MAX_LINES:
+                if (parse_limit(optarg, "max-lines", &value) != 0) return 1;
+                limits.max_lines = (long)value;
+                break;
+            case OPT_MAX_BYTES:
+                if (parse_limit(optarg, "max-bytes", &value) != 0) return 1;
+                limits.max_bytes = value;
+                break;
+            case OPT_MAX_ITEMS:
+                if (parse_limit(optarg, "max-items", &value) != 0) return 1;
+                limits.max_items = (long)value;
+                break;
+            case OPT_BUFFER:
+                buffer_body = 1;
+                break;
+            case OPT_PIPELINE:
+                pipelined = 1;
+                break;
+            case OPT_SCHEMA:
+                if (optarg && strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "%sError: invalid value for --schema: %s (expected json)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                mode = optarg ? BODY_SCHEMA_JSON : BODY_SCHEMA;
+                break;
+            case OPT_TABLE:
+                mode = BODY_TABLE;
+                break;
+            case OPT_CSV:
+                mode = BODY_CSV;
+                break;
+            case OPT_DIFF:
+                diff_mode = 1;
+                break;
+            case OPT_COMPRESSED:
+                compressed = 1;
+                break;
+            case OPT_STATS:
+                if (optarg && strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "%sError: invalid value for --stats: %s (expected json)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+#if CURLSER_STATS
+                // Impresso na saida, qualquer que seja o caminho de retorno
+                if (!stats.enabled) atexit(print_stats_at_exit);
+                stats.enabled = 1;
+                stats_json = optarg != NULL;
+#else
+                fprintf(stderr, "%sError: --stats is not available in this build (make STATS=1)%s\n",
+                        color(RED), color(RESET));
+                return 1;
+#endif
+                break;
+            case OPT_WATCH: {
+                char *end;
+                watch_interval = strtod(optarg, &end);
+                if (*optarg == '\0' || *end != '\0' || !(watch_interval >= 0.1)) {
+                    fprintf(stderr, "%sError: invalid value for --watch: %s (seconds, at least 0.1)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                break;
+            }
+            case OPT_URLS:
+                if (url_list_load(&urls, optarg) != 0) {
+                    url_list_free(&urls);
+                    return 1;
+                }
+                break;
+            case OPT_PREWARM:
+                if (!optarg) {
+                    prewarm = 1;
+                } else if (parse_limit(optarg, "prewarm", &value) != 0) {
+                    return 1;
+                } else {
+                    prewarm = value > 64 ? 64 : (int)value;
+                }
+                break;
+            case OPT_WORKERS:
+                use_workers = 1;
+                if (optarg) {
+                    if (parse_limit(optarg, "workers", &value) != 0) return 1;
+                    worker_opts.workers = value > 256 ? 256 : (int)value;
+                }
+                break;
+            case OPT_ORDER:
+                if (strcmp(optarg, "submission") == 0) {
+                    worker_opts.completion_order = 0;
+                } else if (strcmp(optarg, "completion") == 0) {
+                    worker_opts.completion_order = 1;
+                } else {
+                    fprintf(stderr, "%sError: invalid value for --order: %s (expected submission or completion)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                break;
+            case OPT_OUTPUT_DIR:
+                output_dir = optarg;
+                break;
+            case OPT_OUTPUT_TEMPLATE:
+                output_template = optarg;
+                break;
+            case OPT_RECONNECT:
+                if (!optarg) {
+                    reconnects = -1;
+                } else if (parse_limit(optarg, "reconnect", &value) != 0) {
+                    return 1;
+                } else {
+                    reconnects = (long)value;
+                }
+                break;
+            case OPT_RECORD:
+                record_path = optarg;
+                break;
+            case OPT_REPLAY:
+                replay_path = optarg;
+                break;
+            case OPT_REPLAY_LATENCY: {
+                char *end;
+                replay_latency = optarg ? strtod(optarg, &end) : 1.0;
+                if (optarg && (*optarg == '\0' || *end != '\0' || !(replay_latency >= 0))) {
+                    fprintf(stderr, "%sError: invalid value for --replay-latency: %s (scale, 1 = as recorded)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                break;
+            }
+            case OPT_MATCH_HEADER:
+                if (match_header_count < FIXTURE_MAX_KEY_HEADERS) {
+                    match_headers[match_header_count++] = optarg;
+                } else {
+                    fprintf(stderr, "Error: maximum number of --match-header exceeded (%d)\n", FIXTURE_MAX_KEY_HEADERS);
+                }
+                break;
+            case OPT_SERVE: {
+                char *end;
+                long port = strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || port < 0 || port > 65535) {
+                    fprintf(stderr, "%sError: invalid value for --serve: %s (port, 0 = any free port)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                serve_port = (int)port;
+                break;
+            }
+            case OPT_SELECT:
+                select_css = optarg;
+                break;
+            case OPT_MONITOR:
+                monitor_path = optarg;
+                break;
+            case OPT_METRICS: {
+                char *end;
+                long port = strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || port < 0 || port > 65535) {
+                    fprintf(stderr, "%sError: invalid value for --metrics: %s (port, 0 = any free port)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                metrics_port = (int)port;
+                break;
+            }
+            case OPT_FILE:
+                file_path = optarg;
+                break;
+            case OPT_TYPE:
+                if (content_type_from_name(optarg, &type) != 0) {
+                    fprintf(stderr, "%sError: invalid value for --type: %s (json, xml, html, text, msgpack, cbor, sse)%s\n",
+                            color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                type_given = 1;
+                break;
+            case OPT_SORT_KEYS:
+                json_tree |= JSON_TREE_SORT_KEYS;
+                break;
+            case OPT_COMPACT:
+                json_tree |= JSON_TREE_COMPACT;
+                break;
+            case OPT_CANONICAL:
+                json_tree |= JSON_TREE_CANONICAL;
+                break;
+            case OPT_UNICODE:
+                json_unicode = 1;
+                break;
+            case OPT_MAX_MEMORY:
+                if (parse_limit(optarg, "max-memory", &value) != 0) return 1;
+                if ((unsigned long long)value > SIZE_MAX / (1024 * 1024)) {
+                    fprintf(stderr, "%sError: --max-memory is too large: %s%s\n", color(RED), optarg, color(RESET));
+                    return 1;
+                }
+                max_memory = (size_t)value * 1024 * 1024;
+                break;
             default:
                 print_usage(argv[0]);
                 return 1;
         }
     }
 
+    // URLs da linha de comando depois das do --urls
+    if (!diff_mode) {
+        for (int i = optind; i < argc; i++) {
+            if (url_list_add(&urls, argv[i], strlen(argv[i])) != 0) {
+                fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+                url_list_free(&urls);
+                return 1;
+            }
+        }
+    } else if (urls.count > 0) {
+        fprintf(stderr, "%sError: --urls cannot be combined with --diff%s\n", color(RED), color(RESET));
+        url_list_free(&urls);
+        return 2;
+    }
+
+    if (record_path && replay_path) {
+        fprintf(stderr, "%sError: --record and --replay cannot be combined%s\n", color(RED), color(RESET));
+        url_list_free(&urls);
+        return 2;
+    }
+
+    // Monitor: os alvos vem do arquivo; --replay vale para ensaiar as assercoes
+    if (metrics_port >= 0 && !monitor_path) {
+        fprintf(stderr, "%sError: --metrics needs --monitor%s\n", color(RED), color(RESET));
+        url_list_free(&urls);
+        return 2;
+    }
+    if (monitor_path && (urls.count > 0 || diff_mode || watch_interval > 0 || use_workers || output_dir ||
+                         reconnects != 0 || record_path || serve_port >= 0 || file_path)) {
+        fprintf(stderr, "%sError: --monitor takes no URL and no --diff, --watch, --workers, --output-dir, "
+                        "--reconnect, --record, --serve or --file%s\n", color(RED), color(RESET));
+        url_list_free(&urls);
+        return 2;
+    }
+
+    // Servidor de fixtures: nao ha URL para buscar
+    if (serve_port >= 0) {
+        if (!replay_path || urls.count > 0 || diff_mode) {
+            fprintf(stderr, "%sError: --serve needs --replay and takes no URL%s\n", color(RED), color(RESET));
+            url_list_free(&urls);
+            return 2;
+        }
+        FixtureStore *store = fixture_store_open(replay_path);
+        if (!store) {
+            url_list_free(&urls);
+            return 1;
+        }
+        int result = fixture_serve(store, serve_port, match_headers, match_header_count, replay_latency);
+        fixture_store_close(store);
+        url_list_free(&urls);
+        return result == 0 ? 0 : 1;
+    }
+
+    // O seletor e compilado depois das opcoes, para que os erros acima nao
+    // tenham o que liberar; daqui em diante a saida passa pelo done
+    int result = 0;
+    FixtureStore *fixture_store = NULL;
+    if (select_css) {
+        char error[128];
+        select = html_selector_parse(select_css, error, sizeof(error));
+        if (!select) {
+            fprintf(stderr, "%sError: invalid value for --select: %s%s\n", color(RED), error, color(RESET));
+            url_list_free(&urls);
+            return 1;
+        }
+    }
+
+    // Arquivo local ou stdin: nada de HTTP
+    if (file_path) {
+        if (urls.count > 0 || diff_mode || watch_interval > 0 || use_workers || output_dir || reconnects != 0 ||
+            record_path || replay_path) {
+            fprintf(stderr, "%sError: --file takes no URL and no --diff, --watch, --workers, --output-dir, "
+                            "--reconnect, --record or --replay%s\n", color(RED), color(RESET));
+            result = 2;
+            goto done;
+        }
+        BodyPrinter printer = {
+            .mode = mode,
+            .type_given = type_given,
+            .type = type,
+            .json_tree = json_tree,
+            .select = select,
+            .limits = limits,
+            .pipelined = pipelined
+        };
+        result = run_file(&printer, file_path);
+        goto done;
+    }
+
     // Check if URL was provided
-    if (optind >= argc) {
+    if (optind >= argc && urls.count == 0 && !monitor_path) {
         fprintf(stderr, "%sError: URL not specified%s\n\n", color(RED), color(RESET));
         print_usage(argv[0]);
-        return 1;
+        result = 1;
+        goto done;
+    }
+    if (output_dir && (diff_mode || watch_interval > 0 || use_workers)) {
+        fprintf(stderr, "%sError: --output-dir cannot be combined with --diff, --watch or --workers%s\n",
+                color(RED), color(RESET));
+        result = 2;
+        goto done;
+    }
+    if (mode == BODY_CSV && use_workers) {
+        fprintf(stderr, "%sError: --csv cannot be combined with --workers%s\n", color(RED), color(RESET));
+        result = 2;
+        goto done;
+    }
+    if (reconnects != 0 && (urls.count > 1 || diff_mode || watch_interval > 0 || use_workers || output_dir)) {
+        fprintf(stderr, "%sError: --reconnect takes a single URL and no --diff, --watch, --workers or --output-dir%s\n",
+                color(RED), color(RESET));
+        result = 2;
+        goto done;
+    }
+    if (watch_interval > 0 && urls.count > 1) {
+        fprintf(stderr, "%sError: --watch takes a single URL%s\n", color(RED), color(RESET));
+        result = 2;
+        goto done;
+    }
+    if (diff_mode && argc - optind != 2) {
+        fprintf(stderr, "%sError: --diff takes exactly two sources (URL, file or -)%s\n\n", color(RED), color(RESET));
+        print_usage(argv[0]);
+        result = 2;
+        goto done;
     }
 
-    const char *url = argv[optind];
+    const char *url = diff_mode ? argv[optind] : urls.count > 0 ? urls.items[0] : NULL;
 
-    // Initialize HTTP
-    if (http_init() != 0) {
-        fprintf(stderr, "%sError: failed to initialize HTTP library%s\n", color(RED), color(RESET));
-        return 1;
-    }
+    // Por padrao o body e formatado em streaming, conforme chega da rede
+    BodyPrinter printer = {
+        .show_headers = show_headers,
+        .mode = mode,
+        .type_given = type_given,
+        .type = type,
+        .json_tree = json_tree,
+        .select = select,
+        .limits = limits,
+        .pipelined = pipelined && !buffer_body
+    };
 
     // Configura requisicao
     HttpRequest req = {
@@ -184,37 +1661,58 @@ int main(int argc, char *argv[]) {
         .header_count = header_count,
         .body = data,
         .show_headers = show_headers,
-        .verbose = verbose
+        .verbose = verbose,
+        .compressed = compressed,
+        .on_body = buffer_body ? NULL : on_body,
+        .userdata = &printer,
+        .body_mem_limit = max_memory
     };
 
-    // Executa requisicao
-    HttpResponse *resp = http_request(&req);
-
-    if (!resp) {
-        http_cleanup();
-        return 1;
-    }
-
-    // Exibe status
-    print_status(resp->status_code);
-
-    // Exibe headers se solicitado
-    if (show_headers) {
-        print_headers(resp->headers);
+    // Vale para tudo abaixo, inclusive nos processos do --workers
+    if (record_path || replay_path) {
+        fixture_store = record_path ? fixture_store_create(record_path) : fixture_store_open(replay_path);
+        if (!fixture_store) {
+            result = 1;
+            goto done;
+        }
+        HttpFixtures fixtures = {
+            .store = fixture_store,
+            .replay = replay_path != NULL,
+            .key_headers = match_headers,
+            .key_header_count = match_header_count,
+            .latency = replay_latency
+        };
+        http_set_fixtures(&fixtures);
     }
 
-    // Exibe body formatado ou raw
-    if (resp->body) {
-        if (raw_output) {
-            printf("%s", resp->body);
-        } else {
-            format_output(resp->content_type, resp->body);
-        }
+    if (monitor_path) {
+        MonitorOptions monitor = {
+            .path = monitor_path,
+            .metrics_port = metrics_port,
+            .headers = headers,
+            .header_count = header_count,
+            .compressed = compressed,
+            .verbose = verbose
+        };
+        result = monitor_run(&monitor) == 0 ? 0 : 1;
+    } else if (diff_mode) {
+        result = run_diff(argv[optind], argv[optind + 1], &req, limits);
+    } else if (watch_interval > 0) {
+        result = run_watch(&req, &printer, watch_interval);
+    } else if (reconnects != 0) {
+        result = run_event_stream(&req, &printer, reconnects);
+    } else if (output_dir) {
+        result = run_output_dir(&req, &urls, output_dir, output_template, prewarm);
+    } else {
+        result = run_requests(&req, &printer, &urls, prewarm, use_workers ? &worker_opts : NULL);
     }
 
-    // Limpa
-    http_response_free(resp);
+done:
+    url_list_free(&urls);
+    html_selector_free(select);
+    http_set_fixtures(NULL);
+    fixture_store_close(fixture_store);
     http_cleanup();
 
-    return 0;
+    return result;
 }
@@ -0,0 +1,777 @@
+#include "monitor.h"
+#include "http.h"
+#include "net.h"
+#include "json_dom.h"
+#include "strbuf.h"
+#include "colors.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define MONITOR_LINE_MAX        8192
+#define MONITOR_STATUS_MAX      8
+#define MONITOR_MAX_SPREAD      10.0    // segundos para escalonar a primeira rodada
+#define METRICS_REQUEST_MAX     8192
+
+// Limites do histograma de latencia (os padroes do cliente do Prometheus)
+static const double buckets[] = { 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10 };
+#define BUCKET_COUNT (sizeof(buckets) / sizeof(buckets[0]))
+
+typedef enum {
+    PROBE_OK,
+    PROBE_ERROR,        // transporte: DNS, conexao, TLS, timeout
+    PROBE_STATUS,
+    PROBE_LATENCY,
+    PROBE_JSON,
+    PROBE_RESULTS
+} ProbeResult;
+
+static const char *const result_names[PROBE_RESULTS] = { "success", "error", "status", "latency", "json" };
+
+// Fases como no blackbox_exporter: cada uma e a duracao, nao o instante
+typedef enum {
+    PHASE_RESOLVE,
+    PHASE_CONNECT,
+    PHASE_TLS,
+    PHASE_PROCESSING,   // do fim do handshake ao primeiro byte
+    PHASE_TRANSFER,     // do primeiro byte ao fim
+    PHASE_COUNT
+} Phase;
+
+static const char *const phase_names[PHASE_COUNT] = { "resolve", "connect", "tls", "processing", "transfer" };
+
+typedef struct {
+    // Linha do arquivo
+    char *name;
+    char *label;                    // name com os escapes de label do Prometheus
+    char *url;
+    char *method;
+    double every;
+    double timeout;
+    int status[MONITOR_STATUS_MAX]; // 1-5 = classe (2xx), senao o codigo
+    int status_count;
+    double budget;                  // 0 = sem limite
+    char *json_path;                // NULL = sem assercao de JSON
+    char *json_value;
+
+    // Agendamento (so a thread principal)
+    double next_due;
+    int in_flight;
+    char error[HTTP_ERROR_MAX];
+
+    // Metricas (sob Monitor.lock)
+    unsigned long long bucket_counts[BUCKET_COUNT];
+    unsigned long long count;
+    double sum;
+    unsigned long long results[PROBE_RESULTS];
+    unsigned long long connections;
+    double phases[PHASE_COUNT];     // da ultima sonda concluida
+    long status_code;
+    int up;                         // -1 = ainda nao sondado
+    double last_probe;              // unix
+} Target;
+
+typedef struct {
+    Target *targets;
+    size_t count;
+    pthread_mutex_t lock;
+    int listen_fd;
+} Monitor;
+
+static double now_monotonic(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char* color_if(const char *c) {
+    return colors_enabled ? c : "";
+}
+
+// Arquivo de alvos -----------------------------------------------------------
+
+// "500ms", "1.5s", "2m" ou segundos sem unidade
+static int parse_duration(const char *s, double *out) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v < 0) return -1;
+
+    if (strcmp(end, "ms") == 0) v /= 1000;
+    else if (strcmp(end, "m") == 0) v *= 60;
+    else if (*end != '\0' && strcmp(end, "s") != 0) return -1;
+
+    *out = v;
+    return 0;
+}
+
+// "200", "2xx", "200,204,3xx"
+static int parse_status(Target *t, const char *s) {
+    t->status_count = 0;
+    while (*s) {
+        if (t->status_count == MONITOR_STATUS_MAX) return -1;
+        if (s[0] >= '1' && s[0] <= '5' && tolower((unsigned char)s[1]) == 'x' &&
+            tolower((unsigned char)s[2]) == 'x' && (s[3] == ',' || s[3] == '\0')) {
+            t->status[t->status_count++] = s[0] - '0';
+            s += 3;
+        } else {
+            char *end;
+            long code = strtol(s, &end, 10);
+            if (end == s || code < 100 || code > 999 || (*end != ',' && *end != '\0')) return -1;
+            t->status[t->status_count++] = (int)code;
+            s = end;
+        }
+        if (*s == ',') s++;
+    }
+    return t->status_count > 0 ? 0 : -1;
+}
+
+static int status_ok(const Target *t, long code) {
+    for (int i = 0; i < t->status_count; i++) {
+        int s = t->status[i];
+        if (s < 10 ? code / 100 == s : code == s) return 1;
+    }
+    return 0;
+}
+
+// Escapes de valor de label: barra invertida, aspas e quebra de linha
+static char* label_escape(const char *s) {
+    StrBuf sb = {0};
+    strbuf_puts(&sb, "");       // "" tambem precisa de buffer
+    for (; *s; s++) {
+        if (*s == '\\' || *s == '"') strbuf_putc(&sb, '\\');
+        if (*s == '\n') {
+            strbuf_puts(&sb, "\\n");
+            continue;
+        }
+        strbuf_putc(&sb, *s);
+    }
+    return sb.data;
+}
+
+static void target_free(Target *t) {
+    free(t->name);
+    free(t->label);
+    free(t->url);
+    free(t->method);
+    free(t->json_path);
+    free(t->json_value);
+}
+
+static int parse_error(const char *path, int line, const char *what, const char *value) {
+    fprintf(stderr, "%sError: %s:%d: %s: %s%s\n", color(RED), path, line, what, value, color(RESET));
+    return -1;
+}
+
+// Uma linha do arquivo; retorna 1 com o alvo, 0 se a linha e vazia, -1 em erro
+static int parse_target(Target *t, char *line, const char *path, int line_no) {
+    char *hash = strchr(line, '#');
+    if (hash && (hash == line || isspace((unsigned char)hash[-1]))) *hash = '\0';
+
+    memset(t, 0, sizeof(*t));
+    t->every = MONITOR_DEFAULT_EVERY;
+    t->timeout = MONITOR_DEFAULT_TIMEOUT;
+    t->up = -1;
+
+    int tokens = 0;
+    char *p = line;
+    for (;;) {
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') break;
+        char *tok = p;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        if (*p) *p++ = '\0';
+
+        if (tokens++ == 0) {
+            if (strncmp(tok, "http://", 7) != 0 && strncmp(tok, "https://", 8) != 0) {
+                return parse_error(path, line_no, "expected an http:// or https:// URL", tok);
+            }
+            t->url = strdup(tok);
+            continue;
+        }
+
+        char *value = strchr(tok, '=');
+        if (!value) return parse_error(path, line_no, "expected key=value", tok);
+        *value++ = '\0';
+
+        int bad = 0;
+        if (strcmp(tok, "name") == 0) {
+            free(t->name);
+            t->name = strdup(value);
+        } else if (strcmp(tok, "method") == 0) {
+            free(t->method);
+            t->method = strdup(value);
+        } else if (strcmp(tok, "every") == 0) {
+            bad = parse_duration(value, &t->every) != 0 || t->every < 0.1;
+        } else if (strcmp(tok, "timeout") == 0) {
+            bad = parse_duration(value, &t->timeout) != 0 || t->timeout <= 0;
+        } else if (strcmp(tok, "budget") == 0) {
+            bad = parse_duration(value, &t->budget) != 0;
+        } else if (strcmp(tok, "status") == 0) {
+            bad = parse_status(t, value) != 0;
+        } else if (strcmp(tok, "json") == 0) {
+            char *eq = strstr(value, "==");
+            bad = !eq || (value[0] != '$' && value[0] != '.');
+            if (!bad) {
+                *eq = '\0';
+                free(t->json_path);
+                free(t->json_value);
+                t->json_path = strdup(value);
+                t->json_value = strdup(eq + 2);
+            }
+        } else {
+            return parse_error(path, line_no, "unknown key", tok);
+        }
+        if (bad) {
+            fprintf(stderr, "%sError: %s:%d: invalid value for %s: %s%s\n",
+                    color(RED), path, line_no, tok, value, color(RESET));
+            return -1;
+        }
+    }
+
+    if (tokens == 0) return 0;
+
+    if (!t->name) t->name = strdup(t->url);
+    if (!t->method) t->method = strdup("GET");
+    if (t->status_count == 0) {
+        t->status[0] = 2;
+        t->status_count = 1;
+    }
+    t->label = t->name ? label_escape(t->name) : NULL;
+    if (!t->url || !t->name || !t->method || !t->label || (t->json_path && !t->json_value)) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        return -1;
+    }
+    return 1;
+}
+
+static int load_targets(Monitor *m, const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "%sError: cannot open %s: %s%s\n", color(RED), path, strerror(errno), color(RESET));
+        return -1;
+    }
+
+    char *line = malloc(MONITOR_LINE_MAX);
+    size_t cap = 0;
+    int line_no = 0;
+    int rc = line ? 0 : -1;
+
+    while (rc == 0 && fgets(line, MONITOR_LINE_MAX, fp)) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        Target t;
+        int got = parse_target(&t, line, path, line_no);
+        if (got <= 0) {
+            if (got < 0) rc = -1;
+            target_free(&t);
+            continue;
+        }
+        if (m->count == MONITOR_MAX_TARGETS) {
+            fprintf(stderr, "%sError: %s: more than %d targets%s\n",
+                    color(RED), path, MONITOR_MAX_TARGETS, color(RESET));
+            target_free(&t);
+            rc = -1;
+            break;
+        }
+        if (m->count == cap) {
+            size_t new_cap = cap ? cap * 2 : 16;
+            Target *grown = realloc(m->targets, new_cap * sizeof(Target));
+            if (!grown) {
+                target_free(&t);
+                rc = -1;
+                break;
+            }
+            m->targets = grown;
+            cap = new_cap;
+        }
+        m->targets[m->count++] = t;
+    }
+
+    free(line);
+    fclose(fp);
+    if (rc == 0 && m->count == 0) {
+        fprintf(stderr, "%sError: %s: no targets%s\n", color(RED), path, color(RESET));
+        rc = -1;
+    }
+    return rc;
+}
+
+// Assercao de JSON -----------------------------------------------------------
+
+// "$.a.b[0]" ou ".a.b[0]"; com chaves repetidas vale a ultima
+static const JsonNode* json_path_find(const JsonNode *node, const char *path) {
+    const char *p = path;
+    if (*p == '$') p++;
+
+    while (node && *p) {
+        if (*p == '.') {
+            p++;
+            size_t n = strcspn(p, ".[");
+            if (node->type != JSON_OBJECT) return NULL;
+
+            const JsonNode *found = NULL;
+            for (uint32_t i = 0; i < node->len; i++) {
+                const JsonNode *child = &node->as.children[i];
+                if (child->key_len == n && memcmp(child->key, p, n) == 0) found = child;
+            }
+            node = found;
+            p += n;
+        } else if (*p == '[') {
+            char *end;
+            long index = strtol(p + 1, &end, 10);
+            if (*end != ']' || node->type != JSON_ARRAY || index < 0 || (uint32_t)index >= node->len) return NULL;
+            node = &node->as.children[index];
+            p = end + 1;
+        } else {
+            return NULL;
+        }
+    }
+    return node;
+}
+
+static int json_value_is(const JsonNode *node, const char *expected) {
+    size_t n = strlen(expected);
+
+    switch (node->type) {
+        case JSON_STRING:
+            // O valor esperado pode vir entre aspas
+            if (n >= 2 && expected[0] == '"' && expected[n - 1] == '"') {
+                expected++;
+                n -= 2;
+            }
+            return node->len == n && memcmp(node->as.text, expected, n) == 0;
+        case JSON_NUMBER: {
+            char num[64];
+            if (node->len == n && memcmp(node->as.text, expected, n) == 0) return 1;
+            if (node->len >= sizeof(num)) return 0;
+            memcpy(num, node->as.text, node->len);
+            num[node->len] = '\0';
+            char *end;
+            double want = strtod(expected, &end);
+            return *expected && *end == '\0' && strtod(num, NULL) == want;
+        }
+        case JSON_TRUE:  return strcmp(expected, "true") == 0;
+        case JSON_FALSE: return strcmp(expected, "false") == 0;
+        case JSON_NULL:  return strcmp(expected, "null") == 0;
+        default:         return 0;
+    }
+}
+
+// Retorna 0 se o campo tem o valor esperado; senao descreve a falha
+static int check_json(const Target *t, HttpResponse *resp, char *detail, size_t size) {
+    const char *body = resp->body.size > 0 ? body_store_view(&resp->body) : NULL;
+    JsonDom *dom = body ? json_dom_new(NULL) : NULL;
+
+    if (!dom || json_dom_parse(dom, body, resp->body.size, JSON_DOM_NO_HASH) != 0 || !json_dom_root(dom)) {
+        snprintf(detail, size, "body is not JSON");
+        json_dom_free(dom);
+        return -1;
+    }
+
+    int rc = 0;
+    const JsonNode *node = json_path_find(json_dom_root(dom), t->json_path);
+    if (!node) {
+        snprintf(detail, size, "%s not found", t->json_path);
+        rc = -1;
+    } else if (!json_value_is(node, t->json_value)) {
+        if (node->type == JSON_OBJECT || node->type == JSON_ARRAY) {
+            snprintf(detail, size, "%s is an %s, expected %s", t->json_path,
+                     node->type == JSON_OBJECT ? "object" : "array", t->json_value);
+        } else {
+            const char *text = node->type == JSON_TRUE ? "true" : node->type == JSON_FALSE ? "false" :
+                               node->type == JSON_NULL ? "null" : node->as.text;
+            int len = node->type == JSON_STRING || node->type == JSON_NUMBER ? (int)node->len : (int)strlen(text);
+            snprintf(detail, size, "%s is %.*s, expected %s", t->json_path, len > 64 ? 64 : len, text,
+                     t->json_value);
+        }
+        rc = -1;
+    }
+
+    json_dom_free(dom);
+    return rc;
+}
+
+// Sondas ---------------------------------------------------------------------
+
+static int probe_start(HttpMulti *multi, Target *t, const MonitorOptions *opts) {
+    HttpRequest req = {
+        .url = t->url,
+        .method = t->method,
+        .headers = opts->headers,
+        .header_count = opts->header_count,
+        .verbose = opts->verbose,
+        .compressed = opts->compressed,
+        .timeout = t->timeout,
+        .error = t->error
+    };
+
+    t->error[0] = '\0';
+    if (http_multi_add(multi, &req, t) != 0) return -1;
+    t->in_flight = 1;
+    return 0;
+}
+
+static double phase(double end, double start) {
+    return end > start ? end - start : 0;
+}
+
+static void log_transition(const Target *t, int up, const char *detail) {
+    char when[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    printf("%s %s%s%s %s: %s\n", when, color_if(up ? BOLD_GREEN : BOLD_RED), up ? "UP  " : "DOWN",
+           color_if(RESET), t->name, detail);
+    fflush(stdout);
+}
+
+static void probe_done(Monitor *m, Target *t, HttpResponse *resp) {
+    ProbeResult result = PROBE_OK;
+    char detail[HTTP_ERROR_MAX + 128];
+
+    t->in_flight = 0;
+
+    if (!resp) {
+        result = PROBE_ERROR;
+        snprintf(detail, sizeof(detail), "%s", t->error[0] ? t->error : "request failed");
+    } else if (!status_ok(t, resp->status_code)) {
+        result = PROBE_STATUS;
+        snprintf(detail, sizeof(detail), "status %ld", resp->status_code);
+    } else if (t->budget > 0 && resp->timings.total > t->budget) {
+        result = PROBE_LATENCY;
+        snprintf(detail, sizeof(detail), "%.0f ms, over the %.0f ms budget",
+                 resp->timings.total * 1000, t->budget * 1000);
+    } else if (t->json_path && check_json(t, resp, detail, sizeof(detail)) != 0) {
+        result = PROBE_JSON;
+    } else {
+        snprintf(detail, sizeof(detail), "status %ld in %.0f ms", resp->status_code, resp->timings.total * 1000);
+    }
+
+    int up = result == PROBE_OK;
+    int changed = t->up != up;
+
+    pthread_mutex_lock(&m->lock);
+    t->results[result]++;
+    t->up = up;
+    t->last_probe = (double)time(NULL);
+    if (resp) {
+        const HttpTimings *tm = &resp->timings;
+        double handshake = tm->tls > 0 ? tm->tls : tm->connect;
+
+        t->status_code = resp->status_code;
+        t->connections += (unsigned long long)tm->new_connections;
+        t->count++;
+        t->sum += tm->total;
+        size_t b = 0;
+        while (b < BUCKET_COUNT && tm->total > buckets[b]) b++;
+        if (b < BUCKET_COUNT) t->bucket_counts[b]++;
+
+        t->phases[PHASE_RESOLVE] = tm->dns;
+        t->phases[PHASE_CONNECT] = phase(tm->connect, tm->dns);
+        t->phases[PHASE_TLS] = tm->tls > 0 ? phase(tm->tls, tm->connect) : 0;
+        t->phases[PHASE_PROCESSING] = phase(tm->first_byte, handshake);
+        t->phases[PHASE_TRANSFER] = phase(tm->total, tm->first_byte);
+    } else {
+        t->status_code = 0;
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    if (changed) log_transition(t, up, detail);
+    http_response_free(resp);
+}
+
+// Metricas -------------------------------------------------------------------
+
+static void metric_header(StrBuf *sb, const char *name, const char *type, const char *help) {
+    strbuf_printf(sb, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void render_metrics(Monitor *m, StrBuf *sb) {
+    pthread_mutex_lock(&m->lock);
+
+    metric_header(sb, "curlser_probe_duration_seconds", "histogram", "Total time of each probe, redirects included.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        unsigned long long cumulative = 0;
+        for (size_t b = 0; b < BUCKET_COUNT; b++) {
+            cumulative += t->bucket_counts[b];
+            strbuf_printf(sb, "curlser_probe_duration_seconds_bucket{target=\"%s\",le=\"%g\"} %llu\n",
+                          t->label, buckets[b], cumulative);
+        }
+        strbuf_printf(sb, "curlser_probe_duration_seconds_bucket{target=\"%s\",le=\"+Inf\"} %llu\n",
+                      t->label, t->count);
+        strbuf_printf(sb, "curlser_probe_duration_seconds_sum{target=\"%s\"} %.6f\n", t->label, t->sum);
+        strbuf_printf(sb, "curlser_probe_duration_seconds_count{target=\"%s\"} %llu\n", t->label, t->count);
+    }
+
+    metric_header(sb, "curlser_probe_phase_seconds", "gauge", "Duration of each phase of the last probe.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        if (t->count == 0) continue;
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            strbuf_printf(sb, "curlser_probe_phase_seconds{target=\"%s\",phase=\"%s\"} %.6f\n",
+                          t->label, phase_names[p], t->phases[p]);
+        }
+    }
+
+    metric_header(sb, "curlser_probes_total", "counter", "Probes by result: success or the failed check.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        for (int r = 0; r < PROBE_RESULTS; r++) {
+            strbuf_printf(sb, "curlser_probes_total{target=\"%s\",result=\"%s\"} %llu\n",
+                          t->label, result_names[r], t->results[r]);
+        }
+    }
+
+    metric_header(sb, "curlser_probe_success", "gauge", "Whether the last probe passed every check.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        if (t->up >= 0) strbuf_printf(sb, "curlser_probe_success{target=\"%s\"} %d\n", t->label, t->up);
+    }
+
+    metric_header(sb, "curlser_probe_status_code", "gauge", "HTTP status of the last probe (0 on error).");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        if (t->up >= 0) strbuf_printf(sb, "curlser_probe_status_code{target=\"%s\"} %ld\n", t->label, t->status_code);
+    }
+
+    metric_header(sb, "curlser_probe_connections_total", "counter",
+                  "Connections opened; stays flat while the connection is reused.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        strbuf_printf(sb, "curlser_probe_connections_total{target=\"%s\"} %llu\n", t->label, t->connections);
+    }
+
+    metric_header(sb, "curlser_probe_last_timestamp_seconds", "gauge", "Unix time of the last probe.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        if (t->up >= 0) {
+            strbuf_printf(sb, "curlser_probe_last_timestamp_seconds{target=\"%s\"} %.0f\n", t->label, t->last_probe);
+        }
+    }
+
+    pthread_mutex_unlock(&m->lock);
+
+    // Configuracao: nao muda, dispensa o lock
+    metric_header(sb, "curlser_probe_info", "gauge", "Probed URL and interval of each target.");
+    for (size_t i = 0; i < m->count; i++) {
+        const Target *t = &m->targets[i];
+        char *url = label_escape(t->url);
+        char *method = label_escape(t->method);
+        strbuf_printf(sb, "curlser_probe_info{target=\"%s\",url=\"%s\",method=\"%s\",interval=\"%g\"} 1\n",
+                      t->label, url ? url : "", method ? method : "", t->every);
+        free(url);
+        free(method);
+    }
+}
+
+static int path_is(const char *target, const char *path) {
+    size_t n = strlen(path);
+    return strncmp(target, path, n) == 0 && (target[n] == ' ' || target[n] == '?');
+}
+
+// Uma requisicao por conexao: o Prometheus abre uma a cada coleta
+static void metrics_serve(Monitor *m, int fd, char *buf) {
+    size_t len = 0;
+    buf[0] = '\0';
+    while (!strstr(buf, "\r\n\r\n")) {
+        if (len == METRICS_REQUEST_MAX) return;
+        ssize_t n = recv(fd, buf + len, METRICS_REQUEST_MAX - len, 0);
+        if (n <= 0) return;
+        len += (size_t)n;
+        buf[len] = '\0';
+    }
+
+    int head = strncmp(buf, "HEAD ", 5) == 0;
+    const char *target = strncmp(buf, "GET ", 4) == 0 ? buf + 4 : head ? buf + 5 : NULL;
+    const char *status = "200 OK";
+    const char *type = "text/plain; charset=utf-8";
+    StrBuf body = {0};
+
+    if (!target) {
+        status = "405 Method Not Allowed";
+        strbuf_puts(&body, "method not allowed\n");
+    } else if (path_is(target, "/metrics")) {
+        type = "text/plain; version=0.0.4; charset=utf-8";
+        render_metrics(m, &body);
+    } else if (path_is(target, "/")) {
+        strbuf_printf(&body, "curlser monitor: %zu targets, metrics at /metrics\n", m->count);
+    } else {
+        status = "404 Not Found";
+        strbuf_puts(&body, "not found\n");
+    }
+
+    StrBuf head_buf = {0};
+    strbuf_printf(&head_buf, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                  status, type, body.len);
+    if (head_buf.data && net_send_all(fd, head_buf.data, head_buf.len) == 0 && !head && body.data) {
+        net_send_all(fd, body.data, body.len);
+    }
+    strbuf_free(&head_buf);
+    strbuf_free(&body);
+}
+
+static void* metrics_thread(void *arg) {
+    Monitor *m = (Monitor *)arg;
+    char *buf = malloc(METRICS_REQUEST_MAX + 1);
+    if (!buf) return NULL;
+
+    for (;;) {
+        int fd = accept(m->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            fprintf(stderr, "%sError: accept: %s%s\n", color(RED), strerror(errno), color(RESET));
+            break;
+        }
+
+        // Um cliente lento nao segura as coletas seguintes
+        struct timeval tv = { 2, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        metrics_serve(m, fd, buf);
+        close(fd);
+    }
+
+    free(buf);
+    return NULL;
+}
+
+// Porta em uso vira erro antes de qualquer sonda
+static int metrics_listen(Monitor *m, int port) {
+    int one = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)port);
+    socklen_t addr_len = sizeof(addr);
+
+    m->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m->listen_fd < 0 ||
+        setsockopt(m->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(m->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(m->listen_fd, 16) != 0 ||
+        getsockname(m->listen_fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        fprintf(stderr, "%sError: cannot listen on 127.0.0.1:%d: %s%s\n",
+                color(RED), port, strerror(errno), color(RESET));
+        if (m->listen_fd >= 0) close(m->listen_fd);
+        m->listen_fd = -1;
+        return -1;
+    }
+    return ntohs(addr.sin_port);
+}
+
+// Laco principal ---------------------------------------------------------------
+
+int monitor_run(const MonitorOptions *opts) {
+    Monitor m;
+    memset(&m, 0, sizeof(m));
+    m.listen_fd = -1;
+    pthread_mutex_init(&m.lock, NULL);
+
+    int rc = -1;
+    HttpMulti *multi = NULL;
+
+    if (load_targets(&m, opts->path) != 0) goto done;
+
+    int port = -1;
+    if (opts->metrics_port >= 0) {
+        pthread_t thread;
+        if ((port = metrics_listen(&m, opts->metrics_port)) < 0) goto done;
+        if (pthread_create(&thread, NULL, metrics_thread, &m) != 0) {
+            fprintf(stderr, "%sError: cannot start the metrics thread%s\n", color(RED), color(RESET));
+            goto done;
+        }
+        pthread_detach(thread);
+    }
+
+    multi = http_multi_new(NULL);
+    if (!multi) {
+        fprintf(stderr, "%sError: out of memory%s\n", color(RED), color(RESET));
+        goto done;
+    }
+    // Uma conexao por alvo fica aberta entre as sondas
+    http_multi_keep_connections(multi, (long)m.count);
+
+    if (port >= 0) {
+        printf("monitoring %zu targets, metrics at http://127.0.0.1:%d/metrics\n", m.count, port);
+    } else {
+        printf("monitoring %zu targets\n", m.count);
+    }
+    fflush(stdout);
+
+    // A primeira rodada e espalhada para nao abrir tudo de uma vez
+    double start = now_monotonic();
+    for (size_t i = 0; i < m.count; i++) {
+        Target *t = &m.targets[i];
+        double spread = t->every < MONITOR_MAX_SPREAD ? t->every : MONITOR_MAX_SPREAD;
+        t->next_due = start + spread * (double)i / (double)m.count;
+    }
+
+    for (;;) {
+        double now = now_monotonic();
+        double wake = now + 1.0;
+
+        for (size_t i = 0; i < m.count; i++) {
+            Target *t = &m.targets[i];
+            if (t->in_flight) continue;
+
+            if (t->next_due <= now) {
+                if (probe_start(multi, t, opts) != 0) {
+                    fprintf(stderr, "%sError: cannot start a probe for %s%s\n",
+                            color(RED), t->name, color(RESET));
+                }
+                // Sonda que demorou mais que o intervalo: as rodadas perdidas
+                // sao puladas, sem rajada para recuperar
+                t->next_due += t->every;
+                if (t->next_due <= now) t->next_due = now + t->every;
+                continue;
+            }
+            if (t->next_due < wake) wake = t->next_due;
+        }
+
+        int timeout_ms = (int)((wake - now) * 1000) + 1;
+        HttpResponse *resp;
+        void *tag;
+        int got = http_multi_poll(multi, &resp, &tag, timeout_ms);
+        while (got == 1) {
+            probe_done(&m, (Target *)tag, resp);
+            got = http_multi_poll(multi, &resp, &tag, 0);
+        }
+        if (got < 0) {
+            fprintf(stderr, "%sError: HTTP transfer loop failed%s\n", color(RED), color(RESET));
+            break;
+        }
+    }
+
+done:
+    http_multi_free(multi);
+    if (m.listen_fd >= 0) close(m.listen_fd);
+    for (size_t i = 0; i < m.count; i++) target_free(&m.targets[i]);
+    free(m.targets);
+    return rc;
+}
+
+#else
+
+int monitor_run(const MonitorOptions *opts) {
+    (void)opts;
+    fprintf(stderr, "%sError: --monitor is not supported on this platform%s\n", color(RED), color(RESET));
+    return -1;
+}
+
+#endif // _WIN32
@@ -0,0 +1,30 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+// Modo monitor (--monitor): sonda periodicamente os alvos de um arquivo
+// num unico multi handle (as conexoes ficam abertas entre as sondas), confere
+// as assercoes de cada alvo e publica as metricas no formato texto do
+// Prometheus em http://127.0.0.1:PORT/metrics.
+//
+// Cada linha do arquivo e um alvo; '#' comeca um comentario:
+//
+//   URL [name=NOME] [every=30s] [timeout=10s] [method=GET]
+//       [status=2xx,304] [budget=500ms] [json=$.caminho==valor]
+
+#define MONITOR_DEFAULT_EVERY   30.0    // segundos entre sondas
+#define MONITOR_DEFAULT_TIMEOUT 10.0
+#define MONITOR_MAX_TARGETS     4096
+
+typedef struct {
+    const char *path;               // arquivo de alvos
+    int metrics_port;               // < 0 = sem endpoint, 0 = porta livre
+    const char **headers;           // -H, enviados em todas as sondas
+    int header_count;
+    int compressed;
+    int verbose;
+} MonitorOptions;
+
+// So retorna em erro (arquivo invalido, porta ocupada)
+int monitor_run(const MonitorOptions *opts);
+
+#endif // MONITOR_H
@@ -0,0 +1,17 @@
+#ifndef NET_H
+#define NET_H
+
+#include <stddef.h>
+
+// Escrita completa em sockets, arquivos e pipes
+
+#ifndef _WIN32
+// Envia o bloco inteiro, repetindo apos escritas parciais e EINTR; sem
+// SIGPIPE se o cliente fechou. Retorna 0 ou -1.
+int net_send_all(int fd, const char *data, size_t len);
+
+// O mesmo com write(), para arquivos e pipes
+int net_write_all(int fd, const void *data, size_t len);
+#endif
+
+#endif // NET_H
@@ -0,0 +1,151 @@
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <signal.h>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/stat.h>
+#endif
+
+int colors_enabled = 1;
+OutputState out_state;
+
+static int stdout_is_pipe = 0;
+static StrBuf *capture = NULL;
+
+void out_init(void) {
+    // Nosso buffer ja agrupa as escritas; evita uma segunda copia no stdio
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+#ifndef _WIN32
+    // Com SIGPIPE ignorado, escrever num pipe fechado retorna EPIPE e
+    // conseguimos abortar a transferencia em vez de morrer no meio dela
+    signal(SIGPIPE, SIG_IGN);
+
+    struct stat st;
+    if (fstat(STDOUT_FILENO, &st) == 0) {
+        stdout_is_pipe = S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode);
+    }
+#endif
+}
+
+void out_set_limits(long max_lines, long long max_bytes, long max_items) {
+    out_state.max_lines = max_lines;
+    out_state.max_bytes = max_bytes;
+    out_state.max_items = max_items;
+    out_state.base_lines = out_state.lines;
+    out_state.base_bytes = out_bytes();
+}
+
+void out_flush(void) {
+    if (out_state.len == 0) return;
+
+    if (capture) {
+        if (strbuf_append(capture, out_state.buf, out_state.len) != 0) {
+            out_state.broken = 1;
+        }
+    } else if (!out_state.broken) {
+        size_t written = fwrite(out_state.buf, 1, out_state.len, stdout);
+        if (written < out_state.len) {
+            out_state.broken = 1;
+        }
+    }
+
+    out_state.flushed += out_state.len;
+    out_state.len = 0;
+}
+
+void out_capture(StrBuf *sb) {
+    out_flush();
+    capture = sb;
+}
+
+void out_write(const char *s, size_t n) {
+    // Conta as quebras de linha do bloco inteiro de uma vez
+    const char *nl = s;
+    const char *end = s + n;
+    while ((nl = memchr(nl, '\n', end - nl)) != NULL) {
+        out_state.lines++;
+        nl++;
+    }
+
+    while (n > 0) {
+        if (out_state.len == OUT_BUFFER_SIZE) out_flush();
+
+        size_t room = OUT_BUFFER_SIZE - out_state.len;
+        size_t chunk = n < room ? n : room;
+        memcpy(out_state.buf + out_state.len, s, chunk);
+        out_state.len += chunk;
+        s += chunk;
+        n -= chunk;
+    }
+}
+
+void out_printf(const char *fmt, ...) {
+    char tmp[1024];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+
+    if (n < 0) return;
+    if ((size_t)n < sizeof(tmp)) {
+        out_write(tmp, (size_t)n);
+        return;
+    }
+
+    // Nao coube (URL ou caminho longo): formata de novo no tamanho certo
+    char *big = malloc((size_t)n + 1);
+    if (!big) return;
+    va_start(ap, fmt);
+    vsnprintf(big, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    out_write(big, (size_t)n);
+    free(big);
+}
+
+size_t out_fit(const char *s, size_t n) {
+    size_t fit = n;
+
+    if (out_state.max_bytes > 0) {
+        long long left = out_state.max_bytes - (out_bytes() - out_state.base_bytes);
+        if (left <= 0) return 0;
+        if ((long long)fit > left) fit = (size_t)left;
+    }
+
+    if (out_state.max_lines > 0) {
+        long left = out_state.max_lines - (out_state.lines - out_state.base_lines);
+        if (left <= 0) return 0;
+
+        // Inclui a quebra de linha que completa a ultima linha permitida
+        const char *p = s;
+        const char *end = s + fit;
+        while (left > 0 && (p = memchr(p, '\n', end - p)) != NULL) {
+            p++;
+            if (--left == 0) fit = p - s;
+        }
+    }
+
+    return fit;
+}
+
+int out_check_closed(void) {
+#ifndef _WIN32
+    if (!out_state.broken && stdout_is_pipe) {
+        struct pollfd pfd = { .fd = STDOUT_FILENO, .events = POLLOUT };
+        if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLHUP))) {
+            out_state.broken = 1;
+        }
+    }
+#endif
+    return out_state.broken;
+}
+
+void out_elision(void) {
+    out_color(DIM);
+    out_puts("...");
+    out_color(RESET);
+}
@@ -0,0 +1,100 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <string.h>
+#include "colors.h"
+#include "strbuf.h"
+#include "stats.h"
+
+// Camada de saida: toda a impressao em stdout passa por aqui para que
+// possamos contar linhas/bytes, aplicar os limites de --max-lines,
+// --max-bytes e --max-items e detectar stdout fechado (ex: `| head`)
+
+#define OUT_BUFFER_SIZE 65536
+
+typedef struct {
+    char buf[OUT_BUFFER_SIZE];
+    size_t len;
+    long long flushed;      // bytes ja enviados para stdout
+    long lines;             // quebras de linha emitidas
+    long max_lines;         // 0 = sem limite
+    long long max_bytes;    // 0 = sem limite
+    long max_items;         // 0 = sem limite
+    long base_lines;        // contadores no momento em que os limites foram armados
+    long long base_bytes;
+    int broken;             // stdout fechado ou erro de escrita
+} OutputState;
+
+extern OutputState out_state;
+
+// Prepara stdout (sem buffer do stdio, SIGPIPE ignorado)
+void out_init(void);
+
+// Arma os limites a partir da posicao atual da saida
+void out_set_limits(long max_lines, long long max_bytes, long max_items);
+
+// Envia o buffer para stdout
+void out_flush(void);
+
+// Desvia a saida para sb em vez de stdout (quadros do --watch); NULL volta
+// para stdout. O buffer pendente e enviado ao destino anterior.
+void out_capture(StrBuf *sb);
+
+// Escreve um bloco de bytes
+void out_write(const char *s, size_t n);
+
+// Escreve uma string formatada
+void out_printf(const char *fmt, ...);
+
+// Quantos bytes de s cabem antes de atingir o limite de linhas/bytes
+size_t out_fit(const char *s, size_t n);
+
+// Verifica se o leitor do pipe em stdout ja foi embora
+int out_check_closed(void);
+
+// Marcador de elisao impresso quando a saida e truncada
+void out_elision(void);
+
+static inline void out_putc(char c) {
+    if (out_state.len == OUT_BUFFER_SIZE) out_flush();
+    out_state.buf[out_state.len++] = c;
+    if (c == '\n') out_state.lines++;
+}
+
+static inline void out_puts(const char *s) {
+    out_write(s, strlen(s));
+}
+
+static inline void out_color(const char *c) {
+    if (colors_enabled) {
+        STATS_ADD(color_escapes, 1);
+        out_puts(c);
+    }
+}
+
+static inline void out_indent(int level) {
+    for (int i = 0; i < level * 2; i++) out_putc(' ');
+}
+
+static inline long long out_bytes(void) {
+    return out_state.flushed + (long long)out_state.len;
+}
+
+static inline long out_max_items(void) {
+    return out_state.max_items;
+}
+
+// Limite de linhas ou bytes atingido
+static inline int out_limit_reached(void) {
+    if (out_state.max_lines > 0 && out_state.lines - out_state.base_lines >= out_state.max_lines) return 1;
+    if (out_state.max_bytes > 0 && out_bytes() - out_state.base_bytes >= out_state.max_bytes) return 1;
+    return 0;
+}
+
+// Nada mais sera exibido: limite atingido ou stdout fechado
+static inline int out_stopped(void) {
+    return out_state.broken || out_limit_reached();
+}
+
+#endif // OUTPUT_H
@@ -0,0 +1,67 @@
+#include "pipeline.h"
+#include "ring.h"
+#include "output.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+struct Pipeline {
+    Ring ring;
+    Formatter *formatter;
+    pthread_t thread;
+};
+
+static void* pipeline_consumer(void *arg) {
+    Pipeline *p = (Pipeline *)arg;
+    const char *data;
+    size_t len;
+
+    while ((len = ring_read_begin(&p->ring, &data)) > 0) {
+        int stop = formatter_feed(p->formatter, data, len);
+        ring_read_end(&p->ring, len);
+        out_flush();
+
+        if (stop || out_check_closed()) {
+            // Faz a thread de rede abortar a transferencia
+            ring_cancel(&p->ring);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+Pipeline* pipeline_start(Formatter *formatter, size_t capacity) {
+    Pipeline *p = calloc(1, sizeof(Pipeline));
+    if (!p) return NULL;
+
+    if (ring_init(&p->ring, capacity ? capacity : PIPELINE_RING_SIZE) != 0) {
+        free(p);
+        return NULL;
+    }
+    p->formatter = formatter;
+
+    if (pthread_create(&p->thread, NULL, pipeline_consumer, p) != 0) {
+        fprintf(stderr, "Error: failed to start formatting thread\n");
+        ring_free(&p->ring);
+        free(p);
+        return NULL;
+    }
+
+    return p;
+}
+
+int pipeline_push(Pipeline *p, const char *data, size_t len) {
+    STATS_ADD(ring_bytes_copied, len);
+    return ring_write(&p->ring, data, len) != 0;
+}
+
+void pipeline_finish(Pipeline *p) {
+    if (!p) return;
+
+    ring_close(&p->ring);
+    pthread_join(p->thread, NULL);
+    ring_free(&p->ring);
+    free(p);
+}
@@ -0,0 +1,26 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include "formatters/formatters.h"
+
+// Capacidade padrao do buffer entre a rede e o formatador
+#define PIPELINE_RING_SIZE (4 * 1024 * 1024)
+
+// Formatacao em uma thread separada: a thread de rede so copia os blocos
+// recebidos para um buffer circular e volta para o socket, enquanto a
+// thread de formatacao consome o buffer e escreve em stdout.
+typedef struct Pipeline Pipeline;
+
+// Inicia a thread de formatacao para o formatador dado
+Pipeline* pipeline_start(Formatter *formatter, size_t capacity);
+
+// Entrega um bloco (espera se o buffer estiver cheio).
+// Retorna != 0 quando o formatador nao precisa de mais dados.
+int pipeline_push(Pipeline *p, const char *data, size_t len);
+
+// Sinaliza o fim do body, espera a thread de formatacao e libera o pipeline.
+// O formatador continua aberto e deve ser finalizado pelo chamador.
+void pipeline_finish(Pipeline *p);
+
+#endif // PIPELINE_H
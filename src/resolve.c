@@ -0,0 +1,136 @@
+#include "resolve.h"
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#endif
+
+typedef struct {
+    ResolveEntry *entries;
+    size_t count;
+    size_t next;            // proxima entrada livre, protegida por lock
+    pthread_mutex_t lock;
+} ResolveQueue;
+
+int resolve_is_literal(const char *host) {
+#ifndef _WIN32
+    unsigned char addr[16];
+    return inet_pton(AF_INET, host, addr) == 1 || inet_pton(AF_INET6, host, addr) == 1;
+#else
+    (void)host;
+    return 0;
+#endif
+}
+
+#ifndef _WIN32
+// Junta os enderecos distintos no formato do CURLOPT_RESOLVE
+static char* format_addresses(const struct addrinfo *list) {
+    StrBuf sb = {0};
+
+    for (const struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+        char ip[INET6_ADDRSTRLEN];
+        const void *src;
+        if (ai->ai_family == AF_INET) {
+            src = &((const struct sockaddr_in *)ai->ai_addr)->sin_addr;
+        } else if (ai->ai_family == AF_INET6) {
+            src = &((const struct sockaddr_in6 *)ai->ai_addr)->sin6_addr;
+        } else {
+            continue;
+        }
+        if (!inet_ntop(ai->ai_family, src, ip, sizeof(ip))) continue;
+
+        char item[INET6_ADDRSTRLEN + 2];
+        snprintf(item, sizeof(item), ai->ai_family == AF_INET6 ? "[%s]" : "%s", ip);
+
+        // getaddrinfo repete o endereco para cada tipo de socket
+        size_t n = strlen(item);
+        const char *dup = sb.data;
+        int seen = 0;
+        while (dup && (dup = strstr(dup, item)) != NULL) {
+            if ((dup == sb.data || dup[-1] == ',') && (dup[n] == ',' || dup[n] == '\0')) {
+                seen = 1;
+                break;
+            }
+            dup += n;
+        }
+        if (seen) continue;
+
+        if (sb.len) strbuf_putc(&sb, ',');
+        strbuf_append(&sb, item, n);
+    }
+
+    return sb.data;
+}
+#endif
+
+static void resolve_one(ResolveEntry *e) {
+#ifndef _WIN32
+    struct addrinfo hints, *list = NULL;
+    char port[16];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;
+    snprintf(port, sizeof(port), "%d", e->port);
+
+    if (getaddrinfo(e->host, port, &hints, &list) == 0) {
+        e->addresses = format_addresses(list);
+        freeaddrinfo(list);
+    }
+#else
+    (void)e;
+#endif
+}
+
+static void* resolve_worker(void *arg) {
+    ResolveQueue *q = (ResolveQueue *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        size_t i = q->next++;
+        pthread_mutex_unlock(&q->lock);
+
+        if (i >= q->count) break;
+        resolve_one(&q->entries[i]);
+    }
+    return NULL;
+}
+
+void resolve_all(ResolveEntry *entries, size_t count, int max_threads) {
+    if (count == 0) return;
+    if (max_threads <= 0) max_threads = RESOLVE_MAX_THREADS;
+
+    // Um host so: resolve aqui mesmo, sem criar threads
+    if (count == 1) {
+        resolve_one(&entries[0]);
+        return;
+    }
+
+    ResolveQueue q = { .entries = entries, .count = count };
+    pthread_mutex_init(&q.lock, NULL);
+
+    size_t nthreads = count < (size_t)max_threads ? count : (size_t)max_threads;
+    pthread_t threads[RESOLVE_MAX_THREADS];
+    size_t started = 0;
+
+    if (nthreads > RESOLVE_MAX_THREADS) nthreads = RESOLVE_MAX_THREADS;
+    while (started < nthreads && pthread_create(&threads[started], NULL, resolve_worker, &q) == 0) {
+        started++;
+    }
+
+    // Sem threads (ou o que sobrou) e resolvido nesta thread
+    resolve_worker(&q);
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&q.lock);
+}
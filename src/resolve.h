@@ -0,0 +1,24 @@
+#ifndef RESOLVE_H
+#define RESOLVE_H
+
+#include <stddef.h>
+
+// Resolucao de nomes em paralelo, antes das requisicoes: cada host e
+// resolvido uma unica vez por uma pequena pool de threads (getaddrinfo e
+// bloqueante), e o resultado vai para o cache de DNS do libcurl.
+
+#define RESOLVE_MAX_THREADS 16
+
+typedef struct {
+    char *host;             // nome, sem colchetes
+    int port;
+    char *addresses;        // "1.2.3.4,[2001:db8::1]" (formato do CURLOPT_RESOLVE), ou NULL se falhou
+} ResolveEntry;
+
+// Resolve todas as entradas usando ate max_threads threads (0 = padrao)
+void resolve_all(ResolveEntry *entries, size_t count, int max_threads);
+
+// Host que ja e um endereco IP e nao precisa de DNS
+int resolve_is_literal(const char *host);
+
+#endif // RESOLVE_H
@@ -0,0 +1,130 @@
+#include "ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Tentativas antes de dormir na condition variable
+#define RING_SPINS 64
+
+#define LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+int ring_init(Ring *r, size_t cap) {
+    memset(r, 0, sizeof(*r));
+
+    size_t size = 4096;
+    while (size < cap) size *= 2;
+
+    r->buf = malloc(size);
+    if (!r->buf) return -1;
+    r->cap = size;
+
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    return 0;
+}
+
+// Acorda o outro lado se ele estiver dormindo
+static void ring_wake(Ring *r) {
+    // A atualizacao do indice precisa ser visivel antes de lermos waiters
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->waiters, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&r->lock);
+        pthread_cond_broadcast(&r->cond);
+        pthread_mutex_unlock(&r->lock);
+    }
+}
+
+static int producer_ready(Ring *r) {
+    return r->cap - (__atomic_load_n(&r->head, __ATOMIC_RELAXED) - LOAD(&r->tail)) > 0 ||
+           LOAD(&r->cancelled);
+}
+
+static int consumer_ready(Ring *r) {
+    return LOAD(&r->head) != __atomic_load_n(&r->tail, __ATOMIC_RELAXED) || LOAD(&r->closed);
+}
+
+static void ring_wait(Ring *r, int (*ready)(Ring *)) {
+    for (int i = 0; i < RING_SPINS; i++) {
+        if (ready(r)) return;
+    }
+
+    __atomic_add_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&r->lock);
+    while (!ready(r)) {
+        pthread_cond_wait(&r->cond, &r->lock);
+    }
+    pthread_mutex_unlock(&r->lock);
+    __atomic_sub_fetch(&r->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+int ring_write(Ring *r, const char *data, size_t len) {
+    while (len > 0) {
+        if (LOAD(&r->cancelled)) return -1;
+
+        size_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        size_t space = r->cap - (head - LOAD(&r->tail));
+        if (space == 0) {
+            // Buffer cheio: o formatador esta atrasado, segura a rede
+            ring_wait(r, producer_ready);
+            continue;
+        }
+
+        size_t off = head & (r->cap - 1);
+        size_t n = len;
+        if (n > space) n = space;
+        if (n > r->cap - off) n = r->cap - off;
+
+        memcpy(r->buf + off, data, n);
+        STORE(&r->head, head + n);
+        ring_wake(r);
+
+        data += n;
+        len -= n;
+    }
+
+    return LOAD(&r->cancelled) ? -1 : 0;
+}
+
+void ring_close(Ring *r) {
+    STORE(&r->closed, 1);
+    ring_wake(r);
+}
+
+size_t ring_read_begin(Ring *r, const char **data) {
+    for (;;) {
+        size_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+        size_t head = LOAD(&r->head);
+
+        if (head != tail) {
+            size_t off = tail & (r->cap - 1);
+            size_t n = head - tail;
+            if (n > r->cap - off) n = r->cap - off;
+            *data = r->buf + off;
+            return n;
+        }
+
+        // closed e publicado depois da ultima escrita
+        if (LOAD(&r->closed) && LOAD(&r->head) == tail) {
+            return 0;
+        }
+
+        ring_wait(r, consumer_ready);
+    }
+}
+
+void ring_read_end(Ring *r, size_t n) {
+    STORE(&r->tail, __atomic_load_n(&r->tail, __ATOMIC_RELAXED) + n);
+    ring_wake(r);
+}
+
+void ring_cancel(Ring *r) {
+    STORE(&r->cancelled, 1);
+    ring_wake(r);
+}
+
+void ring_free(Ring *r) {
+    free(r->buf);
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->cond);
+    r->buf = NULL;
+}
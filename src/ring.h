@@ -0,0 +1,45 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// Buffer circular de bytes para um produtor e um consumidor (SPSC).
+// As posicoes de leitura e escrita sao atomicas, sem lock no caminho
+// normal; mutex/cond so entram em cena quando um dos lados precisa
+// dormir (buffer cheio ou vazio).
+typedef struct {
+    char *buf;
+    size_t cap;             // potencia de 2
+    size_t head;            // total escrito (produtor)
+    size_t tail;            // total lido (consumidor)
+    int closed;             // produtor terminou
+    int cancelled;          // consumidor desistiu
+    int waiters;            // threads dormindo em cond
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} Ring;
+
+// Cria o buffer; cap e arredondado para potencia de 2. Retorna 0 ou -1.
+int ring_init(Ring *r, size_t cap);
+
+// Produtor: copia todo o bloco, esperando enquanto o buffer estiver cheio.
+// Retorna -1 se o consumidor cancelou.
+int ring_write(Ring *r, const char *data, size_t len);
+
+// Produtor: nao ha mais dados
+void ring_close(Ring *r);
+
+// Consumidor: espera dados e devolve o trecho contiguo disponivel.
+// Retorna 0 quando o produtor fechou e tudo ja foi lido.
+size_t ring_read_begin(Ring *r, const char **data);
+
+// Consumidor: libera os n bytes lidos
+void ring_read_end(Ring *r, size_t n);
+
+// Consumidor: para de ler; o produtor recebe -1 na proxima escrita
+void ring_cancel(Ring *r);
+
+void ring_free(Ring *r);
+
+#endif // RING_H
@@ -0,0 +1,112 @@
+#include "stats.h"
+
+#if CURLSER_STATS
+
+#include "output.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+Stats stats;
+
+long long stats_thread_cpu_ns(void) {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+#endif
+    return 0;
+}
+
+void stats_formatter_bytes(const char *name, unsigned long long bytes) {
+    int i;
+    for (i = 0; i < stats.formatter_count; i++) {
+        if (strcmp(stats.formatters[i].name, name) == 0) break;
+    }
+    if (i == stats.formatter_count) {
+        if (i == STATS_MAX_FORMATTERS) return;
+        stats.formatters[i].name = name;
+        stats.formatter_count++;
+    }
+    stats.formatters[i].bytes += bytes;
+}
+
+void stats_print(int json) {
+    double cpu = 0;
+    long max_rss_kb = 0;
+
+#ifndef _WIN32
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+              ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+        max_rss_kb = ru.ru_maxrss;
+    }
+#endif
+
+    double format_cpu = stats.format_cpu_ns / 1e9;
+    double transfer_cpu = cpu > format_cpu ? cpu - format_cpu : 0;
+
+    out_flush();
+
+    if (json) {
+        fprintf(stderr, "{\"requests\":%llu,"
+                        "\"headers\":{\"peak_bytes\":%llu,\"reallocs\":%llu,\"bytes_copied\":%llu},"
+                        "\"body\":{\"peak_bytes\":%llu,\"reallocs\":%llu,\"bytes_copied\":%llu,"
+                        "\"spilled_bytes\":%llu,\"streamed_bytes\":%llu,\"ring_bytes_copied\":%llu},"
+                        "\"time\":{\"first_byte_s\":%.6f,\"transfer_s\":%.6f,"
+                        "\"cpu_s\":%.6f,\"transfer_cpu_s\":%.6f,\"format_cpu_s\":%.6f},"
+                        "\"peak_rss_kb\":%ld,\"output_bytes\":%lld,\"color_escapes\":%llu,",
+                stats.requests, stats.header_peak, stats.header_reallocs, stats.header_bytes_copied,
+                stats.body_peak, stats.body_reallocs, stats.body_bytes_copied,
+                stats.body_spilled, stats.body_streamed, stats.ring_bytes_copied,
+                stats.first_byte_time, stats.transfer_time, cpu, transfer_cpu, format_cpu,
+                max_rss_kb, out_bytes(), stats.color_escapes);
+        if (stats.tree_bytes) {
+            fprintf(stderr, "\"json_tree\":{\"parsed_bytes\":%llu,\"nodes\":%llu,\"arena_bytes\":%llu,"
+                            "\"allocs\":%llu,\"parse_cpu_s\":%.6f},",
+                    stats.tree_bytes, stats.tree_nodes, stats.tree_arena_bytes, stats.tree_allocs,
+                    stats.tree_parse_ns / 1e9);
+        }
+        fprintf(stderr, "\"formatters\":{");
+        for (int i = 0; i < stats.formatter_count; i++) {
+            fprintf(stderr, "%s\"%s\":%llu", i ? "," : "", stats.formatters[i].name, stats.formatters[i].bytes);
+        }
+        fprintf(stderr, "}}\n");
+        return;
+    }
+
+    fprintf(stderr, "\n--- stats ---\n");
+    fprintf(stderr, "requests          %llu\n", stats.requests);
+    fprintf(stderr, "headers           %llu B peak, %llu reallocs, %llu B copied\n",
+            stats.header_peak, stats.header_reallocs, stats.header_bytes_copied);
+    fprintf(stderr, "body buffer       %llu B peak, %llu reallocs, %llu B copied\n",
+            stats.body_peak, stats.body_reallocs, stats.body_bytes_copied);
+    fprintf(stderr, "body on disk      %llu B\n", stats.body_spilled);
+    fprintf(stderr, "body streamed     %llu B (no copy)\n", stats.body_streamed);
+    if (stats.ring_bytes_copied) {
+        fprintf(stderr, "pipeline ring     %llu B copied\n", stats.ring_bytes_copied);
+    }
+    fprintf(stderr, "first byte        %.3f ms\n", stats.first_byte_time * 1000);
+    fprintf(stderr, "transfer          %.3f ms\n", stats.transfer_time * 1000);
+    fprintf(stderr, "cpu               %.3f ms (transfer %.3f ms, formatting %.3f ms)\n",
+            cpu * 1000, transfer_cpu * 1000, format_cpu * 1000);
+    fprintf(stderr, "peak rss          %ld KiB\n", max_rss_kb);
+    fprintf(stderr, "output            %lld B, %llu color escapes\n", out_bytes(), stats.color_escapes);
+    if (stats.tree_bytes) {
+        double parse = stats.tree_parse_ns / 1e9;
+        fprintf(stderr, "json tree         %llu B in %.3f ms (%.0f MB/s), %llu nodes, %llu B arena, %llu allocs\n",
+                stats.tree_bytes, parse * 1000, parse > 0 ? stats.tree_bytes / parse / 1e6 : 0,
+                stats.tree_nodes, stats.tree_arena_bytes, stats.tree_allocs);
+    }
+    for (int i = 0; i < stats.formatter_count; i++) {
+        fprintf(stderr, "  %-15s %llu B\n", stats.formatters[i].name, stats.formatters[i].bytes);
+    }
+}
+
+#endif // CURLSER_STATS
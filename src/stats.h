@@ -0,0 +1,81 @@
+#ifndef STATS_H
+#define STATS_H
+
+// Contadores do --stats. Com CURLSER_STATS=0 (make STATS=0) todas as macros
+// viram nada e o caminho quente fica igual ao de um build sem estatisticas.
+
+#ifndef CURLSER_STATS
+#define CURLSER_STATS 1
+#endif
+
+#if CURLSER_STATS
+
+#define STATS_MAX_FORMATTERS 8
+
+typedef struct {
+    int enabled;                            // --stats na linha de comando
+
+    // Recepcao (callbacks do libcurl)
+    unsigned long long requests;
+    unsigned long long header_reallocs;
+    unsigned long long header_bytes_copied;
+    unsigned long long header_peak;
+    unsigned long long body_reallocs;
+    unsigned long long body_bytes_copied;   // memcpy para o buffer em memoria
+    unsigned long long body_peak;           // maior capacidade do buffer do body
+    unsigned long long body_spilled;        // bytes escritos no arquivo temporario
+    unsigned long long body_streamed;       // bytes entregues sem copia (streaming)
+    unsigned long long ring_bytes_copied;   // copias para o ring do --pipeline
+
+    // Tempos informados pelo libcurl (segundos, ultima requisicao)
+    double first_byte_time;
+    double transfer_time;
+
+    // Formatacao
+    long long format_cpu_ns;                // CPU dentro dos formatadores
+    unsigned long long color_escapes;
+
+    // Arvore JSON (--sort-keys, --compact, --canonical)
+    unsigned long long tree_bytes;          // bytes parseados
+    unsigned long long tree_nodes;
+    unsigned long long tree_arena_bytes;
+    unsigned long long tree_allocs;
+    long long tree_parse_ns;                // CPU do parse e da ordenacao
+    struct {
+        const char *name;
+        unsigned long long bytes;
+    } formatters[STATS_MAX_FORMATTERS];
+    int formatter_count;
+} Stats;
+
+extern Stats stats;
+
+#define STATS_ADD(field, n)     do { stats.field += (n); } while (0)
+#define STATS_PEAK(field, v)    do { if ((unsigned long long)(v) > stats.field) stats.field = (v); } while (0)
+#define STATS_SET(field, v)     do { stats.field = (v); } while (0)
+
+// Soma a CPU da thread atual gasta entre BEGIN e END em stats.field
+#define STATS_CPU_BEGIN(var)    long long var = stats.enabled ? stats_thread_cpu_ns() : 0
+#define STATS_CPU_END(var, field) \
+    do { if (stats.enabled) stats.field += stats_thread_cpu_ns() - (var); } while (0)
+
+long long stats_thread_cpu_ns(void);
+
+// Acumula os bytes de saida de um formatador
+void stats_formatter_bytes(const char *name, unsigned long long bytes);
+
+// Imprime em stderr (texto ou JSON)
+void stats_print(int json);
+
+#else
+
+#define STATS_ADD(field, n)         do { } while (0)
+#define STATS_PEAK(field, v)        do { } while (0)
+#define STATS_SET(field, v)         do { } while (0)
+#define STATS_CPU_BEGIN(var)        do { } while (0)
+#define STATS_CPU_END(var, field)   do { } while (0)
+#define stats_formatter_bytes(name, bytes)  do { } while (0)
+
+#endif // CURLSER_STATS
+
+#endif // STATS_H
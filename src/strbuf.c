@@ -0,0 +1,83 @@
+#include "strbuf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+static int strbuf_reserve(StrBuf *sb, size_t extra) {
+    if (sb->len + extra + 1 <= sb->cap) return 0;
+
+    size_t cap = sb->cap ? sb->cap : 256;
+    while (cap < sb->len + extra + 1) cap *= 2;
+
+    char *ptr = realloc(sb->data, cap);
+    if (!ptr) return -1;
+    sb->data = ptr;
+    sb->cap = cap;
+    return 0;
+}
+
+int strbuf_append(StrBuf *sb, const char *s, size_t n) {
+    if (strbuf_reserve(sb, n) != 0) return -1;
+    memcpy(sb->data + sb->len, s, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+    return 0;
+}
+
+int strbuf_puts(StrBuf *sb, const char *s) {
+    return strbuf_append(sb, s, strlen(s));
+}
+
+int strbuf_putc(StrBuf *sb, char c) {
+    return strbuf_append(sb, &c, 1);
+}
+
+int strbuf_printf(StrBuf *sb, const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (n < 0 || strbuf_reserve(sb, (size_t)n) != 0) return -1;
+
+    va_start(ap, fmt);
+    vsnprintf(sb->data + sb->len, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+
+    sb->len += (size_t)n;
+    return 0;
+}
+
+int strbuf_json_string(StrBuf *sb, const char *s, size_t n) {
+    if (strbuf_putc(sb, '"') != 0) return -1;
+
+    for (size_t i = 0; i < n; i++) {
+        unsigned char c = (unsigned char)s[i];
+        switch (c) {
+            case '"':  strbuf_puts(sb, "\\\""); break;
+            case '\\': strbuf_puts(sb, "\\\\"); break;
+            case '\n': strbuf_puts(sb, "\\n"); break;
+            case '\r': strbuf_puts(sb, "\\r"); break;
+            case '\t': strbuf_puts(sb, "\\t"); break;
+            default:
+                if (c < 0x20) strbuf_printf(sb, "\\u%04x", c);
+                else strbuf_putc(sb, (char)c);
+                break;
+        }
+    }
+
+    return strbuf_putc(sb, '"');
+}
+
+void strbuf_reset(StrBuf *sb) {
+    sb->len = 0;
+    if (sb->data) sb->data[0] = '\0';
+}
+
+void strbuf_free(StrBuf *sb) {
+    free(sb->data);
+    sb->data = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef STRBUF_H
+#define STRBUF_H
+
+#include <stddef.h>
+
+// String dinamica simples para montar saidas antes de imprimir
+typedef struct {
+    char *data;     // sempre terminada em '\0' quando nao NULL
+    size_t len;
+    size_t cap;
+} StrBuf;
+
+// Acrescenta n bytes; retorna 0 ou -1 sem memoria
+int strbuf_append(StrBuf *sb, const char *s, size_t n);
+
+int strbuf_puts(StrBuf *sb, const char *s);
+
+int strbuf_putc(StrBuf *sb, char c);
+
+int strbuf_printf(StrBuf *sb, const char *fmt, ...);
+
+// Acrescenta s como string JSON (com aspas e escapes)
+int strbuf_json_string(StrBuf *sb, const char *s, size_t n);
+
+void strbuf_reset(StrBuf *sb);
+
+void strbuf_free(StrBuf *sb);
+
+#endif // STRBUF_H
@@ -0,0 +1,114 @@
+#include "utf8.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static int is_stop(unsigned char c, int stop_non_ascii) {
+    return c == '"' || c == '\\' || (stop_non_ascii && c >= 0x80);
+}
+
+// Trecho ate aspa, barra ou (com stop_non_ascii) byte >= 0x80
+static size_t ascii_span(const char *s, size_t n, int stop_non_ascii) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    // O bit alto de cada byte ja e o proprio teste de "nao ASCII"
+    const __m128i high = _mm_set1_epi8(stop_non_ascii ? (char)0x80 : 0);
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+        int mask = _mm_movemask_epi8(_mm_or_si128(hit, _mm_and_si128(v, high)));
+        if (mask) {
+#if defined(__GNUC__)
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+#else
+            break;
+#endif
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t high = vdupq_n_u8(0x80);
+
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(s + i));
+        uint8x16_t hit = vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash));
+        if (stop_non_ascii) hit = vorrq_u8(hit, vcgeq_u8(v, high));
+        if (vmaxvq_u8(hit)) break;
+    }
+#endif
+
+    while (i < n && !is_stop((unsigned char)s[i], stop_non_ascii)) i++;
+    return i;
+}
+
+int utf8_sequence(const unsigned char *s, size_t n) {
+    unsigned char c = s[0];
+    int len;
+    unsigned char lo = 0x80, hi = 0xBF;     // faixa do segundo byte
+
+    if (c >= 0xC2 && c <= 0xDF) {
+        len = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) lo = 0xA0;           // sem formas longas
+        if (c == 0xED) hi = 0x9F;           // sem surrogates
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;           // ate U+10FFFF
+    } else {
+        return 0;
+    }
+
+    for (int i = 1; i < len; i++) {
+        if ((size_t)i >= n) return -1;
+        unsigned char min = i == 1 ? lo : 0x80;
+        unsigned char max = i == 1 ? hi : 0xBF;
+        if (s[i] < min || s[i] > max) return 0;
+    }
+    return len;
+}
+
+size_t utf8_json_span(const char *s, size_t n, int validate) {
+    if (!validate) return ascii_span(s, n, 0);
+
+    size_t i = 0;
+    for (;;) {
+        i += ascii_span(s + i, n - i, 1);
+        if (i == n || (unsigned char)s[i] < 0x80) return i;
+        int len = utf8_sequence((const unsigned char *)s + i, n - i);
+        if (len <= 0) return i;
+        i += (size_t)len;
+    }
+}
+
+size_t utf8_encode(uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
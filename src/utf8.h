@@ -0,0 +1,31 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// UTF-8 nas strings JSON (--unicode): varredura vetorizada dos trechos ASCII
+// e validacao das sequencias multibyte (RFC 3629)
+
+// Bytes no inicio de s ate a primeira aspa ou barra invertida. Com validate,
+// para tambem numa sequencia UTF-8 invalida ou cortada no fim de s. Os
+// trechos ASCII sao percorridos em blocos de 16 bytes com SSE2/NEON quando
+// disponiveis; so os bytes >= 0x80 sao decodificados.
+size_t utf8_json_span(const char *s, size_t n, int validate);
+
+// Tamanho (2-4) da sequencia valida que comeca em s; 0 se invalida; -1 se
+// s acaba antes do fim de uma sequencia que ate ali e valida
+int utf8_sequence(const unsigned char *s, size_t n);
+
+// Escreve o code point em UTF-8; retorna o numero de bytes (1-4)
+size_t utf8_encode(uint32_t cp, char *out);
+
+// Valor do digito hexadecimal (escapes \uXXXX, &#x...;); -1 se nao for um
+static inline int utf8_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+#endif // UTF8_H
@@ -0,0 +1,150 @@
+#include "watch.h"
+#include "output.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/ioctl.h>
+#endif
+
+#define WATCH_DEFAULT_ROWS 24
+
+void watch_screen_init(WatchScreen *s) {
+    memset(s, 0, sizeof(*s));
+    s->tty = isatty(STDOUT_FILENO);
+
+    if (s->tty) {
+        // Sem quebra automatica: cada linha do quadro ocupa uma linha da tela,
+        // o que permite enderecar as linhas pelo numero
+        out_puts("\033[?7l\033[?25l");
+        out_flush();
+    }
+}
+
+int watch_screen_rows(const WatchScreen *s) {
+    if (!s->tty) return 0;
+
+#ifdef TIOCGWINSZ
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        return ws.ws_row;
+    }
+#endif
+    return WATCH_DEFAULT_ROWS;
+}
+
+void watch_screen_invalidate(WatchScreen *s) {
+    s->drawn = 0;
+}
+
+// Indexa o inicio de cada linha de text
+static int split_lines(size_t **lines, size_t *count, size_t *cap, const char *text, size_t len) {
+    *count = 0;
+    for (size_t i = 0; i < len;) {
+        if (*count == *cap) {
+            size_t ncap = *cap ? *cap * 2 : 64;
+            size_t *n = realloc(*lines, ncap * sizeof(size_t));
+            if (!n) return -1;
+            *lines = n;
+            *cap = ncap;
+        }
+        (*lines)[(*count)++] = i;
+
+        const char *nl = memchr(text + i, '\n', len - i);
+        i = nl ? (size_t)(nl - text) + 1 : len;
+    }
+    return 0;
+}
+
+// Linha i sem a quebra final
+static const char* line_at(const char *text, size_t len, const size_t *lines, size_t count,
+                           size_t i, size_t *n) {
+    size_t end = i + 1 < count ? lines[i + 1] : len;
+    if (end > lines[i] && text[end - 1] == '\n') end--;
+    *n = end - lines[i];
+    return text + lines[i];
+}
+
+static void draw_line(int row, const char *line, size_t n) {
+    out_printf("\033[%d;1H", row);
+    out_write(line, n);
+    // A cor nao vaza para o resto da linha apagada
+    out_color(RESET);
+    out_puts("\033[K");
+}
+
+static size_t update_tty(WatchScreen *s, const char *text, size_t len) {
+    size_t *lines = NULL, count = 0, cap = 0;
+    size_t rewritten = 0;
+    int rows = watch_screen_rows(s);
+
+    if (split_lines(&lines, &count, &cap, text, len) != 0) {
+        free(lines);
+        return 0;
+    }
+    // A ultima linha fica livre para o cursor, senao o terminal rolaria
+    size_t shown = count < (size_t)rows - 1 ? count : (size_t)rows - 1;
+    size_t old_shown = s->line_count < (size_t)rows - 1 ? s->line_count : (size_t)rows - 1;
+
+    if (rows != s->rows) s->drawn = 0;
+    if (!s->drawn) {
+        out_puts("\033[H\033[2J");
+        old_shown = 0;
+    }
+
+    for (size_t i = 0; i < shown; i++) {
+        size_t n, old_n = 0;
+        const char *line = line_at(text, len, lines, count, i, &n);
+        const char *old = NULL;
+
+        if (i < old_shown) {
+            old = line_at(s->frame.data, s->frame.len, s->lines, s->line_count, i, &old_n);
+        }
+        if (old && old_n == n && memcmp(old, line, n) == 0) continue;
+
+        draw_line((int)i + 1, line, n);
+        rewritten++;
+    }
+
+    // Quadro menor que o anterior: apaga o que sobrou
+    if (shown < old_shown) {
+        out_printf("\033[%zu;1H\033[J", shown + 1);
+    }
+    out_printf("\033[%zu;1H", shown + 1);
+    out_flush();
+
+    s->frame.len = 0;
+    strbuf_append(&s->frame, text, len);
+    free(s->lines);
+    s->lines = lines;
+    s->line_count = count;
+    s->line_cap = cap;
+    s->rows = rows;
+    s->drawn = 1;
+    return rewritten;
+}
+
+size_t watch_screen_update(WatchScreen *s, const char *text, size_t len) {
+    if (s->tty) {
+        return update_tty(s, text, len);
+    }
+
+    long before = out_state.lines;
+    if (s->drawn) out_putc('\n');
+    out_write(text, len);
+    if (len > 0 && text[len - 1] != '\n') out_putc('\n');
+    out_flush();
+
+    s->drawn = 1;
+    return (size_t)(out_state.lines - before);
+}
+
+void watch_screen_end(WatchScreen *s) {
+    if (s->tty) {
+        out_puts("\033[?25h\033[?7h");
+        out_flush();
+    }
+    strbuf_free(&s->frame);
+    free(s->lines);
+    memset(s, 0, sizeof(*s));
+}
@@ -0,0 +1,34 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <stddef.h>
+#include "strbuf.h"
+
+// Tela do --watch. Guarda o quadro exibido e, num terminal, reescreve
+// apenas as linhas que mudaram; fora de um terminal cada quadro e impresso
+// inteiro, separado do anterior por uma linha em branco.
+typedef struct {
+    StrBuf frame;       // quadro exibido
+    size_t *lines;      // inicio de cada linha em frame
+    size_t line_count;
+    size_t line_cap;
+    int tty;
+    int rows;           // altura do terminal no ultimo desenho
+    int drawn;          // 0 = proximo quadro limpa a tela
+} WatchScreen;
+
+void watch_screen_init(WatchScreen *s);
+
+// Linhas disponiveis no terminal (0 fora de um terminal)
+int watch_screen_rows(const WatchScreen *s);
+
+// Exibe um quadro; retorna quantas linhas foram reescritas
+size_t watch_screen_update(WatchScreen *s, const char *text, size_t len);
+
+// Forca o redesenho completo no proximo quadro (ex: apos escrever em stderr)
+void watch_screen_invalidate(WatchScreen *s);
+
+// Restaura o terminal e libera o quadro
+void watch_screen_end(WatchScreen *s);
+
+#endif // WATCH_H
@@ -0,0 +1,345 @@
+#include "workers.h"
+#include "output.h"
+#include "strbuf.h"
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
+#ifndef _WIN32
+
+// Fila compartilhada ------------------------------------------------------
+
+// Indices [head, tail) ainda nao pegos. O dono tira do inicio, que e a ordem
+// da lista; os ladroes tiram do fim.
+typedef struct {
+    pthread_mutex_t lock;   // PTHREAD_PROCESS_SHARED
+    size_t head;
+    size_t tail;
+    char pad[64];           // cada fila na sua linha de cache
+} WorkDeque;
+
+typedef struct {
+    int count;
+    WorkDeque deques[];
+} WorkQueue;
+
+static WorkQueue* work_queue_new(int workers, size_t items, size_t *map_len) {
+    *map_len = sizeof(WorkQueue) + (size_t)workers * sizeof(WorkDeque);
+    WorkQueue *q = mmap(NULL, *map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (q == MAP_FAILED) return NULL;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+
+    q->count = workers;
+    for (int w = 0; w < workers; w++) {
+        pthread_mutex_init(&q->deques[w].lock, &attr);
+        q->deques[w].head = items * (size_t)w / (size_t)workers;
+        q->deques[w].tail = items * (size_t)(w + 1) / (size_t)workers;
+    }
+    pthread_mutexattr_destroy(&attr);
+    return q;
+}
+
+static void work_queue_free(WorkQueue *q, size_t map_len) {
+    for (int w = 0; w < q->count; w++) {
+        pthread_mutex_destroy(&q->deques[w].lock);
+    }
+    munmap(q, map_len);
+}
+
+// Proximo indice para o worker self: do proprio bloco ou roubado de outro
+static int work_queue_take(WorkQueue *q, int self, size_t *index) {
+    WorkDeque *own = &q->deques[self];
+
+    pthread_mutex_lock(&own->lock);
+    int found = own->head < own->tail;
+    if (found) *index = own->head++;
+    pthread_mutex_unlock(&own->lock);
+    if (found) return 1;
+
+    // Vitima: quem tem mais itens restantes (leitura sem lock, so estimativa)
+    for (;;) {
+        int victim = -1;
+        size_t most = 0;
+        for (int w = 0; w < q->count; w++) {
+            size_t left = q->deques[w].tail - q->deques[w].head;
+            if (w != self && q->deques[w].head < q->deques[w].tail && left > most) {
+                most = left;
+                victim = w;
+            }
+        }
+        if (victim < 0) return 0;
+
+        WorkDeque *d = &q->deques[victim];
+        pthread_mutex_lock(&d->lock);
+        found = d->head < d->tail;
+        if (found) *index = --d->tail;
+        pthread_mutex_unlock(&d->lock);
+        if (found) return 1;
+    }
+}
+
+// Mensagens worker -> processo principal ------------------------------------
+
+typedef struct {
+    uint64_t index;
+    uint64_t len;           // bytes de saida formatada que seguem
+    uint32_t failed;
+    uint32_t reserved;
+} WorkerMessage;
+
+// Le exatamente len bytes; retorna 0, 1 em EOF logo no inicio ou -1
+static int read_all(int fd, void *data, size_t len) {
+    char *p = data;
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, p + got, len - got);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) return got == 0 ? 1 : -1;
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+// Worker ------------------------------------------------------------------
+
+static int send_result(int fd, size_t index, int failed, const StrBuf *out) {
+    WorkerMessage msg = { .index = index, .len = out->len, .failed = (uint32_t)failed };
+    if (net_write_all(fd, &msg, sizeof(msg)) != 0) return -1;
+    return out->len ? net_write_all(fd, out->data, out->len) : 0;
+}
+
+static void worker_main(int self, int fd, WorkQueue *q, HttpSession *session, const HttpRequest *base,
+                        const char *const *urls, size_t count, const WorkerOptions *opts,
+                        WorkerFormat format, void *userdata) {
+    if (opts->prewarm > 0) {
+        http_session_prewarm(session, urls, count, opts->prewarm);
+    }
+
+    HttpMulti *multi = http_multi_new(session);
+    HttpRequest req = *base;
+    StrBuf out = {0};
+    int alive = multi != NULL;
+
+    while (alive) {
+        size_t index;
+        while (http_multi_pending(multi) < WORKER_TRANSFERS && work_queue_take(q, self, &index)) {
+            req.url = urls[index];
+            if (http_multi_add(multi, &req, (void *)(uintptr_t)index) != 0) {
+                out.len = 0;
+                out_capture(&out);
+                format(index, NULL, userdata);
+                out_capture(NULL);
+                if (send_result(fd, index, 1, &out) != 0) alive = 0;
+            }
+        }
+
+        HttpResponse *resp;
+        void *tag;
+        if (!alive || http_multi_next(multi, &resp, &tag) <= 0) break;
+
+        // A saida do formatador vai para um buffer e depois para o pipe
+        index = (size_t)(uintptr_t)tag;
+        out.len = 0;
+        out_capture(&out);
+        format(index, resp, userdata);
+        out_capture(NULL);
+        out_set_limits(0, 0, 0);
+
+        if (send_result(fd, index, resp == NULL, &out) != 0) alive = 0;
+        http_response_free(resp);
+    }
+
+    http_multi_free(multi);
+    strbuf_free(&out);
+}
+
+// Processo principal --------------------------------------------------------
+
+typedef struct {
+    char *data;
+    size_t len;
+    int done;
+} WorkerResult;
+
+// Escreve um resultado em stdout, com o separador antes de todos menos o
+// primeiro que sai
+static void write_result(const WorkerOptions *opts, int *printed, const char *data, size_t len) {
+    if (len == 0) return;
+    if (*printed && opts->separator) out_puts(opts->separator);
+    out_write(data, len);
+    *printed = 1;
+}
+
+int workers_default_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+int workers_run(HttpSession *session, const HttpRequest *base, const char *const *urls, size_t count,
+                const WorkerOptions *opts, WorkerFormat format, void *userdata) {
+    int workers = opts->workers > 0 ? opts->workers : workers_default_count();
+    if ((size_t)workers > count) workers = (int)count;
+    if (workers < 1) return 0;
+
+    size_t map_len;
+    WorkQueue *q = work_queue_new(workers, count, &map_len);
+    WorkerResult *results = calloc(count, sizeof(WorkerResult));
+    pid_t *pids = calloc((size_t)workers, sizeof(pid_t));
+    struct pollfd *fds = calloc((size_t)workers, sizeof(struct pollfd));
+    if (!q || !results || !pids || !fds) {
+        if (q) work_queue_free(q, map_len);
+        free(results);
+        free(pids);
+        free(fds);
+        return -1;
+    }
+
+    // O que ja esta no buffer de saida nao pode ser herdado pelos workers
+    out_flush();
+    fflush(stderr);
+
+    int started = 0;
+    for (; started < workers; started++) {
+        int p[2];
+        if (pipe(p) != 0) break;
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            close(p[0]);
+            close(p[1]);
+            break;
+        }
+        if (pid == 0) {
+            close(p[0]);
+            for (int w = 0; w < started; w++) close(fds[w].fd);
+            worker_main(started, p[1], q, session, base, urls, count, opts, format, userdata);
+            close(p[1]);
+            _exit(0);   // sem atexit: --stats e os buffers sao do processo principal
+        }
+        close(p[1]);
+        pids[started] = pid;
+        fds[started].fd = p[0];
+        fds[started].events = POLLIN;
+    }
+
+    if (started == 0) {
+        work_queue_free(q, map_len);
+        free(results);
+        free(pids);
+        free(fds);
+        return -1;
+    }
+
+    // Se menos workers subiram, os blocos dos outros ficam na fila e sao
+    // roubados pelos que estao rodando
+
+    size_t next = 0;        // proximo indice a escrever na ordem da lista
+    int printed = 0;
+    int open_fds = started;
+    int failed = 0;
+
+    while (open_fds > 0 && !out_state.broken) {
+        if (poll(fds, (nfds_t)started, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int w = 0; w < started; w++) {
+            if (fds[w].fd < 0 || !(fds[w].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            WorkerMessage msg;
+            char *data = NULL;
+            int r = read_all(fds[w].fd, &msg, sizeof(msg));
+            if (r == 0 && msg.index < count && msg.len > 0) {
+                data = malloc(msg.len);
+                if (!data || read_all(fds[w].fd, data, msg.len) != 0) r = -1;
+            }
+            if (r != 0 || msg.index >= count) {
+                // Worker terminou (ou a mensagem veio quebrada)
+                close(fds[w].fd);
+                fds[w].fd = -1;
+                open_fds--;
+                free(data);
+                continue;
+            }
+
+            failed |= msg.failed != 0;
+
+            if (opts->completion_order) {
+                write_result(opts, &printed, data, msg.len);
+                out_flush();
+                free(data);
+                results[msg.index].done = 1;
+            } else {
+                results[msg.index].data = data;
+                results[msg.index].len = msg.len;
+                results[msg.index].done = 1;
+                while (next < count && results[next].done) {
+                    write_result(opts, &printed, results[next].data, results[next].len);
+                    free(results[next].data);
+                    results[next].data = NULL;
+                    next++;
+                }
+                out_flush();
+            }
+        }
+    }
+
+    // Leitor de stdout foi embora: nao ha para quem formatar
+    if (out_state.broken) {
+        for (int w = 0; w < started; w++) kill(pids[w], SIGTERM);
+    }
+    for (int w = 0; w < started; w++) {
+        if (fds[w].fd >= 0) close(fds[w].fd);
+        int status;
+        while (waitpid(pids[w], &status, 0) < 0 && errno == EINTR) {
+        }
+        if (!out_state.broken && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) failed = 1;
+    }
+
+    // Um worker que morreu deixa buracos: o resto sai na ordem mesmo assim
+    for (size_t i = 0; i < count; i++) {
+        if (!results[i].done && !out_state.broken) failed = 1;
+        if (!out_state.broken && results[i].data) write_result(opts, &printed, results[i].data, results[i].len);
+        free(results[i].data);
+    }
+    out_flush();
+
+    work_queue_free(q, map_len);
+    free(results);
+    free(pids);
+    free(fds);
+    return failed;
+}
+
+#else
+
+int workers_default_count(void) {
+    return 1;
+}
+
+int workers_run(HttpSession *session, const HttpRequest *base, const char *const *urls, size_t count,
+                const WorkerOptions *opts, WorkerFormat format, void *userdata) {
+    (void)session; (void)base; (void)urls; (void)count; (void)opts; (void)format; (void)userdata;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stddef.h>
+#include "http.h"
+
+// Pool de processos para listas grandes de URLs (--workers). Cada worker e um
+// processo com o proprio multi handle e o proprio estado de formatacao, de
+// modo que a formatacao escala com o numero de nucleos. As URLs ficam numa
+// fila em memoria compartilhada: cada worker comeca com um bloco contiguo e,
+// quando o seu acaba, rouba do fim do bloco de quem tem mais trabalho. A
+// saida formatada volta ao processo principal por um pipe e e escrita em
+// stdout na ordem da lista ou na ordem em que fica pronta.
+
+// Requisicoes simultaneas no multi handle de cada worker
+#define WORKER_TRANSFERS 4
+
+typedef struct {
+    int workers;            // processos; 0 = numero de CPUs
+    int prewarm;            // conexoes abertas por host em cada worker
+    int completion_order;   // saida na ordem de conclusao, nao na da lista
+    const char *separator;  // escrito entre dois resultados, na ordem em que saem
+} WorkerOptions;
+
+// Formata uma resposta (NULL se a requisicao falhou) com a camada out_*; roda
+// dentro do worker, com a saida capturada
+typedef void (*WorkerFormat)(size_t index, HttpResponse *resp, void *userdata);
+
+// Numero de CPUs disponiveis
+int workers_default_count(void);
+
+// Executa todas as URLs. A sessao ja resolvida pelo http_session_prewarm e
+// herdada pelos workers. Retorna 0 se todas as requisicoes deram certo, 1 se
+// alguma falhou e -1 se o pool nao pode ser criado (nada foi escrito).
+int workers_run(HttpSession *session, const HttpRequest *base, const char *const *urls, size_t count,
+                const WorkerOptions *opts, WorkerFormat format, void *userdata);
+
+#endif // WORKERS_H